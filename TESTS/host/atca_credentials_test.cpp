@@ -0,0 +1,345 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Host test of the secure element certificate chain stored by
+// mcc_atca_credentials_init(), with the atcacert mock of
+// source/platform/secure_element/host and an in-memory KCM. Each boot prints
+// the I2C blocks of the mock and the KCM writes. The chain is read from the
+// secure element once, later boots do not access it. A chain which does not
+// match the secure element is left as it is and fails the boot until the
+// storage is reset.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "key_config_manager.h"
+#include "storage_kcm.h"
+#include "fcc_defs.h"
+#include "atca_host_mock.h"
+#include "mcc_atca_credentials_init.h"
+
+const char g_fcc_endpoint_parameter_name[] = "mbed.EndpointName";
+const char g_fcc_bootstrap_device_certificate_name[] = "mbed.BootstrapDeviceCert";
+
+// Name of the record, see mcc_atca_credentials_init.c.
+static const char chain_record_name[] = "mcc_atca_chain_record";
+static const char replaced_serial[] = "0123AABBCCDDEEFF11";
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/////////////////
+// In-memory KCM
+/////////////////
+
+struct stored_item {
+    std::string data;
+    bool is_delete_allowed;
+};
+
+struct stored_chain {
+    std::vector<std::string> certs;
+    bool is_delete_allowed;
+};
+
+struct chain_cursor {
+    std::string name;
+    stored_chain chain;
+    size_t next;
+};
+
+typedef std::pair<int, std::string> item_key_t;
+
+static std::map<item_key_t, stored_item> items;
+static std::map<std::string, stored_chain> chains;
+static unsigned long kcm_writes;
+
+static std::string name_of(const uint8_t *name, size_t name_len)
+{
+    return std::string((const char *)name, name_len);
+}
+
+kcm_status_e kcm_item_get_data(const uint8_t *name, size_t name_len, kcm_item_type_e type,
+                               uint8_t *data, size_t max_size, size_t *size)
+{
+    std::map<item_key_t, stored_item>::const_iterator found = items.find(item_key_t(type, name_of(name, name_len)));
+    if (found == items.end()) {
+        return KCM_STATUS_ITEM_NOT_FOUND;
+    }
+    if (found->second.data.size() > max_size) {
+        return KCM_STATUS_INSUFFICIENT_BUFFER;
+    }
+    memcpy(data, found->second.data.data(), found->second.data.size());
+    *size = found->second.data.size();
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_item_delete(const uint8_t *name, size_t name_len, kcm_item_type_e type)
+{
+    std::map<item_key_t, stored_item>::iterator found = items.find(item_key_t(type, name_of(name, name_len)));
+    if (found == items.end()) {
+        return KCM_STATUS_ITEM_NOT_FOUND;
+    }
+    if (!found->second.is_delete_allowed) {
+        return KCM_STATUS_NOT_PERMITTED;
+    }
+    items.erase(found);
+    kcm_writes++;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e storage_item_store(const uint8_t *name, size_t name_len, kcm_item_type_e type, bool is_factory,
+                                storage_item_prefix_type_e prefix, const uint8_t *data, size_t size,
+                                bool is_delete_allowed)
+{
+    (void)is_factory;
+    (void)prefix;
+    const item_key_t key(type, name_of(name, name_len));
+    if (items.count(key)) {
+        return KCM_STATUS_FILE_EXIST;
+    }
+    items[key].data = std::string((const char *)data, size);
+    items[key].is_delete_allowed = is_delete_allowed;
+    kcm_writes++;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e storage_cert_chain_create(kcm_cert_chain_handle *handle, const uint8_t *name, size_t name_len,
+                                       size_t length, bool is_factory, storage_item_prefix_type_e prefix)
+{
+    (void)length;
+    (void)is_factory;
+    (void)prefix;
+    if (chains.count(name_of(name, name_len))) {
+        return KCM_STATUS_FILE_EXIST;
+    }
+    chain_cursor *cursor = new chain_cursor();
+    cursor->name = name_of(name, name_len);
+    cursor->chain.is_delete_allowed = true;
+    cursor->next = 0;
+    *handle = cursor;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e storage_cert_chain_add_next(kcm_cert_chain_handle handle, const uint8_t *data, size_t size,
+                                         storage_item_prefix_type_e prefix, bool is_delete_allowed)
+{
+    (void)prefix;
+    chain_cursor *cursor = (chain_cursor *)handle;
+    cursor->chain.certs.push_back(std::string((const char *)data, size));
+    cursor->chain.is_delete_allowed = cursor->chain.is_delete_allowed && is_delete_allowed;
+    kcm_writes++;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e storage_cert_chain_close(kcm_cert_chain_handle handle, storage_item_prefix_type_e prefix)
+{
+    (void)prefix;
+    chain_cursor *cursor = (chain_cursor *)handle;
+    if (!cursor->chain.certs.empty()) {
+        chains[cursor->name] = cursor->chain;
+    }
+    delete cursor;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_cert_chain_open(kcm_cert_chain_handle *handle, const uint8_t *name, size_t name_len, size_t *length)
+{
+    std::map<std::string, stored_chain>::const_iterator found = chains.find(name_of(name, name_len));
+    if (found == chains.end()) {
+        return KCM_STATUS_ITEM_NOT_FOUND;
+    }
+    chain_cursor *cursor = new chain_cursor();
+    cursor->name = found->first;
+    cursor->chain = found->second;
+    cursor->next = 0;
+    *length = cursor->chain.certs.size();
+    *handle = cursor;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_cert_chain_get_next_size(kcm_cert_chain_handle handle, size_t *size)
+{
+    chain_cursor *cursor = (chain_cursor *)handle;
+    if (cursor->next >= cursor->chain.certs.size()) {
+        return KCM_STATUS_INVALID_PARAMETER;
+    }
+    *size = cursor->chain.certs[cursor->next].size();
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_cert_chain_get_next_data(kcm_cert_chain_handle handle, uint8_t *data, size_t max_size, size_t *size)
+{
+    chain_cursor *cursor = (chain_cursor *)handle;
+    if (cursor->next >= cursor->chain.certs.size()) {
+        return KCM_STATUS_INVALID_PARAMETER;
+    }
+    const std::string &cert = cursor->chain.certs[cursor->next];
+    if (cert.size() > max_size) {
+        return KCM_STATUS_INSUFFICIENT_BUFFER;
+    }
+    memcpy(data, cert.data(), cert.size());
+    *size = cert.size();
+    cursor->next++;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_cert_chain_close(kcm_cert_chain_handle handle)
+{
+    delete (chain_cursor *)handle;
+    return KCM_STATUS_SUCCESS;
+}
+
+/////////////////
+// Boots
+/////////////////
+
+struct boot_result {
+    int res;
+    unsigned long blocks;
+    unsigned long writes;
+};
+
+static double now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static boot_result boot(const char *what)
+{
+    boot_result result;
+
+    kcm_writes = 0;
+    const double start = now_ms();
+    result.res = mcc_atca_credentials_init();
+    result.blocks = atca_host_mock_get_blocks();
+    result.writes = kcm_writes;
+    printf("%-36s res %2d, %5.1f ms, %lu KCM writes, ", what, result.res, now_ms() - start, result.writes);
+    atca_host_mock_print_stats();
+    return result;
+}
+
+static const std::string *stored_leaf()
+{
+    std::map<std::string, stored_chain>::const_iterator found = chains.find(g_fcc_bootstrap_device_certificate_name);
+    return found == chains.end() || found->second.certs.empty() ? NULL : &found->second.certs[0];
+}
+
+static const stored_item *stored_config(const char *name)
+{
+    std::map<item_key_t, stored_item>::const_iterator found = items.find(item_key_t(KCM_CONFIG_ITEM, name));
+    return found == items.end() ? NULL : &found->second;
+}
+
+int main()
+{
+    boot_result result;
+
+    // First boot: the secure element is initialized, its type, serial number
+    // and both certificates are read, the endpoint name, the two certificates
+    // and the record are stored.
+    result = boot("first boot");
+    CHECK(result.res == 0);
+    CHECK(result.blocks == 13);
+    CHECK(result.writes == 4);
+    CHECK(chains.count(g_fcc_bootstrap_device_certificate_name) == 1);
+    CHECK(chains[g_fcc_bootstrap_device_certificate_name].certs.size() == 2);
+    CHECK(!chains[g_fcc_bootstrap_device_certificate_name].is_delete_allowed);
+    const stored_item *endpoint = stored_config(g_fcc_endpoint_parameter_name);
+    CHECK(endpoint != NULL);
+    CHECK(endpoint != NULL && endpoint->data == "sn0123030405060708EE");
+    CHECK(endpoint != NULL && !endpoint->is_delete_allowed);
+    CHECK(stored_config(chain_record_name) != NULL);
+    const std::string leaf = stored_leaf() ? *stored_leaf() : std::string();
+
+    for (int i = 0; i < 2; i++) {
+        result = boot("later boot");
+        CHECK(result.res == 0);
+        CHECK(result.blocks == 0);
+        CHECK(result.writes == 0);
+    }
+
+    // A chain stored by an earlier version, without a record, is compared
+    // with the secure element once.
+    items.erase(item_key_t(KCM_CONFIG_ITEM, chain_record_name));
+    result = boot("chain without record (upgrade)");
+    CHECK(result.res == 0);
+    CHECK(result.blocks == 13);
+    CHECK(result.writes == 1);
+    result = boot("after upgrade");
+    CHECK(result.res == 0);
+    CHECK(result.blocks == 0);
+    CHECK(result.writes == 0);
+
+    // Firmware with other certificate definitions compares the chain once too.
+    items[item_key_t(KCM_CONFIG_ITEM, chain_record_name)].data[ATCA_SERIAL_NUM_SIZE] ^= 0x01;
+    result = boot("record of other definitions");
+    CHECK(result.res == 0);
+    CHECK(result.blocks == 13);
+    CHECK(result.writes == 2);
+    result = boot("after new definitions");
+    CHECK(result.blocks == 0);
+    CHECK(result.writes == 0);
+
+    // A replaced secure element is not noticed while the record is stored.
+    setenv("ATCA_HOST_MOCK_SERIAL", replaced_serial, 1);
+    result = boot("SE replaced, record stored");
+    CHECK(result.res == 0);
+    CHECK(result.blocks == 0);
+
+    // Without the record it is, and the chain is kept until the storage is reset.
+    items.erase(item_key_t(KCM_CONFIG_ITEM, chain_record_name));
+    for (int i = 0; i < 2; i++) {
+        result = boot("SE replaced, record lost");
+        CHECK(result.res != 0);
+        CHECK(result.blocks == 13);
+        CHECK(result.writes == 0);
+        CHECK(stored_leaf() != NULL && *stored_leaf() == leaf);
+        CHECK(stored_config(g_fcc_endpoint_parameter_name) != NULL);
+    }
+
+    items.clear();
+    chains.clear();
+    result = boot("SE replaced, storage reset");
+    CHECK(result.res == 0);
+    CHECK(result.blocks == 13);
+    CHECK(result.writes == 4);
+    CHECK(stored_leaf() != NULL && *stored_leaf() != leaf);
+    result = boot("after storage reset");
+    CHECK(result.res == 0);
+    CHECK(result.blocks == 0);
+    CHECK(result.writes == 0);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Cost of a blink pattern step on the host. A compiled step is an index into
+// blinky_pattern_t, the baseline parsed the next duration from a heap copy of
+// the pattern string with strtol() on every timer event, and copied the
+// string with malloc() on every start.
+//     blinky_pattern_benchmark [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#include "blinky_pattern.h"
+
+typedef std::chrono::steady_clock benchmark_clock;
+
+static volatile uint32_t sink;
+
+static double ns_since(benchmark_clock::time_point start, unsigned long count)
+{
+    return std::chrono::duration<double, std::nano>(benchmark_clock::now() - start).count() / count;
+}
+
+// The baseline Blinky::get_next_int(), -1 at the end of the pattern.
+static int parse_next_step(const char **current)
+{
+    int result = -1;
+    char *endptr;
+    int value = strtol(*current, &endptr, 10);
+
+    if (**current != '\0') {
+        if (*endptr == ':') {
+            endptr += 1;
+            result = value;
+        } else if (*endptr == '\0') {
+            result = value;
+        }
+    }
+    *current = endptr;
+    return result;
+}
+
+static void measure(const std::string &pattern, unsigned long iterations)
+{
+    blinky_pattern_t compiled;
+    if (!blinky_pattern_compile(pattern.data(), pattern.size(), &compiled)) {
+        printf("invalid pattern\n");
+        exit(1);
+    }
+    const unsigned long steps = iterations * compiled.count;
+
+    // Steps of a looping pattern, restarted at the end.
+    benchmark_clock::time_point start = benchmark_clock::now();
+    char *copy = (char *)malloc(pattern.size() + 1);
+    memcpy(copy, pattern.c_str(), pattern.size() + 1);
+    const char *current = copy;
+    for (unsigned long i = 0; i < steps; i++) {
+        int delay = parse_next_step(&current);
+        if (delay < 0) {
+            current = copy;
+            delay = parse_next_step(&current);
+        }
+        sink = delay;
+    }
+    free(copy);
+    const double parsed_step_ns = ns_since(start, steps);
+
+    start = benchmark_clock::now();
+    uint8_t step = 0;
+    for (unsigned long i = 0; i < steps; i++) {
+        if (step >= compiled.count) {
+            step = 0;
+        }
+        sink = compiled.steps[step++];
+    }
+    const double compiled_step_ns = ns_since(start, steps);
+
+    // Starts: the baseline copied the string, now the compiled pattern is copied.
+    start = benchmark_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        char *started = (char *)malloc(pattern.size() + 1);
+        memcpy(started, pattern.c_str(), pattern.size() + 1);
+        sink = started[i % pattern.size()];
+        free(started);
+    }
+    const double parsed_start_ns = ns_since(start, iterations);
+
+    start = benchmark_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        blinky_pattern_t started = compiled;
+        sink = started.steps[i % started.count];
+    }
+    const double compiled_start_ns = ns_since(start, iterations);
+
+    // Compiling is done once, when the resource is written.
+    start = benchmark_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        blinky_pattern_compile(pattern.data(), pattern.size(), &compiled);
+        sink = compiled.count;
+    }
+    const double compile_ns = ns_since(start, iterations);
+
+    printf("%6u %14.1f %14.1f %14.1f %14.1f %12.1f\n", compiled.count, parsed_step_ns, compiled_step_ns,
+           parsed_start_ns, compiled_start_ns, compile_ns);
+}
+
+int main(int argc, char *argv[])
+{
+    const unsigned long iterations = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    std::string pattern;
+
+    printf("%6s %14s %14s %14s %14s %12s\n", "steps", "parsed ns/step", "compiled ns", "parsed ns/start",
+           "compiled ns", "compile ns");
+    measure("500:200:500:200", iterations);
+    for (int i = 0; i < BLINKY_PATTERN_MAX_STEPS; i++) {
+        pattern += (i ? ":" : "");
+        pattern += (i % 2) ? "200" : "86400000";
+    }
+    measure(pattern, iterations / 8);
+    return 0;
+}
@@ -0,0 +1,223 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Host fuzz test of blinky_pattern_compile(). Random, truncated and
+// overlong patterns are compiled and compared with a reference parser built
+// on strtoull(). The inputs are copied to buffers of exactly their length,
+// so a read past the length shows up under AddressSanitizer.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "blinky_pattern.h"
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+// Reference: the steps separated by ':', one trailing ':' allowed.
+static bool reference_compile(const char *pattern, size_t length, std::vector<uint32_t> &steps)
+{
+    std::string text(pattern, strnlen(pattern, length));
+
+    steps.clear();
+    if (!text.empty() && text[text.size() - 1] == ':') {
+        text.erase(text.size() - 1);
+    }
+    if (text.empty()) {
+        return false;
+    }
+
+    size_t begin = 0;
+    for (;;) {
+        size_t end = text.find(':', begin);
+        std::string field = text.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        if (field.empty() || field.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        errno = 0;
+        unsigned long long value = strtoull(field.c_str(), NULL, 10);
+        if (errno == ERANGE || value > BLINKY_PATTERN_MAX_STEP_MS) {
+            return false;
+        }
+        if (steps.size() == BLINKY_PATTERN_MAX_STEPS) {
+            return false;
+        }
+        steps.push_back((uint32_t)value);
+        if (end == std::string::npos) {
+            return true;
+        }
+        begin = end + 1;
+    }
+}
+
+static unsigned long compared;
+
+static void compare(const char *pattern, size_t length)
+{
+    // Exactly length bytes, without a terminator.
+    std::vector<char> buffer(pattern, pattern + length);
+    const char *data = buffer.empty() ? "" : &buffer[0];
+    blinky_pattern_t compiled;
+    std::vector<uint32_t> steps;
+
+    const bool ok = blinky_pattern_compile(data, length, &compiled);
+    const bool expected = reference_compile(data, length, steps);
+
+    compared++;
+    CHECK(ok == expected);
+    if (ok && ok == expected) {
+        CHECK(compiled.count == steps.size());
+        CHECK(memcmp(compiled.steps, &steps[0], steps.size() * sizeof(uint32_t)) == 0);
+    }
+    if (ok != expected) {
+        fprintf(stderr, "pattern \"%.*s\" (%lu bytes)\n", (int)length, data, (unsigned long)length);
+    }
+}
+
+static void compare(const std::string &pattern)
+{
+    compare(pattern.data(), pattern.size());
+}
+
+static std::string repeat_steps(const char *step, int count)
+{
+    std::string pattern;
+    for (int i = 0; i < count; i++) {
+        pattern += (i ? ":" : "");
+        pattern += step;
+    }
+    return pattern;
+}
+
+static void test_valid_patterns(void)
+{
+    blinky_pattern_t compiled;
+
+    CHECK(blinky_pattern_compile("500:200:500", 11, &compiled));
+    CHECK(compiled.count == 3 && compiled.steps[0] == 500 && compiled.steps[1] == 200 && compiled.steps[2] == 500);
+    // Stops at the length, and at a terminator before it.
+    CHECK(blinky_pattern_compile("500:200:500", 4, &compiled));
+    CHECK(compiled.count == 1 && compiled.steps[0] == 500);
+    CHECK(blinky_pattern_compile("100\0:x", 6, &compiled));
+    CHECK(compiled.count == 1 && compiled.steps[0] == 100);
+    CHECK(!blinky_pattern_compile("", 0, &compiled));
+    CHECK(!blinky_pattern_compile(":", 1, &compiled));
+    CHECK(!blinky_pattern_compile("1::2", 4, &compiled));
+    CHECK(!blinky_pattern_compile("-1", 2, &compiled));
+    CHECK(!blinky_pattern_compile(" 1", 2, &compiled));
+}
+
+static void test_durations(void)
+{
+    compare("86400000");
+    compare("86400001");
+    compare("4294967295");
+    compare("4294967296");
+    compare("429496729600");
+    compare("18446744073709551616");
+    compare("99999999999999999999999999999999");
+    compare("000000000000000000000000086400000");
+    compare("1:86400001:1");
+
+    blinky_pattern_t compiled;
+    CHECK(blinky_pattern_compile("86400000", 8, &compiled) && compiled.steps[0] == BLINKY_PATTERN_MAX_STEP_MS);
+    CHECK(!blinky_pattern_compile("4294967296", 10, &compiled));
+}
+
+static void test_step_count(void)
+{
+    const std::string full = repeat_steps("10", BLINKY_PATTERN_MAX_STEPS);
+    const std::string over = repeat_steps("10", BLINKY_PATTERN_MAX_STEPS + 1);
+    blinky_pattern_t compiled;
+
+    CHECK(blinky_pattern_compile(full.data(), full.size(), &compiled) && compiled.count == BLINKY_PATTERN_MAX_STEPS);
+    CHECK(!blinky_pattern_compile(over.data(), over.size(), &compiled));
+    compare(full);
+    compare(full + ":");
+    compare(over);
+    compare(over + ":");
+    compare(repeat_steps("1", 1000));
+}
+
+static void test_truncated(void)
+{
+    const std::string patterns[] = {
+        "500:200:500",
+        "86400000:1:86400001",
+        repeat_steps("7", BLINKY_PATTERN_MAX_STEPS + 1),
+        "1:2:x:3",
+    };
+
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        for (size_t length = 0; length <= patterns[i].size(); length++) {
+            compare(patterns[i].data(), length);
+        }
+    }
+}
+
+static void test_random(unsigned long count)
+{
+    static const char alphabet[] = "0123456789:::";
+    unsigned long accepted = 0;
+
+    srand(1);
+    for (unsigned long n = 0; n < count; n++) {
+        const size_t length = rand() % 120;
+        std::string pattern(length, '0');
+        for (size_t i = 0; i < length; i++) {
+            // Mostly pattern characters, sometimes any byte.
+            pattern[i] = (rand() % 50) ? alphabet[rand() % (sizeof(alphabet) - 1)] : (char)(rand() & 0xFF);
+        }
+        blinky_pattern_t compiled;
+        accepted += blinky_pattern_compile(pattern.data(), pattern.size(), &compiled);
+        compare(pattern);
+    }
+    fprintf(stderr, "random: %lu patterns, %lu accepted\n", count, accepted);
+    CHECK(accepted > 0 && accepted < count);
+}
+
+int main(int argc, char *argv[])
+{
+    const unsigned long count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+
+    // The parser prints why a pattern is rejected, keep the results readable.
+    if (!freopen("/dev/null", "w", stdout)) {
+        return 1;
+    }
+
+    test_valid_patterns();
+    test_durations();
+    test_step_count();
+    test_truncated();
+    test_random(count);
+
+    fprintf(stderr, "compared: %lu\n", compared);
+    fprintf(stderr, "%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
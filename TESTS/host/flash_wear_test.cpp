@@ -0,0 +1,157 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Host test of the flash wear accounting of the memory mapped internal flash
+// simulator. An operation which erases is one compaction, with the duration
+// of the whole operation as its stall, and the trace records it for
+// utils/flash_wear_replay.py. The flash and trace files are written to the
+// working directory.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "pal_plat_internal_flash.h"
+#include "flash_wear.h"
+
+#define TRACE_FILE "flash_wear_trace.csv"
+#define SECTOR_SIZE 0x1000
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+struct trace_row {
+    std::string subsystem;
+    std::string op;
+    unsigned long address;
+    unsigned long size;
+    unsigned long stall_us;
+};
+
+static std::vector<trace_row> read_trace(void)
+{
+    std::vector<trace_row> rows;
+    char line[256];
+    FILE *trace = fopen(TRACE_FILE, "r");
+
+    if (!trace) {
+        return rows;
+    }
+    // Skip the header.
+    if (fgets(line, sizeof(line), trace)) {
+        CHECK(strcmp(line, "time_us,subsystem,op,address,size,stall_us\n") == 0);
+    }
+    while (fgets(line, sizeof(line), trace)) {
+        char subsystem[32];
+        char op[32];
+        trace_row row;
+        if (sscanf(line, "%*lu,%31[^,],%31[^,],%lu,%lu,%lu", subsystem, op, &row.address, &row.size, &row.stall_us) == 5) {
+            row.subsystem = subsystem;
+            row.op = op;
+            rows.push_back(row);
+        }
+    }
+    fclose(trace);
+    return rows;
+}
+
+static std::vector<trace_row> compactions(const std::vector<trace_row> &rows)
+{
+    std::vector<trace_row> found;
+
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (rows[i].op == "compaction") {
+            found.push_back(rows[i]);
+        }
+    }
+    return found;
+}
+
+static void program(uint32_t address)
+{
+    uint32_t data[16];
+
+    memset(data, 0x5A, sizeof(data));
+    CHECK(pal_plat_internalFlashWrite(sizeof(data), address, data) == PAL_SUCCESS);
+}
+
+int main()
+{
+    unlink("internal_flash.bin");
+    unlink(TRACE_FILE);
+    setenv("PAL_FLASH_WEAR_TRACE", TRACE_FILE, 1);
+    CHECK(pal_plat_internalFlashInit() == PAL_SUCCESS);
+
+    // A SOTP write which compacts: the stall covers the copy after the erase.
+    flash_wear_subsystem_e previous = flash_wear_enter(FLASH_WEAR_FCC);
+    flash_wear_operation_begin();
+    program(0);
+    CHECK(pal_plat_internalFlashErase(SECTOR_SIZE, 2 * SECTOR_SIZE) == PAL_SUCCESS);
+    usleep(20000);
+    program(SECTOR_SIZE);
+    flash_wear_operation_end();
+    flash_wear_leave(previous);
+
+    // A write which does not erase, and an erase outside of any operation.
+    flash_wear_operation_begin();
+    program(64);
+    flash_wear_operation_end();
+    CHECK(pal_plat_internalFlashErase(0, SECTOR_SIZE) == PAL_SUCCESS);
+
+    // Nested operations are one compaction, ended by the outermost end.
+    flash_wear_operation_begin();
+    flash_wear_operation_begin();
+    CHECK(pal_plat_internalFlashErase(4 * SECTOR_SIZE, SECTOR_SIZE) == PAL_SUCCESS);
+    flash_wear_operation_end();
+    usleep(10000);
+    CHECK(pal_plat_internalFlashErase(5 * SECTOR_SIZE, SECTOR_SIZE) == PAL_SUCCESS);
+    flash_wear_operation_end();
+
+    // An unmatched end is ignored.
+    flash_wear_operation_end();
+
+    CHECK(pal_plat_internalFlashDeInit() == PAL_SUCCESS);
+
+    const std::vector<trace_row> rows = read_trace();
+    const std::vector<trace_row> found = compactions(rows);
+    CHECK(rows.size() == 9);
+    CHECK(found.size() == 2);
+    if (found.size() == 2) {
+        CHECK(found[0].subsystem == "fcc");
+        CHECK(found[0].address == SECTOR_SIZE);
+        CHECK(found[0].size == 2 * SECTOR_SIZE);
+        CHECK(found[0].stall_us >= 20000);
+        CHECK(found[1].subsystem == "other");
+        CHECK(found[1].address == 4 * SECTOR_SIZE);
+        CHECK(found[1].size == 2 * SECTOR_SIZE);
+        CHECK(found[1].stall_us >= 10000);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,549 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Benchmark of the memory mapped internal flash simulator,
+// source/platform/Linux/pal_plat_internal_flash_mmap.c, against the file
+// system simulator of PAL, which opens the flash file for every access.
+//
+// Both backends are driven by the same model of SOTP, the only user of the
+// internal flash on Linux: records of an 8 byte header and 8 byte aligned
+// data, in two areas which are compacted into each other when full. The
+// boot is timed with the startup profiler in a fresh process per run:
+// platform_init maps or opens the flash and scans the SOTP area as
+// sotp_init() does, and application_init reads the credentials checked at
+// boot. Every credential read is a KCM item file read plus a SOTP read of
+// the root of trust, which ESFS needs to decrypt the item. The item files
+// are the same for both backends.
+//
+// The flash and item files are written to the working directory. Run from
+// the build directory, optionally with the number of boots per backend:
+//     build-host-tests/internal_flash_mmap_benchmark [boots]
+//
+// On a device, compare the "Startup profile:" line of the example built
+// with and without -DPAL_FLASH_OVER_MMAP=ON for the whole client.
+
+#include "pal.h"
+#include "pal_plat_internal_flash.h"
+#include "startup_profiler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <vector>
+
+#define FLASH_SIZE          0x10000
+#define SECTOR_SIZE         0x1000
+#define AREA_SIZE           0x2000
+#define AREA_ADDRESS(area)  ((area) * 0x8000)
+
+#define FILE_FLASH_NAME     "internal_flash_file.bin"
+
+// SOTP types kept on Linux, with their data sizes.
+enum {
+    SOTP_TYPE_ROT,
+    SOTP_TYPE_FACTORY_DONE,
+    SOTP_TYPE_ENTROPY,
+    SOTP_TYPE_SAVED_TIME,
+    SOTP_TYPE_LAST_TIME_BACK,
+    SOTP_TYPE_TRUSTED_TIME_SRV_ID,
+    SOTP_TYPES,
+    SOTP_TYPE_AREA_HEADER = 0xF
+};
+
+static const uint16_t sotp_sizes[SOTP_TYPES] = { 16, 4, 48, 8, 8, 64 };
+
+// Saved time updates before the boot, they leave stale records to scan.
+#define SAVED_TIME_UPDATES  300
+
+// Items read by fcc_verify_device_configured_4mbed_cloud() and registration.
+#define CREDENTIAL_ITEMS    16
+#define CREDENTIAL_SIZE     640
+
+#define DEFAULT_BOOTS       21
+#define CREDENTIAL_READS    10000
+
+#define SOTP_READ_CHUNK     32
+
+typedef struct {
+    uint16_t type;
+    uint16_t length;
+    uint32_t crc;
+} sotp_header_t;
+
+typedef struct {
+    const char *name;
+    palStatus_t (*init)(void);
+    palStatus_t (*deinit)(void);
+    palStatus_t (*read)(const size_t size, const uint32_t address, uint32_t *buffer);
+    palStatus_t (*write)(const size_t size, const uint32_t address, const uint32_t *buffer);
+    palStatus_t (*erase)(uint32_t address, size_t size);
+} flash_backend_t;
+
+/* File system simulator, every access opens the flash file */
+
+static int file_access(bool write, uint32_t address, void *data, size_t size)
+{
+    const int fd = open(FILE_FLASH_NAME, write ? O_RDWR : O_RDONLY);
+    ssize_t done = -1;
+
+    if (fd < 0) {
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    done = write ? pwrite(fd, data, size, address) : pread(fd, data, size, address);
+    close(fd);
+    return (done == (ssize_t)size) ? PAL_SUCCESS : PAL_ERR_GENERIC_FAILURE;
+}
+
+static palStatus_t file_init(void)
+{
+    static uint8_t erased[FLASH_SIZE];
+    const int fd = open(FILE_FLASH_NAME, O_RDWR | O_CREAT, 0600);
+    off_t size;
+
+    if (fd < 0) {
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    size = lseek(fd, 0, SEEK_END);
+    if (size < FLASH_SIZE) {
+        memset(erased, 0xFF, sizeof(erased));
+        if (pwrite(fd, erased, FLASH_SIZE, 0) != FLASH_SIZE) {
+            size = -1;
+        }
+    }
+    close(fd);
+    return (size < 0) ? PAL_ERR_GENERIC_FAILURE : PAL_SUCCESS;
+}
+
+static palStatus_t file_deinit(void)
+{
+    return PAL_SUCCESS;
+}
+
+static palStatus_t file_read(const size_t size, const uint32_t address, uint32_t *buffer)
+{
+    return file_access(false, address, buffer, size);
+}
+
+static palStatus_t file_write(const size_t size, const uint32_t address, const uint32_t *buffer)
+{
+    return file_access(true, address, (void *)buffer, size);
+}
+
+static palStatus_t file_erase(uint32_t address, size_t size)
+{
+    static uint8_t erased[SECTOR_SIZE];
+
+    memset(erased, 0xFF, sizeof(erased));
+    for (size_t offset = 0; offset < size; offset += SECTOR_SIZE) {
+        if (file_access(true, address + offset, erased, SECTOR_SIZE) != PAL_SUCCESS) {
+            return PAL_ERR_GENERIC_FAILURE;
+        }
+    }
+    return PAL_SUCCESS;
+}
+
+static const flash_backend_t backends[] = {
+    { "file", file_init, file_deinit, file_read, file_write, file_erase },
+    {
+        "mmap", pal_plat_internalFlashInit, pal_plat_internalFlashDeInit, pal_plat_internalFlashRead,
+        pal_plat_internalFlashWrite, pal_plat_internalFlashErase
+    },
+};
+
+/* SOTP model */
+
+static const flash_backend_t *flash;
+static uint32_t active_area;
+static uint32_t free_offset;
+static uint32_t record_offsets[SOTP_TYPES];
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    static uint32_t table[256];
+
+    if (!table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++) {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t padded(uint32_t size)
+{
+    return (size + 7) & ~7u;
+}
+
+// Program data before the header, so a torn record reads as blank or bad.
+static int sotp_program(uint32_t area, uint32_t offset, uint16_t type, const void *data, uint16_t length)
+{
+    uint64_t buffer[128 / sizeof(uint64_t)] = { 0 };
+    sotp_header_t header = { type, length, 0 };
+
+    memcpy(buffer, data, length);
+    header.crc = crc32(crc32(0, (const uint8_t *)&header, 4), (const uint8_t *)data, length);
+    if (flash->write(padded(length), AREA_ADDRESS(area) + offset + sizeof(header), (const uint32_t *)buffer) != PAL_SUCCESS ||
+            flash->write(sizeof(header), AREA_ADDRESS(area) + offset, (const uint32_t *)&header) != PAL_SUCCESS) {
+        return -1;
+    }
+    return 0;
+}
+
+// Read the record at offset and check its CRC, reading the data in chunks.
+static int sotp_read_record(uint32_t area, uint32_t offset, sotp_header_t *header, uint8_t *data)
+{
+    uint32_t chunk[SOTP_READ_CHUNK / sizeof(uint32_t)];
+    uint32_t crc;
+
+    if (flash->read(sizeof(*header), AREA_ADDRESS(area) + offset, (uint32_t *)header) != PAL_SUCCESS) {
+        return -1;
+    }
+    if (header->type == 0xFFFF) {
+        return 1;
+    }
+    crc = crc32(0, (const uint8_t *)header, 4);
+    for (uint32_t done = 0; done < padded(header->length); done += SOTP_READ_CHUNK) {
+        const uint32_t size = std::min<uint32_t>(SOTP_READ_CHUNK, padded(header->length) - done);
+        if (flash->read(size, AREA_ADDRESS(area) + offset + sizeof(*header) + done, chunk) != PAL_SUCCESS) {
+            return -1;
+        }
+        const uint32_t valid = (done < header->length) ? std::min<uint32_t>(size, header->length - done) : 0;
+        crc = crc32(crc, (const uint8_t *)chunk, valid);
+        if (data) {
+            memcpy(data + done, chunk, valid);
+        }
+    }
+    return (crc == header->crc) ? 0 : -1;
+}
+
+// Pick the area with the newer header and index its records, as sotp_init() does.
+static int sotp_init(void)
+{
+    uint32_t versions[2] = { 0, 0 };
+    sotp_header_t header;
+
+    for (uint32_t area = 0; area < 2; area++) {
+        uint32_t version;
+        if (sotp_read_record(area, 0, &header, (uint8_t *)&version) == 0 && header.type == SOTP_TYPE_AREA_HEADER) {
+            versions[area] = version;
+        }
+    }
+    if (!versions[0] && !versions[1]) {
+        const uint32_t version = 1;
+        active_area = 0;
+        if (flash->erase(AREA_ADDRESS(0), AREA_SIZE) != PAL_SUCCESS ||
+                sotp_program(0, 0, SOTP_TYPE_AREA_HEADER, &version, sizeof(version)) != 0) {
+            return -1;
+        }
+    } else {
+        active_area = (versions[1] > versions[0]) ? 1 : 0;
+    }
+
+    memset(record_offsets, 0, sizeof(record_offsets));
+    free_offset = sizeof(header) + padded(sizeof(uint32_t));
+    while (free_offset + sizeof(header) <= AREA_SIZE) {
+        const int result = sotp_read_record(active_area, free_offset, &header, NULL);
+        if (result == 1) {
+            break;
+        }
+        if (result != 0 || header.type >= SOTP_TYPES) {
+            return -1;
+        }
+        record_offsets[header.type] = free_offset;
+        free_offset += sizeof(header) + padded(header.length);
+    }
+    return 0;
+}
+
+static int sotp_get(uint16_t type, void *data)
+{
+    sotp_header_t header;
+
+    if (!record_offsets[type]) {
+        return -1;
+    }
+    return sotp_read_record(active_area, record_offsets[type], &header, (uint8_t *)data);
+}
+
+// Copy the newest records into the other area, then switch to it.
+static int sotp_compact(void)
+{
+    const uint32_t target = 1 - active_area;
+    uint8_t data[128];
+    uint32_t version;
+    sotp_header_t header;
+    uint32_t offset = sizeof(header) + padded(sizeof(uint32_t));
+
+    if (sotp_read_record(active_area, 0, &header, (uint8_t *)&version) != 0 ||
+            flash->erase(AREA_ADDRESS(target), AREA_SIZE) != PAL_SUCCESS) {
+        return -1;
+    }
+    for (uint16_t type = 0; type < SOTP_TYPES; type++) {
+        if (!record_offsets[type]) {
+            continue;
+        }
+        if (sotp_read_record(active_area, record_offsets[type], &header, data) != 0 ||
+                sotp_program(target, offset, type, data, header.length) != 0) {
+            return -1;
+        }
+        record_offsets[type] = offset;
+        offset += sizeof(header) + padded(header.length);
+    }
+    version++;
+    if (sotp_program(target, 0, SOTP_TYPE_AREA_HEADER, &version, sizeof(version)) != 0) {
+        return -1;
+    }
+    active_area = target;
+    free_offset = offset;
+    return 0;
+}
+
+static int sotp_set(uint16_t type, const void *data)
+{
+    const uint32_t size = sizeof(sotp_header_t) + padded(sotp_sizes[type]);
+
+    if (free_offset + size > AREA_SIZE && sotp_compact() != 0) {
+        return -1;
+    }
+    if (sotp_program(active_area, free_offset, type, data, sotp_sizes[type]) != 0) {
+        return -1;
+    }
+    record_offsets[type] = free_offset;
+    free_offset += size;
+    return 0;
+}
+
+/* Credentials */
+
+static void credential_name(int item, char *name, size_t size)
+{
+    snprintf(name, size, "kcm_item_%d.bin", item);
+}
+
+// A KCM item read through ESFS: the root of trust, then the item file.
+static int credential_read(int item, uint8_t *data)
+{
+    uint8_t rot[16];
+    char name[32];
+
+    if (sotp_get(SOTP_TYPE_ROT, rot) != 0) {
+        return -1;
+    }
+    credential_name(item, name, sizeof(name));
+    const int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    const ssize_t size = read(fd, data, CREDENTIAL_SIZE);
+    close(fd);
+    return (size == CREDENTIAL_SIZE && data[0] == (uint8_t)(item ^ rot[0])) ? 0 : -1;
+}
+
+// Fresh flash of both backends with the same SOTP contents, and the item files.
+static int provision(void)
+{
+    uint8_t data[128];
+    uint8_t item[CREDENTIAL_SIZE];
+    char name[32];
+
+    unlink(FILE_FLASH_NAME);
+    unlink("internal_flash.bin");
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        flash = &backends[i];
+        if (flash->init() != PAL_SUCCESS || sotp_init() != 0) {
+            return -1;
+        }
+        for (uint16_t type = 0; type < SOTP_TYPES; type++) {
+            memset(data, 0x40 + type, sizeof(data));
+            if (sotp_set(type, data) != 0) {
+                return -1;
+            }
+        }
+        for (uint32_t i = 0; i < SAVED_TIME_UPDATES; i++) {
+            uint64_t saved_time = 1700000000 + i;
+            if (sotp_set(SOTP_TYPE_SAVED_TIME, &saved_time) != 0) {
+                return -1;
+            }
+        }
+        flash->deinit();
+    }
+
+    for (int i = 0; i < CREDENTIAL_ITEMS; i++) {
+        memset(item, i ^ 0x40, sizeof(item));
+        credential_name(i, name, sizeof(name));
+        const int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0 || write(fd, item, sizeof(item)) != (ssize_t)sizeof(item)) {
+            return -1;
+        }
+        close(fd);
+    }
+    return 0;
+}
+
+/* Boot, in a child process so the profiler starts over */
+
+static void boot(const flash_backend_t *backend, int output)
+{
+    char profile[STARTUP_PROFILER_FORMAT_SIZE];
+    uint8_t data[CREDENTIAL_SIZE];
+    uint64_t saved_time = 0;
+    int result = 0;
+
+    flash = backend;
+    startup_profiler_begin(STARTUP_PHASE_PLATFORM_INIT);
+    if (flash->init() != PAL_SUCCESS || sotp_init() != 0 || sotp_get(SOTP_TYPE_SAVED_TIME, &saved_time) != 0) {
+        result = -1;
+    }
+    startup_profiler_end(STARTUP_PHASE_PLATFORM_INIT);
+
+    startup_profiler_begin(STARTUP_PHASE_APPLICATION_INIT);
+    for (int i = 0; i < CREDENTIAL_ITEMS && result == 0; i++) {
+        result = credential_read(i, data);
+    }
+    startup_profiler_end(STARTUP_PHASE_APPLICATION_INIT);
+
+    flash->deinit();
+    if (result != 0 || saved_time != 1700000000 + SAVED_TIME_UPDATES - 1) {
+        strcpy(profile, "failed");
+    } else {
+        startup_profiler_format(profile, sizeof(profile));
+    }
+    if (write(output, profile, strlen(profile) + 1) < 0) {
+        _exit(1);
+    }
+    // Skip the wear report of the mmap backend.
+    _exit(0);
+}
+
+static uint64_t profile_value(const char *profile, const char *key)
+{
+    const char *found = strstr(profile, key);
+    return found ? strtoull(found + strlen(key), NULL, 10) : 0;
+}
+
+static int measure_boots(const flash_backend_t *backend, int boots)
+{
+    std::vector<uint64_t> platform_init;
+    std::vector<uint64_t> application_init;
+    char profile[STARTUP_PROFILER_FORMAT_SIZE] = "";
+
+    for (int i = 0; i < boots; i++) {
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0) {
+            return -1;
+        }
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(pipe_fds[0]);
+            boot(backend, pipe_fds[1]);
+        }
+        close(pipe_fds[1]);
+        const ssize_t size = read(pipe_fds[0], profile, sizeof(profile) - 1);
+        close(pipe_fds[0]);
+        waitpid(pid, NULL, 0);
+        profile[(size > 0) ? size : 0] = '\0';
+        if (profile[0] != '{') {
+            printf("%s: boot %d failed\n", backend->name, i);
+            return -1;
+        }
+        platform_init.push_back(profile_value(profile, "\"platform_init\":"));
+        application_init.push_back(profile_value(profile, "\"application_init\":"));
+    }
+
+    std::sort(platform_init.begin(), platform_init.end());
+    std::sort(application_init.begin(), application_init.end());
+    printf("%-6s %18lu %21lu   last %s\n", backend->name,
+           (unsigned long)platform_init[boots / 2], (unsigned long)application_init[boots / 2], profile);
+    return 0;
+}
+
+static int measure_credential_reads(const flash_backend_t *backend)
+{
+    uint8_t data[CREDENTIAL_SIZE];
+
+    flash = backend;
+    if (flash->init() != PAL_SUCCESS || sotp_init() != 0) {
+        return -1;
+    }
+    const uint64_t start_us = startup_profiler_time_us();
+    for (int i = 0; i < CREDENTIAL_READS; i++) {
+        if (credential_read(i % CREDENTIAL_ITEMS, data) != 0) {
+            return -1;
+        }
+    }
+    const uint64_t elapsed_us = startup_profiler_time_us() - start_us;
+
+    uint8_t rot[16];
+    const uint64_t rot_start_us = startup_profiler_time_us();
+    for (int i = 0; i < CREDENTIAL_READS; i++) {
+        if (sotp_get(SOTP_TYPE_ROT, rot) != 0) {
+            return -1;
+        }
+    }
+    const uint64_t rot_elapsed_us = startup_profiler_time_us() - rot_start_us;
+    flash->deinit();
+
+    printf("%-6s %18.2f %21.2f\n", backend->name, (double)elapsed_us / CREDENTIAL_READS,
+           (double)rot_elapsed_us / CREDENTIAL_READS);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const int boots = (argc > 1) ? atoi(argv[1]) : DEFAULT_BOOTS;
+
+    if (boots < 1 || provision() != 0) {
+        printf("provisioning failed, errno %d\n", errno);
+        return 1;
+    }
+
+    printf("Boot, median of %d, us: %d SOTP records, %d credentials\n", boots,
+           SOTP_TYPES + SAVED_TIME_UPDATES, CREDENTIAL_ITEMS);
+    printf("%-6s %18s %21s\n", "flash", "platform_init", "application_init");
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        if (measure_boots(&backends[i], boots) != 0) {
+            return 1;
+        }
+    }
+
+    printf("\nCredential access, mean of %d, us\n", CREDENTIAL_READS);
+    printf("%-6s %18s %21s\n", "flash", "KCM item read", "root of trust read");
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        if (measure_credential_reads(&backends[i]) != 0) {
+            printf("%s: credential read failed\n", backends[i].name);
+            return 1;
+        }
+    }
+    // Skip the wear report of the provisioning.
+    fflush(stdout);
+    _exit(0);
+}
@@ -0,0 +1,320 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Host test of the METER delta base, source/meter_fw.cpp, and a comparison of
+// a delta update with a full one.
+//
+// The reader and the digest are checked against a meter_fw.bin fixture. Then
+// a new image is installed twice: once from the full image, and once from a
+// patch applied over the base read through meter_fw_read() in small pieces,
+// as the FOTA delta engine does. The delta engine of the client is not
+// built here, the patch is a plain list of copy and insert operations, so
+// the patch size is an upper bound of what a compressed delta would carry.
+//     meter_fw_test [image KiB]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "meter_fw.h"
+#include "fota/fota_crypto.h"
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef std::vector<uint8_t> bytes_t;
+typedef std::chrono::steady_clock test_clock;
+
+static const char candidate_file_name[] = "meter_fw_candidate.bin";
+
+// The delta engine reads the base in pieces of this size.
+#define BASE_READ_SIZE 512
+
+// Patch matching granularity.
+#define PATCH_BLOCK_SIZE 64
+
+static double ms_since(test_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(test_clock::now() - start).count();
+}
+
+static bytes_t sha256(const bytes_t &data)
+{
+    mbedtls_sha256_context ctx;
+    bytes_t digest(32);
+
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    mbedtls_sha256_update_ret(&ctx, data.data(), data.size());
+    mbedtls_sha256_finish_ret(&ctx, digest.data());
+    return digest;
+}
+
+static void write_file(const char *name, const bytes_t &data)
+{
+    FILE *file = fopen(name, "wb");
+    CHECK(file && fwrite(data.data(), 1, data.size(), file) == data.size());
+    if (file) {
+        fclose(file);
+    }
+}
+
+static bytes_t installed_digest(void)
+{
+    bytes_t digest(FOTA_CRYPTO_HASH_SIZE);
+    CHECK(meter_fw_get_digest(digest.data()) == FOTA_STATUS_SUCCESS);
+    return digest;
+}
+
+// Firmware-like content: repeated records with counters, not compressible to nothing.
+static bytes_t make_image(size_t size, uint32_t seed)
+{
+    bytes_t image(size);
+    uint32_t state = seed;
+
+    for (size_t i = 0; i < size; i++) {
+        if (i % 16 < 4) {
+            image[i] = (uint8_t)((i / 16) >> (8 * (i % 4)));
+        } else {
+            state = state * 1103515245 + 12345;
+            image[i] = (uint8_t)(state >> 16);
+        }
+    }
+    return image;
+}
+
+// The next version: a few patched ranges, an inserted function and a removed one.
+static bytes_t make_next_image(const bytes_t &base)
+{
+    bytes_t next(base);
+
+    for (size_t at = 4096; at + 32 < next.size(); at += next.size() / 7) {
+        for (size_t i = 0; i < 32; i++) {
+            next[at + i] ^= 0x5A;
+        }
+    }
+    const bytes_t inserted = make_image(2048, 7);
+    next.insert(next.begin() + next.size() / 3, inserted.begin(), inserted.end());
+    next.erase(next.begin() + 2 * next.size() / 3, next.begin() + 2 * next.size() / 3 + 1024);
+    return next;
+}
+
+/////////////////
+// Patch: [op][offset or length]..., op 'C' copies from the base, 'I' inserts literal bytes.
+/////////////////
+
+static void put_u32(bytes_t &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static uint32_t get_u32(const bytes_t &in, size_t &pos)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)in[pos++] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t block_key(const uint8_t *data)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < PATCH_BLOCK_SIZE; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void flush_insert(bytes_t &patch, const bytes_t &next, size_t from, size_t to)
+{
+    if (to > from) {
+        patch.push_back('I');
+        put_u32(patch, (uint32_t)(to - from));
+        patch.insert(patch.end(), next.begin() + from, next.begin() + to);
+    }
+}
+
+static bytes_t make_patch(const bytes_t &base, const bytes_t &next)
+{
+    std::map<uint64_t, size_t> blocks;
+    bytes_t patch;
+    size_t literal = 0;
+    size_t pos = 0;
+
+    for (size_t offset = 0; offset + PATCH_BLOCK_SIZE <= base.size(); offset += PATCH_BLOCK_SIZE) {
+        blocks.insert(std::make_pair(block_key(&base[offset]), offset));
+    }
+    while (pos + PATCH_BLOCK_SIZE <= next.size()) {
+        std::map<uint64_t, size_t>::const_iterator found = blocks.find(block_key(&next[pos]));
+        if (found == blocks.end() || memcmp(&base[found->second], &next[pos], PATCH_BLOCK_SIZE) != 0) {
+            pos++;
+            continue;
+        }
+        size_t from = found->second;
+        size_t length = PATCH_BLOCK_SIZE;
+        while (from + length < base.size() && pos + length < next.size() && base[from + length] == next[pos + length]) {
+            length++;
+        }
+        flush_insert(patch, next, literal, pos);
+        patch.push_back('C');
+        put_u32(patch, (uint32_t)from);
+        put_u32(patch, (uint32_t)length);
+        pos += length;
+        literal = pos;
+    }
+    flush_insert(patch, next, literal, next.size());
+    return patch;
+}
+
+// Applies the patch into the candidate file, reading the base with meter_fw_read().
+static bool apply_patch(const bytes_t &patch, unsigned long *base_reads)
+{
+    FILE *out = fopen(candidate_file_name, "wb");
+    uint8_t piece[BASE_READ_SIZE];
+    size_t pos = 0;
+    bool ok = (out != NULL);
+
+    while (ok && pos < patch.size()) {
+        const uint8_t op = patch[pos++];
+        if (op == 'C') {
+            size_t offset = get_u32(patch, pos);
+            size_t length = get_u32(patch, pos);
+            while (ok && length > 0) {
+                size_t num_read = 0;
+                size_t size = (length < sizeof(piece)) ? length : sizeof(piece);
+                ok = meter_fw_read(piece, offset, size, &num_read) == FOTA_STATUS_SUCCESS && num_read == size &&
+                     fwrite(piece, 1, size, out) == size;
+                (*base_reads)++;
+                offset += size;
+                length -= size;
+            }
+        } else if (op == 'I') {
+            size_t length = get_u32(patch, pos);
+            ok = fwrite(&patch[pos], 1, length, out) == length;
+            pos += length;
+        } else {
+            ok = false;
+        }
+    }
+    if (out && fclose(out) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+static void test_reader(const bytes_t &image)
+{
+    write_file(METER_FW_FILE, image);
+    meter_fw_close();
+
+    // Pieces at random offsets, as the delta engine reads the base.
+    srand(1);
+    for (int i = 0; i < 2000; i++) {
+        const size_t offset = rand() % (image.size() + 100);
+        const size_t size = 1 + rand() % 1024;
+        uint8_t piece[1024];
+        size_t num_read = 12345;
+        CHECK(meter_fw_read(piece, offset, size, &num_read) == FOTA_STATUS_SUCCESS);
+        const size_t expected = (offset >= image.size()) ? 0 :
+                                (offset + size > image.size()) ? image.size() - offset : size;
+        CHECK(num_read == expected);
+        CHECK(num_read == 0 || memcmp(piece, &image[offset], num_read) == 0);
+    }
+
+    CHECK(installed_digest() == sha256(image));
+
+    // No installed image: the read fails, and so does the digest.
+    meter_fw_close();
+    remove(METER_FW_FILE);
+    uint8_t piece[16];
+    size_t num_read = 0;
+    CHECK(meter_fw_read(piece, 0, sizeof(piece), &num_read) != FOTA_STATUS_SUCCESS);
+    bytes_t digest(FOTA_CRYPTO_HASH_SIZE);
+    CHECK(meter_fw_get_digest(digest.data()) != FOTA_STATUS_SUCCESS);
+    CHECK(meter_fw_store("no_such_candidate.bin") != FOTA_STATUS_SUCCESS);
+}
+
+static void test_delta_against_full(const bytes_t &base)
+{
+    const bytes_t next = make_next_image(base);
+    const bytes_t next_digest = sha256(next);
+
+    // Full: the whole image is transferred and stored.
+    write_file(METER_FW_FILE, base);
+    meter_fw_close();
+    test_clock::time_point start = test_clock::now();
+    write_file(candidate_file_name, next);
+    CHECK(meter_fw_store(candidate_file_name) == FOTA_STATUS_SUCCESS);
+    const double full_ms = ms_since(start);
+    CHECK(installed_digest() == next_digest);
+
+    // Delta: the base digest is checked, the patch applied over the base and stored.
+    write_file(METER_FW_FILE, base);
+    meter_fw_close();
+    const bytes_t patch = make_patch(base, next);
+    unsigned long base_reads = 0;
+    start = test_clock::now();
+    CHECK(installed_digest() == sha256(base));
+    const double digest_ms = ms_since(start);
+    CHECK(apply_patch(patch, &base_reads));
+    CHECK(meter_fw_store(candidate_file_name) == FOTA_STATUS_SUCCESS);
+    const double delta_ms = ms_since(start);
+    CHECK(installed_digest() == next_digest);
+
+    // The next delta applies on top of the stored image.
+    bytes_t following = make_next_image(next);
+    CHECK(apply_patch(make_patch(next, following), &base_reads));
+    CHECK(meter_fw_store(candidate_file_name) == FOTA_STATUS_SUCCESS);
+    CHECK(installed_digest() == sha256(following));
+
+    printf("%-6s %12s %10s %12s\n", "update", "transferred", "apply ms", "base reads");
+    printf("%-6s %12lu %10.2f %12s\n", "full", (unsigned long)next.size(), full_ms, "-");
+    printf("%-6s %12lu %10.2f %12lu   (base digest %.2f ms)\n", "delta", (unsigned long)patch.size(), delta_ms,
+           base_reads, digest_ms);
+    CHECK(patch.size() < next.size() / 10);
+
+    meter_fw_close();
+    remove(METER_FW_FILE);
+    remove(candidate_file_name);
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t image_size = ((argc > 1) ? strtoul(argv[1], NULL, 10) : 512) * 1024;
+    const bytes_t base = make_image(image_size, 1);
+
+    test_reader(base);
+    test_delta_against_full(base);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Host test of kvstore_migrate() over an in-memory KVStore, which can lose
+// power at any write. Every write of a migration is interrupted in turn, and
+// the next boot must complete the migration.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "kvstore_global_api.h"
+#include "migrate_kvstore.h"
+
+extern const uint8_t MIGRATE_BOOTSTRAP_CA_CERT[];
+extern const uint32_t MIGRATE_BOOTSTRAP_CA_CERT_SIZE;
+
+const uint8_t MIGRATE_BOOTSTRAP_CA_CERT[900] = { 0x30, 0x82, 0x03, 0x80 };
+const uint32_t MIGRATE_BOOTSTRAP_CA_CERT_SIZE = sizeof(MIGRATE_BOOTSTRAP_CA_CERT);
+
+static const char *const server_a = "coaps://bootstrap.a.example.com:5684";
+static const char *const server_b = "coaps://bootstrap.b.example.com:5684";
+
+static const char *const lwm2m_keys[] = {
+    "pelion_wCfgParam_mbed.LwM2MServerURI",
+    "pelion_wCrtae_mbed.LwM2MDeviceCert",
+    "pelion_wCrtae_mbed.LwM2MServerCACert",
+    "pelion_wPrvKey_mbed.LwM2MDevicePrivateKey",
+};
+
+/////////////////
+// In-memory KVStore
+/////////////////
+
+struct power_loss {
+};
+
+static std::map<std::string, std::vector<uint8_t> > store;
+static unsigned long write_count;
+static unsigned long read_bytes;
+// Writes left before the power is lost, -1 for none.
+static long writes_left = -1;
+
+static void flash_write(void)
+{
+    if (writes_left == 0) {
+        throw power_loss();
+    }
+    if (writes_left > 0) {
+        writes_left--;
+    }
+    write_count++;
+}
+
+int kv_set(const char *key, const void *buffer, size_t size, uint32_t)
+{
+    flash_write();
+    store[key].assign((const uint8_t *)buffer, (const uint8_t *)buffer + size);
+    return MBED_SUCCESS;
+}
+
+int kv_get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size)
+{
+    std::map<std::string, std::vector<uint8_t> >::const_iterator it = store.find(key);
+    if (it == store.end()) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    *actual_size = (it->second.size() < buffer_size) ? it->second.size() : buffer_size;
+    memcpy(buffer, it->second.data(), *actual_size);
+    read_bytes += *actual_size;
+    return MBED_SUCCESS;
+}
+
+int kv_get_info(const char *key, kv_info_t *info)
+{
+    std::map<std::string, std::vector<uint8_t> >::const_iterator it = store.find(key);
+    if (it == store.end()) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    info->size = it->second.size();
+    info->flags = 0;
+    return MBED_SUCCESS;
+}
+
+int kv_remove(const char *key)
+{
+    if (store.find(key) == store.end()) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    flash_write();
+    store.erase(key);
+    return MBED_SUCCESS;
+}
+
+/////////////////
+// Helpers
+/////////////////
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+static std::vector<uint8_t> bytes(const void *data, size_t size)
+{
+    return std::vector<uint8_t>((const uint8_t *)data, (const uint8_t *)data + size);
+}
+
+// Storage of a device provisioned in the factory, and registered once.
+static void factory_storage(void)
+{
+    const std::vector<uint8_t> uri(30, 'o');
+    const std::vector<uint8_t> cert(700, 0x07);
+
+    store.clear();
+    store["pelion_bCfgParam_mbed.BootstrapServerURI"] = uri;
+    store["pelion_wCfgParam_mbed.BootstrapServerURI"] = uri;
+    store["pelion_bCrtae_mbed.BootstrapServerCACert"] = cert;
+    store["pelion_wCrtae_mbed.BootstrapServerCACert"] = cert;
+    for (size_t i = 0; i < sizeof(lwm2m_keys) / sizeof(lwm2m_keys[0]); i++) {
+        store[lwm2m_keys[i]] = cert;
+    }
+}
+
+static bool migrated_to(const char *server)
+{
+    const std::vector<uint8_t> uri = bytes(server, strlen(server));
+    const std::vector<uint8_t> cert = bytes(MIGRATE_BOOTSTRAP_CA_CERT, MIGRATE_BOOTSTRAP_CA_CERT_SIZE);
+
+    for (size_t i = 0; i < sizeof(lwm2m_keys) / sizeof(lwm2m_keys[0]); i++) {
+        if (store.count(lwm2m_keys[i])) {
+            return false;
+        }
+    }
+    return store["pelion_bCfgParam_mbed.BootstrapServerURI"] == uri &&
+           store["pelion_wCfgParam_mbed.BootstrapServerURI"] == uri &&
+           store["pelion_bCrtae_mbed.BootstrapServerCACert"] == cert &&
+           store["pelion_wCrtae_mbed.BootstrapServerCACert"] == cert &&
+           store.count("pelion_wMIGR") == 1 &&
+           store.count("pelion_wMIGRJ") == 0;
+}
+
+// Runs the migration, the power is lost after `writes` writes, -1 for never.
+// Returns true if the migration returned, i.e. the power stayed on.
+static bool boot(const char *server, long writes, int *status = NULL)
+{
+    writes_left = writes;
+    try {
+        int res = migrate_kvstore(server);
+        if (status) {
+            *status = res;
+        }
+    } catch (const power_loss &) {
+        writes_left = -1;
+        return false;
+    }
+    writes_left = -1;
+    return true;
+}
+
+/////////////////
+// Tests
+/////////////////
+
+static void test_migration_and_reboot(void)
+{
+    int status = -1;
+
+    factory_storage();
+    write_count = 0;
+    CHECK(boot(server_a, -1, &status));
+    CHECK(status == MBED_SUCCESS);
+    CHECK(migrated_to(server_a));
+    // Journal, four keys, four removals, migration key and journal removal.
+    CHECK(write_count == 11);
+    printf("migration: %lu writes\n", write_count);
+
+    write_count = 0;
+    read_bytes = 0;
+    CHECK(boot(server_a, -1, &status));
+    CHECK(status == MBED_SUCCESS);
+    CHECK(write_count == 0);
+    printf("next boot: %lu writes, %lu bytes read\n", write_count, read_bytes);
+}
+
+static void test_values_already_in_place(void)
+{
+    factory_storage();
+    CHECK(boot(server_a, -1));
+    // A lost migration key, all the keys match: only the key is written.
+    store.erase("pelion_wMIGR");
+    write_count = 0;
+    CHECK(boot(server_a, -1));
+    CHECK(migrated_to(server_a));
+    CHECK(write_count == 1);
+}
+
+static void test_power_loss_at_every_write(void)
+{
+    unsigned long points = 0;
+
+    for (long first = 0; ; first++) {
+        factory_storage();
+        if (boot(server_a, first)) {
+            break;
+        }
+        points++;
+        CHECK(boot(server_a, -1));
+        CHECK(migrated_to(server_a));
+
+        // And once more during the recovery.
+        for (long second = 0; ; second++) {
+            factory_storage();
+            CHECK(!boot(server_a, first));
+            if (boot(server_a, second)) {
+                break;
+            }
+            points++;
+            CHECK(boot(server_a, -1));
+            CHECK(migrated_to(server_a));
+        }
+    }
+    printf("power loss: %lu points\n", points);
+    CHECK(points > 11);
+}
+
+static void test_new_table_runs_again(void)
+{
+    factory_storage();
+    CHECK(boot(server_a, -1));
+    CHECK(boot(server_b, -1));
+    CHECK(migrated_to(server_b));
+}
+
+static void test_interrupted_other_table(void)
+{
+    // Migrated to A, then a migration to B was interrupted, then the
+    // firmware of A is back: the keys are migrated to A again.
+    for (long writes = 1; ; writes++) {
+        factory_storage();
+        CHECK(boot(server_a, -1));
+        if (boot(server_b, writes)) {
+            break;
+        }
+        CHECK(boot(server_a, -1));
+        CHECK(migrated_to(server_a));
+    }
+}
+
+static void test_legacy_marker(void)
+{
+    factory_storage();
+    store["pelion_wMIGR"] = std::vector<uint8_t>(1, 0);
+    write_count = 0;
+    CHECK(boot(server_a, -1));
+    CHECK(write_count == 0);
+    CHECK(!migrated_to(server_a));
+}
+
+int main()
+{
+    test_migration_and_reboot();
+    test_values_already_in_place();
+    test_power_loss_at_every_write();
+    test_new_table_runs_again();
+    test_interrupted_other_table();
+    test_legacy_marker();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
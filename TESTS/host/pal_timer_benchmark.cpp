@@ -0,0 +1,234 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Benchmark of the timerfd PAL timers of
+// source/platform/Linux/pal_plat_timer_timerfd.c against POSIX timers
+// delivering a realtime signal to a sigwaitinfo() thread, as the timers of
+// the PAL Linux port do.
+//
+// Each run arms periodic 10 ms timers, 1, 100 and 10000 of them by default,
+// and records for every expiration how late its callback ran against the
+// timer's schedule, and the CPU time of the process. Every run is a fresh
+// process. The program is linked with --wrap like the example, so its
+// pal_plat_osTimer* calls reach the timerfd timers.
+//
+// Run from the build directory, optionally with the seconds per run and the
+// timer counts:
+//     build-host-tests/pal_timer_benchmark [seconds [timers...]]
+
+#include "pal.h"
+#include "pal_plat_rtos.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <vector>
+
+#define PERIOD_MS           10
+#define DEFAULT_SECONDS     3
+
+static const int default_timer_counts[] = { 1, 100, 10000 };
+
+typedef struct {
+    uint64_t expected_ns;
+    timer_t posix_timer;
+    palTimerID_t pal_timer;
+} benchmark_timer_t;
+
+static pthread_mutex_t lateness_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<uint64_t> lateness_ns;
+static bool recording;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static double cpu_seconds(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Lateness against the schedule, skipping the periods which were missed.
+static void timer_expired(void const *argument)
+{
+    benchmark_timer_t *timer = (benchmark_timer_t *)argument;
+    const uint64_t now = now_ns();
+    const uint64_t lateness = (now > timer->expected_ns) ? now - timer->expected_ns : 0;
+
+    do {
+        timer->expected_ns += PERIOD_MS * 1000000ULL;
+    } while (timer->expected_ns < now);
+
+    pthread_mutex_lock(&lateness_mutex);
+    if (recording && lateness_ns.size() < lateness_ns.capacity()) {
+        lateness_ns.push_back(lateness);
+    }
+    pthread_mutex_unlock(&lateness_mutex);
+}
+
+/* Signal timers */
+
+static void *signal_dispatcher(void *arg)
+{
+    sigset_t signals;
+    siginfo_t info;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGRTMIN);
+    for (;;) {
+        if (sigwaitinfo(&signals, &info) > 0) {
+            timer_expired(info.si_value.sival_ptr);
+        }
+    }
+    return arg;
+}
+
+static int start_signal_timers(std::vector<benchmark_timer_t> &timers)
+{
+    sigset_t signals;
+    pthread_t thread;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGRTMIN);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    if (pthread_create(&thread, NULL, signal_dispatcher, NULL) != 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < timers.size(); i++) {
+        struct sigevent event;
+        struct itimerspec spec;
+
+        memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_SIGNAL;
+        event.sigev_signo = SIGRTMIN;
+        event.sigev_value.sival_ptr = &timers[i];
+        if (timer_create(CLOCK_MONOTONIC, &event, &timers[i].posix_timer) != 0) {
+            perror("timer_create");
+            return -1;
+        }
+        spec.it_interval.tv_sec = 0;
+        spec.it_interval.tv_nsec = PERIOD_MS * 1000000L;
+        spec.it_value = spec.it_interval;
+        timers[i].expected_ns = now_ns() + PERIOD_MS * 1000000ULL;
+        timer_settime(timers[i].posix_timer, 0, &spec, NULL);
+    }
+    return 0;
+}
+
+/* timerfd timers, through the wrapped PAL port functions */
+
+static int start_timerfd_timers(std::vector<benchmark_timer_t> &timers)
+{
+    for (size_t i = 0; i < timers.size(); i++) {
+        if (pal_plat_osTimerCreate(timer_expired, &timers[i], palOsTimerPeriodic, &timers[i].pal_timer) != PAL_SUCCESS) {
+            return -1;
+        }
+        timers[i].expected_ns = now_ns() + PERIOD_MS * 1000000ULL;
+        if (pal_plat_osTimerStart(timers[i].pal_timer, PERIOD_MS) != PAL_SUCCESS) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int run(bool signal_timers, int count, int seconds)
+{
+    std::vector<benchmark_timer_t> timers(count);
+
+    lateness_ns.reserve((size_t)count * seconds * (1000 / PERIOD_MS) + 1000);
+    if ((signal_timers ? start_signal_timers(timers) : start_timerfd_timers(timers)) != 0) {
+        printf("%s: cannot start %d timers\n", signal_timers ? "signal" : "timerfd", count);
+        return 1;
+    }
+
+    // Skip the first period, when the timers are still being armed.
+    usleep(PERIOD_MS * 1000);
+    pthread_mutex_lock(&lateness_mutex);
+    recording = true;
+    pthread_mutex_unlock(&lateness_mutex);
+
+    const double cpu_start = cpu_seconds();
+    sleep(seconds);
+    const double cpu_used = cpu_seconds() - cpu_start;
+
+    pthread_mutex_lock(&lateness_mutex);
+    recording = false;
+    std::vector<uint64_t> sorted(lateness_ns);
+    pthread_mutex_unlock(&lateness_mutex);
+    std::sort(sorted.begin(), sorted.end());
+
+    const size_t n = sorted.size();
+    const double expected = (double)count * seconds * (1000 / PERIOD_MS);
+    printf("%-8s %6d %10zu %6.1f%% %10.1f %10.1f %10.1f %6.1f%%\n",
+           signal_timers ? "signal" : "timerfd", count, n, n * 100.0 / expected,
+           n ? sorted[n / 2] / 1e3 : 0.0, n ? sorted[n * 99 / 100] / 1e3 : 0.0, n ? sorted[n - 1] / 1e3 : 0.0,
+           cpu_used * 100 / seconds);
+    fflush(stdout);
+
+    // Exit without stopping the timers, the process goes away.
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const int seconds = (argc > 1) ? atoi(argv[1]) : DEFAULT_SECONDS;
+    std::vector<int> counts(default_timer_counts, default_timer_counts + sizeof(default_timer_counts) / sizeof(default_timer_counts[0]));
+
+    if (argc > 2) {
+        counts.clear();
+        for (int i = 2; i < argc; i++) {
+            counts.push_back(atoi(argv[i]));
+        }
+    }
+    if (seconds < 1) {
+        printf("usage: %s [seconds [timers...]]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%d ms periodic timers, %d s per run, lateness in us\n", PERIOD_MS, seconds);
+    printf("%-8s %6s %10s %7s %10s %10s %10s %7s\n", "timers", "count", "expired", "of due", "p50", "p99", "max", "CPU");
+    int failed = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        for (int signal_timers = 0; signal_timers < 2; signal_timers++) {
+            fflush(stdout);
+            const pid_t pid = fork();
+            if (pid == 0) {
+                _exit(run(signal_timers, counts[i], seconds));
+            }
+            int status = 1;
+            waitpid(pid, &status, 0);
+            failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,57 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the item names of the factory configurator client. The
+// tests which use them define them.
+
+#ifndef HOST_STUB_FCC_DEFS_H
+#define HOST_STUB_FCC_DEFS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const char g_fcc_use_bootstrap_parameter_name[];
+extern const char g_fcc_endpoint_parameter_name[];
+extern const char g_fcc_first_to_claim_parameter_name[];
+extern const char g_fcc_manufacturer_parameter_name[];
+extern const char g_fcc_model_number_parameter_name[];
+extern const char g_fcc_device_type_parameter_name[];
+extern const char g_fcc_hardware_version_parameter_name[];
+extern const char g_fcc_memory_size_parameter_name[];
+extern const char g_fcc_device_serial_number_parameter_name[];
+extern const char g_fcc_device_time_zone_parameter_name[];
+extern const char g_fcc_offset_from_utc_parameter_name[];
+extern const char g_fcc_bootstrap_server_uri_name[];
+extern const char g_fcc_bootstrap_server_ca_certificate_name[];
+extern const char g_fcc_bootstrap_device_certificate_name[];
+extern const char g_fcc_bootstrap_device_private_key_name[];
+extern const char g_fcc_lwm2m_server_uri_name[];
+extern const char g_fcc_lwm2m_server_ca_certificate_name[];
+extern const char g_fcc_lwm2m_device_certificate_name[];
+extern const char g_fcc_lwm2m_device_private_key_name[];
+extern const char g_fcc_update_authentication_certificate_name[];
+extern const char g_fcc_vendor_id_name[];
+extern const char g_fcc_class_id_name[];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_STUB_FCC_DEFS_H
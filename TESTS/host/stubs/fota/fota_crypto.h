@@ -0,0 +1,66 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the FOTA hash API, over the SHA-256 of the mbedtls stub.
+
+#ifndef HOST_STUB_FOTA_CRYPTO_H
+#define HOST_STUB_FOTA_CRYPTO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "fota/fota_status.h"
+#include "mbedtls/sha256.h"
+
+#define FOTA_CRYPTO_HASH_SIZE 32
+
+typedef struct fota_hash_context_s {
+    mbedtls_sha256_context sha256;
+} fota_hash_context_t;
+
+static inline int fota_hash_start(fota_hash_context_t **ctx)
+{
+    *ctx = (fota_hash_context_t *)malloc(sizeof(fota_hash_context_t));
+    if (!*ctx) {
+        return FOTA_STATUS_OUT_OF_MEMORY;
+    }
+    mbedtls_sha256_init(&(*ctx)->sha256);
+    return mbedtls_sha256_starts_ret(&(*ctx)->sha256, 0) ? FOTA_STATUS_INTERNAL_ERROR : FOTA_STATUS_SUCCESS;
+}
+
+static inline int fota_hash_update(fota_hash_context_t *ctx, const uint8_t *buf, uint32_t buf_size)
+{
+    return mbedtls_sha256_update_ret(&ctx->sha256, buf, buf_size) ? FOTA_STATUS_INTERNAL_ERROR : FOTA_STATUS_SUCCESS;
+}
+
+static inline int fota_hash_result(fota_hash_context_t *ctx, uint8_t *hash_buf)
+{
+    return mbedtls_sha256_finish_ret(&ctx->sha256, hash_buf) ? FOTA_STATUS_INTERNAL_ERROR : FOTA_STATUS_SUCCESS;
+}
+
+static inline void fota_hash_finish(fota_hash_context_t **ctx)
+{
+    if (*ctx) {
+        mbedtls_sha256_free(&(*ctx)->sha256);
+        free(*ctx);
+        *ctx = NULL;
+    }
+}
+
+#endif // HOST_STUB_FOTA_CRYPTO_H
@@ -0,0 +1,32 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the FOTA status codes used by the sources under test.
+
+#ifndef HOST_STUB_FOTA_STATUS_H
+#define HOST_STUB_FOTA_STATUS_H
+
+typedef enum {
+    FOTA_STATUS_SUCCESS = 0,
+    FOTA_STATUS_OUT_OF_MEMORY = -50,
+    FOTA_STATUS_INTERNAL_ERROR = -100,
+    FOTA_STATUS_FW_INSTALLATION_FAILED = -131,
+} fota_status_e;
+
+#endif // HOST_STUB_FOTA_STATUS_H
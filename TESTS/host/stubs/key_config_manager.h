@@ -0,0 +1,82 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the KCM item and certificate chain API. The tests which
+// use it provide the functions over an in-memory store.
+
+#ifndef HOST_STUB_KEY_CONFIG_MANAGER_H
+#define HOST_STUB_KEY_CONFIG_MANAGER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    KCM_PRIVATE_KEY_ITEM,
+    KCM_PUBLIC_KEY_ITEM,
+    KCM_SYMMETRIC_KEY_ITEM,
+    KCM_CERTIFICATE_ITEM,
+    KCM_CONFIG_ITEM,
+} kcm_item_type_e;
+
+typedef enum {
+    KCM_STATUS_SUCCESS,
+    KCM_STATUS_ERROR,
+    KCM_STATUS_INVALID_PARAMETER,
+    KCM_STATUS_INSUFFICIENT_BUFFER,
+    KCM_STATUS_OUT_OF_MEMORY,
+    KCM_STATUS_ITEM_NOT_FOUND,
+    KCM_STATUS_FILE_EXIST,
+    KCM_STATUS_NOT_PERMITTED,
+    KCM_STATUS_STORAGE_ERROR,
+} kcm_status_e;
+
+typedef void *kcm_cert_chain_handle;
+typedef const void *kcm_security_desc_s;
+
+kcm_status_e kcm_item_get_data_size(const uint8_t *kcm_item_name, size_t kcm_item_name_len,
+                                    kcm_item_type_e kcm_item_type, size_t *kcm_item_data_size_out);
+kcm_status_e kcm_item_get_data(const uint8_t *kcm_item_name, size_t kcm_item_name_len, kcm_item_type_e kcm_item_type,
+                               uint8_t *kcm_item_data_out, size_t kcm_item_data_max_size, size_t *kcm_item_data_act_size_out);
+kcm_status_e kcm_item_store(const uint8_t *kcm_item_name, size_t kcm_item_name_len, kcm_item_type_e kcm_item_type,
+                            bool kcm_item_is_factory, const uint8_t *kcm_item_data, size_t kcm_item_data_size,
+                            const kcm_security_desc_s kcm_item_info);
+kcm_status_e kcm_item_delete(const uint8_t *kcm_item_name, size_t kcm_item_name_len, kcm_item_type_e kcm_item_type);
+
+kcm_status_e kcm_cert_chain_create(kcm_cert_chain_handle *kcm_chain_handle, const uint8_t *kcm_chain_name,
+                                   size_t kcm_chain_name_len, size_t kcm_chain_len, bool kcm_chain_is_factory);
+kcm_status_e kcm_cert_chain_add_next(kcm_cert_chain_handle kcm_chain_handle, const uint8_t *kcm_cert_data,
+                                     size_t kcm_cert_data_size);
+kcm_status_e kcm_cert_chain_open(kcm_cert_chain_handle *kcm_chain_handle, const uint8_t *kcm_chain_name,
+                                 size_t kcm_chain_name_len, size_t *kcm_chain_len_out);
+kcm_status_e kcm_cert_chain_get_next_size(kcm_cert_chain_handle kcm_chain_handle, size_t *kcm_cert_data_size);
+kcm_status_e kcm_cert_chain_get_next_data(kcm_cert_chain_handle kcm_chain_handle, uint8_t *kcm_cert_data,
+                                          size_t kcm_max_cert_data_size, size_t *kcm_actual_cert_data_size);
+kcm_status_e kcm_cert_chain_close(kcm_cert_chain_handle kcm_chain_handle);
+kcm_status_e kcm_cert_chain_delete(const uint8_t *kcm_chain_name, size_t kcm_chain_name_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_STUB_KEY_CONFIG_MANAGER_H
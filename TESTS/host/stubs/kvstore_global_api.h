@@ -0,0 +1,44 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the global KVStore API, implemented by the test over an
+// in-memory store.
+
+#ifndef HOST_STUB_KVSTORE_GLOBAL_API_H
+#define HOST_STUB_KVSTORE_GLOBAL_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBED_SUCCESS                    0
+#define MBED_ERROR_ITEM_NOT_FOUND       (-1)
+#define MBED_ERROR_FAILED_OPERATION     (-2)
+#define MBED_ERROR_INVALID_SIZE         (-3)
+
+typedef struct info {
+    size_t size;
+    uint32_t flags;
+} kv_info_t;
+
+int kv_set(const char *full_name_key, const void *buffer, size_t size, uint32_t create_flags);
+int kv_get(const char *full_name_key, void *buffer, size_t buffer_size, size_t *actual_size);
+int kv_get_info(const char *full_name_key, kv_info_t *info);
+int kv_remove(const char *full_name_key);
+
+#endif // HOST_STUB_KVSTORE_GLOBAL_API_H
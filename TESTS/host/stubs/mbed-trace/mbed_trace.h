@@ -0,0 +1,30 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in, traces are dropped.
+
+#ifndef HOST_STUB_MBED_TRACE_H
+#define HOST_STUB_MBED_TRACE_H
+
+#define tr_debug(...) ((void)0)
+#define tr_info(...)  ((void)0)
+#define tr_warn(...)  ((void)0)
+#define tr_error(...) ((void)0)
+
+#endif // HOST_STUB_MBED_TRACE_H
@@ -0,0 +1,43 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the mbedtls OID lookup, only the attributes of
+// mbedtls/x509_crt.h are known.
+
+#ifndef HOST_STUB_MBEDTLS_OID_H
+#define HOST_STUB_MBEDTLS_OID_H
+
+#include <string.h>
+
+#include "mbedtls/x509.h"
+
+#define MBEDTLS_ERR_OID_NOT_FOUND -0x002E
+
+static inline int mbedtls_oid_get_attr_short_name(const mbedtls_asn1_buf *oid, const char **short_name)
+{
+    static const unsigned char cn_oid[] = { 0x55, 0x04, 0x03 };
+
+    if (oid->len == sizeof(cn_oid) && memcmp(oid->p, cn_oid, sizeof(cn_oid)) == 0) {
+        *short_name = "CN";
+        return 0;
+    }
+    return MBEDTLS_ERR_OID_NOT_FOUND;
+}
+
+#endif // HOST_STUB_MBEDTLS_OID_H
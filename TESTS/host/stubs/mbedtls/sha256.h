@@ -0,0 +1,146 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Host stand-in for the mbedtls SHA-256 API, a plain implementation of FIPS 180-4.
+
+#ifndef HOST_STUB_MBEDTLS_SHA256_H
+#define HOST_STUB_MBEDTLS_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct mbedtls_sha256_context {
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char block[64];
+    size_t used;
+} mbedtls_sha256_context;
+
+static inline uint32_t host_sha256_ror(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline void host_sha256_block(mbedtls_sha256_context *ctx, const unsigned char *data)
+{
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    uint32_t w[64];
+    uint32_t v[8];
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)data[4 * i] << 24) | ((uint32_t)data[4 * i + 1] << 16) |
+               ((uint32_t)data[4 * i + 2] << 8) | (uint32_t)data[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = host_sha256_ror(w[i - 15], 7) ^ host_sha256_ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = host_sha256_ror(w[i - 2], 17) ^ host_sha256_ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    memcpy(v, ctx->state, sizeof(v));
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = host_sha256_ror(v[4], 6) ^ host_sha256_ror(v[4], 11) ^ host_sha256_ror(v[4], 25);
+        uint32_t t1 = v[7] + s1 + ((v[4] & v[5]) ^ (~v[4] & v[6])) + k[i] + w[i];
+        uint32_t s0 = host_sha256_ror(v[0], 2) ^ host_sha256_ror(v[0], 13) ^ host_sha256_ror(v[0], 22);
+        uint32_t t2 = s0 + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(&v[1], &v[0], 7 * sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++) {
+        ctx->state[i] += v[i];
+    }
+}
+
+static inline void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static inline void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static inline int mbedtls_sha256_starts_ret(mbedtls_sha256_context *ctx, int is224)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    if (is224) {
+        return -1;
+    }
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->length = 0;
+    ctx->used = 0;
+    return 0;
+}
+
+static inline int mbedtls_sha256_update_ret(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    ctx->length += ilen;
+    while (ilen > 0) {
+        size_t take = 64 - ctx->used;
+        if (take > ilen) {
+            take = ilen;
+        }
+        memcpy(ctx->block + ctx->used, input, take);
+        ctx->used += take;
+        input += take;
+        ilen -= take;
+        if (ctx->used == 64) {
+            host_sha256_block(ctx, ctx->block);
+            ctx->used = 0;
+        }
+    }
+    return 0;
+}
+
+static inline int mbedtls_sha256_finish_ret(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    const uint64_t bits = ctx->length * 8;
+    unsigned char pad = 0x80;
+
+    mbedtls_sha256_update_ret(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->used != 56) {
+        mbedtls_sha256_update_ret(ctx, &pad, 1);
+    }
+    for (int i = 7; i >= 0; i--) {
+        ctx->block[ctx->used++] = (unsigned char)(bits >> (8 * i));
+    }
+    host_sha256_block(ctx, ctx->block);
+    for (int i = 0; i < 8; i++) {
+        output[4 * i] = (unsigned char)(ctx->state[i] >> 24);
+        output[4 * i + 1] = (unsigned char)(ctx->state[i] >> 16);
+        output[4 * i + 2] = (unsigned char)(ctx->state[i] >> 8);
+        output[4 * i + 3] = (unsigned char)ctx->state[i];
+    }
+    return 0;
+}
+
+#endif // HOST_STUB_MBEDTLS_SHA256_H
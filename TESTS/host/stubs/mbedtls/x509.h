@@ -0,0 +1,39 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the mbedtls X.509 name types.
+
+#ifndef HOST_STUB_MBEDTLS_X509_H
+#define HOST_STUB_MBEDTLS_X509_H
+
+#include <stddef.h>
+
+typedef struct mbedtls_asn1_buf {
+    int tag;
+    size_t len;
+    unsigned char *p;
+} mbedtls_asn1_buf;
+
+typedef struct mbedtls_x509_name {
+    mbedtls_asn1_buf oid;
+    mbedtls_asn1_buf val;
+    struct mbedtls_x509_name *next;
+} mbedtls_x509_name;
+
+#endif // HOST_STUB_MBEDTLS_X509_H
@@ -0,0 +1,68 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the mbedtls certificate parser. Only the subject CN is
+// parsed: it is the last CN of the DER, the subject follows the issuer.
+
+#ifndef HOST_STUB_MBEDTLS_X509_CRT_H
+#define HOST_STUB_MBEDTLS_X509_CRT_H
+
+#include <string.h>
+
+#include "mbedtls/x509.h"
+
+#define MBEDTLS_ERR_X509_INVALID_NAME -0x2380
+
+typedef struct mbedtls_x509_crt {
+    mbedtls_x509_name subject;
+} mbedtls_x509_crt;
+
+static inline void mbedtls_x509_crt_init(mbedtls_x509_crt *crt)
+{
+    memset(crt, 0, sizeof(*crt));
+}
+
+static inline void mbedtls_x509_crt_free(mbedtls_x509_crt *crt)
+{
+    (void)crt;
+}
+
+static inline int mbedtls_x509_crt_parse_der(mbedtls_x509_crt *crt, const unsigned char *buf, size_t buflen)
+{
+    // OBJECT IDENTIFIER 2.5.4.3 followed by a string of up to 127 bytes
+    static const unsigned char cn_oid[] = { 0x06, 0x03, 0x55, 0x04, 0x03 };
+    int res = MBEDTLS_ERR_X509_INVALID_NAME;
+
+    for (size_t i = 0; i + sizeof(cn_oid) + 2 <= buflen; i++) {
+        const size_t value = i + sizeof(cn_oid);
+        if (memcmp(buf + i, cn_oid, sizeof(cn_oid)) == 0 && buf[value + 1] < 0x80 &&
+                value + 2 + buf[value + 1] <= buflen) {
+            crt->subject.oid.tag = buf[i];
+            crt->subject.oid.len = sizeof(cn_oid) - 2;
+            crt->subject.oid.p = (unsigned char *)buf + i + 2;
+            crt->subject.val.tag = buf[value];
+            crt->subject.val.len = buf[value + 1];
+            crt->subject.val.p = (unsigned char *)buf + value + 2;
+            res = 0;
+        }
+    }
+    return res;
+}
+
+#endif // HOST_STUB_MBEDTLS_X509_CRT_H
@@ -0,0 +1,111 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the parts of pal.h used by the sources under test. The
+// primary mount point is the working directory.
+
+#ifndef HOST_STUB_PAL_H
+#define HOST_STUB_PAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+typedef int32_t palStatus_t;
+
+#define PAL_SUCCESS                         0
+#define PAL_ERR_GENERIC_FAILURE             -1
+#define PAL_ERR_INTERNAL_FLASH_WRONG_SIZE   -2
+#define PAL_ERR_INTERNAL_FLASH_WRITE_ERROR  -3
+#define PAL_ERR_INVALID_ARGUMENT            -4
+#define PAL_ERR_NO_MEMORY                   -5
+
+#define PAL_MAX_FILE_AND_FOLDER_LENGTH 256
+
+#define NULLPTR 0
+#define PAL_SHA256_SIZE 32
+
+typedef uintptr_t palTimerID_t;
+typedef void (*palTimerFuncPtr)(void const *funcArgument);
+
+typedef enum {
+    palOsTimerOnce = 0,
+    palOsTimerPeriodic = 1
+} palTimerType_t;
+
+typedef uintptr_t palMDHandle_t;
+typedef uintptr_t palX509Handle_t;
+
+typedef enum {
+    PAL_SHA256
+} palMDType_t;
+
+typedef enum {
+    PAL_X509_VALID_TO
+} palX509Attr_t;
+
+typedef enum {
+    PAL_FS_PARTITION_PRIMARY,
+    PAL_FS_PARTITION_SECONDARY
+} pal_fsStorageID_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Provided by the tests which use them.
+palStatus_t pal_mdInit(palMDHandle_t *md, palMDType_t mdType);
+palStatus_t pal_mdUpdate(palMDHandle_t md, const unsigned char *input, size_t inLen);
+palStatus_t pal_mdFinal(palMDHandle_t md, unsigned char *output);
+palStatus_t pal_mdFree(palMDHandle_t *md);
+palStatus_t pal_x509Initiate(palX509Handle_t *x509Cert);
+palStatus_t pal_x509CertParse(palX509Handle_t x509Cert, const unsigned char *input, size_t inLen);
+palStatus_t pal_x509CertGetAttribute(palX509Handle_t x509Cert, palX509Attr_t attr, void *output, size_t outLenBytes, size_t *actualOutLenBytes);
+palStatus_t pal_x509Free(palX509Handle_t *x509Cert);
+uint64_t pal_osGetTime(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline palStatus_t pal_fsGetMountPoint(pal_fsStorageID_t dataID, size_t length, char *mountPoint)
+{
+    (void)dataID;
+    if (length < 2) {
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    strcpy(mountPoint, ".");
+    return PAL_SUCCESS;
+}
+
+static inline uint64_t pal_osKernelSysTick(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint64_t pal_osKernelSysTickFrequency(void)
+{
+    return 1000000000;
+}
+
+#endif // HOST_STUB_PAL_H
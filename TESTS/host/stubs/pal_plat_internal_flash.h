@@ -0,0 +1,43 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the internal flash port API of PAL.
+
+#ifndef HOST_STUB_PAL_PLAT_INTERNAL_FLASH_H
+#define HOST_STUB_PAL_PLAT_INTERNAL_FLASH_H
+
+#include "pal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+palStatus_t pal_plat_internalFlashInit(void);
+palStatus_t pal_plat_internalFlashDeInit(void);
+palStatus_t pal_plat_internalFlashRead(const size_t size, const uint32_t address, uint32_t *buffer);
+palStatus_t pal_plat_internalFlashWrite(const size_t size, const uint32_t address, const uint32_t *buffer);
+palStatus_t pal_plat_internalFlashErase(uint32_t address, size_t size);
+size_t pal_plat_internalFlashGetPageSize(void);
+size_t pal_plat_internalFlashGetSectorSize(uint32_t address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_STUB_PAL_PLAT_INTERNAL_FLASH_H
@@ -0,0 +1,40 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the timer functions of the PAL RTOS port API.
+
+#ifndef HOST_STUB_PAL_PLAT_RTOS_H
+#define HOST_STUB_PAL_PLAT_RTOS_H
+
+#include "pal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+palStatus_t pal_plat_osTimerCreate(palTimerFuncPtr function, void *funcArgument, palTimerType_t timerType, palTimerID_t *timerID);
+palStatus_t pal_plat_osTimerStart(palTimerID_t timerID, uint32_t millisec);
+palStatus_t pal_plat_osTimerStop(palTimerID_t timerID);
+palStatus_t pal_plat_osTimerDelete(palTimerID_t *timerID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_STUB_PAL_PLAT_RTOS_H
@@ -0,0 +1,53 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+// Host stand-in for the KCM storage layer used to store factory items. The
+// tests which use it provide the functions over an in-memory store.
+
+#ifndef HOST_STUB_STORAGE_KCM_H
+#define HOST_STUB_STORAGE_KCM_H
+
+#include "key_config_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    STORAGE_ITEM_PREFIX_KCM,
+    STORAGE_ITEM_PREFIX_CE,
+} storage_item_prefix_type_e;
+
+kcm_status_e storage_item_store(const uint8_t *kcm_item_name, size_t kcm_item_name_len, kcm_item_type_e kcm_item_type,
+                                bool kcm_item_is_factory, storage_item_prefix_type_e item_prefix_type,
+                                const uint8_t *kcm_item_data, size_t kcm_item_data_size, bool is_delete_allowed);
+
+kcm_status_e storage_cert_chain_create(kcm_cert_chain_handle *kcm_chain_handle, const uint8_t *kcm_chain_name,
+                                       size_t kcm_chain_name_len, size_t kcm_chain_len, bool kcm_chain_is_factory,
+                                       storage_item_prefix_type_e item_prefix_type);
+kcm_status_e storage_cert_chain_add_next(kcm_cert_chain_handle kcm_chain_handle, const uint8_t *kcm_cert_data,
+                                         size_t kcm_cert_data_size, storage_item_prefix_type_e item_prefix_type,
+                                         bool is_delete_allowed);
+kcm_status_e storage_cert_chain_close(kcm_cert_chain_handle kcm_chain_handle, storage_item_prefix_type_e item_prefix_type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_STUB_STORAGE_KCM_H
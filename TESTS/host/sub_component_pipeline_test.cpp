@@ -0,0 +1,265 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Host test of the sub-component pipeline. Sub-components with equal orders
+// must run at the same time on the worker pool, and every failure must be
+// kept against the sub-component which failed.
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "fota/fota_status.h"
+#include "sub_component_pipeline.h"
+
+uint64_t startup_profiler_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/////////////////
+// Sub-components
+/////////////////
+
+// Time each install and verify takes.
+#define WORK_US 100000
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<std::string> ran;
+static std::vector<std::string> rolled_back;
+static int running;
+static int max_running;
+static std::string failing;
+
+static int work(const char *sub_comp_name, const char *file_name, const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    (void)file_name;
+    (void)vendor_data;
+    (void)vendor_data_size;
+
+    pthread_mutex_lock(&log_lock);
+    ran.push_back(sub_comp_name);
+    if (++running > max_running) {
+        max_running = running;
+    }
+    pthread_mutex_unlock(&log_lock);
+
+    usleep(WORK_US);
+
+    pthread_mutex_lock(&log_lock);
+    running--;
+    pthread_mutex_unlock(&log_lock);
+    return (failing == sub_comp_name) ? FOTA_STATUS_FW_INSTALLATION_FAILED : FOTA_STATUS_SUCCESS;
+}
+
+static int rollback(const char *sub_comp_name, const char *file_name, const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    (void)file_name;
+    (void)vendor_data;
+    (void)vendor_data_size;
+    rolled_back.push_back(sub_comp_name);
+    return FOTA_STATUS_SUCCESS;
+}
+
+// A, B and C install together, then D. All four verify together.
+static void add_sub_components(void)
+{
+    static bool added;
+    static const struct {
+        const char *name;
+        unsigned install_order;
+    } components[] = { { "A", 1 }, { "B", 1 }, { "C", 1 }, { "D", 2 } };
+
+    if (added) {
+        return;
+    }
+    added = true;
+    for (size_t i = 0; i < sizeof(components) / sizeof(components[0]); i++) {
+        sub_component_pipeline_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.name = components[i].name;
+        entry.install_order = components[i].install_order;
+        entry.verify_order = 1;
+        entry.install = work;
+        entry.verify = work;
+        entry.rollback = rollback;
+        sub_component_pipeline_add(&entry);
+    }
+}
+
+static void start_update(const char *failing_name)
+{
+    add_sub_components();
+    sub_component_pipeline_reset();
+    ran.clear();
+    rolled_back.clear();
+    max_running = 0;
+    failing = failing_name ? failing_name : "";
+}
+
+static int install(const char *name)
+{
+    return sub_component_pipeline_install(name, "/tmp/image", (const uint8_t *)"v1", 2);
+}
+
+static int verify(const char *name)
+{
+    return sub_component_pipeline_verify(name, (const uint8_t *)"v1", 2);
+}
+
+static int thread_count(void)
+{
+    int count = 0;
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) {
+        return -1;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+/////////////////
+// Helpers
+/////////////////
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/////////////////
+// Tests
+/////////////////
+
+static void test_equal_orders_run_concurrently(void)
+{
+    start_update(NULL);
+    const uint64_t start_us = startup_profiler_time_us();
+
+    // The group runs once its last member is called.
+    CHECK(install("A") == FOTA_STATUS_SUCCESS);
+    CHECK(install("B") == FOTA_STATUS_SUCCESS);
+    CHECK(ran.empty());
+    CHECK(install("C") == FOTA_STATUS_SUCCESS);
+    CHECK(ran.size() == 3);
+    CHECK(max_running == 3);
+    CHECK(install("D") == FOTA_STATUS_SUCCESS);
+    CHECK(ran.size() == 4);
+
+    max_running = 0;
+    CHECK(verify("A") == FOTA_STATUS_SUCCESS);
+    CHECK(verify("B") == FOTA_STATUS_SUCCESS);
+    CHECK(verify("C") == FOTA_STATUS_SUCCESS);
+    CHECK(verify("D") == FOTA_STATUS_SUCCESS);
+    CHECK(ran.size() == 8);
+    // Four workers, the calling thread being one of them.
+    CHECK(max_running == 4);
+    CHECK(sub_component_pipeline_flush() == FOTA_STATUS_SUCCESS);
+
+    // Three rounds of the work instead of eight.
+    const uint64_t elapsed_us = startup_profiler_time_us() - start_us;
+    printf("equal orders: 8 jobs in %lu ms\n", (unsigned long)(elapsed_us / 1000));
+    CHECK(elapsed_us < 5 * WORK_US);
+}
+
+static void test_failure_kept_per_sub_component(void)
+{
+    start_update("B");
+
+    // A is deferred, so the failure of B is returned by the call for C.
+    CHECK(install("A") == FOTA_STATUS_SUCCESS);
+    CHECK(install("B") == FOTA_STATUS_SUCCESS);
+    CHECK(install("C") == FOTA_STATUS_FW_INSTALLATION_FAILED);
+    CHECK(sub_component_pipeline_result("A") == FOTA_STATUS_SUCCESS);
+    CHECK(sub_component_pipeline_result("B") == FOTA_STATUS_FW_INSTALLATION_FAILED);
+    CHECK(sub_component_pipeline_result("C") == FOTA_STATUS_SUCCESS);
+    // The members which installed are rolled back in reverse order.
+    CHECK(rolled_back.size() == 2 && rolled_back[0] == "C" && rolled_back[1] == "A");
+    CHECK(sub_component_pipeline_flush() == FOTA_STATUS_FW_INSTALLATION_FAILED);
+}
+
+static void test_failure_of_incomplete_group(void)
+{
+    start_update("A");
+
+    // The package holds A and D only, the group of A runs when D is called.
+    CHECK(install("A") == FOTA_STATUS_SUCCESS);
+    CHECK(install("D") == FOTA_STATUS_FW_INSTALLATION_FAILED);
+    CHECK(ran.size() == 1);
+    CHECK(sub_component_pipeline_result("A") == FOTA_STATUS_FW_INSTALLATION_FAILED);
+    CHECK(sub_component_pipeline_result("D") == FOTA_STATUS_SUCCESS);
+    CHECK(sub_component_pipeline_flush() == FOTA_STATUS_FW_INSTALLATION_FAILED);
+
+    // The next update starts clean.
+    start_update(NULL);
+    CHECK(sub_component_pipeline_flush() == FOTA_STATUS_SUCCESS);
+}
+
+static void test_result_runs_the_group(void)
+{
+    start_update("B");
+
+    CHECK(verify("A") == FOTA_STATUS_SUCCESS);
+    CHECK(verify("B") == FOTA_STATUS_SUCCESS);
+    CHECK(sub_component_pipeline_result("B") == FOTA_STATUS_FW_INSTALLATION_FAILED);
+    CHECK(ran.size() == 2);
+    CHECK(sub_component_pipeline_flush() == FOTA_STATUS_FW_INSTALLATION_FAILED);
+}
+
+static void test_pool_is_reused(void)
+{
+    start_update(NULL);
+    const int threads = thread_count();
+
+    for (int i = 0; i < 20; i++) {
+        start_update(NULL);
+        CHECK(install("A") == FOTA_STATUS_SUCCESS);
+        CHECK(install("B") == FOTA_STATUS_SUCCESS);
+        CHECK(install("C") == FOTA_STATUS_SUCCESS);
+    }
+    CHECK(thread_count() == threads);
+}
+
+int main()
+{
+    test_equal_orders_run_concurrently();
+    test_failure_kept_per_sub_component();
+    test_failure_of_incomplete_group();
+    test_result_runs_the_group();
+    test_pool_is_reused();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,447 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Host test of the verification record over an in-memory KCM. Every item
+// which fcc_verify_device_configured_4mbed_cloud() checks, every certificate
+// of the device chains and the private keys must change the digest. The
+// certificates are "CERT:<not after>:<payload>" strings for the stub parser.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "key_config_manager.h"
+#include "fcc_defs.h"
+#include "mbedtls/sha256.h"
+#include "pal.h"
+#include "verification_record.h"
+
+const char g_fcc_use_bootstrap_parameter_name[] = "mbed.UseBootstrap";
+const char g_fcc_endpoint_parameter_name[] = "mbed.EndpointName";
+const char g_fcc_first_to_claim_parameter_name[] = "mbed.FirstToClaim";
+const char g_fcc_manufacturer_parameter_name[] = "mbed.Manufacturer";
+const char g_fcc_model_number_parameter_name[] = "mbed.ModelNumber";
+const char g_fcc_device_type_parameter_name[] = "mbed.DeviceType";
+const char g_fcc_hardware_version_parameter_name[] = "mbed.HardwareVersion";
+const char g_fcc_memory_size_parameter_name[] = "mbed.MemoryTotalKB";
+const char g_fcc_device_serial_number_parameter_name[] = "mbed.SerialNumber";
+const char g_fcc_device_time_zone_parameter_name[] = "mbed.Timezone";
+const char g_fcc_offset_from_utc_parameter_name[] = "mbed.UTCOffset";
+const char g_fcc_bootstrap_server_uri_name[] = "mbed.BootstrapServerURI";
+const char g_fcc_bootstrap_server_ca_certificate_name[] = "mbed.BootstrapServerCACert";
+const char g_fcc_bootstrap_device_certificate_name[] = "mbed.BootstrapDeviceCert";
+const char g_fcc_bootstrap_device_private_key_name[] = "mbed.BootstrapDevicePrivateKey";
+const char g_fcc_lwm2m_server_uri_name[] = "mbed.LwM2MServerURI";
+const char g_fcc_lwm2m_server_ca_certificate_name[] = "mbed.LwM2MServerCACert";
+const char g_fcc_lwm2m_device_certificate_name[] = "mbed.LwM2MDeviceCert";
+const char g_fcc_lwm2m_device_private_key_name[] = "mbed.LwM2MDevicePrivateKey";
+const char g_fcc_update_authentication_certificate_name[] = "mbed.UpdateAuthCert";
+const char g_fcc_vendor_id_name[] = "mbed.VendorId";
+const char g_fcc_class_id_name[] = "mbed.ClassId";
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/////////////////
+// In-memory KCM
+/////////////////
+
+typedef std::pair<int, std::string> item_key_t;
+
+static std::map<item_key_t, std::string> items;
+static std::map<std::string, std::vector<std::string> > chains;
+// Private keys whose data cannot be read, as in a secure element.
+static std::set<std::string> unreadable_keys;
+
+struct chain_cursor {
+    std::vector<std::string> certs;
+    size_t next;
+};
+
+static std::string name_of(const uint8_t *name, size_t name_len)
+{
+    return std::string((const char *)name, name_len);
+}
+
+kcm_status_e kcm_item_get_data_size(const uint8_t *name, size_t name_len, kcm_item_type_e type, size_t *size)
+{
+    std::map<item_key_t, std::string>::const_iterator found = items.find(item_key_t(type, name_of(name, name_len)));
+    if (found == items.end()) {
+        return KCM_STATUS_ITEM_NOT_FOUND;
+    }
+    *size = found->second.size();
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_item_get_data(const uint8_t *name, size_t name_len, kcm_item_type_e type,
+                               uint8_t *data, size_t max_size, size_t *size)
+{
+    std::map<item_key_t, std::string>::const_iterator found = items.find(item_key_t(type, name_of(name, name_len)));
+    if (found == items.end()) {
+        return KCM_STATUS_ITEM_NOT_FOUND;
+    }
+    if (type == KCM_PRIVATE_KEY_ITEM && unreadable_keys.count(found->first.second)) {
+        return KCM_STATUS_NOT_PERMITTED;
+    }
+    if (found->second.size() > max_size) {
+        return KCM_STATUS_INSUFFICIENT_BUFFER;
+    }
+    memcpy(data, found->second.data(), found->second.size());
+    *size = found->second.size();
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_item_store(const uint8_t *name, size_t name_len, kcm_item_type_e type, bool is_factory,
+                            const uint8_t *data, size_t size, const kcm_security_desc_s info)
+{
+    (void)is_factory;
+    (void)info;
+    const item_key_t key(type, name_of(name, name_len));
+    if (items.count(key)) {
+        return KCM_STATUS_FILE_EXIST;
+    }
+    items[key] = std::string((const char *)data, size);
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_item_delete(const uint8_t *name, size_t name_len, kcm_item_type_e type)
+{
+    return items.erase(item_key_t(type, name_of(name, name_len))) ? KCM_STATUS_SUCCESS : KCM_STATUS_ITEM_NOT_FOUND;
+}
+
+// A single certificate opens as a chain of one, as in KCM.
+kcm_status_e kcm_cert_chain_open(kcm_cert_chain_handle *handle, const uint8_t *name, size_t name_len, size_t *length)
+{
+    const std::string chain_name = name_of(name, name_len);
+    chain_cursor *cursor = new chain_cursor();
+
+    cursor->next = 0;
+    if (chains.count(chain_name)) {
+        cursor->certs = chains[chain_name];
+    } else if (items.count(item_key_t(KCM_CERTIFICATE_ITEM, chain_name))) {
+        cursor->certs.push_back(items[item_key_t(KCM_CERTIFICATE_ITEM, chain_name)]);
+    } else {
+        delete cursor;
+        return KCM_STATUS_ITEM_NOT_FOUND;
+    }
+    *length = cursor->certs.size();
+    *handle = cursor;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_cert_chain_get_next_size(kcm_cert_chain_handle handle, size_t *size)
+{
+    chain_cursor *cursor = (chain_cursor *)handle;
+    if (cursor->next >= cursor->certs.size()) {
+        return KCM_STATUS_INVALID_PARAMETER;
+    }
+    *size = cursor->certs[cursor->next].size();
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_cert_chain_get_next_data(kcm_cert_chain_handle handle, uint8_t *data, size_t max_size, size_t *size)
+{
+    chain_cursor *cursor = (chain_cursor *)handle;
+    if (cursor->next >= cursor->certs.size()) {
+        return KCM_STATUS_INVALID_PARAMETER;
+    }
+    const std::string &cert = cursor->certs[cursor->next];
+    if (cert.size() > max_size) {
+        return KCM_STATUS_INSUFFICIENT_BUFFER;
+    }
+    memcpy(data, cert.data(), cert.size());
+    *size = cert.size();
+    cursor->next++;
+    return KCM_STATUS_SUCCESS;
+}
+
+kcm_status_e kcm_cert_chain_close(kcm_cert_chain_handle handle)
+{
+    delete (chain_cursor *)handle;
+    return KCM_STATUS_SUCCESS;
+}
+
+/////////////////
+// PAL digest, certificate parser and time
+/////////////////
+
+static mbedtls_sha256_context sha256;
+static std::string parsed_cert;
+static uint64_t now_s;
+
+palStatus_t pal_mdInit(palMDHandle_t *md, palMDType_t type)
+{
+    (void)type;
+    mbedtls_sha256_init(&sha256);
+    mbedtls_sha256_starts_ret(&sha256, 0);
+    *md = (palMDHandle_t)&sha256;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_mdUpdate(palMDHandle_t md, const unsigned char *input, size_t length)
+{
+    mbedtls_sha256_update_ret((mbedtls_sha256_context *)md, input, length);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_mdFinal(palMDHandle_t md, unsigned char *output)
+{
+    mbedtls_sha256_finish_ret((mbedtls_sha256_context *)md, output);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_mdFree(palMDHandle_t *md)
+{
+    mbedtls_sha256_free((mbedtls_sha256_context *)*md);
+    *md = NULLPTR;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_x509Initiate(palX509Handle_t *cert)
+{
+    *cert = 1;
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_x509CertParse(palX509Handle_t cert, const unsigned char *input, size_t length)
+{
+    (void)cert;
+    parsed_cert.assign((const char *)input, length);
+    return parsed_cert.compare(0, 5, "CERT:") == 0 ? PAL_SUCCESS : PAL_ERR_GENERIC_FAILURE;
+}
+
+palStatus_t pal_x509CertGetAttribute(palX509Handle_t cert, palX509Attr_t attr, void *output, size_t size, size_t *actual_size)
+{
+    (void)cert;
+    (void)attr;
+    const uint64_t not_after = strtoull(parsed_cert.c_str() + 5, NULL, 10);
+    if (size < sizeof(not_after)) {
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    memcpy(output, &not_after, sizeof(not_after));
+    *actual_size = sizeof(not_after);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_x509Free(palX509Handle_t *cert)
+{
+    *cert = NULLPTR;
+    return PAL_SUCCESS;
+}
+
+uint64_t pal_osGetTime(void)
+{
+    return now_s;
+}
+
+/////////////////
+// Tests
+/////////////////
+
+#define NOW             1700000000ULL
+#define CERT_NOT_AFTER  "1900000000"
+
+static void put(const char *name, kcm_item_type_e type, const std::string &value)
+{
+    items[item_key_t(type, name)] = value;
+}
+
+static std::string cert(const char *subject)
+{
+    return std::string("CERT:" CERT_NOT_AFTER ":") + subject;
+}
+
+// A developer provisioned device, with two level device certificate chains.
+static void provision(void)
+{
+    items.clear();
+    chains.clear();
+    unreadable_keys.clear();
+    now_s = NOW;
+
+    put(g_fcc_use_bootstrap_parameter_name, KCM_CONFIG_ITEM, std::string("\1\0\0\0", 4));
+    put(g_fcc_endpoint_parameter_name, KCM_CONFIG_ITEM, "016f0c2a0c5b0a580a01000000000000");
+    put(g_fcc_first_to_claim_parameter_name, KCM_CONFIG_ITEM, std::string("\0\0\0\0", 4));
+    put(g_fcc_manufacturer_parameter_name, KCM_CONFIG_ITEM, "Manufacturer");
+    put(g_fcc_model_number_parameter_name, KCM_CONFIG_ITEM, "Model");
+    put(g_fcc_device_type_parameter_name, KCM_CONFIG_ITEM, "Type");
+    put(g_fcc_hardware_version_parameter_name, KCM_CONFIG_ITEM, "1.0");
+    put(g_fcc_memory_size_parameter_name, KCM_CONFIG_ITEM, std::string("\0\1\0\0", 4));
+    put(g_fcc_device_serial_number_parameter_name, KCM_CONFIG_ITEM, "SN0001");
+    put(g_fcc_device_time_zone_parameter_name, KCM_CONFIG_ITEM, "Europe/Helsinki");
+    put(g_fcc_offset_from_utc_parameter_name, KCM_CONFIG_ITEM, "+0200");
+    put(g_fcc_bootstrap_server_uri_name, KCM_CONFIG_ITEM, "coaps://bootstrap.example.com:5684");
+    put(g_fcc_bootstrap_server_ca_certificate_name, KCM_CERTIFICATE_ITEM, cert("bootstrap CA"));
+    put(g_fcc_bootstrap_device_private_key_name, KCM_PRIVATE_KEY_ITEM, "bootstrap private key");
+    put(g_fcc_bootstrap_device_private_key_name, KCM_PUBLIC_KEY_ITEM, "bootstrap public key");
+    put(g_fcc_lwm2m_server_uri_name, KCM_CONFIG_ITEM, "coaps://lwm2m.example.com:5684");
+    put(g_fcc_lwm2m_server_ca_certificate_name, KCM_CERTIFICATE_ITEM, cert("LwM2M CA"));
+    put(g_fcc_lwm2m_device_private_key_name, KCM_PRIVATE_KEY_ITEM, "LwM2M private key");
+    put(g_fcc_update_authentication_certificate_name, KCM_CERTIFICATE_ITEM, cert("update"));
+    put(g_fcc_vendor_id_name, KCM_CONFIG_ITEM, std::string(16, 'v'));
+    put(g_fcc_class_id_name, KCM_CONFIG_ITEM, std::string(16, 'c'));
+
+    chains[g_fcc_bootstrap_device_certificate_name].push_back(cert("bootstrap device"));
+    chains[g_fcc_bootstrap_device_certificate_name].push_back(cert("bootstrap intermediate"));
+    put(g_fcc_bootstrap_device_certificate_name, KCM_CERTIFICATE_ITEM, cert("bootstrap device"));
+    // The LwM2M certificate is a single certificate, not a chain.
+    put(g_fcc_lwm2m_device_certificate_name, KCM_CERTIFICATE_ITEM, cert("LwM2M device"));
+
+    verification_record_clear();
+}
+
+// Flip the last byte, so the size stays the same.
+static void flip(std::string &value)
+{
+    value[value.size() - 1] ^= 1;
+}
+
+static void test_store_and_match(void)
+{
+    provision();
+    CHECK(!verification_record_matches());
+    verification_record_store();
+    CHECK(verification_record_matches());
+    CHECK(verification_record_matches());
+
+    verification_record_clear();
+    CHECK(!verification_record_matches());
+}
+
+// Every stored item, including the private keys, changes the digest.
+static void test_every_item_is_covered(void)
+{
+    provision();
+    const std::map<item_key_t, std::string> provisioned = items;
+
+    for (std::map<item_key_t, std::string>::const_iterator it = provisioned.begin(); it != provisioned.end(); ++it) {
+        const item_key_t key = it->first;
+        // The public key is only read for unreadable private keys, tested below.
+        if (key.first == KCM_PUBLIC_KEY_ITEM) {
+            continue;
+        }
+        // The chain is read instead of the leaf certificate.
+        if (chains.count(key.second)) {
+            continue;
+        }
+
+        verification_record_store();
+        flip(items[key]);
+        if (verification_record_matches()) {
+            printf("change of %s not detected\n", key.second.c_str());
+        }
+        CHECK(!verification_record_matches());
+        items[key] = it->second;
+        CHECK(verification_record_matches());
+
+        items.erase(key);
+        CHECK(!verification_record_matches());
+        items[key] = it->second;
+    }
+}
+
+static void test_chain_is_covered(void)
+{
+    provision();
+    std::vector<std::string> &chain = chains[g_fcc_bootstrap_device_certificate_name];
+
+    verification_record_store();
+    flip(chain[1]);
+    CHECK(!verification_record_matches());
+    flip(chain[1]);
+    CHECK(verification_record_matches());
+
+    chain.push_back(cert("bootstrap root"));
+    CHECK(!verification_record_matches());
+    chain.pop_back();
+    CHECK(verification_record_matches());
+
+    // An intermediate about to expire verifies again.
+    verification_record_clear();
+    chain[1] = "CERT:" + std::to_string(NOW + 24 * 3600) + ":bootstrap intermediate";
+    verification_record_store();
+    CHECK(!verification_record_matches());
+    now_s = 0;
+    CHECK(verification_record_matches());
+}
+
+// A missing optional item hashes differently from an empty one.
+static void test_missing_and_empty_items(void)
+{
+    provision();
+    items.erase(item_key_t(KCM_CONFIG_ITEM, g_fcc_first_to_claim_parameter_name));
+    verification_record_store();
+    CHECK(verification_record_matches());
+
+    put(g_fcc_first_to_claim_parameter_name, KCM_CONFIG_ITEM, "");
+    CHECK(!verification_record_matches());
+}
+
+// A private key which cannot be read is covered by the public key of its pair.
+static void test_unreadable_private_key(void)
+{
+    provision();
+    unreadable_keys.insert(g_fcc_bootstrap_device_private_key_name);
+    verification_record_store();
+    CHECK(verification_record_matches());
+
+    flip(items[item_key_t(KCM_PUBLIC_KEY_ITEM, g_fcc_bootstrap_device_private_key_name)]);
+    CHECK(!verification_record_matches());
+
+    // Without a public key nothing covers the key, no record is kept.
+    provision();
+    unreadable_keys.insert(g_fcc_lwm2m_device_private_key_name);
+    verification_record_store();
+    CHECK(!verification_record_matches());
+    CHECK(!items.count(item_key_t(KCM_CONFIG_ITEM, VERIFICATION_RECORD_NAME)));
+}
+
+static void test_older_record_version(void)
+{
+    provision();
+    verification_record_store();
+    std::string &record = items[item_key_t(KCM_CONFIG_ITEM, VERIFICATION_RECORD_NAME)];
+    CHECK(record.size() > 4);
+    record[0] = 1;
+    CHECK(!verification_record_matches());
+}
+
+int main()
+{
+    test_store_and_match();
+    test_every_item_is_covered();
+    test_chain_is_covered();
+    test_missing_and_empty_items();
+    test_unreadable_private_key();
+    test_older_record_version();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
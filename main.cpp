@@ -54,6 +54,8 @@
 #include "pdmc_example.h"
 #include "application_init.h"
 #include "mcc_common_setup.h"
+#include "startup_profiler.h"
+#include "pdmc_fleet.h"
 
 static void main_application(void);
 
@@ -70,7 +72,11 @@ int mbed_cloud_application_entrypoint(void)
 int main(void)
 #endif //MBED_CLOUD_APPLICATION_NONSTANDARD_ENTRYPOINT
 {
+#if defined(__linux__) && defined(PDMC_FLEET)
+    return pdmc_fleet_run(main_application);
+#else
     return mcc_platform_run_program(main_application);
+#endif
 }
 
 void main_application(void)
@@ -82,22 +88,28 @@ void main_application(void)
 #endif
 
     // Initialize trace-library first
+    startup_profiler_begin(STARTUP_PHASE_TRACE_INIT);
     if (!application_init_mbed_trace()) {
         printf("Failed initializing mbed trace\r\n");
         return;
     }
+    startup_profiler_end(STARTUP_PHASE_TRACE_INIT);
 
     // Initialize storage
+    startup_profiler_begin(STARTUP_PHASE_STORAGE_INIT);
     if (mcc_platform_storage_init() != 0) {
         printf("Failed to initialize storage\r\n");
         return;
     }
+    startup_profiler_end(STARTUP_PHASE_STORAGE_INIT);
 
     // Initialize platform-specific components
+    startup_profiler_begin(STARTUP_PHASE_PLATFORM_INIT);
     if (mcc_platform_init() != 0) {
         printf("ERROR - platform_init() failed!\r\n");
         return;
     }
+    startup_profiler_end(STARTUP_PHASE_PLATFORM_INIT);
 
     // Print some statistics of the object sizes and their heap memory consumption.
     // NOTE: This *must* be done before creating MbedCloudClient, as the statistic calculation
@@ -118,18 +130,24 @@ void main_application(void)
      * 3. Connect to network interface using 'connect()`.                       // Implemented in `mcc_platform_interface_connect()`.
      * 4. Connect Device Management Client to service using `setup()`.          // Implemented in `mbedClient.register_and_connect)`.
      */
+    startup_profiler_begin(STARTUP_PHASE_INTERFACE_INIT);
     (void) mcc_platform_interface_init();
+    startup_profiler_end(STARTUP_PHASE_INTERFACE_INIT);
 
     // application_init() runs the following initializations:
     //  1. platform initialization
     //  2. print memory statistics if MEMORY_TESTS_HEAP is defined
     //  3. FCC initialization.
+    startup_profiler_begin(STARTUP_PHASE_APPLICATION_INIT);
     if (!application_init()) {
         printf("Initialization failed, exiting application!\r\n");
         return;
     }
+    startup_profiler_end(STARTUP_PHASE_APPLICATION_INIT);
 
+    startup_profiler_begin(STARTUP_PHASE_PDMC_INIT);
     pdmc_init();
+    startup_profiler_end(STARTUP_PHASE_PDMC_INIT);
 
 #if defined MBED_CONF_MBED_CLOUD_CLIENT_NETWORK_MANAGER &&\
  (MBED_CONF_MBED_CLOUD_CLIENT_NETWORK_MANAGER == 1)
@@ -147,22 +165,10 @@ void main_application(void)
     // Print platform information
     mcc_platform_sw_build_info();
 
-    // Initialize network
-    int timeout_ms = 5000;
-    int retry_counter = 0;
-    while (-1 == mcc_platform_interface_connect()) {
-        // Will try to connect using mcc_platform_interface_connect forever.
-        // wait timeout is always doubled
-        printf("Network connect failed. Try again after %d milliseconds.\n", timeout_ms);
-        mcc_platform_do_wait(timeout_ms);
-        timeout_ms *= 2;
-
-        if (++retry_counter == MAX_PDMC_CLIENT_CONNECTION_ERROR_COUNT) {
-            printf("Max error count %d reached, rebooting.\n\n", MAX_PDMC_CLIENT_CONNECTION_ERROR_COUNT);
-            mcc_platform_do_wait(1000);
-            mcc_platform_reboot();
-        }
-    }
+    // Initialize network, retries with backoff and reboots after MAX_PDMC_CLIENT_CONNECTION_ERROR_COUNT failures
+    startup_profiler_begin(STARTUP_PHASE_INTERFACE_CONNECT);
+    pdmc_connect_network();
+    startup_profiler_end(STARTUP_PHASE_INTERFACE_CONNECT);
     printf("Network initialized, registering...\r\n");
 
 #ifdef MEMORY_TESTS_HEAP
@@ -182,6 +188,8 @@ void main_application(void)
     }
 #endif
 
+    // The registration phase ends in the MbedCloudClient::Registered callback.
+    startup_profiler_begin(STARTUP_PHASE_REGISTRATION);
     pdmc_connect();
 
 #ifdef USE_EVENT_QUEUE
@@ -197,14 +205,15 @@ void main_application(void)
  (MBED_CONF_MBED_CLOUD_CLIENT_NETWORK_MANAGER == 1)
     // Wait until client is registered.
     while (pdmc_registered() == false) {
-        mcc_platform_do_wait(100);
+        mcc_platform_wait_event(MCC_PLATFORM_EVENT_REGISTERED, MCC_PLATFORM_WAIT_FOREVER);
     }
     network_manager.nm_cloud_client_connect_indication();
 #endif
 
-    // Check if client is registering or registered, if true sleep and repeat.
+    // Sleep while the client is registering or registered, the status
+    // handler wakes us up when it unregisters.
     while (pdmc_register_called()) {
-        mcc_platform_do_wait(100);
+        mcc_platform_wait_event(MCC_PLATFORM_EVENT_UNREGISTERED, MCC_PLATFORM_WAIT_FOREVER);
     }
 
     // Client unregistered, disconnect and exit program.
@@ -41,6 +41,11 @@
 #define MBED_CONF_MBED_CLIENT_MAX_CERTIFICATE_SIZE   2048
 #endif
 
+// utils/local_lwm2m_server.py serves plain CoAP over UDP.
+#if defined(LOCAL_LWM2M_SERVER_URI) && !defined(MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP_QUEUE)
+#define MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP
+#endif
+
 #if !defined(MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP) && !defined(MBED_CLOUD_CLIENT_TRANSPORT_MODE_TCP) && !defined(MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP_QUEUE)
 #define MBED_CLOUD_CLIENT_TRANSPORT_MODE_TCP
 #endif
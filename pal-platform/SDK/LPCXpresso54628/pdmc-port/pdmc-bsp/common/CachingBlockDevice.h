@@ -0,0 +1,155 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2022 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CACHING_BLOCK_DEVICE_H
+#define CACHING_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+
+// Number of cache lines, the cache uses lines * line size bytes of RAM.
+#ifndef CACHING_BLOCK_DEVICE_LINES
+#define CACHING_BLOCK_DEVICE_LINES 8
+#endif
+
+// Bytes per cache line, a multiple of the program size.
+#ifndef CACHING_BLOCK_DEVICE_LINE_SIZE
+#define CACHING_BLOCK_DEVICE_LINE_SIZE 512
+#endif
+
+/** Operation counters of a CachingBlockDevice
+ */
+struct caching_block_device_stats_t {
+    uint32_t reads;             /*!< read() calls */
+    uint32_t read_hits;         /*!< read() calls served from the cache */
+    uint32_t programs;          /*!< program() calls */
+    uint32_t device_reads;      /*!< reads of the underlying device */
+    uint32_t device_programs;   /*!< programs of the underlying device */
+    uint32_t device_erases;     /*!< erases of the underlying device */
+};
+
+/** BlockDevice decorator with an LRU read cache and write-back programs
+ *
+ *  Reads are served from lines of the underlying device kept in RAM, and
+ *  programs are collected in the lines. The programmed pages of a line are
+ *  written back with one program per run of consecutive pages when the line
+ *  is evicted, on sync() and on deinit(). Lines never straddle an erase unit.
+ *
+ *  As with BufferedBlockDevice, programmed data reaches the device on sync(),
+ *  so users must sync at their commit points, which KVStore does.
+ */
+class CachingBlockDevice : public mbed::BlockDevice {
+public:
+
+    /** Creates a CachingBlockDevice
+     *
+     *  @param bd       Underlying block device
+     */
+    CachingBlockDevice(mbed::BlockDevice *bd);
+
+    virtual ~CachingBlockDevice();
+
+    /** Initialize the underlying device and allocate the cache
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Write back the cache and deinitialize the underlying device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Write back the programmed data of the cache
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks, through the cache
+     *
+     *  @param buffer   Buffer to write blocks to
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    /** Program blocks, into the cache
+     *
+     *  The blocks must have been erased prior to being programmed
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    /** Erase blocks, drops the cached data of the blocks
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    virtual mbed::bd_size_t get_read_size() const;
+
+    virtual mbed::bd_size_t get_program_size() const;
+
+    virtual mbed::bd_size_t get_erase_size() const;
+
+    virtual mbed::bd_size_t get_erase_size(mbed::bd_addr_t addr) const;
+
+    virtual int get_erase_value() const;
+
+    virtual mbed::bd_size_t size() const;
+
+    virtual const char *get_type() const;
+
+    /** Get the operation counters
+     *
+     *  @param stats    Counters since init()
+     */
+    void get_stats(caching_block_device_stats_t &stats) const;
+
+private:
+    struct cache_line_t {
+        mbed::bd_addr_t addr;
+        bool used;
+        uint32_t last_use;
+        uint32_t valid;         // pages holding device or programmed data
+        uint32_t dirty;         // pages programmed but not written back
+        uint8_t *data;
+    };
+
+    cache_line_t *find_line(mbed::bd_addr_t line_addr);
+    int get_line(mbed::bd_addr_t line_addr, cache_line_t *&line);
+    int load_line(cache_line_t *line);
+    int write_back(cache_line_t *line);
+
+    mbed::BlockDevice *_bd;
+    cache_line_t _lines[CACHING_BLOCK_DEVICE_LINES];
+    uint8_t *_cache;
+    uint8_t *_scratch;
+    mbed::bd_size_t _line_size;
+    mbed::bd_size_t _page_size;
+    uint32_t _use_count;
+    caching_block_device_stats_t _stats;
+};
+
+#endif /* CACHING_BLOCK_DEVICE_H */
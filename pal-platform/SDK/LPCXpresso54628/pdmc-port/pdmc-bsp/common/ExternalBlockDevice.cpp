@@ -27,6 +27,15 @@
 
 #include "port_storage.h"
 
+/* Cache the storage in RAM, see CachingBlockDevice.h */
+#ifndef BLOCK_DEVICE_CACHE
+#define BLOCK_DEVICE_CACHE 0
+#endif
+
+#if BLOCK_DEVICE_CACHE
+#include "CachingBlockDevice.h"
+#endif
+
 #if 0
 #define debug_print(...) printf(__VA_ARGS__)
 #else
@@ -37,7 +46,12 @@ namespace mbed {
 
 BlockDevice* BlockDevice::get_default_instance()
 {
+#if BLOCK_DEVICE_CACHE
+    static ExternalBlockDevice external_bd;
+    static CachingBlockDevice bd(&external_bd);
+#else
     static ExternalBlockDevice bd;
+#endif
     return &bd;
 }
 
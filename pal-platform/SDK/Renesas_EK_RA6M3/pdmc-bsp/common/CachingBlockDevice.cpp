@@ -0,0 +1,383 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2022 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CachingBlockDevice.h"
+
+#include <new>
+#include <string.h>
+
+using namespace mbed;
+
+// Pages of a line are tracked in 32 bit masks.
+#define MAX_PAGES_PER_LINE 32
+
+static inline bd_size_t min_size(bd_size_t a, bd_size_t b)
+{
+    return (a < b) ? a : b;
+}
+
+CachingBlockDevice::CachingBlockDevice(BlockDevice *bd)
+    : _bd(bd), _cache(NULL), _scratch(NULL), _line_size(0), _page_size(0), _use_count(0)
+{
+    memset(_lines, 0, sizeof(_lines));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+CachingBlockDevice::~CachingBlockDevice()
+{
+    deinit();
+}
+
+int CachingBlockDevice::init()
+{
+    int result = _bd->init();
+
+    if (result != 0) {
+        return result;
+    }
+
+    /* line size: a whole number of pages, within one erase unit */
+    _page_size = _bd->get_program_size();
+    _line_size = (CACHING_BLOCK_DEVICE_LINE_SIZE + _page_size - 1) / _page_size * _page_size;
+
+    if (_line_size > _page_size * MAX_PAGES_PER_LINE) {
+        _line_size = _page_size * MAX_PAGES_PER_LINE;
+    }
+    if (_bd->get_erase_size() % _line_size) {
+        _line_size = _page_size;
+    }
+
+    delete[] _cache;
+    _cache = new (std::nothrow) uint8_t[(CACHING_BLOCK_DEVICE_LINES + 1) * _line_size];
+
+    if (!_cache) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    for (size_t index = 0; index < CACHING_BLOCK_DEVICE_LINES; index++) {
+        _lines[index].used = false;
+        _lines[index].dirty = 0;
+        _lines[index].data = _cache + index * _line_size;
+    }
+    _scratch = _cache + CACHING_BLOCK_DEVICE_LINES * _line_size;
+    _use_count = 0;
+    memset(&_stats, 0, sizeof(_stats));
+
+    return 0;
+}
+
+int CachingBlockDevice::deinit()
+{
+    if (!_cache) {
+        return 0;
+    }
+
+    int result = sync();
+
+    delete[] _cache;
+    _cache = NULL;
+    _scratch = NULL;
+
+    int deinit_result = _bd->deinit();
+
+    return (result != 0) ? result : deinit_result;
+}
+
+int CachingBlockDevice::sync()
+{
+    int result = 0;
+
+    for (size_t index = 0; (index < CACHING_BLOCK_DEVICE_LINES) && (result == 0); index++) {
+        if (_lines[index].used) {
+            result = write_back(&_lines[index]);
+        }
+    }
+
+    return (result != 0) ? result : _bd->sync();
+}
+
+CachingBlockDevice::cache_line_t *CachingBlockDevice::find_line(bd_addr_t line_addr)
+{
+    for (size_t index = 0; index < CACHING_BLOCK_DEVICE_LINES; index++) {
+        if (_lines[index].used && (_lines[index].addr == line_addr)) {
+            return &_lines[index];
+        }
+    }
+
+    return NULL;
+}
+
+int CachingBlockDevice::get_line(bd_addr_t line_addr, cache_line_t *&line)
+{
+    line = find_line(line_addr);
+
+    if (line) {
+        return 0;
+    }
+
+    /* take a free line, or evict the least recently used one */
+    cache_line_t *victim = &_lines[0];
+
+    for (size_t index = 0; index < CACHING_BLOCK_DEVICE_LINES; index++) {
+        if (!_lines[index].used) {
+            victim = &_lines[index];
+            break;
+        }
+        if (_lines[index].last_use < victim->last_use) {
+            victim = &_lines[index];
+        }
+    }
+
+    if (victim->used) {
+        int result = write_back(victim);
+
+        if (result != 0) {
+            return result;
+        }
+    }
+
+    victim->addr = line_addr;
+    victim->used = true;
+    victim->valid = 0;
+    victim->dirty = 0;
+    line = victim;
+
+    return 0;
+}
+
+int CachingBlockDevice::load_line(cache_line_t *line)
+{
+    const uint32_t pages = _line_size / _page_size;
+    const bd_size_t length = min_size(_line_size, _bd->size() - line->addr);
+
+    int result = _bd->read(_scratch, line->addr, length);
+    _stats.device_reads++;
+
+    if (result != 0) {
+        return result;
+    }
+
+    /* keep the pages programmed into the cache */
+    for (uint32_t page = 0; page < pages; page++) {
+        if (!(line->valid & (1UL << page))) {
+            memcpy(line->data + page * _page_size, _scratch + page * _page_size, _page_size);
+        }
+    }
+    line->valid = (pages == MAX_PAGES_PER_LINE) ? 0xFFFFFFFFUL : ((1UL << pages) - 1);
+
+    return 0;
+}
+
+int CachingBlockDevice::write_back(cache_line_t *line)
+{
+    const uint32_t pages = _line_size / _page_size;
+    uint32_t page = 0;
+
+    /* one program per run of consecutive programmed pages */
+    while (line->dirty && (page < pages)) {
+        if (!(line->dirty & (1UL << page))) {
+            page++;
+            continue;
+        }
+
+        uint32_t end = page;
+
+        while ((end < pages) && (line->dirty & (1UL << end))) {
+            end++;
+        }
+
+        int result = _bd->program(line->data + page * _page_size,
+                                  line->addr + page * _page_size,
+                                  (end - page) * _page_size);
+        _stats.device_programs++;
+
+        if (result != 0) {
+            return result;
+        }
+
+        for (; page < end; page++) {
+            line->dirty &= ~(1UL << page);
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t page_mask(bd_size_t offset, bd_size_t size, bd_size_t page_size)
+{
+    uint32_t first = offset / page_size;
+    uint32_t last = (offset + size - 1) / page_size;
+    uint32_t mask = 0;
+
+    for (uint32_t page = first; page <= last; page++) {
+        mask |= (1UL << page);
+    }
+
+    return mask;
+}
+
+int CachingBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    uint8_t *destination = (uint8_t *) buffer;
+    bool hit = true;
+
+    if (!_cache || !is_valid_read(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _stats.reads++;
+
+    while (size) {
+        bd_addr_t line_addr = addr - (addr % _line_size);
+        bd_size_t offset = addr - line_addr;
+        bd_size_t chunk = min_size(_line_size - offset, size);
+        uint32_t pages = page_mask(offset, chunk, _page_size);
+        cache_line_t *line = find_line(line_addr);
+        int result = 0;
+
+        if (!line && (chunk == _line_size) && (size > _line_size)) {
+
+            /* whole lines of a bulk read bypass the cache, so they do not evict it */
+            result = _bd->read(destination, addr, chunk);
+            _stats.device_reads++;
+            hit = false;
+
+        } else {
+            if (!line || ((line->valid & pages) != pages)) {
+                result = get_line(line_addr, line);
+
+                if (result == 0) {
+                    result = load_line(line);
+                }
+                hit = false;
+            }
+
+            if (result == 0) {
+                line->last_use = ++_use_count;
+                memcpy(destination, line->data + offset, chunk);
+            }
+        }
+
+        if (result != 0) {
+            return result;
+        }
+
+        addr += chunk;
+        destination += chunk;
+        size -= chunk;
+    }
+
+    if (hit) {
+        _stats.read_hits++;
+    }
+
+    return 0;
+}
+
+int CachingBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    const uint8_t *source = (const uint8_t *) buffer;
+
+    if (!_cache || !is_valid_program(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _stats.programs++;
+
+    while (size) {
+        bd_addr_t line_addr = addr - (addr % _line_size);
+        bd_size_t offset = addr - line_addr;
+        bd_size_t chunk = min_size(_line_size - offset, size);
+        uint32_t pages = page_mask(offset, chunk, _page_size);
+        cache_line_t *line = NULL;
+
+        int result = get_line(line_addr, line);
+
+        if (result != 0) {
+            return result;
+        }
+
+        memcpy(line->data + offset, source, chunk);
+        line->valid |= pages;
+        line->dirty |= pages;
+        line->last_use = ++_use_count;
+
+        addr += chunk;
+        source += chunk;
+        size -= chunk;
+    }
+
+    return 0;
+}
+
+int CachingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    if (!_cache || !is_valid_erase(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    /* lines lie within one erase unit, the erased ones are dropped with their programs */
+    for (size_t index = 0; index < CACHING_BLOCK_DEVICE_LINES; index++) {
+        if (_lines[index].used && (_lines[index].addr >= addr) && (_lines[index].addr < addr + size)) {
+            _lines[index].used = false;
+            _lines[index].dirty = 0;
+        }
+    }
+
+    _stats.device_erases++;
+
+    return _bd->erase(addr, size);
+}
+
+bd_size_t CachingBlockDevice::get_read_size() const
+{
+    return _bd->get_read_size();
+}
+
+bd_size_t CachingBlockDevice::get_program_size() const
+{
+    return _bd->get_program_size();
+}
+
+bd_size_t CachingBlockDevice::get_erase_size() const
+{
+    return _bd->get_erase_size();
+}
+
+bd_size_t CachingBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _bd->get_erase_size(addr);
+}
+
+int CachingBlockDevice::get_erase_value() const
+{
+    return _bd->get_erase_value();
+}
+
+bd_size_t CachingBlockDevice::size() const
+{
+    return _bd->size();
+}
+
+const char *CachingBlockDevice::get_type() const
+{
+    return _bd->get_type();
+}
+
+void CachingBlockDevice::get_stats(caching_block_device_stats_t &stats) const
+{
+    stats = _stats;
+}
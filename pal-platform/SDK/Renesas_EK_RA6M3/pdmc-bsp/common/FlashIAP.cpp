@@ -100,11 +100,16 @@ int FlashIAP::erase(uint32_t address, uint32_t size)
     int32_t ret = 0;
 
     while ((address < erase_end_addr) && (ret == 0)) {
+        uint32_t erased = 0;
 
-        ret = flash_erase_sector(NULL, address);
-        uint32_t current_sector_size = flash_get_sector_size(NULL, address);
+        ret = flash_erase_sectors(NULL, address, erase_end_addr - address, &erased);
 
-        address += current_sector_size;
+        /* no progress, avoid looping forever */
+        if ((ret == 0) && (erased == 0)) {
+            ret = -1;
+        }
+
+        address += erased;
     }
 
     return ret;
@@ -18,6 +18,17 @@
 
 #include "port_storage.h"
 
+/* Cache the storage in RAM, see CachingBlockDevice.h. The RA6M3 firmware
+ * build stores KVStore through FlashIAP and does not build this file, so on
+ * RA6M3 the cache only applies to host builds with target/host/host_storage.c. */
+#ifndef BLOCK_DEVICE_CACHE
+#define BLOCK_DEVICE_CACHE 0
+#endif
+
+#if BLOCK_DEVICE_CACHE
+#include "CachingBlockDevice.h"
+#endif
+
 using namespace mbed;
 #include <inttypes.h>
 
@@ -36,7 +47,12 @@ using namespace mbed;
 
 mbed::BlockDevice* mbed::BlockDevice::get_default_instance()
 {
+#if BLOCK_DEVICE_CACHE
+    static PALBlockDevice pal_bd;
+    static CachingBlockDevice default_bd(&pal_bd);
+#else
     static PALBlockDevice default_bd;
+#endif
 
     return &default_bd;
 }
@@ -89,14 +105,35 @@ int PALBlockDevice::erase(bd_addr_t address,
     uint32_t erase_address = address + offset;
     uint32_t end_address = address + offset + size;
 
-    /* erase one sector at a time */
+    /* erase the whole storage in one operation if the port can */
+    if ((address == 0) && (size == port_storage_get_size())) {
+        result = port_storage_erase_all();
+
+        if (result != PORT_STORAGE_ERROR_UNSUPPORTED) {
+            return result;
+        }
+        result = 0;
+    }
+
+    /* erase as many sectors at a time as the port allows */
     while ((erase_address < end_address) && (result == 0)) {
+        uint32_t erased = 0;
+
+        result = port_storage_erase_sectors(erase_address, end_address - erase_address, &erased);
+
+        /* fall back to erasing the current sector */
+        if (result == PORT_STORAGE_ERROR_UNSUPPORTED) {
+            result = port_storage_erase_sector(erase_address);
+            erased = port_storage_get_sector_size(erase_address);
+        }
 
-        /* erase current sector */
-        result = port_storage_erase_sector(erase_address);
+        /* no progress, avoid looping forever */
+        if ((result == 0) && (erased == 0)) {
+            result = -1;
+        }
 
         /* set next erase address */
-        erase_address += port_storage_get_sector_size(erase_address);
+        erase_address += erased;
     }
 
     return result;
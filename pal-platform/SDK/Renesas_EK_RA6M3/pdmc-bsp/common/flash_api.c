@@ -39,6 +39,21 @@ int32_t flash_erase_sector(flash_t *obj, uint32_t address)
     return port_storage_erase_sector(address);
 }
 
+int32_t flash_erase_sectors(flash_t *obj, uint32_t address, uint32_t size, uint32_t *erased)
+{
+    (void) obj;
+
+    int32_t result = port_storage_erase_sectors(address, size, erased);
+
+    /* fall back to erasing the current sector */
+    if (result == PORT_STORAGE_ERROR_UNSUPPORTED) {
+        result = port_storage_erase_sector(address);
+        *erased = port_storage_get_sector_size(address);
+    }
+
+    return result;
+}
+
 int32_t flash_read(flash_t *obj, uint32_t address, uint8_t *data, uint32_t size)
 {
     (void) obj;
@@ -63,6 +63,18 @@ int32_t flash_free(flash_t *obj);
  */
 int32_t flash_erase_sector(flash_t *obj, uint32_t address);
 
+/** Erase consecutive sectors starting at defined address
+ *
+ * Erases as many sectors of the range in one operation as the port allows, or
+ * the sector at address when the port can only erase one at a time.
+ * @param obj The flash object
+ * @param address The sector starting address
+ * @param size The number of bytes left to erase
+ * @param erased The number of bytes erased
+ * @return 0 for success, -1 for error
+ */
+int32_t flash_erase_sectors(flash_t *obj, uint32_t address, uint32_t size, uint32_t *erased);
+
 /** Read data starting at defined address
  *
  * This function has a WEAK implementation using memcpy for backwards compatibility.
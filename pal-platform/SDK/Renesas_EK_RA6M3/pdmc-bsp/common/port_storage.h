@@ -23,6 +23,9 @@
 extern "C" {
 #endif
 
+/* Returned by the optional functions when the port does not provide them. */
+#define PORT_STORAGE_ERROR_UNSUPPORTED (-2)
+
 int32_t port_storage_init(void);
 
 int32_t port_storage_deinit(void);
@@ -33,6 +36,14 @@ int32_t port_storage_program_page(uint32_t address, const uint8_t* data, uint32_
 
 int32_t port_storage_erase_sector(uint32_t address);
 
+/* Optional: erase consecutive sectors from address in one operation, at most size bytes.
+ * The port may erase fewer, e.g. up to the end of a region, and sets erased to the
+ * number of bytes erased. */
+int32_t port_storage_erase_sectors(uint32_t address, uint32_t size, uint32_t* erased);
+
+/* Optional: erase the whole storage area. */
+int32_t port_storage_erase_all(void);
+
 uint32_t port_storage_get_sector_size(uint32_t address);
 
 uint32_t port_storage_get_page_size(uint32_t address);
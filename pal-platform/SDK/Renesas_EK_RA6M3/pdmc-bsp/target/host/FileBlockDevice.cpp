@@ -0,0 +1,178 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2022 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FileBlockDevice.h"
+
+#include <string.h>
+
+using namespace mbed;
+
+#define ERASE_VALUE (0xFF)
+
+FileBlockDevice::FileBlockDevice(const char *path, bd_size_t size, bd_size_t program_size, bd_size_t erase_size)
+    : _path(path), _file(NULL), _size(size), _program_size(program_size), _erase_size(erase_size)
+{
+}
+
+FileBlockDevice::~FileBlockDevice()
+{
+    deinit();
+}
+
+int FileBlockDevice::fill(bd_addr_t addr, bd_size_t size)
+{
+    uint8_t erased[256];
+
+    memset(erased, ERASE_VALUE, sizeof(erased));
+
+    if (fseek(_file, addr, SEEK_SET) != 0) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    while (size) {
+        size_t chunk = (size < sizeof(erased)) ? size : sizeof(erased);
+
+        if (fwrite(erased, 1, chunk, _file) != chunk) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        size -= chunk;
+    }
+
+    return 0;
+}
+
+int FileBlockDevice::init()
+{
+    if (_file) {
+        return 0;
+    }
+
+    _file = fopen(_path, "r+b");
+
+    if (!_file) {
+        _file = fopen(_path, "w+b");
+
+        if (!_file) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+    }
+
+    /* extend a new or short file with erased bytes */
+    fseek(_file, 0, SEEK_END);
+    long length = ftell(_file);
+
+    if ((length >= 0) && ((bd_size_t) length < _size)) {
+        return fill(length, _size - length);
+    }
+
+    return 0;
+}
+
+int FileBlockDevice::deinit()
+{
+    if (_file) {
+        fclose(_file);
+        _file = NULL;
+    }
+
+    return 0;
+}
+
+int FileBlockDevice::sync()
+{
+    return (_file && (fflush(_file) == 0)) ? 0 : BD_ERROR_DEVICE_ERROR;
+}
+
+int FileBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!_file || !is_valid_read(addr, size) || (fseek(_file, addr, SEEK_SET) != 0)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return (fread(buffer, 1, size, _file) == size) ? 0 : BD_ERROR_DEVICE_ERROR;
+}
+
+int FileBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    uint8_t current[256];
+    bd_size_t checked = 0;
+
+    if (!_file || !is_valid_program(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    /* programming only works on erased flash */
+    while (checked < size) {
+        size_t chunk = (size - checked < sizeof(current)) ? (size - checked) : sizeof(current);
+
+        if (read(current, addr + checked, chunk) != 0) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        for (size_t index = 0; index < chunk; index++) {
+            if (current[index] != ERASE_VALUE) {
+                printf("FileBlockDevice: program of unerased byte at 0x%llx\r\n",
+                       (unsigned long long) (addr + checked + index));
+                return BD_ERROR_DEVICE_ERROR;
+            }
+        }
+        checked += chunk;
+    }
+
+    if (fseek(_file, addr, SEEK_SET) != 0) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return (fwrite(buffer, 1, size, _file) == size) ? 0 : BD_ERROR_DEVICE_ERROR;
+}
+
+int FileBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    if (!_file || !is_valid_erase(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return fill(addr, size);
+}
+
+bd_size_t FileBlockDevice::get_read_size() const
+{
+    return 1;
+}
+
+bd_size_t FileBlockDevice::get_program_size() const
+{
+    return _program_size;
+}
+
+bd_size_t FileBlockDevice::get_erase_size() const
+{
+    return _erase_size;
+}
+
+int FileBlockDevice::get_erase_value() const
+{
+    return ERASE_VALUE;
+}
+
+bd_size_t FileBlockDevice::size() const
+{
+    return _size;
+}
+
+const char *FileBlockDevice::get_type() const
+{
+    return "FILE";
+}
@@ -0,0 +1,79 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2022 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FILE_BLOCK_DEVICE_H
+#define FILE_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+
+#include <stdio.h>
+
+/** BlockDevice backed by a file, for host builds
+ *
+ *  Behaves as NOR flash: programming is only allowed on erased bytes, and
+ *  every read, program and erase goes to the file, so the device costs what
+ *  an uncached flash would in operations.
+ */
+class FileBlockDevice : public mbed::BlockDevice {
+public:
+
+    /** Creates a FileBlockDevice
+     *
+     *  @param path         File holding the contents, created erased if missing
+     *  @param size         Device size in bytes
+     *  @param program_size Size of a programmable block in bytes
+     *  @param erase_size   Size of an erasable block in bytes
+     */
+    FileBlockDevice(const char *path, mbed::bd_size_t size,
+                    mbed::bd_size_t program_size = 256, mbed::bd_size_t erase_size = 4096);
+
+    virtual ~FileBlockDevice();
+
+    virtual int init();
+
+    virtual int deinit();
+
+    virtual int sync();
+
+    virtual int read(void *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    virtual int program(const void *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    virtual int erase(mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    virtual mbed::bd_size_t get_read_size() const;
+
+    virtual mbed::bd_size_t get_program_size() const;
+
+    virtual mbed::bd_size_t get_erase_size() const;
+
+    virtual int get_erase_value() const;
+
+    virtual mbed::bd_size_t size() const;
+
+    virtual const char *get_type() const;
+
+private:
+    int fill(mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    const char *_path;
+    FILE *_file;
+    mbed::bd_size_t _size;
+    mbed::bd_size_t _program_size;
+    mbed::bd_size_t _erase_size;
+};
+
+#endif /* FILE_BLOCK_DEVICE_H */
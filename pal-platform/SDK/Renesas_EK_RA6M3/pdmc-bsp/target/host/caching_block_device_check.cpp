@@ -0,0 +1,211 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2022 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host check of CachingBlockDevice against a RAM model.
+ *
+ * Runs random erases, programs, syncs and reads of any size over a cached
+ * FileBlockDevice, and compares every read with a RAM copy of what the
+ * device must hold. Programs follow NOR flash, in program size steps from
+ * the write pointer of each erase unit, as KVStore does. After deinit() the
+ * file must hold the model. A KVStore-like pattern of small metadata reads
+ * with a program and a sync per set then compares the cached and uncached
+ * device operations.
+ *
+ * The device files check.bin and pattern.bin are written to the working
+ * directory. Build and run from pdmc-bsp:
+ *   c++ -Icommon -Itarget/host common/CachingBlockDevice.cpp \
+ *       target/host/FileBlockDevice.cpp target/host/caching_block_device_check.cpp
+ *   ./a.out [operations]
+ */
+
+#include "CachingBlockDevice.h"
+#include "FileBlockDevice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace mbed;
+
+#define DEVICE_SIZE     (256 * 1024)
+#define PROGRAM_SIZE    256
+#define ERASE_SIZE      4096
+#define ERASE_UNITS     (DEVICE_SIZE / ERASE_SIZE)
+#define MAX_READ_SIZE   8192
+
+#define DEFAULT_OPERATIONS 200000
+#define PATTERN_GETS       2000
+
+static uint8_t model[DEVICE_SIZE];
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int check_random_operations(long operations)
+{
+    static uint8_t data[MAX_READ_SIZE];
+    static uint8_t read_back[MAX_READ_SIZE];
+    bd_size_t write_pointer[ERASE_UNITS] = { 0 };
+
+    FileBlockDevice file("check.bin", DEVICE_SIZE, PROGRAM_SIZE, ERASE_SIZE);
+    CachingBlockDevice cache(&file);
+
+    if (cache.init() != BD_ERROR_OK || cache.erase(0, DEVICE_SIZE) != BD_ERROR_OK) {
+        printf("init failed\n");
+        return 1;
+    }
+    memset(model, 0xFF, sizeof(model));
+    srand(1);
+
+    for (long i = 0; i < operations; i++) {
+        const int op = rand() % 100;
+        const int unit = rand() % ERASE_UNITS;
+        const bd_addr_t base = (bd_addr_t)unit * ERASE_SIZE;
+
+        if (op < 2) {
+            if (cache.erase(base, ERASE_SIZE) != BD_ERROR_OK) {
+                printf("erase failed at operation %ld\n", i);
+                return 1;
+            }
+            memset(model + base, 0xFF, ERASE_SIZE);
+            write_pointer[unit] = 0;
+        } else if (op < 20) {
+            if (write_pointer[unit] >= ERASE_SIZE) {
+                continue;
+            }
+            const bd_size_t pages = (ERASE_SIZE - write_pointer[unit]) / PROGRAM_SIZE;
+            const bd_size_t size = PROGRAM_SIZE * (1 + rand() % pages);
+            for (bd_size_t j = 0; j < size; j++) {
+                data[j] = (uint8_t)rand();
+            }
+            if (cache.program(data, base + write_pointer[unit], size) != BD_ERROR_OK) {
+                printf("program failed at operation %ld\n", i);
+                return 1;
+            }
+            memcpy(model + base + write_pointer[unit], data, size);
+            write_pointer[unit] += size;
+        } else if (op < 22) {
+            if (cache.sync() != BD_ERROR_OK) {
+                printf("sync failed at operation %ld\n", i);
+                return 1;
+            }
+        } else {
+            // Mostly small reads, some bulk reads across lines and erase units.
+            const bd_addr_t addr = rand() % DEVICE_SIZE;
+            bd_size_t size = 1 + rand() % ((op < 25) ? MAX_READ_SIZE : 64);
+            if (addr + size > DEVICE_SIZE) {
+                size = DEVICE_SIZE - addr;
+            }
+            if (cache.read(read_back, addr, size) != BD_ERROR_OK) {
+                printf("read failed at operation %ld\n", i);
+                return 1;
+            }
+            if (memcmp(read_back, model + addr, size) != 0) {
+                printf("read mismatch at operation %ld, address 0x%lx size %lu\n",
+                       i, (unsigned long)addr, (unsigned long)size);
+                return 1;
+            }
+        }
+    }
+
+    caching_block_device_stats_t stats;
+    cache.get_stats(stats);
+    if (cache.deinit() != BD_ERROR_OK) {
+        printf("deinit failed\n");
+        return 1;
+    }
+
+    // Everything programmed must have been written back.
+    FileBlockDevice written("check.bin", DEVICE_SIZE, PROGRAM_SIZE, ERASE_SIZE);
+    written.init();
+    for (bd_addr_t addr = 0; addr < DEVICE_SIZE; addr += MAX_READ_SIZE) {
+        if (written.read(read_back, addr, MAX_READ_SIZE) != BD_ERROR_OK ||
+                memcmp(read_back, model + addr, MAX_READ_SIZE) != 0) {
+            printf("file differs from the model at 0x%lx\n", (unsigned long)addr);
+            return 1;
+        }
+    }
+    written.deinit();
+
+    printf("random operations: %ld passed, %u reads (%u hits), %u device reads, %u device programs\n",
+           operations, stats.reads, stats.read_hits, stats.device_reads, stats.device_programs);
+    return 0;
+}
+
+static void measure_pattern(bool cached)
+{
+    uint8_t data[PROGRAM_SIZE];
+    uint8_t read_back[64];
+
+    FileBlockDevice file("pattern.bin", DEVICE_SIZE, PROGRAM_SIZE, ERASE_SIZE);
+    CachingBlockDevice cache(&file);
+    BlockDevice *bd = cached ? (BlockDevice *)&cache : (BlockDevice *)&file;
+
+    bd->init();
+    bd->erase(0, DEVICE_SIZE);
+
+    // Every get reads the area header and the last record, every fourth get is followed by a set.
+    bd_addr_t offset = ERASE_SIZE;
+    const double start_s = now_s();
+    for (int i = 0; i < PATTERN_GETS; i++) {
+        for (int header = 0; header < 4; header++) {
+            bd->read(read_back, header * 16, 16);
+        }
+        bd->read(read_back, (offset > ERASE_SIZE) ? offset - PROGRAM_SIZE : ERASE_SIZE, 64);
+        if (i % 4 == 0) {
+            memset(data, i, sizeof(data));
+            bd->program(data, offset, PROGRAM_SIZE);
+            offset += PROGRAM_SIZE;
+            if (offset >= DEVICE_SIZE) {
+                bd->erase(ERASE_SIZE, DEVICE_SIZE - ERASE_SIZE);
+                offset = ERASE_SIZE;
+            }
+            bd->sync();
+        }
+    }
+    const double elapsed_s = now_s() - start_s;
+
+    if (cached) {
+        caching_block_device_stats_t stats;
+        cache.get_stats(stats);
+        printf("cached:   %.1f us per get, %u device reads for %u reads, %u device programs\n",
+               elapsed_s * 1e6 / PATTERN_GETS, stats.device_reads, stats.reads, stats.device_programs);
+    } else {
+        printf("uncached: %.1f us per get, %d device reads, %d device programs\n",
+               elapsed_s * 1e6 / PATTERN_GETS, PATTERN_GETS * 5, PATTERN_GETS / 4);
+    }
+    bd->deinit();
+}
+
+int main(int argc, char **argv)
+{
+    const long operations = (argc > 1) ? atol(argv[1]) : DEFAULT_OPERATIONS;
+
+    if (check_random_operations(operations) != 0) {
+        printf("FAILED\n");
+        return 1;
+    }
+    measure_pattern(false);
+    measure_pattern(true);
+    printf("PASSED\n");
+    return 0;
+}
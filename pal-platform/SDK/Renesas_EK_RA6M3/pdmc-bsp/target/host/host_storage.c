@@ -0,0 +1,271 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2020 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Simulated port_storage for host builds, to benchmark and check PALBlockDevice.
+ *
+ * The layout follows the RA6M3 code flash: 8 KiB blocks up to 64 KiB, then
+ * 32 KiB blocks. Each erase operation pays a setup time plus a time per block,
+ * so coalesced erases show their gain. Programming is only allowed on erased
+ * bytes.
+ *
+ * Functions for the host programs, declare them where they are used:
+ *   void host_storage_print_stats(void);
+ *   void host_storage_get_stats(uint32_t *erase_operations, uint32_t *erased_blocks);
+ *   void host_storage_configure(int latency, int erase_sectors);
+ * host_storage_configure() turns the simulated latencies and the support of
+ * port_storage_erase_sectors() on or off, both are on by default.
+ *
+ * target/host/host_storage_check.cpp checks and benchmarks the FlashIAP and
+ * PALBlockDevice erases over it.
+ */
+
+#include "port_storage.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define ERASE_VALUE (0xFF)
+
+#define SMALL_BLOCK_SIZE    (8 * 1024)
+#define SMALL_REGION_END    (64 * 1024)
+#define LARGE_BLOCK_SIZE    (32 * 1024)
+#define PAGE_SIZE           (128)
+
+#ifndef HOST_STORAGE_SIZE
+#define HOST_STORAGE_SIZE   (2 * 1024 * 1024)
+#endif
+
+/* Simulated latencies in microseconds. */
+#ifndef HOST_STORAGE_ERASE_SETUP_US
+#define HOST_STORAGE_ERASE_SETUP_US (2000)
+#endif
+#ifndef HOST_STORAGE_ERASE_SMALL_US
+#define HOST_STORAGE_ERASE_SMALL_US (15000)
+#endif
+#ifndef HOST_STORAGE_ERASE_LARGE_US
+#define HOST_STORAGE_ERASE_LARGE_US (45000)
+#endif
+#ifndef HOST_STORAGE_ERASE_ALL_US
+#define HOST_STORAGE_ERASE_ALL_US (1000000)
+#endif
+#ifndef HOST_STORAGE_PROGRAM_US
+#define HOST_STORAGE_PROGRAM_US (100)
+#endif
+
+/* Blocks erased with one operation, as on the target. */
+#ifndef PORT_STORAGE_ERASE_MAX_SECTORS
+#define PORT_STORAGE_ERASE_MAX_SECTORS (8)
+#endif
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+static uint8_t *flash = NULL;
+
+static uint32_t erase_operations = 0;
+static uint32_t erased_blocks = 0;
+static uint32_t programmed_pages = 0;
+
+static int latency_enabled = 1;
+static int erase_sectors_supported = 1;
+
+static void simulate_latency(uint32_t us)
+{
+    struct timespec delay = { us / 1000000, (us % 1000000) * 1000 };
+
+    if (latency_enabled) {
+        nanosleep(&delay, NULL);
+    }
+}
+
+static uint32_t block_size(uint32_t address)
+{
+    return (address < SMALL_REGION_END) ? SMALL_BLOCK_SIZE : LARGE_BLOCK_SIZE;
+}
+
+static uint32_t block_erase_us(uint32_t address)
+{
+    return (address < SMALL_REGION_END) ? HOST_STORAGE_ERASE_SMALL_US : HOST_STORAGE_ERASE_LARGE_US;
+}
+
+int32_t port_storage_init(void)
+{
+    if (!flash) {
+        flash = (uint8_t *) malloc(HOST_STORAGE_SIZE);
+
+        if (!flash) {
+            return -1;
+        }
+
+        /* Contents are undefined before the first erase. */
+        for (uint32_t index = 0; index < HOST_STORAGE_SIZE; index++) {
+            flash[index] = (uint8_t) rand();
+        }
+    }
+
+    return 0;
+}
+
+int32_t port_storage_deinit(void)
+{
+    return 0;
+}
+
+int32_t port_storage_read(uint32_t address, uint8_t *data, uint32_t size)
+{
+    if ((address > HOST_STORAGE_SIZE) || (size > HOST_STORAGE_SIZE - address)) {
+        return -1;
+    }
+
+    memcpy(data, flash + address, size);
+
+    return 0;
+}
+
+int32_t port_storage_program_page(uint32_t address, const uint8_t *data, uint32_t size)
+{
+    if ((address % PAGE_SIZE) || (size % PAGE_SIZE) ||
+        (address > HOST_STORAGE_SIZE) || (size > HOST_STORAGE_SIZE - address)) {
+        return -1;
+    }
+
+    for (uint32_t index = 0; index < size; index++) {
+
+        /* Only erased bytes can be programmed. */
+        if (flash[address + index] != ERASE_VALUE) {
+            printf("host_storage: program of unerased byte at 0x%" PRIX32 "\r\n", address + index);
+            return -1;
+        }
+    }
+
+    simulate_latency(HOST_STORAGE_PROGRAM_US * (size / PAGE_SIZE));
+    memcpy(flash + address, data, size);
+    programmed_pages += size / PAGE_SIZE;
+
+    return 0;
+}
+
+static int32_t erase_blocks(uint32_t address, uint32_t size, uint32_t *erased)
+{
+    uint32_t sector_size = block_size(address);
+    uint32_t region_end = (address < SMALL_REGION_END) ? SMALL_REGION_END : HOST_STORAGE_SIZE;
+    uint32_t count = size / sector_size;
+
+    *erased = 0;
+
+    if ((address >= HOST_STORAGE_SIZE) || (address % sector_size)) {
+        return -1;
+    }
+
+    if (count > (region_end - address) / sector_size) {
+        count = (region_end - address) / sector_size;
+    }
+    if (count > PORT_STORAGE_ERASE_MAX_SECTORS) {
+        count = PORT_STORAGE_ERASE_MAX_SECTORS;
+    }
+    if (count == 0) {
+        count = 1;
+    }
+
+    simulate_latency(HOST_STORAGE_ERASE_SETUP_US + count * block_erase_us(address));
+    memset(flash + address, ERASE_VALUE, count * sector_size);
+    erase_operations++;
+    erased_blocks += count;
+    *erased = count * sector_size;
+
+    return 0;
+}
+
+int32_t port_storage_erase_sector(uint32_t address)
+{
+    uint32_t erased = 0;
+
+    return erase_blocks(address, block_size(address), &erased);
+}
+
+int32_t port_storage_erase_sectors(uint32_t address, uint32_t size, uint32_t *erased)
+{
+    if (!erase_sectors_supported) {
+        return PORT_STORAGE_ERROR_UNSUPPORTED;
+    }
+
+    return erase_blocks(address, size, erased);
+}
+
+int32_t port_storage_erase_all(void)
+{
+    uint32_t small_blocks = SMALL_REGION_END / SMALL_BLOCK_SIZE;
+    uint32_t large_blocks = (HOST_STORAGE_SIZE - SMALL_REGION_END) / LARGE_BLOCK_SIZE;
+
+    simulate_latency(HOST_STORAGE_ERASE_SETUP_US + HOST_STORAGE_ERASE_ALL_US);
+    memset(flash, ERASE_VALUE, HOST_STORAGE_SIZE);
+    erase_operations++;
+    erased_blocks += small_blocks + large_blocks;
+
+    return 0;
+}
+
+uint32_t port_storage_get_sector_size(uint32_t address)
+{
+    return block_size(address);
+}
+
+uint32_t port_storage_get_page_size(uint32_t address)
+{
+    return PAGE_SIZE;
+}
+
+uint32_t port_storage_get_start_address(void)
+{
+    return 0;
+}
+
+uint32_t port_storage_get_size(void)
+{
+    return HOST_STORAGE_SIZE;
+}
+
+uint8_t port_storage_get_erase_value(void)
+{
+    return ERASE_VALUE;
+}
+
+void host_storage_get_stats(uint32_t *operations, uint32_t *blocks)
+{
+    *operations = erase_operations;
+    *blocks = erased_blocks;
+}
+
+void host_storage_configure(int latency, int erase_sectors)
+{
+    latency_enabled = latency;
+    erase_sectors_supported = erase_sectors;
+}
+
+void host_storage_print_stats(void)
+{
+    printf("host_storage: %" PRIu32 " erase operations, %" PRIu32 " blocks erased, %" PRIu32 " pages programmed\r\n",
+           erase_operations, erased_blocks, programmed_pages);
+}
@@ -0,0 +1,315 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2022 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host check and benchmark of the coalesced erases over target/host/host_storage.c.
+ *
+ * The check runs random erases, programs and reads through FlashIAP, the
+ * path of KVStore and FOTA on RA6M3, and through PALBlockDevice, once with
+ * port_storage_erase_sectors() and once with the single-sector fallback.
+ * Every read and, after each erase, the whole storage are compared with a
+ * RAM model, so data outside an erased range must stay untouched. The
+ * simulated latencies are off during the check.
+ *
+ * The benchmark then erases 1 MiB of 32 KiB blocks with the simulated
+ * latencies, one sector per call as FlashIAP::erase() did before, then
+ * through FlashIAP and PALBlockDevice.
+ *
+ * Build and run from pdmc-bsp:
+ *   cc -c -Icommon common/flash_api.c target/host/host_storage.c
+ *   c++ -Icommon common/FlashIAP.cpp common/PALBlockDevice.cpp \
+ *       target/host/host_storage_check.cpp flash_api.o host_storage.o
+ *   ./a.out [operations]
+ */
+
+#include "FlashIAP.h"
+#include "PALBlockDevice.h"
+#include "port_storage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+void host_storage_get_stats(uint32_t *erase_operations, uint32_t *erased_blocks);
+void host_storage_configure(int latency, int erase_sectors);
+}
+
+using namespace mbed;
+
+#define MAX_STORAGE_SIZE    (4 * 1024 * 1024)
+#define MAX_ERASE_SECTORS   40
+#define DEFAULT_OPERATIONS  2000
+
+#define BENCHMARK_ADDRESS   (1024 * 1024)
+#define BENCHMARK_SIZE      (1024 * 1024)
+
+static uint8_t model[MAX_STORAGE_SIZE];
+static uint8_t read_back[MAX_STORAGE_SIZE];
+
+static uint32_t sectors[MAX_STORAGE_SIZE / 1024];
+static uint32_t sector_count;
+static uint32_t storage_size;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Erase through one of the paths, the address is relative to the storage start.
+class Eraser {
+public:
+    virtual ~Eraser() {}
+    virtual const char *name() = 0;
+    virtual int erase(uint32_t address, uint32_t size) = 0;
+    virtual int program(const uint8_t *data, uint32_t address, uint32_t size) = 0;
+    virtual int read(uint8_t *data, uint32_t address, uint32_t size) = 0;
+};
+
+class FlashIAPEraser : public Eraser {
+public:
+    FlashIAPEraser() : _start(0)
+    {
+        _flash.init();
+        _start = _flash.get_flash_start();
+    }
+    ~FlashIAPEraser()
+    {
+        _flash.deinit();
+    }
+    const char *name()
+    {
+        return "FlashIAP";
+    }
+    int erase(uint32_t address, uint32_t size)
+    {
+        return _flash.erase(_start + address, size);
+    }
+    int program(const uint8_t *data, uint32_t address, uint32_t size)
+    {
+        return _flash.program(data, _start + address, size);
+    }
+    int read(uint8_t *data, uint32_t address, uint32_t size)
+    {
+        return _flash.read(data, _start + address, size);
+    }
+
+private:
+    FlashIAP _flash;
+    uint32_t _start;
+};
+
+class PALBlockDeviceEraser : public Eraser {
+public:
+    const char *name()
+    {
+        return "PALBlockDevice";
+    }
+    int erase(uint32_t address, uint32_t size)
+    {
+        return _bd.erase(address, size);
+    }
+    int program(const uint8_t *data, uint32_t address, uint32_t size)
+    {
+        return _bd.program(data, address, size);
+    }
+    int read(uint8_t *data, uint32_t address, uint32_t size)
+    {
+        return _bd.read(data, address, size);
+    }
+
+private:
+    PALBlockDevice _bd;
+};
+
+// Sector start addresses, relative to the storage start.
+static void load_layout(void)
+{
+    const uint32_t start = port_storage_get_start_address();
+
+    storage_size = port_storage_get_size();
+    sector_count = 0;
+    for (uint32_t address = 0; address < storage_size; address += port_storage_get_sector_size(start + address)) {
+        sectors[sector_count++] = address;
+    }
+}
+
+static uint32_t sector_end(uint32_t index)
+{
+    return (index + 1 < sector_count) ? sectors[index + 1] : storage_size;
+}
+
+static int compare_all(Eraser &eraser, long operation)
+{
+    if (eraser.read(read_back, 0, storage_size) != 0) {
+        printf("%s: read failed at operation %ld\n", eraser.name(), operation);
+        return 1;
+    }
+    for (uint32_t address = 0; address < storage_size; address++) {
+        if (read_back[address] != model[address]) {
+            printf("%s: storage differs from the model at 0x%lx after operation %ld\n",
+                   eraser.name(), (unsigned long)address, operation);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_random_operations(Eraser &eraser, long operations, int erase_sectors)
+{
+    static uint8_t data[32 * 1024];
+    const uint32_t page_size = port_storage_get_page_size(port_storage_get_start_address());
+    uint32_t operations_before, blocks_before, operations_after, blocks_after;
+
+    host_storage_configure(0, erase_sectors);
+    host_storage_get_stats(&operations_before, &blocks_before);
+
+    // The contents before the first erase are whatever the storage holds.
+    if (eraser.read(model, 0, storage_size) != 0) {
+        printf("%s: read failed\n", eraser.name());
+        return 1;
+    }
+    srand(1);
+
+    for (long i = 0; i < operations; i++) {
+        const int op = rand() % 100;
+        const uint32_t first = rand() % sector_count;
+
+        if (op < 20) {
+            // A run of sectors, possibly across the block size change and to the end.
+            uint32_t last = first + rand() % MAX_ERASE_SECTORS;
+            if (op < 2) {
+                last = sector_count - 1;
+            } else if (last >= sector_count) {
+                last = sector_count - 1;
+            }
+            const uint32_t size = sector_end(last) - sectors[first];
+            if (eraser.erase(sectors[first], size) != 0) {
+                printf("%s: erase failed at operation %ld\n", eraser.name(), i);
+                return 1;
+            }
+            memset(model + sectors[first], 0xFF, size);
+            if (compare_all(eraser, i) != 0) {
+                return 1;
+            }
+        } else if (op < 60) {
+            // Program erased pages of a sector.
+            const uint32_t pages = (sector_end(first) - sectors[first]) / page_size;
+            const uint32_t page = rand() % pages;
+            uint32_t count = 1 + rand() % (pages - page);
+            if (count * page_size > sizeof(data)) {
+                count = sizeof(data) / page_size;
+            }
+            const uint32_t address = sectors[first] + page * page_size;
+            bool erased = true;
+            for (uint32_t j = 0; j < count * page_size; j++) {
+                erased = erased && (model[address + j] == 0xFF);
+                data[j] = (uint8_t)rand();
+            }
+            if (!erased) {
+                continue;
+            }
+            if (eraser.program(data, address, count * page_size) != 0) {
+                printf("%s: program failed at operation %ld\n", eraser.name(), i);
+                return 1;
+            }
+            memcpy(model + address, data, count * page_size);
+        } else {
+            const uint32_t address = rand() % storage_size;
+            uint32_t size = 1 + rand() % sizeof(data);
+            if (address + size > storage_size) {
+                size = storage_size - address;
+            }
+            if (eraser.read(read_back, address, size) != 0 || memcmp(read_back, model + address, size) != 0) {
+                printf("%s: read mismatch at operation %ld, address 0x%lx size %lu\n",
+                       eraser.name(), i, (unsigned long)address, (unsigned long)size);
+                return 1;
+            }
+        }
+    }
+
+    host_storage_get_stats(&operations_after, &blocks_after);
+    printf("%-14s %-12s %ld operations passed, %lu erase operations for %lu blocks\n",
+           eraser.name(), erase_sectors ? "coalesced" : "fallback", operations,
+           (unsigned long)(operations_after - operations_before),
+           (unsigned long)(blocks_after - blocks_before));
+    return 0;
+}
+
+static void measure_erase(const char *name, Eraser *eraser)
+{
+    const uint32_t start = port_storage_get_start_address();
+    uint32_t operations_before, blocks_before, operations_after, blocks_after;
+
+    host_storage_configure(1, 1);
+    host_storage_get_stats(&operations_before, &blocks_before);
+    const double start_s = now_s();
+
+    if (eraser) {
+        eraser->erase(BENCHMARK_ADDRESS, BENCHMARK_SIZE);
+    } else {
+        for (uint32_t address = BENCHMARK_ADDRESS; address < BENCHMARK_ADDRESS + BENCHMARK_SIZE;
+                address += port_storage_get_sector_size(start + address)) {
+            port_storage_erase_sector(start + address);
+        }
+    }
+
+    const double elapsed_s = now_s() - start_s;
+    host_storage_get_stats(&operations_after, &blocks_after);
+    printf("%-22s %10lu %8lu %10.0f\n", name, (unsigned long)(operations_after - operations_before),
+           (unsigned long)(blocks_after - blocks_before), elapsed_s * 1000);
+}
+
+int main(int argc, char **argv)
+{
+    const long operations = (argc > 1) ? atol(argv[1]) : DEFAULT_OPERATIONS;
+
+    port_storage_init();
+    load_layout();
+    if (storage_size > MAX_STORAGE_SIZE || BENCHMARK_ADDRESS + BENCHMARK_SIZE > storage_size) {
+        printf("unexpected storage size %lu\n", (unsigned long)storage_size);
+        return 1;
+    }
+
+    int failed = 0;
+    {
+        FlashIAPEraser flash;
+        failed |= check_random_operations(flash, operations, 1);
+        failed |= check_random_operations(flash, operations, 0);
+    }
+    {
+        PALBlockDeviceEraser bd;
+        failed |= check_random_operations(bd, operations, 1);
+        failed |= check_random_operations(bd, operations, 0);
+    }
+    if (failed) {
+        printf("FAILED\n");
+        return 1;
+    }
+
+    printf("\n%-22s %10s %8s %10s\n", "1 MiB erase", "operations", "blocks", "ms");
+    measure_erase("one sector per call", NULL);
+    FlashIAPEraser flash;
+    measure_erase("FlashIAP", &flash);
+    PALBlockDeviceEraser bd;
+    measure_erase("PALBlockDevice", &bd);
+
+    printf("PASSED\n");
+    return 0;
+}
@@ -45,6 +45,11 @@
 
 #define ERASE_VALUE (0xFF)
 
+/* Blocks erased with one driver call, bounds the time with interrupts disabled. */
+#ifndef PORT_STORAGE_ERASE_MAX_SECTORS
+#define PORT_STORAGE_ERASE_MAX_SECTORS (8)
+#endif
+
 /*******************************************************************************
  * Prototypes
  ******************************************************************************/
@@ -120,6 +125,69 @@ int32_t port_storage_erase_sector(uint32_t address)
     return (status == FSP_SUCCESS) ? 0 : -1;
 }
 
+int32_t port_storage_erase_sectors(uint32_t address, uint32_t size, uint32_t *erased)
+{
+    DEBUG_PRINT("port_storage_erase_sectors: %X %X\r\n", address, size);
+
+    flash_info_t info = { 0 };
+    fsp_err_t status = g_flash.p_api->infoGet(g_flash.p_ctrl, &info);
+
+    *erased = 0;
+
+    if (status == FSP_SUCCESS) {
+        status = FSP_ERR_INVALID_ARGUMENT;
+
+        /* Step through each flash region. */
+        for (size_t index = 0; index < info.code_flash.num_regions; index++) {
+
+            /**
+             * Find region containing address.
+             */
+            uint32_t start = info.code_flash.p_block_array[index].block_section_st_addr;
+            uint32_t end = info.code_flash.p_block_array[index].block_section_end_addr;
+
+            if ((start <= address) && (address <= end)) {
+
+                /* Blocks of the region within the range, the driver erases them in one go. */
+                uint32_t block_size = info.code_flash.p_block_array[index].block_size;
+                uint32_t count = size / block_size;
+                uint32_t region_count = (end - address + 1) / block_size;
+
+                if (count > region_count) {
+                    count = region_count;
+                }
+                if (count > PORT_STORAGE_ERASE_MAX_SECTORS) {
+                    count = PORT_STORAGE_ERASE_MAX_SECTORS;
+                }
+                if (count == 0) {
+                    count = 1;
+                }
+
+                enter_critical();
+                status = g_flash.p_api->erase(g_flash.p_ctrl, address, count);
+                exit_critical();
+
+                if (status == FSP_SUCCESS) {
+                    *erased = count * block_size;
+                }
+                break;
+            }
+        }
+    }
+
+    return (status == FSP_SUCCESS) ? 0 : -1;
+}
+
+int32_t port_storage_erase_all(void)
+{
+    DEBUG_PRINT("port_storage_erase_all\r\n");
+
+    /**
+     * The storage spans the code flash the application runs from.
+     */
+    return PORT_STORAGE_ERROR_UNSUPPORTED;
+}
+
 int32_t port_storage_read(uint32_t address, uint8_t *data, uint32_t size)
 {
     DEBUG_PRINT("port_storage_read: %X %p %X\r\n", address, data, size);
@@ -22,7 +22,13 @@
 #define PAL_USE_HW_ROT 0
 #define PAL_USE_HW_RTC 0
 #define PAL_USE_HW_TRNG 1
+#if defined(PAL_FLASH_OVER_MMAP)
+// Flash over a memory mapped file, see source/platform/Linux/pal_plat_internal_flash_mmap.c
+#define PAL_SIMULATOR_FLASH_OVER_FILE_SYSTEM 0
+#define PAL_USE_INTERNAL_FLASH 1
+#else
 #define PAL_SIMULATOR_FLASH_OVER_FILE_SYSTEM 1
+#endif
 #define PAL_USE_SECURE_TIME 1
 
 #include "Linux_default.h"
@@ -23,10 +23,22 @@
 #include "mbed-trace/mbed_trace.h"
 #include "mbed-trace-helper.h"
 #include "factory_configurator_client.h"
+#ifdef LOCAL_LWM2M_SERVER_URI
+#include <string.h>
+#include "key_config_manager.h"
+#include "fcc_defs.h"
+#include "pdmc_fleet.h"
+#endif
 #include "mcc_common_setup.h"
 #include "mcc_common_button_and_led.h"
+#include "flash_wear.h"
 #include "application_init.h"
 #include "migrate_kvstore.h"
+#include "startup_profiler.h"
+#include "verification_record.h"
+#if defined(__linux__)
+#include "storage_snapshot.h"
+#endif
 
 #if defined (MEMORY_TESTS_HEAP)
 #include "memory_tests.h"
@@ -222,6 +234,79 @@ bool application_init_mbed_trace(void)
     return true;
 }
 
+#ifdef LOCAL_LWM2M_SERVER_URI
+static kcm_status_e replace_config_item(const char *name, const uint8_t *value, size_t size)
+{
+    // Storing over an existing item fails, so delete it first.
+    kcm_status_e status = kcm_item_delete((const uint8_t *)name, strlen(name), KCM_CONFIG_ITEM);
+    if (status != KCM_STATUS_SUCCESS && status != KCM_STATUS_ITEM_NOT_FOUND) {
+        return status;
+    }
+    return kcm_item_store((const uint8_t *)name, strlen(name), KCM_CONFIG_ITEM, false, value, size, NULL);
+}
+
+#if defined(__linux__) && defined(PDMC_FLEET)
+// The local server identifies the endpoints by name, so append
+// the index of the endpoint to the developer endpoint name.
+static kcm_status_e use_fleet_endpoint_name()
+{
+    const int index = pdmc_fleet_index();
+    const char *name = g_fcc_endpoint_parameter_name;
+    char endpoint_name[128];
+    char suffix[16];
+    size_t size = 0;
+
+    if (index < 0) {
+        return KCM_STATUS_SUCCESS;
+    }
+    kcm_status_e status = kcm_item_get_data((const uint8_t *)name, strlen(name), KCM_CONFIG_ITEM,
+                                            (uint8_t *)endpoint_name, sizeof(endpoint_name) - 1, &size);
+    if (status != KCM_STATUS_SUCCESS) {
+        return status;
+    }
+    endpoint_name[size] = '\0';
+
+    const int suffix_len = snprintf(suffix, sizeof(suffix), "-%d", index);
+    if (size >= (size_t)suffix_len && strcmp(endpoint_name + size - suffix_len, suffix) == 0) {
+        return KCM_STATUS_SUCCESS;
+    }
+    if (size + suffix_len >= sizeof(endpoint_name)) {
+        return KCM_STATUS_INSUFFICIENT_BUFFER;
+    }
+    strcpy(endpoint_name + size, suffix);
+    return replace_config_item(name, (const uint8_t *)endpoint_name, strlen(endpoint_name));
+}
+#endif
+
+// Register directly with the server of utils/local_lwm2m_server.py,
+// without bootstrap and without DTLS.
+static bool use_local_lwm2m_server()
+{
+    const uint32_t use_bootstrap = 0;
+    kcm_status_e status;
+
+    printf("Using local LwM2M server %s\r\n", LOCAL_LWM2M_SERVER_URI);
+    status = replace_config_item(g_fcc_lwm2m_server_uri_name,
+                                 (const uint8_t *)LOCAL_LWM2M_SERVER_URI,
+                                 strlen(LOCAL_LWM2M_SERVER_URI));
+    if (status == KCM_STATUS_SUCCESS) {
+        status = replace_config_item(g_fcc_use_bootstrap_parameter_name,
+                                     (const uint8_t *)&use_bootstrap,
+                                     sizeof(use_bootstrap));
+    }
+#if defined(__linux__) && defined(PDMC_FLEET)
+    if (status == KCM_STATUS_SUCCESS) {
+        status = use_fleet_endpoint_name();
+    }
+#endif
+    if (status != KCM_STATUS_SUCCESS) {
+        printf("Failed to configure local LwM2M server, status %d\r\n", status);
+        return 1;
+    }
+    return 0;
+}
+#endif // LOCAL_LWM2M_SERVER_URI
+
 static bool verify_cloud_configuration()
 {
     int status = 0;
@@ -238,11 +323,30 @@ static bool verify_cloud_configuration()
         result = 1;
     }
 #endif
-#ifndef PDMC_EXAMPLE_MINIMAL
+#ifdef LOCAL_LWM2M_SERVER_URI
+    // The verification requires a coaps:// server, skip it for the local server.
+    if (result == 0) {
+        result = use_local_lwm2m_server();
+    }
+#elif !defined(PDMC_EXAMPLE_MINIMAL)
 #if MBED_CONF_APP_DEVELOPER_MODE == 1
+    // Skip the full verification while the verified credentials are unchanged.
+    uint64_t verify_start_us = startup_profiler_time_us();
+    if (result == 0 && verification_record_matches()) {
+        printf("Credentials unchanged since verification, checked in %lu us\r\n",
+               (unsigned long)(startup_profiler_time_us() - verify_start_us));
+        return 0;
+    }
+    verify_start_us = startup_profiler_time_us();
     status = fcc_verify_device_configured_4mbed_cloud();
+    printf("Credentials verified in %lu us\r\n",
+           (unsigned long)(startup_profiler_time_us() - verify_start_us));
     print_fcc_status(status);
-    if (status != FCC_STATUS_SUCCESS && status != FCC_STATUS_EXPIRED_CERTIFICATE) {
+    if (status == FCC_STATUS_SUCCESS) {
+        if (result == 0) {
+            verification_record_store();
+        }
+    } else if (status != FCC_STATUS_EXPIRED_CERTIFICATE) {
         result = 1;
     }
 #endif
@@ -316,7 +420,9 @@ bool application_init(void)
     int ret;
 
     printf("Migration mode on.\n");
+    flash_wear_subsystem_e previous = flash_wear_enter(FLASH_WEAR_MIGRATION);
     ret = migrate_kvstore(MBED_CLOUD_CLIENT_MIGRATE_BOOTSTRAP_TO);
+    flash_wear_leave(previous);
     if (ret != 0) {
         printf("ERROR - migrate_kvstore failed with %d\n", ret);
         return false;
@@ -338,11 +444,26 @@ bool application_init(void)
 
     printf("Start Device Management Client\r\n");
 
-    if (initialize_fcc() != 0) {
+#if defined(__linux__)
+    // Boot from a provisioned storage snapshot, if one was given.
+    bool snapshot_restored = storage_snapshot_boot();
+#endif
+
+    // Counts the SOTP writes of FCC, the KCM items are files on Linux.
+    flash_wear_subsystem_e previous_wear = flash_wear_enter(FLASH_WEAR_FCC);
+    bool fcc_failed = initialize_fcc();
+    flash_wear_leave(previous_wear);
+    if (fcc_failed) {
         printf("Failed initializing FCC\r\n");
         return false;
     }
 
+#if defined(__linux__)
+    if (!snapshot_restored) {
+        storage_snapshot_provisioned();
+    }
+#endif
+
     return true;
 }
 
@@ -391,7 +512,10 @@ static int sotp_initialize(void)
 // Include this only for Developer mode and a device which doesn't have in-built TRNG support.
 #if MBED_CONF_APP_DEVELOPER_MODE == 1
 #if defined (PAL_USER_DEFINED_CONFIGURATION) && !PAL_USE_HW_TRNG
+    // One SOTP write, counted as a compaction if it erases.
+    flash_wear_operation_begin();
     status = fcc_entropy_set(MBED_CLOUD_DEV_ENTROPY, FCC_ENTROPY_SIZE);
+    flash_wear_operation_end();
 
     if (status != FCC_STATUS_SUCCESS && status != FCC_STATUS_ENTROPY_ERROR) {
         printf("fcc_entropy_set failed with status %d! - exit\r\n", status);
@@ -404,7 +528,9 @@ static int sotp_initialize(void)
     /* Include this only for Developer mode. The application will use fixed RoT to simplify user-experience with the application.
      * With this change the application be reflashed/SOTP can be erased safely without invalidating the application credentials.
      */
+    flash_wear_operation_begin();
     status = fcc_rot_set(MBED_CLOUD_DEV_ROT, FCC_ROT_SIZE);
+    flash_wear_operation_end();
 
     if (status != FCC_STATUS_SUCCESS && status != FCC_STATUS_ROT_ERROR) {
         printf("fcc_rot_set failed with status %d! - exit\r\n", status);
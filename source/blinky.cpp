@@ -27,6 +27,7 @@
 #include "ns-hal-pal/ns_hal_init.h"
 #include "mcc_common_button_and_led.h"
 #include "pdmc_example.h"
+#include "notification_coalescer.h"
 #include "m2mresource.h"
 
 #define BLINKY_TASKLET_LOOP_INIT_EVENT 0
@@ -34,9 +35,15 @@
 #define BLINKY_TASKLET_PATTERN_TIMER 2
 #define BLINKY_TASKLET_LOOP_TIMER 3
 #define BLINKY_TASKLET_AUTOMATIC_INCREMENT_TIMER 4
+#define BLINKY_TASKLET_BUTTON_EVENT 5
 
 #define BUTTON_POLL_INTERVAL_MS 100
 
+// Minimum time between two notifications of the button resource.
+#ifndef BUTTON_NOTIFICATION_MIN_PERIOD_MS
+#define BUTTON_NOTIFICATION_MIN_PERIOD_MS 1000
+#endif
+
 #ifdef MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP_QUEUE
 #define AUTOMATIC_INCREMENT_INTERVAL_MS 300000 // Update resource periodically every 300 seconds
 #else
@@ -45,6 +52,10 @@
 
 int8_t Blinky::_tasklet = -1;
 
+// Preallocated, as button presses are sent from interrupt or input thread context.
+static arm_event_storage_t button_event;
+static volatile bool button_event_queued = false;
+
 extern "C" {
 
     static void blinky_event_handler_wrapper(arm_event_s *event)
@@ -59,21 +70,31 @@ extern "C" {
         }
     }
 
+    static void blinky_button_pressed(void)
+    {
+        // Presses arriving while the previous one is queued are merged with it.
+        if (!button_event_queued) {
+            button_event_queued = true;
+            eventOS_event_send_user_allocated(&button_event);
+        }
+    }
+
 }
 
 Blinky::Blinky()
-    : _pattern(NULL),
-      _curr_pattern(NULL),
+    : _step(0),
       _button_resource(NULL),
       _state(STATE_IDLE),
-      _restart(false)
+      _restart(false),
+      _button_polling(true)
 {
     _button_count = 0;
+    _next_pattern.count = 0;
+    _pattern.count = 0;
 }
 
 Blinky::~Blinky()
 {
-    // stop will free the pattern buffer if any is allocated
     stop();
 }
 
@@ -97,12 +118,33 @@ void Blinky::init(M2MResource *resource)
 
     // create the tasklet, if not done already
     create_tasklet();
+
+    button_event.data.event_type = BLINKY_TASKLET_BUTTON_EVENT;
+    button_event.data.receiver = _tasklet;
+    button_event.data.sender = _tasklet;
+    button_event.data.data_ptr = this;
+    button_event.data.priority = ARM_LIB_LOW_PRIORITY_EVENT;
+
+    _button_polling = !mcc_platform_set_button_callback(blinky_button_pressed);
+
+    if (!notification_coalescer_add(resource, BUTTON_NOTIFICATION_MIN_PERIOD_MS)) {
+        printf("Button resource updates are not coalesced\r\n");
+    }
 }
 
-bool Blinky::start(const char *pattern, size_t length, bool pattern_restart)
+bool Blinky::set_pattern(const char *pattern, size_t length)
 {
-    assert(pattern);
+    blinky_pattern_t compiled;
+
+    if (!blinky_pattern_compile(pattern, length, &compiled)) {
+        return false;
+    }
+    _next_pattern = compiled;
+    return true;
+}
 
+bool Blinky::start(bool pattern_restart)
+{
     // create the tasklet, if not done already
     create_tasklet();
 
@@ -111,61 +153,27 @@ bool Blinky::start(const char *pattern, size_t length, bool pattern_restart)
     // allow one to start multiple times before previous sequence has completed
     stop();
 
-    _pattern = (char *)malloc(length + 1);
-    if (_pattern == NULL) {
-        return false;
-    }
-
-    memcpy(_pattern, pattern, length);
-    _pattern[length] = '\0';
-
-    _curr_pattern = _pattern;
+    _pattern = _next_pattern;
+    _step = 0;
 
     return run_step();
 }
 
 void Blinky::stop()
 {
-    free(_pattern);
-    _pattern = NULL;
-    _curr_pattern = NULL;
+    _step = _pattern.count;
     _state = STATE_IDLE;
 }
 
-int Blinky::get_next_int()
-{
-    int result = -1;
-
-    char *endptr;
-
-    int conv_result  = strtol(_curr_pattern, &endptr, 10);
-
-    if (*_curr_pattern != '\0') {
-        // ints are separated with ':', which we will skip on next time
-        if (*endptr == ':') {
-            endptr += 1;
-            result = conv_result;
-        } else if (*endptr == '\0') { // end of
-            result = conv_result;
-        } else {
-            printf("invalid char %c\n", *endptr);
-        }
-    }
-
-    _curr_pattern = endptr;
-
-    return result;
-}
-
 bool Blinky::run_step()
 {
-    int32_t delay = get_next_int();
-
-    if (delay < 0) {
+    if (_step >= _pattern.count) {
         _state = STATE_IDLE;
         return false;
     }
 
+    const int32_t delay = _pattern.steps[_step++];
+
     if (request_timed_event(BLINKY_TASKLET_PATTERN_TIMER, ARM_LIB_MED_PRIORITY_EVENT, delay) == false) {
         _state = STATE_IDLE;
         assert(false);
@@ -188,6 +196,10 @@ void Blinky::event_handler(const arm_event_s &event)
         case BLINKY_TASKLET_LOOP_TIMER:
             handle_buttons();
             break;
+        case BLINKY_TASKLET_BUTTON_EVENT:
+            button_event_queued = false;
+            handle_button_press();
+            break;
         case BLINKY_TASKLET_AUTOMATIC_INCREMENT_TIMER:
             handle_automatic_increment();
             break;
@@ -202,13 +214,17 @@ void Blinky::handle_pattern_event()
     bool success = run_step();
 
     if ((!success) && (_restart)) {
-        _curr_pattern = _pattern;
+        _step = 0;
         run_step();
     }
 }
 
 void Blinky::request_next_loop_event()
 {
+    // Only needed when the button presses are not sent as events.
+    if (!_button_polling) {
+        return;
+    }
     request_timed_event(BLINKY_TASKLET_LOOP_TIMER, ARM_LIB_LOW_PRIORITY_EVENT, BUTTON_POLL_INTERVAL_MS);
 }
 
@@ -246,18 +262,18 @@ void Blinky::handle_buttons()
     // this might be stopped now, but the loop should then be restarted after re-registration
     request_next_loop_event();
 
+    if (mcc_platform_button_clicked()) {
+        handle_button_press();
+    }
+}
+
+void Blinky::handle_button_press()
+{
+    assert(_button_resource);
+
     if (pdmc_registered()) {
-        if (mcc_platform_button_clicked()) {
-#ifdef MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP_QUEUE
-            if (pdmc_paused()) {
-                printf("Calling Pelion Client resumed()\r\n");
-                pdmc_resume();
-            }
-#endif
-            _button_count = _button_resource->get_value_int() + 1;
-            _button_resource->set_value(_button_count);
-            printf("Button resource manually updated. Value %d\r\n", _button_count);
-        }
+        increment_button_count();
+        printf("Button resource manually updated. Value %d\r\n", _button_count);
     }
 }
 
@@ -269,14 +285,15 @@ void Blinky::handle_automatic_increment()
     request_automatic_increment_event();
 
     if (pdmc_registered()) {
-#ifdef MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP_QUEUE
-        if (pdmc_paused()) {
-            printf("Calling Pelion Client resumed()\r\n");
-            pdmc_resume();
-        }
-#endif
-        _button_count = _button_resource->get_value_int() + 1;
-        _button_resource->set_value(_button_count);
+        increment_button_count();
         printf("Button resource automatically updated. Value %d\r\n", _button_count);
     }
 }
+
+// The update, and in queue mode the resume, is done by the coalescer
+// together with the other pending notifications.
+void Blinky::increment_button_count()
+{
+    _button_count = notification_coalescer_get_value_int(_button_resource) + 1;
+    notification_coalescer_set_value(_button_resource, _button_count);
+}
@@ -20,9 +20,11 @@
 #define __BLINKY_H__
 
 #include "sal-stack-nanostack-eventloop/nanostack-event-loop/eventOS_event.h"
+#include "blinky_pattern.h"
 
 class M2MResource;
 
+#include <stddef.h>
 #include <stdint.h>
 
 class Blinky {
@@ -38,7 +40,10 @@ public:
 
     void init(M2MResource *resource);
 
-    bool start(const char *pattern, size_t length, bool pattern_restart);
+    // Set the pattern used by the next start(), returns false if it is not valid.
+    bool set_pattern(const char *pattern, size_t length);
+
+    bool start(bool pattern_restart);
 
     void stop();
 
@@ -55,16 +60,18 @@ private:
     bool request_timed_event(uint8_t event_type, arm_library_event_priority_e priority, int32_t delay);
 
     void handle_buttons();
+    void handle_button_press();
     void handle_automatic_increment();
+    void increment_button_count();
 
 private:
-    int get_next_int();
     bool run_step();
 
 private:
 
-    char *_pattern;
-    const char *_curr_pattern;
+    blinky_pattern_t _next_pattern;
+    blinky_pattern_t _pattern;
+    uint8_t _step;
 
     M2MResource     *_button_resource;
 
@@ -74,6 +81,9 @@ private:
 
     bool _restart;
 
+    // Set if the platform cannot deliver button presses as events.
+    bool _button_polling;
+
     static int8_t _tasklet;
 
 };
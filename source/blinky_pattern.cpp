@@ -0,0 +1,66 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include <stdio.h>
+
+#include "blinky_pattern.h"
+
+static bool add_step(blinky_pattern_t *compiled, uint32_t duration)
+{
+    if (compiled->count == BLINKY_PATTERN_MAX_STEPS) {
+        printf("pattern has more than %d steps\n", BLINKY_PATTERN_MAX_STEPS);
+        return false;
+    }
+    compiled->steps[compiled->count++] = duration;
+    return true;
+}
+
+bool blinky_pattern_compile(const char *pattern, size_t length, blinky_pattern_t *compiled)
+{
+    uint32_t value = 0;
+    bool digits = false;
+
+    compiled->count = 0;
+
+    for (size_t i = 0; i < length && pattern[i] != '\0'; i++) {
+        const char c = pattern[i];
+        if (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            if (value > BLINKY_PATTERN_MAX_STEP_MS) {
+                printf("pattern step too long\n");
+                return false;
+            }
+            digits = true;
+        } else if (c == ':' && digits) {
+            if (!add_step(compiled, value)) {
+                return false;
+            }
+            value = 0;
+            digits = false;
+        } else {
+            printf("invalid char %c\n", c);
+            return false;
+        }
+    }
+
+    if (digits && !add_step(compiled, value)) {
+        return false;
+    }
+
+    return compiled->count > 0;
+}
@@ -0,0 +1,50 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef BLINKY_PATTERN_H
+#define BLINKY_PATTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Maximum number of steps in a blink pattern.
+#ifndef BLINKY_PATTERN_MAX_STEPS
+#define BLINKY_PATTERN_MAX_STEPS 32
+#endif
+
+// Maximum duration of one step in milliseconds.
+#define BLINKY_PATTERN_MAX_STEP_MS 86400000
+
+// Blink pattern compiled from its "500:200:500" string form.
+typedef struct blinky_pattern {
+    uint32_t steps[BLINKY_PATTERN_MAX_STEPS];   // Durations in milliseconds
+    uint8_t count;
+} blinky_pattern_t;
+
+/**
+ * @brief Compile a pattern, a list of step durations in milliseconds separated by ':'.
+ *
+ * The value of a resource is not necessarily terminated, so parsing stops at
+ * length or '\0'.
+ *
+ * @return false if the pattern is empty, has an invalid character, a step over
+ *         BLINKY_PATTERN_MAX_STEP_MS or more than BLINKY_PATTERN_MAX_STEPS steps.
+ */
+bool blinky_pattern_compile(const char *pattern, size_t length, blinky_pattern_t *compiled);
+
+#endif // BLINKY_PATTERN_H
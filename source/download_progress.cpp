@@ -0,0 +1,107 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "download_progress.h"
+#include "startup_profiler.h"
+#include "m2minterfacefactory.h"
+#include "m2mresource.h"
+
+static M2MResource *progress_res;
+static M2MResource *throughput_res;
+static M2MResource *eta_res;
+
+static uint64_t start_us;
+static uint32_t start_bytes;
+static uint32_t last_downloaded;
+static uint32_t last_step;
+
+static M2MResource *create_integer_resource(M2MObjectList &object_list, uint16_t resource_id)
+{
+    M2MResource *res = M2MInterfaceFactory::create_resource(object_list, 5000, 0, resource_id,
+                                                            M2MResourceInstance::INTEGER, M2MBase::GET_ALLOWED);
+    if (res) {
+        res->set_value(0);
+        res->set_observable(true);
+    }
+    return res;
+}
+
+bool download_progress_create_resources(M2MObjectList &object_list)
+{
+    progress_res = create_integer_resource(object_list, 4);
+    throughput_res = create_integer_resource(object_list, 5);
+    eta_res = create_integer_resource(object_list, 6);
+
+    return progress_res && throughput_res && eta_res;
+}
+
+void download_progress_update(uint32_t downloaded, uint32_t total)
+{
+    if (total == 0) {
+        return;
+    }
+    // The last block may be reported past the size of the image.
+    if (downloaded > total) {
+        downloaded = total;
+    }
+
+    const uint32_t percent = (uint32_t)((uint64_t)downloaded * 100 / total);
+    const uint32_t step = percent / DOWNLOAD_PROGRESS_STEP_PERCENT;
+    const bool done = (downloaded >= total);
+    bool started = false;
+
+    // A new or restarted download, a resumed one starts from where it was.
+    if (start_us == 0 || downloaded < last_downloaded) {
+        start_us = startup_profiler_time_us();
+        start_bytes = downloaded;
+        started = true;
+    }
+    last_downloaded = downloaded;
+
+    if (!started && step <= last_step && !done) {
+        return;
+    }
+    last_step = step;
+
+    const uint64_t elapsed_us = startup_profiler_time_us() - start_us;
+    uint32_t throughput = 0;
+    uint32_t eta_s = 0;
+    if (elapsed_us > 0) {
+        throughput = (uint32_t)((uint64_t)(downloaded - start_bytes) * 1000000 / elapsed_us);
+    }
+    if (throughput > 0) {
+        eta_s = (total - downloaded) / throughput;
+    }
+
+    printf("Downloading: %" PRIu32 " %%, %" PRIu32 " B/s, %" PRIu32 " s remaining\r\n",
+           percent, throughput, eta_s);
+
+    if (progress_res) {
+        progress_res->set_value(percent);
+        throughput_res->set_value(throughput);
+        eta_res->set_value(eta_s);
+    }
+
+    if (done) {
+        printf("Download completed\r\n");
+        start_us = 0;
+    }
+}
@@ -0,0 +1,51 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef DOWNLOAD_PROGRESS_H
+#define DOWNLOAD_PROGRESS_H
+
+#include <stdint.h>
+
+#include "m2minterface.h"
+
+// Progress is reported each time the download crosses a multiple of this.
+#ifndef DOWNLOAD_PROGRESS_STEP_PERCENT
+#define DOWNLOAD_PROGRESS_STEP_PERCENT 5
+#endif
+
+/**
+ * @brief Create the observable download progress resources:
+ *        5000/0/4 progress in percent, 5000/0/5 throughput in bytes/s
+ *        and 5000/0/6 estimated time remaining in seconds.
+ * @return true on success.
+ */
+bool download_progress_create_resources(M2MObjectList &object_list);
+
+/**
+ * @brief Report download progress, called for every received chunk.
+ *
+ * Costs a couple of divisions per call, the console line and the resource
+ * values are only updated when a DOWNLOAD_PROGRESS_STEP_PERCENT boundary is
+ * crossed or the download completes.
+ *
+ * @param downloaded Bytes received so far.
+ * @param total Size of the download in bytes.
+ */
+void download_progress_update(uint32_t downloaded, uint32_t total);
+
+#endif // DOWNLOAD_PROGRESS_H
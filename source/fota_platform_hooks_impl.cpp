@@ -24,30 +24,85 @@
 #include "fota/fota_platform_hooks.h"
 #if defined(TARGET_LIKE_LINUX) && (MBED_CLOUD_CLIENT_FOTA_SUB_COMPONENT_SUPPORT == 1)
 #include "fota/fota_sub_component.h"
+#include "sub_component_pipeline.h"
 #endif
 
 #if defined(FOTA_CUSTOM_PLATFORM)
 
+#include "fota_stream_installer.h"
+#include "flash_wear.h"
+
+#if defined(TARGET_LIKE_LINUX)
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+// Installed METER image, the base of delta updates.
+#include "meter_fw.h"
+#endif
+
 static fota_component_desc_info_t external_component_info;
 
+// Subsystem charged with the flash wear before the update started. The candidate
+// is a file on Linux, so only the SOTP writes during the update are counted.
+static flash_wear_subsystem_e wear_before_update = FLASH_WEAR_OTHER;
+
 
 /* Callback examples */
 
 #if defined(TARGET_LIKE_LINUX) && (MBED_CLOUD_CLIENT_FOTA_SUB_COMPONENT_SUPPORT == 1)
+/*Subcomponent work, run by the pipeline on its workers*/
+static int sub_component_install_work(const char *sub_comp_name, const char *file_name, const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    printf("Installing sub_comp_name: %s from %s, vendor_data: %.*s\n", sub_comp_name, file_name ? file_name : "", (int)vendor_data_size, vendor_data);
+    return FOTA_STATUS_SUCCESS;
+}
+
+static int sub_component_verify_work(const char *sub_comp_name, const char *file_name, const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    printf("Verifying sub_comp_name: %s, vendor_data: %.*s\n", sub_comp_name, (int)vendor_data_size, vendor_data);
+    return FOTA_STATUS_SUCCESS;
+}
+
+static int sub_component_rollback_work(const char *sub_comp_name, const char *file_name, const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    printf("Rolling back sub_comp_name: %s\n", sub_comp_name);
+    return FOTA_STATUS_SUCCESS;
+}
+
 /*Subcomponent callbacks*/
+static int sub_component_installer(const char *comp_name, const char *sub_comp_name, const char *file_name, const uint8_t *vendor_data, size_t vendor_data_size, void *app_ctx)
+{
+    printf("-----------------------------------------------------------------------------------\n");
+    printf("sub_component_installer CB invoked for sub_comp_name: %s\n", sub_comp_name);
+
+    return sub_component_pipeline_install(sub_comp_name, file_name, vendor_data, vendor_data_size);
+}
+
+static int sub_component_verifier(const char *comp_name, const char *sub_comp_name, const uint8_t *vendor_data, size_t vendor_data_size, void *app_ctx)
+{
+    printf("-----------------------------------------------------------------------------------\n");
+    printf("sub_component_verifier CB invoked for sub_comp_name: %s\n", sub_comp_name);
+
+    return sub_component_pipeline_verify(sub_comp_name, vendor_data, vendor_data_size);
+}
+
 int sub_component_rollback_handler(const char *comp_name, const char *sub_comp_name, const uint8_t *vendor_data, size_t vendor_data_size, void *app_ctx)
 {
     printf("-----------------------------------------------------------------------------------\n");
     printf("sub_component_rollback_handler CB invoked for sub_comp_name: %s, vendor_data: %.*s\n", sub_comp_name, (int)vendor_data_size, vendor_data);
 
-    return FOTA_STATUS_SUCCESS;
+    return sub_component_pipeline_rollback(sub_comp_name, vendor_data, vendor_data_size);
 }
 
 int sub_component_finalize_handler(const char *comp_name, const char *sub_comp_name, const uint8_t *vendor_data, size_t vendor_data_size, fota_status_e fota_status, void *app_ctx)
 {
     printf("-----------------------------------------------------------------------------------\n");
     printf("sub_component_finalize_handler CB invoked for sub_comp_name: %s, vendor_data: %.*s\n", sub_comp_name, (int)vendor_data_size, vendor_data);
-    
+
+    // Groups the package did not fill completely are still waiting.
+    if (fota_status == FOTA_STATUS_SUCCESS) {
+        return sub_component_pipeline_flush();
+    }
     return FOTA_STATUS_SUCCESS;
 }
 #endif //#if defined(TARGET_LIKE_LINUX) && (MBED_CLOUD_CLIENT_FOTA_SUB_COMPONENT_SUPPORT == 1)
@@ -72,17 +127,74 @@ static int pdmc_component_verifier(const char *comp_name, const char *sub_comp_n
     return FOTA_STATUS_SUCCESS;
 }
 
+#if defined(TARGET_LIKE_LINUX)
+#if defined(FOTA_STREAM_INSTALLER_SIM)
+// Program the candidate into the simulated flash, to measure the streaming installer.
+static int meter_fw_stream(const char *candidate_file_name)
+{
+    uint8_t chunk[1024];
+    size_t length;
+
+    FILE *in = fopen(candidate_file_name, "rb");
+    if (!in) {
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    fseek(in, 0, SEEK_END);
+    long image_size = ftell(in);
+    rewind(in);
+
+    int ret = fota_stream_installer_start(fota_stream_installer_default_flash(), (image_size > 0) ? image_size : 0);
+    while (ret == FOTA_STATUS_SUCCESS && (length = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        ret = fota_stream_installer_write(chunk, length);
+    }
+    if (ret == FOTA_STATUS_SUCCESS && ferror(in)) {
+        ret = FOTA_STATUS_INTERNAL_ERROR;
+    }
+    fclose(in);
+
+    if (ret == FOTA_STATUS_SUCCESS) {
+        return fota_stream_installer_finish(NULL);
+    }
+    fota_stream_installer_abort();
+    return ret;
+}
+#endif
+#endif // TARGET_LIKE_LINUX
+
 #if !defined(TARGET_LIKE_LINUX)
 static int pdmc_component_installer(const char *comp_name, const char *sub_comp_name, fota_comp_candidate_iterate_callback_info *info, const uint8_t *vendor_data, size_t vendor_data_size, void *app_ctx)
 {
+    // Stream the candidate to flash when the platform has a backend, otherwise just show progress.
+#if FOTA_STREAM_INSTALLER_FLASH
+    int ret;
+#endif
+
     switch (info->status) {
         case FOTA_CANDIDATE_ITERATE_START:
             printf("fota candidate iterate start \n");
+#if FOTA_STREAM_INSTALLER_FLASH
+            return fota_stream_installer_start(fota_stream_installer_default_flash(), info->header_info->fw_size);
+#else
             return FOTA_STATUS_SUCCESS;
+#endif
         case FOTA_CANDIDATE_ITERATE_FRAGMENT:
+#if FOTA_STREAM_INSTALLER_FLASH
+            ret = fota_stream_installer_write(info->frag_buf, info->frag_size);
+            if (ret != FOTA_STATUS_SUCCESS) {
+                fota_stream_installer_abort();
+            }
+            return ret;
+#else
             printf(".");
             return FOTA_STATUS_SUCCESS;
+#endif
         case FOTA_CANDIDATE_ITERATE_FINISH:
+#if FOTA_STREAM_INSTALLER_FLASH
+            ret = fota_stream_installer_finish(info->header_info->digest);
+            if (ret != FOTA_STATUS_SUCCESS) {
+                return ret;
+            }
+#endif
             printf("\nfota candidate iterate finish \n");
             printf("\nApplication received external update\n"); // Use same phrase than in UCHub case. Test case is polling this line.
             print_component_info(comp_name, sub_comp_name, vendor_data, vendor_data_size);
@@ -98,6 +210,15 @@ static int pdmc_component_installer(const char *comp_name, const char *sub_comp_
     printf("-----------------------------------------------------------------------------------\n");
     printf("pdmc_component_installer CB invoked\n");
     print_component_info(comp_name, sub_comp_name, vendor_data, vendor_data_size);
+    if (strcmp(comp_name, "METER") == 0) {
+#if defined(FOTA_STREAM_INSTALLER_SIM)
+        int ret = meter_fw_stream(file_name);
+        if (ret != FOTA_STATUS_SUCCESS) {
+            return ret;
+        }
+#endif
+        return meter_fw_store(file_name);
+    }
     return FOTA_STATUS_SUCCESS;
 }
 #endif
@@ -108,7 +229,12 @@ int fota_platform_init_hook(bool after_upgrade)
     int ret = 0;
 
     external_component_info.install_alignment = 1;
+#if defined(TARGET_LIKE_LINUX)
+    // A delta needs the installed image as its base, the first update has to be a full one.
+    external_component_info.support_delta = (access(METER_FW_FILE, R_OK) == 0);
+#else
     external_component_info.support_delta = false;
+#endif
     external_component_info.need_reboot = true;
     external_component_info.component_verify_install_cb = NULL;
     external_component_info.component_verify_cb = pdmc_component_verifier;
@@ -118,38 +244,63 @@ int fota_platform_init_hook(bool after_upgrade)
     external_component_info.component_install_cb = pdmc_component_installer;
     external_component_info.component_finalize_cb = NULL;
 
+#if defined(TARGET_LIKE_LINUX)
+    external_component_info.curr_fw_read = meter_fw_read;
+    external_component_info.curr_fw_get_digest = meter_fw_get_digest;
+#else
     external_component_info.curr_fw_read = 0; // only needed if support_delta = true
     external_component_info.curr_fw_get_digest = 0; // only needed if support_delta = true
+#endif
 
     ret = fota_component_add(&external_component_info, "METER", "0.0.0");
 
 #if defined(TARGET_LIKE_LINUX) && (MBED_CLOUD_CLIENT_FOTA_SUB_COMPONENT_SUPPORT == 1)	
     printf("Add sub components\n");
 
+    // Sub-components with the same install or verify order are processed concurrently.
+    sub_component_pipeline_entry_t pipeline_entry = { 0 };
+    pipeline_entry.install = sub_component_install_work;
+    pipeline_entry.verify = sub_component_verify_work;
+    pipeline_entry.rollback = sub_component_rollback_work;
+
     fota_sub_comp_info_t dummy_sub_component_desc = { 0 };
     dummy_sub_component_desc.finalize_cb = sub_component_finalize_handler;
     dummy_sub_component_desc.finalize_order = 1;
-    dummy_sub_component_desc.install_cb= pdmc_component_installer;
+    dummy_sub_component_desc.install_cb = sub_component_installer;
     dummy_sub_component_desc.install_order = 1;
     dummy_sub_component_desc.rollback_cb = sub_component_rollback_handler;
     dummy_sub_component_desc.rollback_order = 2;
-    dummy_sub_component_desc.verify_cb= pdmc_component_verifier;
+    dummy_sub_component_desc.verify_cb = sub_component_verifier;
     dummy_sub_component_desc.verify_order = 1;
     ret = fota_sub_component_add("MAIN","BL", &dummy_sub_component_desc); //Component MAIN registered by default during fota initialization, no need to call `fota_component_add` for MAIN component.
     if (ret != 0){
         return ret;
     }
+    pipeline_entry.name = "BL";
+    pipeline_entry.install_order = dummy_sub_component_desc.install_order;
+    pipeline_entry.verify_order = dummy_sub_component_desc.verify_order;
+    ret = sub_component_pipeline_add(&pipeline_entry);
+    if (ret != 0){
+        return ret;
+    }
 
     fota_sub_comp_info_t dummy_sub_component_desc2 = { 0 };
     dummy_sub_component_desc2.finalize_cb = sub_component_finalize_handler;
     dummy_sub_component_desc2.finalize_order = 2;
-    dummy_sub_component_desc2.install_cb = pdmc_component_installer;
+    dummy_sub_component_desc2.install_cb = sub_component_installer;
     dummy_sub_component_desc2.install_order = 2;
     dummy_sub_component_desc2.rollback_cb = sub_component_rollback_handler;
     dummy_sub_component_desc2.rollback_order = 1;
-    dummy_sub_component_desc2.verify_cb = pdmc_component_verifier;
+    dummy_sub_component_desc2.verify_cb = sub_component_verifier;
     dummy_sub_component_desc2.verify_order = 2;
     ret = fota_sub_component_add("MAIN","rootfs", &dummy_sub_component_desc2);//Component MAIN registered by default during fota initialization, no need to call `fota_component_add` for MAIN component.
+    if (ret != 0){
+        return ret;
+    }
+    pipeline_entry.name = "rootfs";
+    pipeline_entry.install_order = dummy_sub_component_desc2.install_order;
+    pipeline_entry.verify_order = dummy_sub_component_desc2.verify_order;
+    ret = sub_component_pipeline_add(&pipeline_entry);
 #endif
 
     return ret;
@@ -157,16 +308,25 @@ int fota_platform_init_hook(bool after_upgrade)
 
 int fota_platform_start_update_hook(const char *comp_name)
 {
+    wear_before_update = flash_wear_enter(FLASH_WEAR_FOTA);
+#if defined(TARGET_LIKE_LINUX) && (MBED_CLOUD_CLIENT_FOTA_SUB_COMPONENT_SUPPORT == 1)
+    sub_component_pipeline_reset();
+#endif
     return FOTA_STATUS_SUCCESS;
 }
 
 int fota_platform_finish_update_hook(const char *comp_name)
 {
+    flash_wear_leave(wear_before_update);
     return FOTA_STATUS_SUCCESS;
 }
 
 int fota_platform_abort_update_hook(const char *comp_name)
 {
+    flash_wear_leave(wear_before_update);
+#if FOTA_STREAM_INSTALLER_FLASH
+    fota_stream_installer_abort();
+#endif
     return FOTA_STATUS_SUCCESS;
 }
 
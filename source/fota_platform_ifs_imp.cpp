@@ -23,6 +23,7 @@
 #define TRACE_GROUP "FOTA"
 
 #include "fota/fota_app_ifs.h"    // required for implementing custom install callback for Linux like targets
+#include "download_progress.h"
 #include <stdio.h>
 #include <assert.h>
 
@@ -40,13 +41,7 @@ int fota_app_on_complete(int32_t status)
 
 void fota_app_on_download_progress(size_t downloaded_size, size_t current_chunk_size, size_t total_size)
 {
-    static const uint32_t  print_range_percent = 5;
-    uint32_t progress = (downloaded_size + current_chunk_size) * 100 / total_size;
-    uint32_t prev_progress = downloaded_size * 100 / total_size;
-
-    if (downloaded_size == 0 || ((progress / print_range_percent) > (prev_progress / print_range_percent))) {
-        printf("Downloading firmware. %" PRIu32 "%%\n", progress);
-    }
+    download_progress_update(downloaded_size + current_chunk_size, total_size);
 }
 
 int fota_app_on_install_authorization()
@@ -0,0 +1,488 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "mbed-cloud-client/MbedCloudClient.h"
+
+#include "fota_stream_installer.h"
+
+#if (defined(MBED_CLOUD_CLIENT_FOTA_ENABLE) && (MBED_CLOUD_CLIENT_FOTA_ENABLE)) && FOTA_STREAM_INSTALLER_FLASH
+
+#include "startup_profiler.h"
+#include "fota/fota_status.h"
+#include "fota/fota_crypto.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(TARGET_LIKE_LINUX)
+#include <pthread.h>
+#include <unistd.h>
+#define FOTA_STREAM_INSTALLER_THREADED 1
+#elif defined(TARGET_LIKE_MBED)
+#include "mbed.h"
+#if MBED_CONF_RTOS_PRESENT
+#define FOTA_STREAM_INSTALLER_THREADED 1
+#endif
+#endif
+
+#ifndef FOTA_STREAM_INSTALLER_THREADED
+#define FOTA_STREAM_INSTALLER_THREADED 0
+#endif
+
+#ifndef FOTA_STREAM_INSTALLER_STACK_SIZE
+#define FOTA_STREAM_INSTALLER_STACK_SIZE 2048
+#endif
+
+typedef struct {
+    uint8_t data[FOTA_STREAM_INSTALLER_BUFFER_SIZE];
+    uint32_t address;
+    uint32_t size;
+} stream_buffer_t;
+
+static stream_buffer_t buffers[2];
+static stream_buffer_t *filling = NULL;
+// Buffer handed to the writer, NULL while it is idle.
+static stream_buffer_t *in_flight = NULL;
+static int write_result = FOTA_STATUS_SUCCESS;
+
+static const fota_stream_flash_t *stream_flash = NULL;
+static fota_hash_context_t *hash_ctx = NULL;
+static uint32_t erased_until = 0;
+static size_t received = 0;
+static uint64_t start_us = 0;
+static uint64_t flash_busy_us = 0;
+
+/* Erase ahead of the buffer and program it, runs on the writer */
+
+static int program_buffer(stream_buffer_t *buffer)
+{
+    const uint64_t begin_us = startup_profiler_time_us();
+    const uint32_t end = buffer->address + buffer->size;
+    int ret = 0;
+
+    while (ret == 0 && erased_until < end) {
+        uint32_t sector_size = stream_flash->get_sector_size(erased_until);
+        ret = stream_flash->erase(erased_until, sector_size);
+        erased_until += sector_size;
+    }
+    if (ret == 0) {
+        ret = stream_flash->program(buffer->address, buffer->data, buffer->size);
+    }
+
+    flash_busy_us += startup_profiler_time_us() - begin_us;
+    if (ret != 0) {
+        printf("Flash write at 0x%" PRIx32 " failed: %d\n", buffer->address, ret);
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    return FOTA_STATUS_SUCCESS;
+}
+
+/* Writer thread */
+
+#if FOTA_STREAM_INSTALLER_THREADED
+#if defined(TARGET_LIKE_LINUX)
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t writer_thread;
+#define writer_lock()   pthread_mutex_lock(&writer_mutex)
+#define writer_unlock() pthread_mutex_unlock(&writer_mutex)
+#define writer_wait()   pthread_cond_wait(&writer_cond, &writer_mutex)
+#define writer_notify() pthread_cond_broadcast(&writer_cond)
+#else
+static rtos::Mutex writer_mutex;
+static rtos::ConditionVariable writer_cond(writer_mutex);
+static rtos::Thread *writer_thread = NULL;
+#define writer_lock()   writer_mutex.lock()
+#define writer_unlock() writer_mutex.unlock()
+#define writer_wait()   writer_cond.wait()
+#define writer_notify() writer_cond.notify_all()
+#endif
+
+static bool writer_running = false;
+static bool writer_stopping = false;
+
+static void writer_loop(void)
+{
+    writer_lock();
+    for (;;) {
+        while (!in_flight && !writer_stopping) {
+            writer_wait();
+        }
+        if (!in_flight) {
+            break;
+        }
+        stream_buffer_t *buffer = in_flight;
+        writer_unlock();
+
+        int ret = program_buffer(buffer);
+
+        writer_lock();
+        if (ret != FOTA_STATUS_SUCCESS && write_result == FOTA_STATUS_SUCCESS) {
+            write_result = ret;
+        }
+        in_flight = NULL;
+        writer_notify();
+    }
+    writer_unlock();
+}
+
+#if defined(TARGET_LIKE_LINUX)
+static void *writer_thread_func(void *arg)
+{
+    writer_loop();
+    return NULL;
+}
+#endif
+
+static void writer_start(void)
+{
+    writer_stopping = false;
+#if defined(TARGET_LIKE_LINUX)
+    writer_running = (pthread_create(&writer_thread, NULL, writer_thread_func, NULL) == 0);
+#else
+    writer_thread = new (std::nothrow) rtos::Thread(osPriorityBelowNormal, FOTA_STREAM_INSTALLER_STACK_SIZE);
+    writer_running = writer_thread && (writer_thread->start(writer_loop) == osOK);
+#endif
+    if (!writer_running) {
+        printf("No writer thread, programming in the caller\n");
+    }
+}
+
+// Wait until the buffer in flight is programmed.
+static int writer_idle(void)
+{
+    writer_lock();
+    while (in_flight) {
+        writer_wait();
+    }
+    int ret = write_result;
+    writer_unlock();
+    return ret;
+}
+
+static int writer_submit(stream_buffer_t *buffer)
+{
+    if (!writer_running) {
+        return program_buffer(buffer);
+    }
+    writer_lock();
+    while (in_flight) {
+        writer_wait();
+    }
+    int ret = write_result;
+    if (ret == FOTA_STATUS_SUCCESS) {
+        in_flight = buffer;
+        writer_notify();
+    }
+    writer_unlock();
+    return ret;
+}
+
+static void writer_stop(void)
+{
+    writer_lock();
+    writer_stopping = true;
+    writer_notify();
+    writer_unlock();
+#if defined(TARGET_LIKE_LINUX)
+    if (writer_running) {
+        pthread_join(writer_thread, NULL);
+    }
+#else
+    if (writer_thread) {
+        if (writer_running) {
+            writer_thread->join();
+        }
+        delete writer_thread;
+        writer_thread = NULL;
+    }
+#endif
+    writer_running = false;
+}
+#else
+static void writer_start(void)
+{
+}
+
+static int writer_idle(void)
+{
+    return write_result;
+}
+
+static int writer_submit(stream_buffer_t *buffer)
+{
+    int ret = program_buffer(buffer);
+    if (ret != FOTA_STATUS_SUCCESS && write_result == FOTA_STATUS_SUCCESS) {
+        write_result = ret;
+    }
+    return ret;
+}
+
+static void writer_stop(void)
+{
+}
+#endif // FOTA_STREAM_INSTALLER_THREADED
+
+/* Flash backends */
+
+#if defined(TARGET_LIKE_LINUX)
+static uint8_t *sim_flash = NULL;
+static size_t sim_size = 0;
+static unsigned long sim_program_us = FOTA_STREAM_SIM_PROGRAM_US;
+static unsigned long sim_erase_us = FOTA_STREAM_SIM_ERASE_US;
+
+static unsigned long sim_env(const char *name, unsigned long default_value)
+{
+    const char *env = getenv(name);
+    return env ? strtoul(env, NULL, 0) : default_value;
+}
+
+static int sim_init(size_t image_size)
+{
+    sim_size = (image_size + FOTA_STREAM_SIM_SECTOR_SIZE - 1) / FOTA_STREAM_SIM_SECTOR_SIZE * FOTA_STREAM_SIM_SECTOR_SIZE;
+    free(sim_flash);
+    sim_flash = (uint8_t *)malloc(sim_size ? sim_size : 1);
+    if (!sim_flash) {
+        return -1;
+    }
+    // Leftovers of an earlier image, so a missing erase shows up.
+    memset(sim_flash, 0, sim_size);
+    sim_program_us = sim_env("FOTA_STREAM_SIM_PROGRAM_US", FOTA_STREAM_SIM_PROGRAM_US);
+    sim_erase_us = sim_env("FOTA_STREAM_SIM_ERASE_US", FOTA_STREAM_SIM_ERASE_US);
+    return 0;
+}
+
+static int sim_erase(uint32_t address, uint32_t size)
+{
+    if ((address % FOTA_STREAM_SIM_SECTOR_SIZE) || (size % FOTA_STREAM_SIM_SECTOR_SIZE) || address + size > sim_size) {
+        return -1;
+    }
+    usleep(sim_erase_us * (size / FOTA_STREAM_SIM_SECTOR_SIZE));
+    memset(sim_flash + address, 0xFF, size);
+    return 0;
+}
+
+static int sim_program(uint32_t address, const uint8_t *data, uint32_t size)
+{
+    if ((address % FOTA_STREAM_SIM_PAGE_SIZE) || (size % FOTA_STREAM_SIM_PAGE_SIZE) || address + size > sim_size) {
+        return -1;
+    }
+    usleep(sim_program_us * (size / FOTA_STREAM_SIM_PAGE_SIZE));
+    for (uint32_t i = 0; i < size; i++) {
+        // Programming only clears bits.
+        if ((sim_flash[address + i] & data[i]) != data[i]) {
+            return -1;
+        }
+        sim_flash[address + i] = data[i];
+    }
+    return 0;
+}
+
+static uint32_t sim_get_sector_size(uint32_t address)
+{
+    return FOTA_STREAM_SIM_SECTOR_SIZE;
+}
+
+static uint32_t sim_get_page_size(void)
+{
+    return FOTA_STREAM_SIM_PAGE_SIZE;
+}
+
+static uint8_t sim_get_erase_value(void)
+{
+    return 0xFF;
+}
+
+static const fota_stream_flash_t default_flash = {
+    sim_init, sim_erase, sim_program, sim_get_sector_size, sim_get_page_size, sim_get_erase_value
+};
+
+#else
+static mbed::FlashIAP flash_iap;
+
+static int iap_init(size_t image_size)
+{
+    if (image_size > FOTA_STREAM_INSTALLER_SIZE) {
+        return -1;
+    }
+    return flash_iap.init();
+}
+
+static int iap_erase(uint32_t address, uint32_t size)
+{
+    return flash_iap.erase(FOTA_STREAM_INSTALLER_ADDRESS + address, size);
+}
+
+static int iap_program(uint32_t address, const uint8_t *data, uint32_t size)
+{
+    return flash_iap.program(data, FOTA_STREAM_INSTALLER_ADDRESS + address, size);
+}
+
+static uint32_t iap_get_sector_size(uint32_t address)
+{
+    return flash_iap.get_sector_size(FOTA_STREAM_INSTALLER_ADDRESS + address);
+}
+
+static uint32_t iap_get_page_size(void)
+{
+    return flash_iap.get_page_size();
+}
+
+static uint8_t iap_get_erase_value(void)
+{
+    return flash_iap.get_erase_value();
+}
+
+static const fota_stream_flash_t default_flash = {
+    iap_init, iap_erase, iap_program, iap_get_sector_size, iap_get_page_size, iap_get_erase_value
+};
+#endif
+
+const fota_stream_flash_t *fota_stream_installer_default_flash(void)
+{
+    return &default_flash;
+}
+
+/* Installer */
+
+int fota_stream_installer_start(const fota_stream_flash_t *flash, size_t image_size)
+{
+    fota_stream_installer_abort();
+
+    const uint32_t page_size = flash->get_page_size();
+    if (!page_size || FOTA_STREAM_INSTALLER_BUFFER_SIZE % page_size) {
+        printf("Buffer size %u is not a multiple of the page size %" PRIu32 "\n",
+               (unsigned)FOTA_STREAM_INSTALLER_BUFFER_SIZE, page_size);
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    if (flash->init(image_size) != 0 || fota_hash_start(&hash_ctx) != FOTA_STATUS_SUCCESS) {
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+
+    stream_flash = flash;
+    filling = &buffers[0];
+    filling->address = 0;
+    filling->size = 0;
+    in_flight = NULL;
+    write_result = FOTA_STATUS_SUCCESS;
+    erased_until = 0;
+    received = 0;
+    flash_busy_us = 0;
+    start_us = startup_profiler_time_us();
+
+    writer_start();
+    return FOTA_STATUS_SUCCESS;
+}
+
+static int submit_filling(void)
+{
+    stream_buffer_t *buffer = filling;
+    int ret = writer_submit(buffer);
+
+    // The other buffer is free once the writer has taken this one.
+    filling = (buffer == &buffers[0]) ? &buffers[1] : &buffers[0];
+    filling->address = buffer->address + buffer->size;
+    filling->size = 0;
+    return ret;
+}
+
+int fota_stream_installer_write(const uint8_t *data, size_t size)
+{
+    if (!stream_flash) {
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    if (fota_hash_update(hash_ctx, data, size) != FOTA_STATUS_SUCCESS) {
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    received += size;
+
+    while (size) {
+        size_t chunk = FOTA_STREAM_INSTALLER_BUFFER_SIZE - filling->size;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(filling->data + filling->size, data, chunk);
+        filling->size += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (filling->size == FOTA_STREAM_INSTALLER_BUFFER_SIZE) {
+            int ret = submit_filling();
+            if (ret != FOTA_STATUS_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    return FOTA_STATUS_SUCCESS;
+}
+
+int fota_stream_installer_finish(const uint8_t *expected_digest)
+{
+    uint8_t digest[FOTA_CRYPTO_HASH_SIZE];
+    int ret = FOTA_STATUS_SUCCESS;
+
+    if (!stream_flash) {
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+
+    // Pad the tail to a whole page.
+    if (filling->size) {
+        const uint32_t page_size = stream_flash->get_page_size();
+        const uint32_t padded = (filling->size + page_size - 1) / page_size * page_size;
+        memset(filling->data + filling->size, stream_flash->get_erase_value(), padded - filling->size);
+        filling->size = padded;
+        ret = submit_filling();
+    }
+    if (ret == FOTA_STATUS_SUCCESS) {
+        ret = writer_idle();
+    }
+
+    if (ret == FOTA_STATUS_SUCCESS) {
+        ret = fota_hash_result(hash_ctx, digest);
+        if (ret == FOTA_STATUS_SUCCESS && expected_digest && memcmp(digest, expected_digest, sizeof(digest)) != 0) {
+            printf("Installed image digest mismatch\n");
+            ret = FOTA_STATUS_INTERNAL_ERROR;
+        }
+    }
+
+    if (ret == FOTA_STATUS_SUCCESS) {
+        const uint64_t elapsed_us = startup_profiler_time_us() - start_us;
+        printf("Installed %lu bytes in %lu ms, %.2f MB/s, flash busy %lu%%\n",
+               (unsigned long)received, (unsigned long)(elapsed_us / 1000),
+               elapsed_us ? (double)received / (double)elapsed_us : 0.0,
+               elapsed_us ? (unsigned long)(flash_busy_us * 100 / elapsed_us) : 0UL);
+    }
+
+    fota_stream_installer_abort();
+    return ret;
+}
+
+void fota_stream_installer_abort(void)
+{
+    if (!stream_flash) {
+        return;
+    }
+    writer_idle();
+    writer_stop();
+    fota_hash_finish(&hash_ctx);
+    stream_flash = NULL;
+}
+
+#endif // MBED_CLOUD_CLIENT_FOTA_ENABLE && FOTA_STREAM_INSTALLER_FLASH
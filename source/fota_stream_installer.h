@@ -0,0 +1,109 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef FOTA_STREAM_INSTALLER_H
+#define FOTA_STREAM_INSTALLER_H
+
+/*
+ * Reference streaming installer for external components.
+ *
+ * Fragments of the candidate are collected into one of two buffers and hashed
+ * as they arrive. A full buffer is handed to a writer thread, which erases and
+ * programs it while the next fragments fill the other buffer, so the install
+ * time is bound by the flash rather than by the sum of read, verify and write.
+ * Without threads the buffers are programmed in the caller.
+ *
+ * Flash backends:
+ * - Linux: RAM simulator with program and erase latencies, built with
+ *   FOTA_STREAM_INSTALLER_SIM.
+ * - Mbed OS: FlashIAP region given by FOTA_STREAM_INSTALLER_ADDRESS and
+ *   FOTA_STREAM_INSTALLER_SIZE.
+ * Without a backend the installer and its buffers are not built.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if (defined(TARGET_LIKE_LINUX) && defined(FOTA_STREAM_INSTALLER_SIM)) || \
+    (defined(TARGET_LIKE_MBED) && defined(FOTA_STREAM_INSTALLER_ADDRESS) && defined(FOTA_STREAM_INSTALLER_SIZE))
+#define FOTA_STREAM_INSTALLER_FLASH 1
+#else
+#define FOTA_STREAM_INSTALLER_FLASH 0
+#endif
+
+// Size of each of the two buffers, a multiple of the program size.
+#ifndef FOTA_STREAM_INSTALLER_BUFFER_SIZE
+#define FOTA_STREAM_INSTALLER_BUFFER_SIZE 4096
+#endif
+
+// Simulated flash, latencies can be overridden at runtime through
+// the environment variables of the same name.
+#ifndef FOTA_STREAM_SIM_PAGE_SIZE
+#define FOTA_STREAM_SIM_PAGE_SIZE 256
+#endif
+#ifndef FOTA_STREAM_SIM_SECTOR_SIZE
+#define FOTA_STREAM_SIM_SECTOR_SIZE 4096
+#endif
+#ifndef FOTA_STREAM_SIM_PROGRAM_US
+#define FOTA_STREAM_SIM_PROGRAM_US 500      // per page
+#endif
+#ifndef FOTA_STREAM_SIM_ERASE_US
+#define FOTA_STREAM_SIM_ERASE_US 30000      // per sector
+#endif
+
+typedef struct {
+    int (*init)(size_t image_size);
+    int (*erase)(uint32_t address, uint32_t size);
+    int (*program)(uint32_t address, const uint8_t *data, uint32_t size);
+    uint32_t (*get_sector_size)(uint32_t address);
+    uint32_t (*get_page_size)(void);
+    uint8_t (*get_erase_value)(void);
+} fota_stream_flash_t;
+
+#if FOTA_STREAM_INSTALLER_FLASH
+/**
+ * @brief Flash backend of the platform.
+ */
+const fota_stream_flash_t *fota_stream_installer_default_flash(void);
+
+/**
+ * @brief Start installing an image of image_size bytes to the start of the flash.
+ * @return FOTA_STATUS_SUCCESS or a FOTA error.
+ */
+int fota_stream_installer_start(const fota_stream_flash_t *flash, size_t image_size);
+
+/**
+ * @brief Append a fragment of the image, blocks only while both buffers are in use.
+ * @return FOTA_STATUS_SUCCESS, or the error of an earlier write.
+ */
+int fota_stream_installer_write(const uint8_t *data, size_t size);
+
+/**
+ * @brief Program the rest of the image and report the install rate.
+ * @param expected_digest Digest of the image to compare with, or NULL.
+ * @return FOTA_STATUS_SUCCESS or a FOTA error.
+ */
+int fota_stream_installer_finish(const uint8_t *expected_digest);
+
+/**
+ * @brief Stop an install, waits for the write in progress.
+ */
+void fota_stream_installer_abort(void);
+#endif // FOTA_STREAM_INSTALLER_FLASH
+
+#endif // FOTA_STREAM_INSTALLER_H
@@ -0,0 +1,201 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifdef MBED_CLOUD_CLIENT_USER_CONFIG_FILE
+#include MBED_CLOUD_CLIENT_USER_CONFIG_FILE
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "large_res_stream.h"
+#include "m2mresource.h"
+#include "startup_profiler.h"
+
+// One cursor per blockwise transfer in progress. The block buffer is owned by the
+// cursor, so no memory is allocated on the request path and an interrupted transfer
+// only keeps its cursor until a new transfer needs it.
+typedef struct large_res_cursor {
+    const M2MResourceBase *resource;
+    size_t next_offset;
+    uint32_t last_used;
+    bool in_use;
+    uint8_t block[LARGE_RES_STREAM_BLOCK_SIZE];
+} large_res_cursor_t;
+
+static large_res_cursor_t cursors[LARGE_RES_STREAM_MAX_TRANSFERS];
+static uint32_t use_counter = 0;
+
+// Statistics
+static uint32_t stat_blocks = 0;
+static uint32_t stat_transfers = 0;
+static uint32_t stat_evicted = 0;
+static uint32_t stat_active_max = 0;
+static uint64_t stat_first_block_us = 0;
+static uint64_t stat_last_block_us = 0;
+
+static coap_response_code_e large_res_stream_read(const M2MResourceBase &resource,
+                                                  uint8_t *&buffer,
+                                                  size_t &buffer_size,
+                                                  size_t &total_size,
+                                                  const size_t offset,
+                                                  void *client_args);
+
+static large_res_cursor_t *find_cursor(const M2MResourceBase &resource, size_t offset)
+{
+    for (int i = 0; i < LARGE_RES_STREAM_MAX_TRANSFERS; i++) {
+        if (cursors[i].in_use && cursors[i].resource == &resource && cursors[i].next_offset == offset) {
+            return &cursors[i];
+        }
+    }
+    return NULL;
+}
+
+static large_res_cursor_t *acquire_cursor(const M2MResourceBase &resource)
+{
+    large_res_cursor_t *cursor = NULL;
+    large_res_cursor_t *oldest = NULL;
+    uint32_t active = 0;
+
+    for (int i = 0; i < LARGE_RES_STREAM_MAX_TRANSFERS; i++) {
+        if (cursors[i].in_use) {
+            active++;
+            if (!oldest || cursors[i].last_used < oldest->last_used) {
+                oldest = &cursors[i];
+            }
+        } else if (!cursor) {
+            cursor = &cursors[i];
+        }
+    }
+
+    if (cursor) {
+        active++;
+    } else {
+        // All cursors busy, take over the least recently used transfer.
+        cursor = oldest;
+        stat_evicted++;
+    }
+    if (active > stat_active_max) {
+        stat_active_max = active;
+    }
+
+    cursor->resource = &resource;
+    cursor->next_offset = 0;
+    cursor->in_use = true;
+    stat_transfers++;
+
+    return cursor;
+}
+
+bool large_res_stream_attach(M2MResource *resource, const large_res_stream_t *stream)
+{
+    if (!resource || !stream || !stream->read) {
+        return false;
+    }
+    return resource->set_read_resource_function(large_res_stream_read, (void *)stream);
+}
+
+void large_res_stream_release(const M2MBase &resource)
+{
+    // The status callback does not tell which transfer failed. The failed
+    // message is the response to the latest block of the resource, so only
+    // the cursor which served it is released.
+    large_res_cursor_t *latest = NULL;
+
+    for (int i = 0; i < LARGE_RES_STREAM_MAX_TRANSFERS; i++) {
+        if (cursors[i].in_use && cursors[i].resource == &resource &&
+                (!latest || cursors[i].last_used > latest->last_used)) {
+            latest = &cursors[i];
+        }
+    }
+    if (latest) {
+        latest->in_use = false;
+    }
+}
+
+void large_res_stream_print_stats()
+{
+    const uint64_t elapsed_us = stat_last_block_us - stat_first_block_us;
+
+    printf("Large resource transfers: %lu, blocks: %lu, evicted: %lu, max parallel: %lu/%d\r\n",
+           (unsigned long)stat_transfers, (unsigned long)stat_blocks,
+           (unsigned long)stat_evicted, (unsigned long)stat_active_max,
+           LARGE_RES_STREAM_MAX_TRANSFERS);
+    if (elapsed_us > 0) {
+        printf("Large resource blocks/s: %lu\r\n",
+               (unsigned long)((uint64_t)(stat_blocks - 1) * 1000000 / elapsed_us));
+    }
+}
+
+static coap_response_code_e large_res_stream_read(const M2MResourceBase &resource,
+                                                  uint8_t *&buffer,
+                                                  size_t &buffer_size,
+                                                  size_t &total_size,
+                                                  const size_t offset,
+                                                  void *client_args)
+{
+    const large_res_stream_t *stream = (const large_res_stream_t *)client_args;
+
+    total_size = stream->total_size;
+    if (offset > total_size) {
+        return COAP_RESPONSE_BAD_REQUEST;
+    }
+
+    if (buffer_size > LARGE_RES_STREAM_BLOCK_SIZE) {
+        printf("Block size %lu exceeds LARGE_RES_STREAM_BLOCK_SIZE\r\n", (unsigned long)buffer_size);
+        return COAP_RESPONSE_INTERNAL_SERVER_ERROR;
+    }
+
+    // Continue the transfer expecting this offset. A block which is not expected,
+    // e.g. from a transfer whose cursor was evicted, is served from a new cursor,
+    // since the producer does not depend on any earlier blocks.
+    large_res_cursor_t *cursor = NULL;
+    if (offset != 0) {
+        cursor = find_cursor(resource, offset);
+    }
+    if (!cursor) {
+        cursor = acquire_cursor(resource);
+    }
+    cursor->last_used = ++use_counter;
+
+    // Adjust last package size
+    if (offset + buffer_size > total_size) {
+        buffer_size = total_size - offset;
+    }
+
+    const uint8_t *data = stream->read(stream->ctx, offset, cursor->block, buffer_size);
+    if (!data) {
+        cursor->in_use = false;
+        return COAP_RESPONSE_INTERNAL_SERVER_ERROR;
+    }
+
+    // The cursor is released with the last block, its buffer stays intact until
+    // the cursor is acquired again by a following request.
+    cursor->next_offset = offset + buffer_size;
+    if (cursor->next_offset >= total_size) {
+        cursor->in_use = false;
+    }
+
+    buffer = (uint8_t *)data;
+    stat_last_block_us = startup_profiler_time_us();
+    if (stat_blocks++ == 0) {
+        stat_first_block_us = stat_last_block_us;
+    }
+
+    return COAP_RESPONSE_CONTENT;
+}
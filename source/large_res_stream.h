@@ -0,0 +1,83 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef LARGE_RES_STREAM_H
+#define LARGE_RES_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class M2MBase;
+class M2MResource;
+
+// Number of blockwise GET transfers which can be in progress at the same time.
+// When all cursors are busy, a new transfer takes over the least recently used one.
+#ifndef LARGE_RES_STREAM_MAX_TRANSFERS
+#define LARGE_RES_STREAM_MAX_TRANSFERS 4
+#endif
+
+// Size of the per-transfer block buffer, must not be smaller than the CoAP block size in use.
+#ifndef LARGE_RES_STREAM_BLOCK_SIZE
+#define LARGE_RES_STREAM_BLOCK_SIZE SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE
+#endif
+
+/**
+ * @brief Block producer of a streamed resource.
+ *
+ * Called once for every CoAP block of a GET request. A source backed by contiguous
+ * memory can return a pointer straight into that memory, other sources fill `block`
+ * and return it.
+ *
+ * @param ctx Context given in large_res_stream_t.
+ * @param offset Offset of the first requested byte.
+ * @param block Buffer of the transfer cursor, valid until the next block of the same transfer.
+ * @param length Amount of bytes requested.
+ * @return Pointer to `length` bytes of payload, or NULL on error.
+ */
+typedef const uint8_t *(*large_res_stream_read_cb)(void *ctx, size_t offset, uint8_t *block, size_t length);
+
+typedef struct large_res_stream {
+    large_res_stream_read_cb read;  // Block producer
+    size_t total_size;              // Total payload size in bytes
+    void *ctx;                      // Passed as is to the producer
+} large_res_stream_t;
+
+/**
+ * @brief Serve GET requests of the resource from the given stream.
+ * @param resource Resource to attach to, must be created with GET_ALLOWED.
+ * @param stream Stream descriptor, must stay valid as long as the resource exists.
+ * @return true on success.
+ */
+bool large_res_stream_attach(M2MResource *resource, const large_res_stream_t *stream);
+
+/**
+ * @brief Release the transfer cursor which served the latest block of the resource,
+ *        for example when sending that block has failed. Other transfers of the
+ *        resource keep their cursors.
+ */
+void large_res_stream_release(const M2MBase &resource);
+
+// Print the transfer statistics of the cursor pool.
+//
+// To benchmark on Linux, build with MEMORY_TESTS_HEAP and LOCAL_LWM2M_SERVER and run
+//     utils/local_lwm2m_server.py --get /5000/0/2 -p 16 -n 1000
+// The server reports the blocks/s it received, the client the blocks/s it served
+// and the heap peak on each delivered transfer.
+void large_res_stream_print_stats();
+
+#endif // LARGE_RES_STREAM_H
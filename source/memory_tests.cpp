@@ -16,11 +16,9 @@
 // limitations under the License.
 // ----------------------------------------------------------------------------
 
-#ifdef TARGET_LIKE_MBED
+#if defined(TARGET_LIKE_MBED) || defined(__linux__)
 #if defined (MEMORY_TESTS_HEAP)
 
-// used by print_heap_stats only
-#include "mbed_stats.h"
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include "mbed-client/m2mbase.h"
@@ -38,89 +36,205 @@
 #include "mbed-client/m2mserver.h"
 #include "mbed-client/m2msecurity.h"
 #include "source/include/m2mreporthandler.h"
+#include "MbedCloudClient.h"
 
+#ifdef TARGET_LIKE_MBED
 #include "mbed.h"
 #include "mbed_stats.h"
 
+typedef mbed_stats_heap_t heap_stats_t;
+#define heap_stats_get mbed_stats_heap_get
+#else
+// Linux heap accounting, see source/platform/Linux/mcc_heap_stats.cpp
+#include "mcc_heap_stats.h"
+
+typedef mcc_heap_stats_t heap_stats_t;
+#define heap_stats_get mcc_heap_stats_get
+#endif
+
+// Number of call sites listed by print_heap_stats(), if supported by the platform.
+#ifndef MEMORY_TESTS_HEAP_SITES
+#define MEMORY_TESTS_HEAP_SITES 5
+#endif
+
+#include "startup_profiler.h"
+
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 #endif
 
 #if defined (MEMORY_TESTS_HEAP)
 void print_heap_stats()
 {
-    mbed_stats_heap_t stats;
-    mbed_stats_heap_get(&stats);
+    heap_stats_t stats;
+    heap_stats_get(&stats);
     printf("**** current_size: %" PRIu32 "\n", stats.current_size);
     printf("**** max_size    : %" PRIu32 "\n", stats.max_size);
+#ifndef TARGET_LIKE_MBED
+    mcc_heap_stats_print_sites(MEMORY_TESTS_HEAP_SITES);
+#endif
+}
+
+// Builds object_count objects, each having object_instance_count instances of
+// resource_count resources. Resource value types cycle through the first
+// value_type_count entries of test_value_types.
+static const M2MResourceInstance::ResourceType test_value_types[] = {
+    M2MResourceInstance::INTEGER,
+    M2MResourceInstance::STRING,
+    M2MResourceInstance::FLOAT,
+    M2MResourceInstance::BOOLEAN
+};
+
+static int create_m2mobject_tree(M2MObjectList& object_list, const m2mobject_test_shape_t& shape)
+{
+    const int object_id_range_start = 90;
+    const int object_id_range_end = object_id_range_start + shape.object_count;
+    int value_type_count = shape.value_type_count;
+    int total_resource_count = 0;
+
+    if (value_type_count < 1 || value_type_count > (int)(sizeof(test_value_types) / sizeof(test_value_types[0]))) {
+        value_type_count = 1;
+    }
+
+    for (int object_id = object_id_range_start; object_id < object_id_range_end; object_id++) {
+        for (int object_instance_id = 0; object_instance_id < shape.object_instance_count; object_instance_id++) {
+            for (int resource_id = 0; resource_id < shape.resource_count; resource_id++) {
+                const M2MResourceInstance::ResourceType type = test_value_types[resource_id % value_type_count];
+
+                M2MResource* resource = M2MInterfaceFactory::create_resource(object_list, object_id, object_instance_id,
+                                                                             resource_id, type, M2MBase::GET_ALLOWED);
+                assert(resource != NULL);
+
+                resource->set_observable(true);
+                if (type == M2MResourceInstance::STRING) {
+                    resource->set_value((const uint8_t *)"seven", 5);
+                } else if (type == M2MResourceInstance::FLOAT) {
+                    resource->set_value_float(7.0f);
+                } else {
+                    resource->set_value(type == M2MResourceInstance::BOOLEAN ? 1 : 7);
+                }
+
+                total_resource_count++;
+            }
+        }
+    }
+
+    return total_resource_count;
+}
+
+// Estimated size of the CoRE link format resource list the registration
+// carries, e.g. </90/0/1>;rt="x";obs, for each resource. The client builds
+// the actual payload only when registering.
+static size_t link_format_estimate_size(const M2MObjectList& object_list)
+{
+    size_t size = 0;
+
+    for (M2MObjectList::const_iterator obj = object_list.begin(); obj != object_list.end(); obj++) {
+        const M2MObjectInstanceList &instances = (*obj)->instances();
+        for (M2MObjectInstanceList::const_iterator inst = instances.begin(); inst != instances.end(); inst++) {
+            const M2MResourceList &resources = (*inst)->resources();
+            for (M2MResourceList::const_iterator res = resources.begin(); res != resources.end(); res++) {
+                const char *rt = (*res)->resource_type();
+                size += strlen((*res)->uri_path()) + strlen("</>,");
+                if (rt && *rt) {
+                    size += strlen(rt) + strlen(";rt=\"\"");
+                }
+                if ((*res)->is_observable()) {
+                    size += strlen(";obs");
+                }
+            }
+        }
+    }
+
+    return size;
+}
+
+static void delete_m2mobject_tree(M2MObjectList& object_list)
+{
+    for (M2MObjectList::const_iterator obj = object_list.begin(); obj != object_list.end(); obj++) {
+        delete *obj;
+    }
+    object_list.clear();
 }
 
 void create_m2mobject_test_set(M2MObjectList& object_list)
 {
     printf("*************************************\n");
 
-    mbed_stats_heap_t stats;
-    mbed_stats_heap_get(&stats);
+    heap_stats_t stats;
+    heap_stats_get(&stats);
 
     uint32_t initial = stats.current_size;
 
-    const int object_count = 1;
-    const int object_id_range_start = 90;
-    const int object_id_range_end = object_id_range_start + object_count;
+    m2mobject_test_shape_t shape;
+    shape.object_count = MEMORY_TESTS_OBJECT_COUNT;
+    shape.object_instance_count = MEMORY_TESTS_OBJECT_INSTANCE_COUNT;
+    shape.resource_count = MEMORY_TESTS_RESOURCE_COUNT;
+    shape.value_type_count = MEMORY_TESTS_VALUE_TYPE_COUNT;
 
-    const int object_instance_count = 5;
-    const int resource_count = 5;
+    int total_resource_count = create_m2mobject_tree(object_list, shape);
 
-    int total_object_count = 0;
-    int total_object_instance_count = 0;
-    int total_resource_count = 0;
-
-    for (int object_id = object_id_range_start; object_id < object_id_range_end; object_id++) {
+    printf("objects       : %d\n", shape.object_count);
+    printf("obj instances : %d\n", shape.object_count * shape.object_instance_count);
+    printf("resources     : %d\n", total_resource_count);
 
-        char buff[64];
-        sprintf(buff, "%d", object_id);
-        M2MObject *obj = M2MInterfaceFactory::create_object(buff);
+    heap_stats_get(&stats);
+    printf("heap used     : %" PRIu32 "\n", stats.current_size - initial);
 
-        for (int object_instance_id = 0; object_instance_id < object_instance_count; object_instance_id++) {
+    printf("*************************************\n");
+}
 
-            M2MObjectInstance* obj_inst = obj->create_object_instance(object_instance_id);
+void print_m2mobject_scaling_stats(MbedCloudClient& client, const m2mobject_test_shape_t& shape, int steps)
+{
+    printf("\n*** M2M object tree scaling ***\n");
+    printf("%10s %10s %10s %10s %10s %10s %10s\n", "resources", "heap", "heap/res", "create us", "ns/res",
+           "add us", "link est");
 
-            assert(obj_inst != NULL);
-            total_object_instance_count++;
-            for (int resource_id = 0; resource_id < resource_count; resource_id++) {
-                String res_name;
-                String res_type;
+    m2mobject_test_shape_t step_shape = shape;
 
-                res_name.append_int(resource_id);
-                res_type.append_int(resource_id);
+    for (int step = 0; step < steps; step++) {
+        M2MObjectList object_list;
+        heap_stats_t stats;
 
-                M2MResource* resource = obj_inst->create_dynamic_resource(res_name, res_type,
-                                                                        M2MResourceInstance::INTEGER, true);
+        heap_stats_get(&stats);
+        uint32_t initial = stats.current_size;
+        uint64_t start_us = startup_profiler_time_us();
 
-                assert(resource != NULL);
+        int resources = create_m2mobject_tree(object_list, step_shape);
 
-                resource->set_operation(M2MBase::GET_ALLOWED);
-                resource->set_value(7);
+        uint64_t create_us = startup_profiler_time_us() - start_us;
+        heap_stats_get(&stats);
+        uint32_t heap_used = stats.current_size - initial;
 
-                total_resource_count++;
-            }
+        // The client is not set up yet, so the tree is removed before it is
+        // ever registered.
+        start_us = startup_profiler_time_us();
+        client.add_objects(object_list);
+        uint64_t add_us = startup_profiler_time_us() - start_us;
+        for (M2MObjectList::const_iterator obj = object_list.begin(); obj != object_list.end(); obj++) {
+            client.remove_object(*obj);
         }
 
-        object_list.push_back(obj);
-        total_object_count++;
-    }
+        printf("%10d %10" PRIu32 " %10" PRIu32 " %10lu %10lu %10lu %10lu\n",
+               resources, heap_used, resources ? heap_used / resources : 0,
+               (unsigned long)create_us,
+               resources ? (unsigned long)(create_us * 1000 / resources) : 0UL,
+               (unsigned long)add_us,
+               (unsigned long)link_format_estimate_size(object_list));
 
-    printf("objects       : %d\n", total_object_count);
-    printf("obj instances : %d\n", total_object_instance_count);
-    printf("resources     : %d\n", total_resource_count);
+        delete_m2mobject_tree(object_list);
 
-    mbed_stats_heap_get(&stats);
-    printf("heap used     : %" PRIu32 "\n", stats.current_size - initial);
+        // Grow the tree by doubling the innermost dimension.
+        step_shape.resource_count *= 2;
+    }
 
-    printf("*************************************\n");
+    printf("*************************************\n\n");
 }
 
 // Note: the mbed-os needs to be compiled with MEMORY_TESTS_HEAP to get
 // functional heap stats, or the mbed_stats_heap_get() will return just zeroes.
+// On Linux the statistics come from interposing malloc, which needs glibc.
 void print_m2mobject_stats()
 {
     printf("\n*** M2M object sizes in bytes ***\n");
@@ -136,8 +250,8 @@ void print_m2mobject_stats()
     printf("M2MReportHandler: %lu\n", (unsigned long)sizeof(M2MReportHandler));
     printf("*************************************\n\n");
 
-    mbed_stats_heap_t stats;
-    mbed_stats_heap_get(&stats);
+    heap_stats_t stats;
+    heap_stats_get(&stats);
 
     printf("*** M2M heap stats in bytes***\n");
     uint32_t initial = stats.current_size;
@@ -145,10 +259,10 @@ void print_m2mobject_stats()
     // M2MDevice
     M2MDevice *device_object = M2MInterfaceFactory::create_device();
     if (device_object) {
-        mbed_stats_heap_get(&stats);
+        heap_stats_get(&stats);
         printf("M2MDevice heap size: %" PRIu32 "\n", stats.current_size - initial);
         M2MDevice::delete_instance();
-        mbed_stats_heap_get(&stats);
+        heap_stats_get(&stats);
         if (initial != stats.current_size) {
             printf("M2MDevice leaked: %" PRIu32 "bytes\n", stats.current_size - initial);
         }
@@ -160,10 +274,10 @@ void print_m2mobject_stats()
     initial = stats.current_size;
     M2MServer *server = M2MInterfaceFactory::create_server();
     if (server) {
-        mbed_stats_heap_get(&stats);
+        heap_stats_get(&stats);
         printf("M2MServer heap size: %" PRIu32 "\n", stats.current_size - initial);
         delete server;
-        mbed_stats_heap_get(&stats);
+        heap_stats_get(&stats);
         if (initial != stats.current_size) {
             printf("M2MServer leaked: %" PRIu32 "bytes\n", stats.current_size - initial);
         }
@@ -175,13 +289,13 @@ void print_m2mobject_stats()
     initial = stats.current_size;
     M2MSecurity *security = M2MInterfaceFactory::create_security(M2MSecurity::M2MServer);
     if (security) {
-        mbed_stats_heap_get(&stats);
+        heap_stats_get(&stats);
         printf("M2MSecurity heap size: %" PRIu32 "\n", stats.current_size - initial);
 
         // If the MbedCloudClient is already instantiated, this corrupts heap as it frees the
         // singleton of M2MSecurity, which is still used by it. Use with care.
         M2MSecurity::delete_instance();
-        mbed_stats_heap_get(&stats);
+        heap_stats_get(&stats);
         if (initial != stats.current_size) {
             printf("M2MSecurity leaked: %" PRIu32 "bytes\n", stats.current_size - initial);
         }
@@ -197,7 +311,7 @@ void print_m2mobject_stats()
         printf("Could not create M2MObject\n");
         return;
     }
-    mbed_stats_heap_get(&stats);
+    heap_stats_get(&stats);
     printf("M2MObject heap size: %" PRIu32 "\n", stats.current_size - initial);
     initial = stats.current_size;
 
@@ -207,7 +321,7 @@ void print_m2mobject_stats()
         delete obj;
         return;
     }
-    mbed_stats_heap_get(&stats);
+    heap_stats_get(&stats);
     printf("M2MObjectInstance heap size: %" PRIu32 "\n", stats.current_size - initial);
 
     initial = stats.current_size;
@@ -217,11 +331,11 @@ void print_m2mobject_stats()
         delete obj;
         return;
     }
-    mbed_stats_heap_get(&stats);
+    heap_stats_get(&stats);
     printf("M2MResource heap size: %" PRIu32 "\n", stats.current_size - initial);
 
     delete obj;
-    mbed_stats_heap_get(&stats);
+    heap_stats_get(&stats);
     if (before_object != stats.current_size) {
         printf("Resource leaked: %" PRIu32 "bytes\n", stats.current_size - before_object);
     }
@@ -229,4 +343,4 @@ void print_m2mobject_stats()
 }
 
 #endif // MEMORY_TESTS_HEAP
-#endif // TARGET_LIKE_MBED
+#endif // TARGET_LIKE_MBED || __linux__
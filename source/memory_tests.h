@@ -20,10 +20,13 @@
 #define __MEMORY_TESTS_H__
 
 #include "mbed-client/m2minterface.h"
+#ifdef TARGET_LIKE_MBED
 #include "mbed.h"
+#endif
 
 //FORWARD DECLARATION
 class M2MObject;
+class MbedCloudClient;
 namespace m2m {
     template<class ObjectTemplate> class Vector;
 }
@@ -32,9 +35,38 @@ using namespace m2m;
 
 typedef Vector<M2MObject *> M2MObjectList;
 
+// Shape of the test set created by create_m2mobject_test_set().
+#ifndef MEMORY_TESTS_OBJECT_COUNT
+#define MEMORY_TESTS_OBJECT_COUNT 1
+#endif
+#ifndef MEMORY_TESTS_OBJECT_INSTANCE_COUNT
+#define MEMORY_TESTS_OBJECT_INSTANCE_COUNT 5
+#endif
+#ifndef MEMORY_TESTS_RESOURCE_COUNT
+#define MEMORY_TESTS_RESOURCE_COUNT 5
+#endif
+// Number of value types the resources cycle through: INTEGER, STRING, FLOAT, BOOLEAN.
+#ifndef MEMORY_TESTS_VALUE_TYPE_COUNT
+#define MEMORY_TESTS_VALUE_TYPE_COUNT 1
+#endif
+
+typedef struct m2mobject_test_shape {
+    int object_count;
+    int object_instance_count;
+    int resource_count;         // Per object instance
+    int value_type_count;
+} m2mobject_test_shape_t;
+
 // A function for creating a batch of resources for memory consumption purposes.
 void create_m2mobject_test_set(M2MObjectList& object_list);
 
+// Build object trees starting from the given shape, doubling the resource count on
+// each of the steps, and print heap use, creation time, add_objects() time and an
+// estimate of the link format size the registration carries.
+// The trees are added to the given client and removed again, so this must be
+// called before the client is set up.
+void print_m2mobject_scaling_stats(MbedCloudClient& client, const m2mobject_test_shape_t& shape, int steps);
+
 // Print into serial the m2m object sizes and heap allocation sizes.
 void print_m2mobject_stats();
 
@@ -0,0 +1,118 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "mbed-cloud-client/MbedCloudClient.h"
+
+#if defined(TARGET_LIKE_LINUX) && (MBED_CLOUD_CLIENT_FOTA_ENABLE) && defined(FOTA_CUSTOM_PLATFORM)
+
+#include "meter_fw.h"
+#include "fota/fota_crypto.h"
+#include "fota/fota_status.h"
+
+#include <stdio.h>
+
+static FILE *meter_fw_file = NULL;
+
+void meter_fw_close(void)
+{
+    if (meter_fw_file) {
+        fclose(meter_fw_file);
+        meter_fw_file = NULL;
+    }
+}
+
+int meter_fw_read(uint8_t *buf, size_t offset, size_t size, size_t *num_read)
+{
+    if (!meter_fw_file) {
+        meter_fw_file = fopen(METER_FW_FILE, "rb");
+        if (!meter_fw_file) {
+            printf("Cannot open %s\n", METER_FW_FILE);
+            return FOTA_STATUS_INTERNAL_ERROR;
+        }
+    }
+    if (fseek(meter_fw_file, (long)offset, SEEK_SET) != 0) {
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    *num_read = fread(buf, 1, size, meter_fw_file);
+    if (ferror(meter_fw_file)) {
+        meter_fw_close();
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    return FOTA_STATUS_SUCCESS;
+}
+
+int meter_fw_get_digest(uint8_t *buf)
+{
+    fota_hash_context_t *hash_ctx = NULL;
+    uint8_t chunk[512];
+    size_t offset = 0;
+    size_t num_read = 0;
+
+    int ret = fota_hash_start(&hash_ctx);
+    while (ret == FOTA_STATUS_SUCCESS) {
+        ret = meter_fw_read(chunk, offset, sizeof(chunk), &num_read);
+        if (ret != FOTA_STATUS_SUCCESS || num_read == 0) {
+            break;
+        }
+        ret = fota_hash_update(hash_ctx, chunk, num_read);
+        offset += num_read;
+    }
+    if (ret == FOTA_STATUS_SUCCESS) {
+        ret = fota_hash_result(hash_ctx, buf);
+    }
+    fota_hash_finish(&hash_ctx);
+    return ret;
+}
+
+int meter_fw_store(const char *candidate_file_name)
+{
+    static const char tmp_file_name[] = METER_FW_FILE ".tmp";
+    uint8_t chunk[512];
+    size_t length;
+    int ret = FOTA_STATUS_SUCCESS;
+
+    FILE *in = fopen(candidate_file_name, "rb");
+    FILE *out = fopen(tmp_file_name, "wb");
+    if (!in || !out) {
+        ret = FOTA_STATUS_INTERNAL_ERROR;
+    }
+    while (ret == FOTA_STATUS_SUCCESS && (length = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        if (fwrite(chunk, 1, length, out) != length) {
+            ret = FOTA_STATUS_INTERNAL_ERROR;
+        }
+    }
+    if (ret == FOTA_STATUS_SUCCESS && ferror(in)) {
+        ret = FOTA_STATUS_INTERNAL_ERROR;
+    }
+    if (in) {
+        fclose(in);
+    }
+    if (out && fclose(out) != 0) {
+        ret = FOTA_STATUS_INTERNAL_ERROR;
+    }
+
+    meter_fw_close();
+    if (ret != FOTA_STATUS_SUCCESS || rename(tmp_file_name, METER_FW_FILE) != 0) {
+        printf("Failed to store %s\n", METER_FW_FILE);
+        remove(tmp_file_name);
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    return FOTA_STATUS_SUCCESS;
+}
+
+#endif // TARGET_LIKE_LINUX && MBED_CLOUD_CLIENT_FOTA_ENABLE && FOTA_CUSTOM_PLATFORM
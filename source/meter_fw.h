@@ -0,0 +1,59 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef METER_FW_H
+#define METER_FW_H
+
+/*
+ * Installed image of the METER component on Linux, the base of its delta
+ * updates. The FOTA library reads it through meter_fw_read() and
+ * meter_fw_get_digest(), and the installer replaces it with
+ * meter_fw_store() so the next delta applies on top of the new image.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef METER_FW_FILE
+#define METER_FW_FILE "meter_fw.bin"
+#endif
+
+/**
+ * @brief Read a piece of the installed image, the curr_fw_read callback of the component.
+ *
+ * The file is kept open between the calls, the delta engine reads the base in
+ * small pieces. num_read is less than size at the end of the image.
+ */
+int meter_fw_read(uint8_t *buf, size_t offset, size_t size, size_t *num_read);
+
+/**
+ * @brief Hash the installed image, the curr_fw_get_digest callback of the component.
+ */
+int meter_fw_get_digest(uint8_t *buf);
+
+/**
+ * @brief Replace the installed image with the candidate, through a temporary file and rename().
+ */
+int meter_fw_store(const char *candidate_file_name);
+
+/**
+ * @brief Close the installed image, if meter_fw_read() has opened it.
+ */
+void meter_fw_close(void);
+
+#endif // METER_FW_H
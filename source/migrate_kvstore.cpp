@@ -27,28 +27,37 @@
 #include "mbed-trace/mbed_trace.h"
 #include "KVStore.h"
 #include "kvstore_global_api.h"
+#include "mbedtls/sha256.h"
+#include "migrate_kvstore.h"
 
 using namespace mbed;
 
 #define TRACE_GROUP "MIGR"
-#define MAX_CONTENT_LEN 1024     // Max certificate length
 #define backupBootstrapURI  "pelion_bCfgParam_mbed.BootstrapServerURI"
 #define workingBootstrapURI "pelion_wCfgParam_mbed.BootstrapServerURI"
 #define backupBootstrapCA   "pelion_bCrtae_mbed.BootstrapServerCACert"
 #define workingBootstrapCA  "pelion_wCrtae_mbed.BootstrapServerCACert"
 #define migrationKey        "pelion_wMIGR"
+#define migrationJournalKey "pelion_wMIGRJ"
 
-// Please note that migration state is NOT reset after a sucesfull migration.
-// If you have a need to do multiple migrations, you should make a special SW
-// update at some stage to disable migration and also remove the migrationKey
-// at that stage OR alternatively change the name of the key (say pelion_wMIGR2)
-// for 2nd migration etc. so that a unique state per migration is retained.
-typedef struct rep_key_info {
-    const char      *key;            // KVSStore key name
-    const uint8_t   *value;          // New value to replace
-    size_t          size;            // New value length/size
-    bool            printable;       // Is entry printable string?
-} rep_key_info;
+#define MIGRATION_RECORD_MAGIC  0x5247494d  // "MIGR"
+#define MIGRATION_DIGEST_SIZE   32
+// Size of the marker written by the earlier versions of this file.
+#define MIGRATION_LEGACY_MARKER_SIZE 1
+
+// Content of both the migration key and the journal key: the digest of the
+// operation table being (or already) applied.
+//
+// The migration key is written once all operations are applied, and a
+// migration is skipped while the key holds the digest of the current table.
+// Changing the table, for example the bootstrap server, runs the migration
+// again. A migration key written by an earlier version of this file does not
+// hold a digest, and is taken as done.
+typedef struct migration_record {
+    uint32_t    magic;
+    uint32_t    count;
+    uint8_t     digest[MIGRATION_DIGEST_SIZE];
+} migration_record_t;
 
 /* Definitions for bootstrap cert info via the migrate_server_cert.h */
 
@@ -56,169 +65,255 @@ extern const uint8_t MIGRATE_BOOTSTRAP_CA_CERT[];
 extern const uint32_t MIGRATE_BOOTSTRAP_CA_CERT_SIZE;
 
 /* Internal function prototypes */
-static int kvstore_locate_and_replace(rep_key_info *);
-static int kvstore_clear_LwM2M_info(void);
+static int kvstore_migration_digest(const kvstore_migration_op_t *ops, size_t count, uint8_t *digest);
+static int kvstore_migration_read_record(const char *key, migration_record_t *record, size_t *size);
+static int kvstore_migration_write_record(const char *key, const migration_record_t *record);
+static bool kvstore_migration_pending(const kvstore_migration_op_t *op, uint32_t *flags);
+static int kvstore_migration_apply(const kvstore_migration_op_t *op, uint32_t flags);
 
 /* migrate_kvstore      Change the bootstrap server address.
                         NOTE! Supports only Mbed OS / KVStore and production mode.
 
     There are two sets of keys that need to be updated.
     Working set and backup set. They both need to be deleted and re-recreated with the new value.
+    The LwM2M credentials are removed, so that the client bootstraps again.
 
 */
 int migrate_kvstore(const char *new_BS_server) {
-    int status;
-    kv_info_t info;
-    rep_key_info bURI = { backupBootstrapURI, 
-                        (const uint8_t *) new_BS_server,
-                        strlen(backupBootstrapURI),
-                        true,  // Printable
-                        };
-    rep_key_info wURI  = { workingBootstrapURI, 
-                        (const uint8_t *) new_BS_server,
-                        strlen(backupBootstrapURI),
-                        true,  // Printable
-                        };
-    rep_key_info bCert  = { backupBootstrapCA, 
-                        MIGRATE_BOOTSTRAP_CA_CERT,
-                        MIGRATE_BOOTSTRAP_CA_CERT_SIZE,
-                        false,  // Printable
-                        };
-    rep_key_info wCert  = { workingBootstrapCA, 
-                        MIGRATE_BOOTSTRAP_CA_CERT,
-                        MIGRATE_BOOTSTRAP_CA_CERT_SIZE,
-                        false,  // Printable
-                        };
-
-    // Check migration status, skip if key is found.
-    status = kv_get_info(migrationKey, &info);
+    const kvstore_migration_op_t ops[] = {
+        { backupBootstrapURI, (const uint8_t *) new_BS_server, strlen(new_BS_server), true },
+        { workingBootstrapURI, (const uint8_t *) new_BS_server, strlen(new_BS_server), true },
+        { backupBootstrapCA, MIGRATE_BOOTSTRAP_CA_CERT, MIGRATE_BOOTSTRAP_CA_CERT_SIZE, false },
+        { workingBootstrapCA, MIGRATE_BOOTSTRAP_CA_CERT, MIGRATE_BOOTSTRAP_CA_CERT_SIZE, false },
+        { "pelion_wCfgParam_mbed.LwM2MServerURI", NULL, 0, false },
+        { "pelion_wCrtae_mbed.LwM2MDeviceCert", NULL, 0, false },
+        { "pelion_wCrtae_mbed.LwM2MServerCACert", NULL, 0, false },
+        { "pelion_wPrvKey_mbed.LwM2MDevicePrivateKey", NULL, 0, false },
+    };
+
+    int status = kvstore_migrate(ops, sizeof(ops) / sizeof(ops[0]), migrationKey, migrationJournalKey);
     if (status == MBED_SUCCESS) {
-        tr_info("Migration done already, %s exists.", migrationKey);
-        return status;
+        printf("Migration done.\n");
     }
-    // Migration NOT done, let's do it.
-    // Always do locate and replace, it will only change the value if it's not
-    // already what it should be. We get value back via bool changed if the value
-    // is what it should be.
-    status = kvstore_locate_and_replace(&bURI);
-    status = status + kvstore_locate_and_replace(&wURI);
-    status = status + kvstore_locate_and_replace(&bCert);
-    status = status + kvstore_locate_and_replace(&wCert);
-    status = status + kvstore_clear_LwM2M_info();
+    return status;
+}
+
+/* kvstore_migrate      Apply a table of key operations as one migration.
+
+    Before the first key is changed, the journal key is written with the digest
+    of the table. The operations are then applied in order, the migration key is
+    written and the journal is removed. After a power loss the journal is found
+    on the next boot, and the migration is rolled forward: the operations are
+    idempotent, as every value comes from the firmware, so the keys already
+    changed are found equal and skipped.
+
+    A journal of another table, e.g. after a firmware downgrade, overrides the
+    migration key: the current table is applied again, as its keys may have
+    been changed by the interrupted migration.
+
+    Each value is compared with the stored one before it is written, so a key is
+    only written when it changes, and a migration with nothing to change does not
+    write the journal at all.
+*/
+int kvstore_migrate(const kvstore_migration_op_t *ops, size_t count, const char *done_key, const char *journal_key) {
+    migration_record_t record;
+    migration_record_t stored;
+    size_t stored_size = 0;
+    kv_info_t info;
+    int status;
+
+    memset(&record, 0, sizeof(record));
+    record.magic = MIGRATION_RECORD_MAGIC;
+    record.count = count;
+    status = kvstore_migration_digest(ops, count, record.digest);
     if (status != MBED_SUCCESS) {
-        // Failure to update any of the keys is pretty fatal, as
-        // either connection or RFS will fail
-        tr_error("ERROR - Migration failed, %d", status);
+        tr_error("ERROR - Can't compute migration digest, %d", status);
         return status;
     }
+
+    // The journal names the table of an interrupted migration.
+    bool journaled = (kv_get_info(journal_key, &info) == MBED_SUCCESS);
+    bool journal_current = false;
+    if (journaled) {
+        status = kvstore_migration_read_record(journal_key, &stored, &stored_size);
+        journal_current = (status == MBED_SUCCESS && stored_size == sizeof(stored) &&
+                           0 == memcmp(&stored, &record, sizeof(record)));
+    }
+
+    // Check migration status, skip if the same migration is done already. An
+    // interrupted migration of another table may have changed the keys since,
+    // so the migration key is not trusted then.
+    status = kvstore_migration_read_record(done_key, &stored, &stored_size);
+    if ((!journaled || journal_current) && status == MBED_SUCCESS &&
+        (stored_size == MIGRATION_LEGACY_MARKER_SIZE ||
+         (stored_size == sizeof(stored) && 0 == memcmp(&stored, &record, sizeof(record))))) {
+        tr_info("Migration done already, %s exists.", done_key);
+        if (journaled) {
+            // Interrupted after the migration key was written.
+            (void) kv_remove(journal_key);
+        }
+        return MBED_SUCCESS;
+    }
+
+    if (journal_current) {
+        tr_warn("Resuming interrupted migration, %s exists.", journal_key);
+    } else if (journaled) {
+        // Its values are not in this firmware, so it cannot be completed. This
+        // table is applied in full instead, keys outside of it are left as they are.
+        tr_warn("Interrupted migration of another table in %s, applying this table.", journal_key);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t flags = 0;
+        if (!kvstore_migration_pending(&ops[i], &flags)) {
+            continue;
+        }
+        if (!journal_current) {
+            status = kvstore_migration_write_record(journal_key, &record);
+            if (status != MBED_SUCCESS) {
+                tr_error("ERROR - Can't write migration journal %s - error, %d", journal_key, status);
+                return status;
+            }
+            journaled = true;
+            journal_current = true;
+        }
+        status = kvstore_migration_apply(&ops[i], flags);
+        if (status != MBED_SUCCESS) {
+            // Failure to update any of the keys is pretty fatal, as
+            // either connection or RFS will fail. The journal is kept,
+            // so the next boot tries again.
+            tr_error("ERROR - Migration failed, %d", status);
+            return status;
+        }
+    }
+
     // Create migration key to mark "all done".
-    status = kv_set(migrationKey, &status, 1, 0);
+    status = kvstore_migration_write_record(done_key, &record);
     if (status != MBED_SUCCESS) {
-        // Not failing whole operation, because the actual relevant keys
-        // managed to be changed. Flag write failing is not fatal, it will
-        // just cause unnecessary further LwM2M cert wiping.
-        tr_error("ERROR - Can't write migration key %s - error, %d", migrationKey, status);
+        // The journal is kept, the next boot finds the keys migrated and writes the key again.
+        tr_error("ERROR - Can't write migration key %s - error, %d", done_key, status);
+        return status;
     }
-    else {
-        printf("Migration done.\n");
+
+    if (journaled) {
+        status = kv_remove(journal_key);
+        if (status != MBED_SUCCESS) {
+            // Not fatal, the journal is removed on the next boot.
+            tr_warn("WARNING - Can't remove migration journal %s - error, %d", journal_key, status);
+        }
     }
-    return status;
+    return MBED_SUCCESS;
 }
 
 /*
-    locate_and_replace      find the given key (with name),
-                            verify if the names is matching migration value
-                            and if not, set the new value to it.
-
-                            remove() did not work for some reason.
+    kvstore_migration_digest    SHA-256 over the key names, the operations
+                                and the new values of the table.
 */
-static int kvstore_locate_and_replace(rep_key_info *repKey) {
+static int kvstore_migration_digest(const kvstore_migration_op_t *ops, size_t count, uint8_t *digest) {
+    mbedtls_sha256_context ctx;
+    int res;
 
-    size_t actual_size = 0;
+    mbedtls_sha256_init(&ctx);
+    res = mbedtls_sha256_starts_ret(&ctx, 0);
+    for (size_t i = 0; i < count && res == 0; i++) {
+        const uint32_t size = ops[i].value ? (uint32_t) ops[i].size : UINT32_MAX;
+        res = mbedtls_sha256_update_ret(&ctx, (const unsigned char *) ops[i].key, strlen(ops[i].key) + 1);
+        if (res == 0) {
+            res = mbedtls_sha256_update_ret(&ctx, (const unsigned char *) &size, sizeof(size));
+        }
+        if (res == 0 && ops[i].value) {
+            res = mbedtls_sha256_update_ret(&ctx, ops[i].value, ops[i].size);
+        }
+    }
+    if (res == 0) {
+        res = mbedtls_sha256_finish_ret(&ctx, digest);
+    }
+    mbedtls_sha256_free(&ctx);
+
+    return (res == 0) ? MBED_SUCCESS : MBED_ERROR_FAILED_OPERATION;
+}
+
+static int kvstore_migration_read_record(const char *key, migration_record_t *record, size_t *size) {
+    memset(record, 0, sizeof(*record));
+    return kv_get(key, record, sizeof(*record), size);
+}
+
+static int kvstore_migration_write_record(const char *key, const migration_record_t *record) {
+    return kv_set(key, record, sizeof(*record), 0);
+}
+
+/*
+    kvstore_migration_pending   check if the operation changes the key,
+                                and return the flags of the existing key.
+
+                                The stored value is only read when its size
+                                matches the new value.
+*/
+static bool kvstore_migration_pending(const kvstore_migration_op_t *op, uint32_t *flags) {
     kv_info_t info;
+    size_t actual_size = 0;
+    bool pending = true;
     int res;
-    char kv_value[MAX_CONTENT_LEN + 1];
 
-    res = kv_get_info(repKey->key, &info);
+    res = kv_get_info(op->key, &info);
+    if (res == MBED_ERROR_ITEM_NOT_FOUND) {
+        if (!op->value) {
+            tr_info("Key %s does not exist (OK).", op->key);
+        }
+        return (op->value != NULL);
+    }
     if (res != MBED_SUCCESS) {
-        // Can't get key info - key likely not existing?
-        tr_warn("WARNING - kv_get_info failed %d for %s", res, repKey->key);
+        // Can't get key info, write it anyway.
+        tr_warn("WARNING - kv_get_info failed %d for %s", res, op->key);
+        return true;
     }
-    else {
-        // Does the value already match new value (i.e. our 2nd or n+ run here)
-        if (MAX_CONTENT_LEN < info.size) {
-            tr_error("ERROR - migrate - buffer len < info.size %d", info.size);
-            return MBED_ERROR_INVALID_SIZE;
-        }
-        memset(kv_value, 0, sizeof(kv_value));
-        res = kv_get(repKey->key, kv_value, info.size, &actual_size);
-        if (res != MBED_SUCCESS) {
-            tr_error("ERROR - kv_get failed with %d for %s", res, repKey->key);
-            return res;
-        }
-        if (actual_size == info.size && 
-            repKey->size == actual_size &&
-            0 == memcmp(kv_value, repKey->value, repKey->size) ) {
-            // We have a match, same string in both - just return with success
-            tr_info("Migration for %s already done.", repKey->key);
-            return MBED_SUCCESS;
-        }
+    *flags = info.flags;
+
+    if (!op->value || info.size != op->size) {
+        return true;
     }
 
-    res = kv_set(repKey->key, repKey->value, repKey->size, info.flags);
-    if (res != MBED_SUCCESS) {
-        tr_error("ERROR - kv_set failed %d for %s", res, repKey->key);
-        return res;
+    uint8_t *kv_value = (uint8_t *) malloc(info.size ? info.size : 1);
+    if (!kv_value) {
+        return true;
     }
-    else {
-        if (repKey->printable) {
-            tr_info("kv_set %s succeeded, written new value %s", repKey->key, repKey->value);
-        }
-        else {
-            tr_info("kv_set %s succeeded, written len %d bytes", repKey->key, repKey->size);
-        }
+    res = kv_get(op->key, kv_value, info.size, &actual_size);
+    if (res == MBED_SUCCESS && actual_size == op->size &&
+        0 == memcmp(kv_value, op->value, op->size)) {
+        // We have a match, same value in both.
+        tr_info("Migration for %s already done.", op->key);
+        pending = false;
     }
-    return res;
+    free(kv_value);
+    return pending;
 }
 
-static int kvstore_clear_LwM2M_info() {
-
-    const char *keys[] = {"pelion_wCfgParam_mbed.LwM2MServerURI",
-                          "pelion_wCrtae_mbed.LwM2MDeviceCert",
-                          "pelion_wCrtae_mbed.LwM2MServerCACert",
-                          "pelion_wPrvKey_mbed.LwM2MDevicePrivateKey",
-                           };
-    kv_info_t info;
-    int index = 0;
-    int failed = MBED_SUCCESS;
-    int rounds = (sizeof(keys)/sizeof(char*));      // Nbr of keys to remove
+static int kvstore_migration_apply(const kvstore_migration_op_t *op, uint32_t flags) {
     int res;
 
-    while (index < rounds) {
-        res = kv_get_info(keys[index], &info);
+    if (!op->value) {
+        res = kv_remove(op->key);
         if (res == MBED_ERROR_ITEM_NOT_FOUND) {
-            // No such key.
-            tr_info("Key %s does not exist (OK).", keys[index]);
             res = MBED_SUCCESS;
-            index++;
-            continue;
         }
-        res = kv_remove(keys[index]);
         if (res != MBED_SUCCESS) {
-            tr_error("ERROR - failed to remove %s, code %d", keys[index], res);
-            failed = res;
+            tr_error("ERROR - failed to remove %s, code %d", op->key, res);
         }
         else {
-            tr_info("Removed %s as part of migration.", keys[index]);
+            tr_info("Removed %s as part of migration.", op->key);
         }
-        index++;
+        return res;
     }
 
-    if (failed != MBED_SUCCESS) {
-        res = failed;
+    res = kv_set(op->key, op->value, op->size, flags);
+    if (res != MBED_SUCCESS) {
+        tr_error("ERROR - kv_set failed %d for %s", res, op->key);
+    }
+    else if (op->printable) {
+        tr_info("kv_set %s succeeded, written new value %.*s", op->key, (int) op->size, (const char *) op->value);
     }
     else {
-        tr_warn("LwM2M credentials wiped to ensure bootstrap.");
+        tr_info("kv_set %s succeeded, written len %d bytes", op->key, (int) op->size);
     }
     return res;
 }
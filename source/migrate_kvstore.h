@@ -27,7 +27,25 @@
 
 */
 #if defined __MBED__
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One key operation of a migration.
+typedef struct kvstore_migration_op {
+    const char      *key;            // KVStore key name
+    const uint8_t   *value;          // New value to replace, NULL removes the key
+    size_t          size;            // New value length/size
+    bool            printable;       // Is entry printable string?
+} kvstore_migration_op_t;
+
 int migrate_kvstore(const char *new_value);
+
+/* kvstore_migrate      Apply the operations as one migration, journaled in journal_key.
+                        Returns MBED_SUCCESS once done_key holds the digest of the table,
+                        an interrupted migration is completed on the next call.
+*/
+int kvstore_migrate(const kvstore_migration_op_t *ops, size_t count, const char *done_key, const char *journal_key);
 #else
     #if  defined MBED_CLOUD_CLIENT_MIGRATE_BOOTSTRAP
         #error "No migration_kvstore implementation for other than Mbed OS using KVStore."
@@ -0,0 +1,225 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifdef MBED_CLOUD_CLIENT_USER_CONFIG_FILE
+#include MBED_CLOUD_CLIENT_USER_CONFIG_FILE
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "notification_coalescer.h"
+#include "sal-stack-nanostack-eventloop/nanostack-event-loop/eventOS_event.h"
+#include "sal-stack-nanostack-eventloop/nanostack-event-loop/eventOS_event_timer.h"
+#include "pdmc_example.h"
+#include "m2mresource.h"
+
+#define COALESCER_TASKLET_INIT_EVENT 0
+#define COALESCER_TASKLET_FLUSH_TIMER 1
+
+typedef struct coalescer_slot {
+    M2MResource *resource;
+    uint32_t min_period_ticks;
+    uint32_t last_sent_ticks;   // Valid if sent is set
+    int64_t value;              // Valid if pending is set
+    bool pending;
+    bool sent;
+} coalescer_slot_t;
+
+static coalescer_slot_t slots[NOTIFICATION_COALESCER_MAX_RESOURCES];
+static int8_t tasklet = -1;
+static bool flush_scheduled = false;
+
+static void flush_pending();
+
+static void resume_client()
+{
+#ifdef MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP_QUEUE
+    if (pdmc_paused()) {
+        printf("Calling Pelion Client resumed()\r\n");
+        pdmc_resume();
+    }
+#endif
+}
+
+static void coalescer_event_handler(arm_event_s *event)
+{
+    if (event->event_type == COALESCER_TASKLET_FLUSH_TIMER) {
+        flush_scheduled = false;
+        flush_pending();
+    }
+}
+
+static coalescer_slot_t *find_slot(const M2MResource *resource)
+{
+    for (int i = 0; i < NOTIFICATION_COALESCER_MAX_RESOURCES; i++) {
+        if (slots[i].resource == resource) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Ticks until the minimum period of the slot has elapsed, 0 if it already has.
+static uint32_t ticks_until_allowed(const coalescer_slot_t *slot, uint32_t now)
+{
+    if (!slot->sent) {
+        return 0;
+    }
+    uint32_t elapsed = now - slot->last_sent_ticks;
+    return (elapsed < slot->min_period_ticks) ? slot->min_period_ticks - elapsed : 0;
+}
+
+static bool schedule_flush(uint32_t delay_ticks)
+{
+    arm_event_t event = {};
+
+    event.event_type = COALESCER_TASKLET_FLUSH_TIMER;
+    event.receiver = tasklet;
+    event.sender = tasklet;
+    event.priority = ARM_LIB_LOW_PRIORITY_EVENT;
+
+    if (eventOS_event_send_after(&event, delay_ticks) == NULL) {
+        printf("Notification coalescer cannot schedule flush\n");
+        return false;
+    }
+    flush_scheduled = true;
+    return true;
+}
+
+// Send the slots whose minimum period has elapsed, and wait for the rest.
+static void flush_pending()
+{
+    const uint32_t now = eventOS_event_timer_ticks();
+    uint32_t next_delay = UINT32_MAX;
+    bool resumed = false;
+
+    for (int i = 0; i < NOTIFICATION_COALESCER_MAX_RESOURCES; i++) {
+        coalescer_slot_t *slot = &slots[i];
+        if (!slot->pending) {
+            continue;
+        }
+        uint32_t delay = ticks_until_allowed(slot, now);
+        if (delay > 0) {
+            if (delay < next_delay) {
+                next_delay = delay;
+            }
+            continue;
+        }
+        if (!resumed) {
+            resume_client();
+            resumed = true;
+        }
+        slot->pending = false;
+        slot->sent = true;
+        slot->last_sent_ticks = now;
+        slot->resource->set_value(slot->value);
+    }
+
+    // If this fails, the rest goes out with the next change.
+    if (next_delay != UINT32_MAX && !flush_scheduled) {
+        (void)schedule_flush(next_delay);
+    }
+}
+
+bool notification_coalescer_add(M2MResource *resource, uint32_t min_period_ms)
+{
+    if (tasklet < 0) {
+        tasklet = eventOS_event_handler_create(coalescer_event_handler, COALESCER_TASKLET_INIT_EVENT);
+        if (tasklet < 0) {
+            return false;
+        }
+    }
+
+    coalescer_slot_t *slot = find_slot(resource);
+    if (!slot) {
+        slot = find_slot(NULL);
+        if (!slot) {
+            return false;
+        }
+    }
+
+    slot->resource = resource;
+    slot->min_period_ticks = eventOS_event_timer_ms_to_ticks(min_period_ms);
+    slot->pending = false;
+    slot->sent = false;
+    return true;
+}
+
+void notification_coalescer_set_value(M2MResource *resource, int64_t value)
+{
+    assert(resource);
+
+    coalescer_slot_t *slot = find_slot(resource);
+    if (!slot) {
+        resume_client();
+        resource->set_value(value);
+        return;
+    }
+
+    slot->value = value;
+    slot->pending = true;
+
+    // The first change opens the batch, the following ones join it.
+    if (!flush_scheduled) {
+        const uint32_t now = eventOS_event_timer_ticks();
+        uint32_t delay = eventOS_event_timer_ms_to_ticks(NOTIFICATION_COALESCER_BATCH_WINDOW_MS);
+        for (int i = 0; i < NOTIFICATION_COALESCER_MAX_RESOURCES; i++) {
+            if (slots[i].pending) {
+                uint32_t allowed = ticks_until_allowed(&slots[i], now);
+                if (allowed > delay) {
+                    delay = allowed;
+                }
+            }
+        }
+        if (!schedule_flush(delay)) {
+            // Out of event memory, do not hold the values back.
+            notification_coalescer_flush();
+        }
+    }
+}
+
+int64_t notification_coalescer_get_value_int(M2MResource *resource)
+{
+    coalescer_slot_t *slot = find_slot(resource);
+    if (slot && slot->pending) {
+        return slot->value;
+    }
+    return resource->get_value_int();
+}
+
+void notification_coalescer_discard(M2MResource *resource)
+{
+    coalescer_slot_t *slot = find_slot(resource);
+    if (slot && resource) {
+        slot->pending = false;
+    }
+}
+
+void notification_coalescer_flush()
+{
+    const uint32_t now = eventOS_event_timer_ticks();
+
+    // Forget the minimum periods, everything pending goes out now.
+    for (int i = 0; i < NOTIFICATION_COALESCER_MAX_RESOURCES; i++) {
+        if (slots[i].pending) {
+            slots[i].last_sent_ticks = now - slots[i].min_period_ticks;
+        }
+    }
+    flush_pending();
+}
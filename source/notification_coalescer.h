@@ -0,0 +1,77 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef NOTIFICATION_COALESCER_H
+#define NOTIFICATION_COALESCER_H
+
+#include <stdint.h>
+
+class M2MResource;
+
+// Number of resources which can be registered to the coalescer.
+#ifndef NOTIFICATION_COALESCER_MAX_RESOURCES
+#define NOTIFICATION_COALESCER_MAX_RESOURCES 4
+#endif
+
+// Time to collect changes after the first one, before they are sent together.
+#ifndef NOTIFICATION_COALESCER_BATCH_WINDOW_MS
+#ifdef MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP_QUEUE
+#define NOTIFICATION_COALESCER_BATCH_WINDOW_MS 5000
+#else
+#define NOTIFICATION_COALESCER_BATCH_WINDOW_MS 200
+#endif
+#endif
+
+/**
+ * @brief Register a resource whose value updates go through the coalescer.
+ * @param resource Integer resource.
+ * @param min_period_ms Minimum time between two updates of the resource.
+ * @return true on success, false if all slots are in use.
+ */
+bool notification_coalescer_add(M2MResource *resource, uint32_t min_period_ms);
+
+/**
+ * @brief Set the value of a registered resource.
+ *
+ * The value is applied to the resource, and so notified, when the batch is
+ * flushed. The batch is flushed once the batch window has passed and the
+ * minimum period of every pending resource has elapsed, so all pending
+ * changes go out in one wake. A newer value replaces a pending one.
+ *
+ * In queue mode the client is resumed once per batch.
+ * Resources which have not been registered are updated immediately.
+ */
+void notification_coalescer_set_value(M2MResource *resource, int64_t value);
+
+/**
+ * @brief Value of the resource including a pending update.
+ */
+int64_t notification_coalescer_get_value_int(M2MResource *resource);
+
+/**
+ * @brief Drop the pending update of the resource, for example
+ *        when the server has written a new value to it.
+ */
+void notification_coalescer_discard(M2MResource *resource);
+
+/**
+ * @brief Apply the pending updates now.
+ */
+void notification_coalescer_flush();
+
+#endif // NOTIFICATION_COALESCER_H
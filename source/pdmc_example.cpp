@@ -26,6 +26,12 @@
 #include "key_config_manager.h"
 #include "factory_configurator_client.h"
 #include "mbed-client/m2minterface.h"
+#include "large_res_stream.h"
+#include "startup_profiler.h"
+#include "pdmc_fleet.h"
+#include "notification_coalescer.h"
+#include "reconnect_policy.h"
+#include "download_progress.h"
 
 #ifndef MBED_CONF_MBED_CLOUD_CLIENT_DISABLE_CERTIFICATE_ENROLLMENT
 #include "certificate_enrollment_user_cb.h"
@@ -52,7 +58,7 @@ static void blink_cb(void *);
 static void factory_reset_cb(void *);
 static void delivery_status_cb(const M2MBase &object, const M2MBase::MessageDeliveryStatus status, const M2MBase::MessageType type);
 static void large_res_sent_cb(const M2MBase &base, const M2MBase::MessageDeliveryStatus status, const M2MBase::MessageType type);
-static coap_response_code_e large_res_read_requested(const M2MResourceBase &resource, uint8_t *&buffer, size_t &buffer_size, size_t &total_size, const size_t offset, void *client_args);
+static const uint8_t *large_res_read_requested(void *ctx, size_t offset, uint8_t *block, size_t length);
 
 // PDMC callback functions
 static void pdmc_error_handler(int error_code);
@@ -64,6 +70,7 @@ static void pdmc_external_update_cb(uint32_t start_address, uint32_t size);
 
 // Helper methods
 static void reboot_if_threshold_value(int threshold);
+static void update_startup_profile();
 
 // Global variables
 #ifndef PDMC_EXAMPLE_MINIMAL
@@ -75,10 +82,10 @@ static MbedCloudClient pdmc_client;
 static M2MObjectList object_list;
 static bool register_called = false;
 static bool registered = false;
-static int error_count = 0;
+static reconnect_policy_t reconnect_policy = RECONNECT_POLICY_INIT("pdmc_reconnect", PDMC_RECONNECT_BASE_MS);
 volatile bool paused = false;
-static uint8_t *large_res_data = NULL;
 const static int16_t large_res_size = 2049;
+static const large_res_stream_t large_res_stream = { large_res_read_requested, large_res_size, NULL };
 
 // Pointers to the resources that will be created in main_application().
 static M2MResource *button_res;
@@ -86,6 +93,7 @@ static M2MResource *pattern_res;
 static M2MResource *blink_res;
 static M2MResource *factory_reset_res;
 static M2MResource *large_res;
+static M2MResource *startup_profile_res;
 
 void pdmc_init()
 {
@@ -100,17 +108,21 @@ void pdmc_close()
 void pdmc_resume()
 {
     paused = false;
-    int timeout_ms = 5000;
+    pdmc_connect_network();
+
+    pdmc_client.resume(mcc_platform_get_network_interface());
+}
+
+void pdmc_connect_network()
+{
     while (-1 == mcc_platform_interface_connect()) {
         // Will try to connect using mcc_platform_interface_connect until error count and then does reboot if
-        // not successful. Wait timeout is always doubled
-        printf("Network did not recover after pause. Try again after %d milliseconds.\n", timeout_ms);
-        mcc_platform_do_wait(timeout_ms);
-        timeout_ms *= 2;
+        // not successful. The backoff is reset when the client registers.
+        uint32_t timeout_ms = reconnect_policy_failure(&reconnect_policy);
+        printf("Network connect failed. Try again after %" PRIu32 " milliseconds.\n", timeout_ms);
+        mcc_platform_do_wait((int)timeout_ms);
         reboot_if_threshold_value(MAX_PDMC_CLIENT_CONNECTION_ERROR_COUNT);
     }
-
-    pdmc_client.resume(mcc_platform_get_network_interface());
 }
 
 bool pdmc_connect()
@@ -121,7 +133,21 @@ bool pdmc_connect()
     create_m2mobject_test_set(object_list);
 #endif
 
+#ifdef MEMORY_TESTS_HEAP
+#ifdef MEMORY_TESTS_SCALING_STEPS
+    // Object tree scaling, from one resource per instance to 2^(steps-1).
+    // Timed on pdmc_client before the setup, a second client would share its
+    // M2MDevice and M2MSecurity singletons.
+    const m2mobject_test_shape_t shape = { MEMORY_TESTS_OBJECT_COUNT, MEMORY_TESTS_OBJECT_INSTANCE_COUNT,
+                                           1, MEMORY_TESTS_VALUE_TYPE_COUNT };
+    print_m2mobject_scaling_stats(pdmc_client, shape, MEMORY_TESTS_SCALING_STEPS);
+#endif
+    uint64_t add_objects_start_us = startup_profiler_time_us();
     pdmc_client.add_objects(object_list);
+    printf("add_objects() took %lu us\r\n", (unsigned long)(startup_profiler_time_us() - add_objects_start_us));
+#else
+    pdmc_client.add_objects(object_list);
+#endif
 
     pdmc_client.on_error(&pdmc_error_handler);
     pdmc_client.on_status_changed(&pdmc_status_handler);
@@ -154,6 +180,7 @@ bool pdmc_connect()
 
 #ifndef PDMC_EXAMPLE_MINIMAL
     blinky.init(button_res);
+    blinky.set_pattern((const char *)pattern_res->value(), pattern_res->value_length());
     blinky.request_next_loop_event();
     blinky.request_automatic_increment_event();
 #endif
@@ -194,7 +221,15 @@ static void pdmc_status_handler(int status)
         case MbedCloudClient::Registered:
             printf("Client registered\r\n");
             registered = true;
-            error_count = 0;
+            reconnect_policy_success(&reconnect_policy);
+            if (!startup_profiler_complete()) {
+                startup_profiler_end(STARTUP_PHASE_REGISTRATION);
+                update_startup_profile();
+            }
+#if defined(__linux__) && defined(PDMC_FLEET)
+            pdmc_fleet_report(PDMC_FLEET_REGISTERED);
+#endif
+            mcc_platform_signal_event(MCC_PLATFORM_EVENT_REGISTERED);
             static const ConnectorClientEndpointInfo *endpoint = NULL;
             if (endpoint == NULL) {
                 endpoint = pdmc_client.endpoint_info();
@@ -217,6 +252,10 @@ static void pdmc_status_handler(int status)
             registered = false;
             register_called = false;
             printf("Client unregistered - Exiting application\n");
+#if defined(__linux__) && defined(PDMC_FLEET)
+            pdmc_fleet_report(PDMC_FLEET_UNREGISTERED);
+#endif
+            mcc_platform_signal_event(MCC_PLATFORM_EVENT_UNREGISTERED);
 #ifdef MEMORY_TESTS_HEAP
             print_heap_stats();
 #endif
@@ -224,7 +263,7 @@ static void pdmc_status_handler(int status)
 
         case MbedCloudClient::RegistrationUpdated:
             printf("Client registration updated\n");
-            error_count = 0;
+            reconnect_policy_success(&reconnect_policy);
             break;
 
         case MbedCloudClient::Paused:
@@ -360,6 +399,7 @@ static void pdmc_error_handler(int error_code)
             error_code == MbedCloudClient::ConnectDnsResolvingFailed ||
             error_code == MbedCloudClient::ConnectSecureConnectionFailed ||
             error_code == MbedCloudClient::ConnectTimeout) {
+        (void)reconnect_policy_failure(&reconnect_policy);
         reboot_if_threshold_value(MAX_ERROR_COUNT);
     }
 #endif
@@ -421,7 +461,24 @@ bool create_pdmc_resources()
     }
 
     large_res->set_message_delivery_status_cb((void(*)(const M2MBase &, const M2MBase::MessageDeliveryStatus, const M2MBase::MessageType, void *))large_res_sent_cb, NULL);
-    large_res->set_read_resource_function(large_res_read_requested, NULL);
+    if (!large_res_stream_attach(large_res, &large_res_stream)) {
+        return false;
+    }
+
+    // Create a resource for reading the duration of each startup phase until the first registration,
+    // in microseconds as a JSON object. Path of this resource will be: 5000/0/3.
+    startup_profile_res = M2MInterfaceFactory::create_resource(object_list, 5000, 0, 3, M2MResourceInstance::STRING, M2MBase::GET_ALLOWED);
+    if (!startup_profile_res) {
+        return false;
+    }
+
+#if defined(MBED_CLOUD_CLIENT_SUPPORT_UPDATE) || defined(MBED_CLOUD_CLIENT_FOTA_ENABLE)
+    // Create resources for the firmware download progress, throughput and time remaining.
+    // Paths of these resources will be: 5000/0/4, 5000/0/5 and 5000/0/6.
+    if (!download_progress_create_resources(object_list)) {
+        return false;
+    }
+#endif
 
 #ifdef MBED_CLOUD_CLIENT_TRANSPORT_MODE_UDP_QUEUE
     button_res->set_auto_observable(true);
@@ -435,17 +492,34 @@ bool create_pdmc_resources()
 
 static void reboot_if_threshold_value(int threshold)
 {
-    if (++error_count == threshold) {
+    if (reconnect_policy_reboot_due(&reconnect_policy, threshold)) {
         printf("Max error count %d reached, rebooting.\n\n", threshold);
         mcc_platform_do_wait(1 * 1000);
         mcc_platform_reboot();
     }
 }
 
+static void update_startup_profile()
+{
+    char buffer[STARTUP_PROFILER_FORMAT_SIZE];
+    size_t length = startup_profiler_format(buffer, sizeof(buffer));
+
+    if (startup_profile_res && length > 0) {
+        startup_profile_res->set_value((const unsigned char *)buffer, length);
+    }
+
+#if defined(__linux__)
+    startup_profiler_print();
+#endif
+}
+
 /** Resource callback functions --> **/
 
 static void button_counter_updated(const char *)
 {
+    // The value written by the server replaces a pending local update.
+    notification_coalescer_discard(button_res);
+
     // Converts uint64_t to a string to remove the dependency for int64 printf implementation.
     char buffer[20 + 1];
     (void) m2m::itoa_c(button_res->get_value_int(), buffer);
@@ -455,6 +529,13 @@ static void button_counter_updated(const char *)
 static void blink_pattern_updated(const char *)
 {
     printf("PUT received, new value: %s\r\n", pattern_res->get_value_string().c_str());
+
+#ifndef PDMC_EXAMPLE_MINIMAL
+    // Compile the pattern here, so blinking does not need to parse it.
+    if (!blinky.set_pattern((const char *)pattern_res->value(), pattern_res->value_length())) {
+        printf("Invalid blink pattern, keeping the previous one\r\n");
+    }
+#endif
 }
 
 static void blink_cb(void *)
@@ -462,12 +543,11 @@ static void blink_cb(void *)
     String pattern_string = pattern_res->get_value_string();
     printf("POST executed\r\n");
 
-    // The pattern is something like 500:200:500, so parse that.
-    // LED blinking is done while parsing.
+    // The pattern is something like 500:200:500, compiled when it was set.
 #ifndef PDMC_EXAMPLE_MINIMAL
     const bool restart_pattern = false;
-    if (blinky.start((char *)pattern_res->value(), pattern_res->value_length(), restart_pattern) == false) {
-        printf("out of memory error\r\n");
+    if (blinky.start(restart_pattern) == false) {
+        printf("no valid blink pattern\r\n");
     }
 #endif
     blink_res->send_delayed_post_response();
@@ -513,13 +593,16 @@ static void large_res_sent_cb(const M2MBase &base,
 {
     switch (status) {
         case M2MBase::MESSAGE_STATUS_DELIVERED:
-            free(large_res_data);
-            printf("5000/0/2 data sent to server, memory can be now released\r\n");
+            printf("5000/0/2 data sent to server\r\n");
+#ifdef MEMORY_TESTS_HEAP
+            large_res_stream_print_stats();
+            print_heap_stats();
+#endif
             break;
 
         case M2MBase::MESSAGE_STATUS_SEND_FAILED:
             printf("Failed to send 5000/0/2 data!\r\n");
-            free(large_res_data);
+            large_res_stream_release(base);
             break;
 
         default:
@@ -540,34 +623,18 @@ static void factory_reset_cb(void *)
     kcm_factory_reset();
 }
 
-static coap_response_code_e large_res_read_requested(const M2MResourceBase &resource,
-                                                     uint8_t *&buffer,
-                                                     size_t &buffer_size,
-                                                     size_t &total_size,
-                                                     const size_t offset,
-                                                     void */*client_args*/)
+// Produces the 5000/0/2 payload one block at a time into the buffer of the transfer,
+// so the whole payload is never held in memory.
+static const uint8_t *large_res_read_requested(void */*ctx*/,
+                                               size_t offset,
+                                               uint8_t *block,
+                                               size_t length)
 {
-    printf("GET request received for resource: %s\r\n", resource.uri_path());
-
-    // Allocate buffer when first request comes in
     if (offset == 0) {
-        large_res_data = (uint8_t *)malloc(large_res_size);
-        memset(large_res_data, 0, large_res_size);
-    }
-
-    if (!large_res_data) {
-        return COAP_RESPONSE_INTERNAL_SERVER_ERROR;
-    }
-
-    total_size = large_res_size;
-
-    // Adjust last package size
-    if (offset + buffer_size > total_size) {
-        buffer_size = total_size - offset;
+        printf("GET request received for resource: 5000/0/2\r\n");
     }
 
-    // Read data from offset
-    buffer = (uint8_t *)large_res_data + offset;
+    memset(block, 0, length);
 
-    return COAP_RESPONSE_CONTENT;
+    return block;
 }
@@ -23,8 +23,12 @@
 
 // Starting with 5s, after every iteration waiting time is multiplied by 2 -> max waiting time is with 9 is 1280s (~21min)
 // it is this long as with bad cellular rssi register and plmn selection might take 5mins so we wan't to give it a few tries.
+// The actual wait is randomized below that limit, see reconnect_policy.h.
 #define MAX_PDMC_CLIENT_CONNECTION_ERROR_COUNT 9
 
+// Base wait of the reconnect backoff.
+#define PDMC_RECONNECT_BASE_MS 5000
+
 void pdmc_init();
 
 void pdmc_close();
@@ -33,6 +37,9 @@ bool pdmc_connect();
 
 void pdmc_resume();
 
+// Connect the network interface, retrying with backoff until it succeeds.
+void pdmc_connect_network();
+
 bool pdmc_registered();
 
 bool pdmc_paused();
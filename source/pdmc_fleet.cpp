@@ -0,0 +1,311 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "pdmc_fleet.h"
+
+#if defined(__linux__) && defined(PDMC_FLEET)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "pal.h"
+#include "startup_profiler.h"
+
+#define FLEET_DIR "fleet"
+
+// Period of the checks for exited endpoints and for the timeout.
+#define FLEET_POLL_MS 200
+
+typedef enum {
+    FLEET_ENDPOINT_RUNNING,
+    FLEET_ENDPOINT_REGISTERED,
+    FLEET_ENDPOINT_EXITED
+} fleet_endpoint_state_e;
+
+typedef struct fleet_message {
+    int index;
+    int event;
+} fleet_message_t;
+
+// Write end of the report pipe in an endpoint process, -1 in the parent.
+static int report_fd = -1;
+static int fleet_index = -1;
+
+static int fleet_size(void)
+{
+    const char *env = getenv("PDMC_FLEET_SIZE");
+    int size = env ? atoi(env) : PDMC_FLEET_DEFAULT_SIZE;
+    return (size > 0) ? size : PDMC_FLEET_DEFAULT_SIZE;
+}
+
+static int fleet_timeout_s(void)
+{
+    const char *env = getenv("PDMC_FLEET_TIMEOUT");
+    int timeout = env ? atoi(env) : PDMC_FLEET_DEFAULT_TIMEOUT;
+    return (timeout > 0) ? timeout : PDMC_FLEET_DEFAULT_TIMEOUT;
+}
+
+// Directory holding a storage snapshot with the credentials of each endpoint.
+static const char *fleet_credentials(void)
+{
+    const char *dir = getenv("PDMC_FLEET_CREDENTIALS");
+    return (dir && *dir) ? dir : NULL;
+}
+
+// Proportional set size of the process, so pages shared with
+// the other endpoints are divided between them.
+static unsigned long process_pss_kb(pid_t pid)
+{
+    char path[64];
+    char line[128];
+    unsigned long pss_kb = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "Pss: %lu kB", &pss_kb) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return pss_kb;
+}
+
+// Boot the endpoint from its own credentials, see pdmc_fleet.h.
+static bool use_endpoint_credentials(int index)
+{
+    const char *credentials = fleet_credentials();
+    char path[PATH_MAX];
+    struct stat st;
+
+    if (!credentials) {
+        // Endpoint names of the local server are made unique in application_init.cpp.
+        return true;
+    }
+    if (snprintf(path, sizeof(path), "%s/%d", credentials, index) >= (int)sizeof(path) ||
+            stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        printf("Fleet endpoint %d: no credentials in %s/%d\n", index, credentials, index);
+        return false;
+    }
+    return setenv("PDMC_STORAGE_SNAPSHOT", path, 1) == 0;
+}
+
+static void run_endpoint(int index, main_t main_func)
+{
+    char path[32];
+
+    fleet_index = index;
+
+    // Endpoints stop with the fleet.
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+    snprintf(path, sizeof(path), FLEET_DIR "/%d", index);
+    if ((mkdir(path, 0744) != 0 && errno != EEXIST) || chdir(path) != 0) {
+        printf("Fleet endpoint %d: cannot use directory %s\n", index, path);
+        _exit(1);
+    }
+
+    // Keep the console of the fleet readable, and the button thread off the terminal.
+    int log_fd = open("console.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int null_fd = open("/dev/null", O_RDONLY);
+    if (log_fd >= 0) {
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        close(log_fd);
+    }
+    if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        close(null_fd);
+    }
+
+    if (!use_endpoint_credentials(index)) {
+        fflush(NULL);
+        _exit(1);
+    }
+
+    int status = mcc_platform_run_program(main_func);
+    fflush(NULL);
+    _exit(status);
+}
+
+int pdmc_fleet_run(main_t main_func)
+{
+    const int size = fleet_size();
+    char mount_point[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    int fds[2];
+
+    // The storage of each endpoint is separated by its working directory.
+    if (pal_fsGetMountPoint(PAL_FS_PARTITION_PRIMARY, sizeof(mount_point), mount_point) != PAL_SUCCESS ||
+            mount_point[0] == '/') {
+        printf("Fleet mode needs a storage mount point relative to the working directory\n");
+        return 1;
+    }
+
+    // Device Management does not accept many connections with one identity.
+#ifndef LOCAL_LWM2M_SERVER_URI
+    const char *credentials = fleet_credentials();
+    if (!credentials || credentials[0] != '/') {
+        printf("Fleet mode needs an absolute PDMC_FLEET_CREDENTIALS directory with the credentials of each endpoint\n");
+        return 1;
+    }
+#endif
+
+    if ((mkdir(FLEET_DIR, 0744) != 0 && errno != EEXIST) || pipe(fds) != 0) {
+        printf("Fleet mode setup failed, errno %d\n", errno);
+        return 1;
+    }
+
+    pid_t *pids = (pid_t *)calloc(size, sizeof(pid_t));
+    fleet_endpoint_state_e *states = (fleet_endpoint_state_e *)calloc(size, sizeof(fleet_endpoint_state_e));
+    if (!pids || !states) {
+        free(pids);
+        free(states);
+        return 1;
+    }
+
+    printf("Starting fleet of %d endpoints in ./" FLEET_DIR "\n", size);
+    fflush(stdout);
+
+    const uint64_t start_us = startup_profiler_time_us();
+    int started = 0;
+    for (; started < size; started++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            report_fd = fds[1];
+            run_endpoint(started, main_func);
+        } else if (pid < 0) {
+            printf("fork() failed after %d endpoints, errno %d\n", started, errno);
+            break;
+        }
+        pids[started] = pid;
+    }
+    close(fds[1]);
+
+    // Collect the registrations until every endpoint has registered or exited. Every endpoint
+    // holds the write end of the pipe, so the exits are reaped rather than waited for as end of file.
+    const uint64_t deadline_us = start_us + (uint64_t)fleet_timeout_s() * 1000000;
+    fleet_message_t msg;
+    int registered = 0;
+    int exited = 0;
+    uint64_t last_us = start_us;
+    while (registered + exited < started) {
+        struct pollfd pfd = { fds[0], POLLIN, 0 };
+        if (poll(&pfd, 1, FLEET_POLL_MS) > 0 && (pfd.revents & POLLIN) &&
+                read(fds[0], &msg, sizeof(msg)) == sizeof(msg) &&
+                msg.index >= 0 && msg.index < started) {
+            if (msg.event == PDMC_FLEET_REGISTERED && states[msg.index] != FLEET_ENDPOINT_REGISTERED) {
+                // The exit of the endpoint may have been reaped before its report was read.
+                if (states[msg.index] == FLEET_ENDPOINT_EXITED) {
+                    exited--;
+                }
+                states[msg.index] = FLEET_ENDPOINT_REGISTERED;
+                last_us = startup_profiler_time_us();
+                registered++;
+            } else if (msg.event == PDMC_FLEET_UNREGISTERED) {
+                printf("Fleet endpoint %d unregistered\n", msg.index);
+            }
+        }
+
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            for (int i = 0; i < started; i++) {
+                if (pids[i] != pid) {
+                    continue;
+                }
+                pids[i] = 0;
+                if (states[i] == FLEET_ENDPOINT_RUNNING) {
+                    printf("Fleet endpoint %d exited before registering, status %d, see " FLEET_DIR "/%d/console.log\n",
+                           i, WIFEXITED(status) ? WEXITSTATUS(status) : -1, i);
+                    states[i] = FLEET_ENDPOINT_EXITED;
+                    exited++;
+                }
+                break;
+            }
+        }
+
+        if (startup_profiler_time_us() >= deadline_us) {
+            printf("Fleet: timeout, %d endpoints did not register\n", started - registered - exited);
+            break;
+        }
+    }
+
+    unsigned long pss_kb = 0;
+    int running = 0;
+    for (int i = 0; i < started; i++) {
+        if (pids[i] > 0) {
+            pss_kb += process_pss_kb(pids[i]);
+            running++;
+        }
+    }
+
+    const uint64_t elapsed_us = last_us - start_us;
+    printf("Fleet: %d/%d endpoints registered in %lu ms, %.1f registrations/s, %d exited\n",
+           registered, started, (unsigned long)(elapsed_us / 1000),
+           elapsed_us ? (double)registered * 1000000.0 / (double)elapsed_us : 0.0, exited);
+    printf("Fleet: %lu kB PSS per running endpoint\n", running ? pss_kb / running : 0UL);
+    fflush(stdout);
+
+    // Keep running until the endpoints are done.
+    for (int i = 0; i < started; i++) {
+        if (pids[i] > 0) {
+            waitpid(pids[i], NULL, 0);
+        }
+    }
+
+    close(fds[0]);
+    free(pids);
+    free(states);
+
+    return 1;
+}
+
+int pdmc_fleet_index(void)
+{
+    return fleet_index;
+}
+
+void pdmc_fleet_report(pdmc_fleet_event_e event)
+{
+    if (report_fd < 0) {
+        return;
+    }
+
+    // Messages are smaller than PIPE_BUF, so the writes of the endpoints do not interleave.
+    fleet_message_t msg = { fleet_index, (int)event };
+    if (write(report_fd, &msg, sizeof(msg)) != sizeof(msg)) {
+        printf("Fleet report failed, errno %d\n", errno);
+    }
+}
+
+#endif // __linux__ && PDMC_FLEET
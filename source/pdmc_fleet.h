@@ -0,0 +1,86 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef PDMC_FLEET_H
+#define PDMC_FLEET_H
+
+/*
+ * Fleet mode for load testing a Device Management service from one Linux host.
+ *
+ * The client library keeps its state (MbedCloudClient, the M2M singletons,
+ * KCM and PAL) per process, so every simulated endpoint runs main_application()
+ * in its own forked process. The endpoints share the read-only pages of the
+ * parent and each of them gets its own working directory fleet/<index>/,
+ * which holds its storage and console.log.
+ *
+ * Every endpoint has its own identity. Set PDMC_FLEET_CREDENTIALS to an
+ * absolute directory holding a storage snapshot (see storage_snapshot.h) of
+ * a device provisioned with its own credentials for each index, as
+ * <dir>/0, <dir>/1 and so on. A snapshot is captured by running a single
+ * provisioned device with PDMC_STORAGE_SNAPSHOT=<dir>/<index>. Endpoints
+ * without a snapshot exit. Device Management does not accept the same
+ * credentials from many connections, so the fleet does not start without
+ * them. With LOCAL_LWM2M_SERVER_URI the credentials are optional, as the
+ * endpoint name is the identity and <index> is appended to it.
+ *
+ * The parent reaps the endpoints that exit before registering, and stops
+ * waiting for registrations after PDMC_FLEET_TIMEOUT seconds.
+ *
+ * Enabled with PDMC_FLEET, the number of endpoints is read from the environment
+ * variable PDMC_FLEET_SIZE.
+ */
+
+#include "mcc_common_setup.h"
+
+#if defined(__linux__) && defined(PDMC_FLEET)
+
+// Number of endpoints when PDMC_FLEET_SIZE is not set.
+#ifndef PDMC_FLEET_DEFAULT_SIZE
+#define PDMC_FLEET_DEFAULT_SIZE 10
+#endif
+
+// Seconds to wait for the registrations when PDMC_FLEET_TIMEOUT is not set.
+#ifndef PDMC_FLEET_DEFAULT_TIMEOUT
+#define PDMC_FLEET_DEFAULT_TIMEOUT 300
+#endif
+
+typedef enum {
+    PDMC_FLEET_REGISTERED,
+    PDMC_FLEET_UNREGISTERED
+} pdmc_fleet_event_e;
+
+/*
+ * Fork the endpoints, each running main_func, and report the aggregate
+ * registration rate and memory use per endpoint.
+ */
+int pdmc_fleet_run(main_t main_func);
+
+/*
+ * Index of the calling endpoint, -1 when not running in fleet mode.
+ */
+int pdmc_fleet_index(void);
+
+/*
+ * Report an event of the calling endpoint to the fleet, does nothing
+ * when not running in fleet mode.
+ */
+void pdmc_fleet_report(pdmc_fleet_event_e event);
+
+#endif // __linux__ && PDMC_FLEET
+
+#endif // PDMC_FLEET_H
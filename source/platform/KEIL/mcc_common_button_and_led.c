@@ -25,6 +25,12 @@ uint8_t mcc_platform_button_clicked(void)
     return 0;
 }
 
+uint8_t mcc_platform_set_button_callback(mcc_platform_button_cb cb)
+{
+    (void)cb;
+    return 0;
+}
+
 uint8_t mcc_platform_init_button_and_led(void)
 {
     return 1;
@@ -44,6 +44,7 @@ const osThreadAttr_t app_main_attr = {
 };
 
 static void *network_interface = NULL;
+static osEventFlagsId_t event_flags;
 
 #ifdef RTE_IoT_Socket_WiFi
 
@@ -165,6 +166,7 @@ int mcc_platform_init(void)
 #endif
 
     osKernelInitialize();
+    event_flags = osEventFlagsNew(NULL);
 
     return 0;
 }
@@ -179,6 +181,25 @@ void mcc_platform_do_wait(int timeout_ms)
     osDelay(timeout_ms);
 }
 
+void mcc_platform_signal_event(uint32_t events)
+{
+    if (event_flags) {
+        (void)osEventFlagsSet(event_flags, events);
+    }
+}
+
+uint32_t mcc_platform_wait_event(uint32_t events, int timeout_ms)
+{
+    if (event_flags == NULL) {
+        mcc_platform_do_wait(timeout_ms == MCC_PLATFORM_WAIT_FOREVER ? 100 : timeout_ms);
+        return 0;
+    }
+    uint32_t timeout = (timeout_ms == MCC_PLATFORM_WAIT_FOREVER) ? osWaitForever : (uint32_t)timeout_ms;
+    uint32_t set = osEventFlagsWait(event_flags, events, osFlagsWaitAny, timeout);
+    // Errors, including the timeout, have the top bit set.
+    return (set & osFlagsError) ? 0 : (set & events);
+}
+
 int mcc_platform_run_program(main_t mainFunc)
 {
     mainFunc();
@@ -31,6 +31,7 @@
 
 #if PLATFORM_ENABLE_BUTTON
 static volatile int button_pressed = 0;
+static volatile mcc_platform_button_cb button_cb = NULL;
 #endif
 
 // Internal function prototypes
@@ -58,6 +59,17 @@ uint8_t mcc_platform_button_clicked(void)
     return 0;
 }
 
+uint8_t mcc_platform_set_button_callback(mcc_platform_button_cb cb)
+{
+#if PLATFORM_ENABLE_BUTTON
+    button_cb = cb;
+#else
+    (void)cb;
+#endif
+    // No polling is needed without a button either.
+    return 1;
+}
+
 #if PLATFORM_ENABLE_BUTTON
 void *button_thread(void *arg)
 {
@@ -65,7 +77,12 @@ void *button_thread(void *arg)
     // and consumes a lot of CPU. EOF will be return if there is no tty
     // or Ctrl+D is pressed.
     while (getchar() != EOF) {
-        button_pressed = 1;
+        mcc_platform_button_cb cb = button_cb;
+        if (cb) {
+            cb();
+        } else {
+            button_pressed = 1;
+        }
     }
     button_pressed = 0;
     return NULL;
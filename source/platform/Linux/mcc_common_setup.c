@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -191,6 +192,62 @@ void mcc_platform_do_wait(int timeout_ms)
     } while ((-1 == stat) && (EINTR == errno)) ;
 }
 
+static pthread_once_t event_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t event_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t event_cond;
+static uint32_t event_flags;
+
+static void event_init(void)
+{
+    // Timeouts must not jump with the wall clock.
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&event_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void mcc_platform_signal_event(uint32_t events)
+{
+    pthread_once(&event_once, event_init);
+    pthread_mutex_lock(&event_mutex);
+    event_flags |= events;
+    pthread_cond_broadcast(&event_cond);
+    pthread_mutex_unlock(&event_mutex);
+}
+
+uint32_t mcc_platform_wait_event(uint32_t events, int timeout_ms)
+{
+    struct timespec deadline;
+    uint32_t set;
+    int stat = 0;
+
+    pthread_once(&event_once, event_init);
+    if (timeout_ms != MCC_PLATFORM_WAIT_FOREVER) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&event_mutex);
+    while ((event_flags & events) == 0 && stat != ETIMEDOUT) {
+        if (timeout_ms == MCC_PLATFORM_WAIT_FOREVER) {
+            stat = pthread_cond_wait(&event_cond, &event_mutex);
+        } else {
+            stat = pthread_cond_timedwait(&event_cond, &event_mutex, &deadline);
+        }
+    }
+    set = event_flags & events;
+    event_flags &= ~set;
+    pthread_mutex_unlock(&event_mutex);
+
+    return set;
+}
+
 int mcc_platform_run_program(main_t mainFunc)
 {
     mainFunc();
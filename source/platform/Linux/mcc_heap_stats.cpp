@@ -0,0 +1,517 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+///////////
+// INCLUDES
+///////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <new>
+#include <sys/mman.h>
+
+#include "mcc_heap_stats.h"
+
+#if defined(MEMORY_TESTS_HEAP) && defined(__GLIBC__)
+
+// Linux counterpart of the Mbed OS heap statistics. The malloc family and the
+// C++ allocation operators are interposed, each block gets a header recording
+// its size and call site, and the glibc allocator does the actual work.
+//
+// Blocks allocated before the interposer, or by ld.so, have no header. The
+// pointers returned by the interposer are therefore kept in a set, and only
+// those are taken as having one: nothing is read before a foreign pointer.
+
+extern "C" {
+    void *__libc_malloc(size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void *ptr);
+}
+
+// Call sites are kept in an open addressing table, sites which do not fit are
+// accounted together to a NULL site.
+#ifndef MCC_HEAP_STATS_SITES
+#define MCC_HEAP_STATS_SITES 512
+#endif
+
+typedef struct heap_header {
+    size_t size;
+    void *site;
+    size_t offset;      // Offset of the user pointer from the block returned by glibc
+    size_t reserved;
+} heap_header_t;
+
+static_assert(sizeof(heap_header_t) % 16 == 0, "header must keep malloc alignment");
+
+typedef struct heap_site {
+    void *site;
+    size_t current_size;
+    uint32_t alloc_cnt;
+} heap_site_t;
+
+static mcc_heap_stats_t heap_stats;
+static heap_site_t heap_sites[MCC_HEAP_STATS_SITES];
+static heap_site_t heap_site_overflow;
+static volatile bool heap_lock_flag = false;
+
+// Set of the live user pointers, open addressing with linear probing. The
+// table is mapped directly, as allocating it through malloc would recurse.
+static uintptr_t *live_table;
+static size_t live_capacity;
+static size_t live_count;
+
+static void heap_lock(void)
+{
+    while (__atomic_test_and_set(&heap_lock_flag, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static void heap_unlock(void)
+{
+    __atomic_clear(&heap_lock_flag, __ATOMIC_RELEASE);
+}
+
+// Must be called with the lock held.
+static heap_site_t *heap_site_get(void *site)
+{
+    size_t index = ((uintptr_t)site >> 2) % MCC_HEAP_STATS_SITES;
+
+    for (size_t i = 0; i < MCC_HEAP_STATS_SITES; i++) {
+        heap_site_t *entry = &heap_sites[(index + i) % MCC_HEAP_STATS_SITES];
+        if (entry->site == site) {
+            return entry;
+        }
+        if (entry->site == NULL) {
+            entry->site = site;
+            return entry;
+        }
+    }
+
+    return &heap_site_overflow;
+}
+
+static size_t live_slot(uintptr_t ptr)
+{
+    return (size_t)(((uint64_t)(ptr >> 4) * 0x9E3779B97F4A7C15ull) >> 16) & (live_capacity - 1);
+}
+
+// Must be called with the lock held.
+static bool live_grow(void)
+{
+    size_t capacity = live_capacity ? live_capacity * 2 : 4096;
+    void *table = mmap(NULL, capacity * sizeof(uintptr_t), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (table == MAP_FAILED) {
+        return false;
+    }
+
+    uintptr_t *old_table = live_table;
+    size_t old_capacity = live_capacity;
+    live_table = (uintptr_t *)table;
+    live_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_table[i]) {
+            size_t slot = live_slot(old_table[i]);
+            while (live_table[slot]) {
+                slot = (slot + 1) & (live_capacity - 1);
+            }
+            live_table[slot] = old_table[i];
+        }
+    }
+    if (old_table) {
+        munmap(old_table, old_capacity * sizeof(uintptr_t));
+    }
+    return true;
+}
+
+// Must be called with the lock held.
+static bool live_insert(void *ptr)
+{
+    if ((live_count + 1) * 2 > live_capacity && !live_grow()) {
+        return false;
+    }
+    size_t slot = live_slot((uintptr_t)ptr);
+    while (live_table[slot]) {
+        slot = (slot + 1) & (live_capacity - 1);
+    }
+    live_table[slot] = (uintptr_t)ptr;
+    live_count++;
+    return true;
+}
+
+// Must be called with the lock held, returns false for a pointer not in the set.
+static bool live_remove(void *ptr)
+{
+    if (!live_capacity) {
+        return false;
+    }
+    size_t slot = live_slot((uintptr_t)ptr);
+    while (live_table[slot] != (uintptr_t)ptr) {
+        if (!live_table[slot]) {
+            return false;
+        }
+        slot = (slot + 1) & (live_capacity - 1);
+    }
+
+    // Shift the following entries of the probe sequence back, so no tombstones are needed.
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & (live_capacity - 1); live_table[next]; next = (next + 1) & (live_capacity - 1)) {
+        size_t home = live_slot(live_table[next]);
+        if (((next - home) & (live_capacity - 1)) >= ((next - hole) & (live_capacity - 1))) {
+            live_table[hole] = live_table[next];
+            hole = next;
+        }
+    }
+    live_table[hole] = 0;
+    live_count--;
+    return true;
+}
+
+// Must be called with the lock held.
+static bool live_contains(void *ptr)
+{
+    if (!live_capacity) {
+        return false;
+    }
+    for (size_t slot = live_slot((uintptr_t)ptr); live_table[slot]; slot = (slot + 1) & (live_capacity - 1)) {
+        if (live_table[slot] == (uintptr_t)ptr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *heap_track(void *raw, size_t size, size_t offset, void *site)
+{
+    char *ptr = raw ? (char *)raw + offset : NULL;
+
+    heap_lock();
+    if (ptr && !live_insert(ptr)) {
+        __libc_free(raw);
+        ptr = NULL;
+    }
+    if (!ptr) {
+        heap_stats.alloc_fail_cnt++;
+        heap_unlock();
+        return NULL;
+    }
+
+    heap_header_t *header = (heap_header_t *)ptr - 1;
+    header->size = size;
+    header->site = site;
+    header->offset = offset;
+
+    heap_stats.current_size += size;
+    heap_stats.total_size += size;
+    heap_stats.alloc_cnt++;
+    if (heap_stats.current_size > heap_stats.max_size) {
+        heap_stats.max_size = heap_stats.current_size;
+    }
+    heap_site_t *entry = heap_site_get(site);
+    entry->current_size += size;
+    entry->alloc_cnt++;
+    heap_unlock();
+
+    return ptr;
+}
+
+// Returns the header of a block allocated through heap_track(), NULL otherwise.
+static heap_header_t *heap_header_of(void *ptr)
+{
+    heap_lock();
+    bool owned = live_contains(ptr);
+    heap_unlock();
+    return owned ? (heap_header_t *)ptr - 1 : NULL;
+}
+
+// Must be called with the lock held.
+static void heap_untrack_locked(const heap_header_t *header)
+{
+    heap_stats.current_size -= header->size;
+    heap_stats.alloc_cnt--;
+    heap_site_t *entry = heap_site_get(header->site);
+    entry->current_size -= header->size;
+    entry->alloc_cnt--;
+}
+
+static void *heap_alloc(size_t size, void *site)
+{
+    if (size > SIZE_MAX - sizeof(heap_header_t)) {
+        return heap_track(NULL, size, 0, site);
+    }
+    return heap_track(__libc_malloc(size + sizeof(heap_header_t)), size, sizeof(heap_header_t), site);
+}
+
+static void *heap_alloc_aligned(size_t alignment, size_t size, void *site)
+{
+    if (alignment < sizeof(heap_header_t)) {
+        alignment = sizeof(heap_header_t);
+    }
+    // Reserve a full alignment unit for the header to keep the user pointer aligned.
+    size_t offset = (sizeof(heap_header_t) + alignment - 1) & ~(alignment - 1);
+    if (size > SIZE_MAX - offset) {
+        return heap_track(NULL, size, 0, site);
+    }
+    return heap_track(__libc_memalign(alignment, size + offset), size, offset, site);
+}
+
+static void heap_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    heap_header_t *header = (heap_header_t *)ptr - 1;
+    heap_lock();
+    if (!live_remove(ptr)) {
+        heap_unlock();
+        __libc_free(ptr);
+        return;
+    }
+    heap_untrack_locked(header);
+    heap_unlock();
+
+    __libc_free((char *)ptr - header->offset);
+}
+
+extern "C" {
+
+    void *malloc(size_t size)
+    {
+        return heap_alloc(size, __builtin_return_address(0));
+    }
+
+    void *calloc(size_t nmemb, size_t size)
+    {
+        if (size && nmemb > SIZE_MAX / size) {
+            return NULL;
+        }
+        void *ptr = heap_alloc(nmemb * size, __builtin_return_address(0));
+        if (ptr) {
+            memset(ptr, 0, nmemb * size);
+        }
+        return ptr;
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        void *site = __builtin_return_address(0);
+
+        if (!ptr) {
+            return heap_alloc(size, site);
+        }
+        if (size == 0) {
+            heap_free(ptr);
+            return NULL;
+        }
+
+        heap_header_t *header = heap_header_of(ptr);
+        if (!header) {
+            return __libc_realloc(ptr, size);
+        }
+
+        if (header->offset != sizeof(heap_header_t) || size > SIZE_MAX - sizeof(heap_header_t)) {
+            // Aligned block, the alignment is not kept by __libc_realloc().
+            void *new_ptr = heap_alloc(size, site);
+            if (new_ptr) {
+                memcpy(new_ptr, ptr, (header->size < size) ? header->size : size);
+                heap_free(ptr);
+            }
+            return new_ptr;
+        }
+
+        // The old pointer leaves the set before glibc may release it. It is
+        // accounted as freed only once glibc has succeeded, on failure the
+        // old block stays valid and goes back to the set.
+        heap_header_t old = *header;
+        heap_lock();
+        live_remove(ptr);
+        heap_unlock();
+        void *raw = __libc_realloc((char *)ptr - old.offset, size + sizeof(heap_header_t));
+        heap_lock();
+        if (!raw) {
+            // Cannot fail, the slot of the old pointer was just freed.
+            (void)live_insert(ptr);
+            heap_stats.alloc_fail_cnt++;
+            heap_unlock();
+            return NULL;
+        }
+        heap_untrack_locked(&old);
+        heap_unlock();
+        return heap_track(raw, size, sizeof(heap_header_t), site);
+    }
+
+    void free(void *ptr)
+    {
+        heap_free(ptr);
+    }
+
+    void *memalign(size_t alignment, size_t size)
+    {
+        return heap_alloc_aligned(alignment, size, __builtin_return_address(0));
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size)
+    {
+        return heap_alloc_aligned(alignment, size, __builtin_return_address(0));
+    }
+
+    int posix_memalign(void **memptr, size_t alignment, size_t size)
+    {
+        if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+            return EINVAL;
+        }
+        void *ptr = heap_alloc_aligned(alignment, size, __builtin_return_address(0));
+        if (!ptr) {
+            return ENOMEM;
+        }
+        *memptr = ptr;
+        return 0;
+    }
+
+    void *valloc(size_t size)
+    {
+        return heap_alloc_aligned(sysconf(_SC_PAGESIZE), size, __builtin_return_address(0));
+    }
+
+    size_t malloc_usable_size(void *ptr)
+    {
+        heap_header_t *header = ptr ? heap_header_of(ptr) : NULL;
+        return header ? header->size : 0;
+    }
+
+    void mcc_heap_stats_get(mcc_heap_stats_t *stats)
+    {
+        heap_lock();
+        *stats = heap_stats;
+        heap_unlock();
+    }
+
+    void mcc_heap_stats_print_sites(unsigned max_sites)
+    {
+        // Printing may allocate, so pick the top sites while holding the lock
+        // and print only after releasing it.
+        heap_site_t top[16];
+        unsigned count = 0;
+
+        if (max_sites > sizeof(top) / sizeof(top[0])) {
+            max_sites = sizeof(top) / sizeof(top[0]);
+        }
+
+        heap_lock();
+        for (size_t i = 0; i <= MCC_HEAP_STATS_SITES; i++) {
+            const heap_site_t *entry = (i < MCC_HEAP_STATS_SITES) ? &heap_sites[i] : &heap_site_overflow;
+            if (entry->current_size == 0) {
+                continue;
+            }
+            unsigned pos = count;
+            while (pos > 0 && top[pos - 1].current_size < entry->current_size) {
+                if (pos < max_sites) {
+                    top[pos] = top[pos - 1];
+                }
+                pos--;
+            }
+            if (pos < max_sites) {
+                top[pos] = *entry;
+                if (count < max_sites) {
+                    count++;
+                }
+            }
+        }
+        heap_unlock();
+
+        for (unsigned i = 0; i < count; i++) {
+            printf("**** site %p: %lu bytes in %lu blocks\n", top[i].site,
+                   (unsigned long)top[i].current_size, (unsigned long)top[i].alloc_cnt);
+        }
+    }
+
+}
+
+void *operator new(std::size_t size)
+{
+    void *ptr = heap_alloc(size, __builtin_return_address(0));
+    if (!ptr) {
+#if defined(__cpp_exceptions)
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+    return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    void *ptr = heap_alloc(size, __builtin_return_address(0));
+    if (!ptr) {
+#if defined(__cpp_exceptions)
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+    return ptr;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return heap_alloc(size, __builtin_return_address(0));
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return heap_alloc(size, __builtin_return_address(0));
+}
+
+void operator delete(void *ptr) noexcept
+{
+    heap_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    heap_free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    heap_free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    heap_free(ptr);
+}
+
+#else // MEMORY_TESTS_HEAP && __GLIBC__
+
+void mcc_heap_stats_get(mcc_heap_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void mcc_heap_stats_print_sites(unsigned max_sites)
+{
+    (void) max_sites;
+}
+
+#endif // MEMORY_TESTS_HEAP && __GLIBC__
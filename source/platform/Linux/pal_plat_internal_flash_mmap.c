@@ -0,0 +1,386 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// Internal flash of PAL simulated over a memory mapped file.
+//
+// Replaces PAL_SIMULATOR_FLASH_OVER_FILE_SYSTEM, which turns every flash
+// access into file syscalls, when built with PAL_FLASH_OVER_MMAP. Reads are
+// memcpy from the mapping, programs and erases follow NOR flash: programming
+// only clears bits and erasing sets the sector to the erase value. The mapping
+// is written back to the file on erase and deinit, the points where the flash
+// users switch areas, or after every program with PAL_FLASH_MMAP_SYNC_WRITES.
+// TESTS/host/internal_flash_mmap_benchmark.cpp compares boot and credential
+// access with the file system simulator.
+//
+// The operations are also counted for the wear report of flash_wear.h. Only
+// SOTP uses the internal flash on Linux, so the report covers its traffic.
+// An operation of flash_wear_operation_begin() and flash_wear_operation_end()
+// which erased is a compaction, stalling its caller for the whole operation.
+
+#include "pal.h"
+#include "pal_plat_internal_flash.h"
+#include "flash_wear.h"
+
+#if defined(PAL_FLASH_OVER_MMAP) && !PAL_SIMULATOR_FLASH_OVER_FILE_SYSTEM
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Backing file, relative to the primary mount point.
+#ifndef PAL_FLASH_MMAP_FILE
+#define PAL_FLASH_MMAP_FILE "internal_flash.bin"
+#endif
+
+// Flash geometry, the size covers both internal flash sections.
+#ifndef PAL_FLASH_MMAP_SIZE
+#if defined(PAL_INTERNAL_FLASH_SECTION_2_ADDRESS) && defined(PAL_INTERNAL_FLASH_SECTION_2_SIZE)
+#define PAL_FLASH_MMAP_SIZE (PAL_INTERNAL_FLASH_SECTION_2_ADDRESS + PAL_INTERNAL_FLASH_SECTION_2_SIZE)
+#else
+#define PAL_FLASH_MMAP_SIZE 0x10000
+#endif
+#endif
+
+#ifndef PAL_FLASH_MMAP_SECTOR_SIZE
+#define PAL_FLASH_MMAP_SECTOR_SIZE 0x1000
+#endif
+
+#ifndef PAL_FLASH_MMAP_PAGE_SIZE
+#define PAL_FLASH_MMAP_PAGE_SIZE 8
+#endif
+
+#ifndef PAL_FLASH_MMAP_SYNC_WRITES
+#define PAL_FLASH_MMAP_SYNC_WRITES 0
+#endif
+
+// Program and erase cycles of a sector, for the lifetime projection.
+#ifndef PAL_FLASH_MMAP_ENDURANCE
+#define PAL_FLASH_MMAP_ENDURANCE 100000
+#endif
+
+#define PAL_FLASH_MMAP_ERASE_VALUE 0xFF
+#define PAL_FLASH_MMAP_SECTORS (PAL_FLASH_MMAP_SIZE / PAL_FLASH_MMAP_SECTOR_SIZE)
+
+static uint8_t *flash_map = NULL;
+
+/* Wear accounting */
+
+typedef struct {
+    uint32_t operations;
+    uint32_t programs;
+    uint64_t program_bytes;
+    uint32_t erases;
+    uint32_t erased_sectors;
+    uint32_t compactions;
+    uint64_t stall_us;
+    uint64_t max_stall_us;
+} wear_counters_t;
+
+// The logical operation in progress, see flash_wear_operation_begin().
+typedef struct {
+    uint32_t depth;
+    uint64_t start_us;
+    uint32_t erase_address;
+    uint64_t erased_bytes;
+} wear_operation_t;
+
+static const char *const subsystem_names[FLASH_WEAR_SUBSYSTEMS] = { "other", "fcc", "fota", "migration" };
+
+static wear_counters_t wear[FLASH_WEAR_SUBSYSTEMS];
+static uint32_t sector_erases[PAL_FLASH_MMAP_SECTORS];
+static flash_wear_subsystem_e active_subsystem = FLASH_WEAR_OTHER;
+static wear_operation_t operation;
+static uint64_t wear_start_us = 0;
+static FILE *wear_trace = NULL;
+
+static uint64_t wear_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void wear_trace_op(const char *op, uint32_t address, uint64_t size, uint64_t stall_us)
+{
+    if (wear_trace) {
+        fprintf(wear_trace, "%" PRIu64 ",%s,%s,%" PRIu32 ",%" PRIu64 ",%" PRIu64 "\n",
+                wear_time_us() - wear_start_us, subsystem_names[active_subsystem],
+                op, address, size, stall_us);
+    }
+}
+
+flash_wear_subsystem_e flash_wear_enter(flash_wear_subsystem_e subsystem)
+{
+    flash_wear_subsystem_e previous = active_subsystem;
+
+    if (subsystem < FLASH_WEAR_SUBSYSTEMS) {
+        active_subsystem = subsystem;
+        wear[subsystem].operations++;
+    }
+    return previous;
+}
+
+void flash_wear_leave(flash_wear_subsystem_e previous)
+{
+    active_subsystem = previous;
+}
+
+void flash_wear_operation_begin(void)
+{
+    if (operation.depth++ == 0) {
+        operation.start_us = wear_time_us();
+        operation.erased_bytes = 0;
+    }
+}
+
+void flash_wear_operation_end(void)
+{
+    if (operation.depth == 0 || --operation.depth > 0 || operation.erased_bytes == 0) {
+        return;
+    }
+
+    // The caller waited for the whole operation, not only for the erase.
+    const uint64_t stall_us = wear_time_us() - operation.start_us;
+    wear_counters_t *w = &wear[active_subsystem];
+    w->compactions++;
+    w->stall_us += stall_us;
+    if (stall_us > w->max_stall_us) {
+        w->max_stall_us = stall_us;
+    }
+    wear_trace_op("compaction", operation.erase_address, operation.erased_bytes, stall_us);
+}
+
+void flash_wear_report(void)
+{
+    uint32_t max_erases = 0;
+    uint64_t total_erases = 0;
+
+    printf("Internal flash (SOTP) wear, %u sectors of %u bytes:\n", (unsigned)PAL_FLASH_MMAP_SECTORS, (unsigned)PAL_FLASH_MMAP_SECTOR_SIZE);
+    printf("KCM items and FOTA candidates are files, their writes are not counted.\n");
+    printf("%-10s %6s %8s %10s %8s %8s %6s %10s %10s\n",
+           "subsystem", "ops", "programs", "bytes", "erases", "sectors", "compct", "stall ms", "max ms");
+    for (int i = 0; i < FLASH_WEAR_SUBSYSTEMS; i++) {
+        const wear_counters_t *w = &wear[i];
+        printf("%-10s %6" PRIu32 " %8" PRIu32 " %10" PRIu64 " %8" PRIu32 " %8" PRIu32 " %6" PRIu32 " %10.1f %10.1f\n",
+               subsystem_names[i], w->operations, w->programs, w->program_bytes, w->erases,
+               w->erased_sectors, w->compactions, w->stall_us / 1000.0, w->max_stall_us / 1000.0);
+    }
+    printf("Erases outside a flash_wear_operation_begin() scope are not compactions.\n");
+
+    for (int i = 0; i < PAL_FLASH_MMAP_SECTORS; i++) {
+        total_erases += sector_erases[i];
+        if (sector_erases[i] > max_erases) {
+            max_erases = sector_erases[i];
+        }
+    }
+
+    // The most erased sector wears out first, at the rate seen so far.
+    const double elapsed_s = (wear_time_us() - wear_start_us) / 1000000.0;
+    printf("Sector erases: %" PRIu64 " total, %" PRIu32 " max over %.0f s\n", total_erases, max_erases, elapsed_s);
+    if (max_erases && elapsed_s > 0) {
+        printf("Projected lifetime at this rate: %.1f years for %u cycles\n",
+               PAL_FLASH_MMAP_ENDURANCE / (max_erases / elapsed_s) / (365.0 * 24 * 3600),
+               (unsigned)PAL_FLASH_MMAP_ENDURANCE);
+    }
+}
+
+static bool in_range(uint32_t address, size_t size)
+{
+    return (address <= PAL_FLASH_MMAP_SIZE) && (size <= PAL_FLASH_MMAP_SIZE - address);
+}
+
+// Write the pages of the range back to the file.
+static palStatus_t sync_range(uint32_t address, size_t size)
+{
+    const uintptr_t page_mask = (uintptr_t)sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t start = (uintptr_t)(flash_map + address) & ~page_mask;
+    uintptr_t end = (uintptr_t)(flash_map + address + size);
+
+    if (msync((void *)start, end - start, MS_SYNC) != 0) {
+        printf("pal_plat_internalFlash: msync failed, errno %d\n", errno);
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_plat_internalFlashInit(void)
+{
+    char path[PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    struct stat st;
+
+    if (flash_map) {
+        return PAL_SUCCESS;
+    }
+
+    if (wear_start_us == 0) {
+        const char *trace_file = getenv("PAL_FLASH_WEAR_TRACE");
+        wear_start_us = wear_time_us();
+        if (trace_file) {
+            wear_trace = fopen(trace_file, "w");
+            if (wear_trace) {
+                fprintf(wear_trace, "time_us,subsystem,op,address,size,stall_us\n");
+            }
+        }
+        atexit(flash_wear_report);
+    }
+
+    if (pal_fsGetMountPoint(PAL_FS_PARTITION_PRIMARY, sizeof(path), path) != PAL_SUCCESS ||
+            strlen(path) + sizeof("/" PAL_FLASH_MMAP_FILE) > sizeof(path)) {
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    strcat(path, "/" PAL_FLASH_MMAP_FILE);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("pal_plat_internalFlashInit: cannot open %s, errno %d\n", path, errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+
+    const off_t old_size = st.st_size;
+    if (old_size < PAL_FLASH_MMAP_SIZE && ftruncate(fd, PAL_FLASH_MMAP_SIZE) != 0) {
+        close(fd);
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+
+    flash_map = (uint8_t *)mmap(NULL, PAL_FLASH_MMAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps the file open.
+    close(fd);
+    if (flash_map == MAP_FAILED) {
+        flash_map = NULL;
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+
+    // Flash which was never written reads as erased.
+    if (old_size < PAL_FLASH_MMAP_SIZE) {
+        memset(flash_map + old_size, PAL_FLASH_MMAP_ERASE_VALUE, PAL_FLASH_MMAP_SIZE - old_size);
+        return sync_range(old_size, PAL_FLASH_MMAP_SIZE - old_size);
+    }
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_plat_internalFlashDeInit(void)
+{
+    palStatus_t status = PAL_SUCCESS;
+
+    if (flash_map) {
+        status = sync_range(0, PAL_FLASH_MMAP_SIZE);
+        munmap(flash_map, PAL_FLASH_MMAP_SIZE);
+        flash_map = NULL;
+        if (wear_trace) {
+            fflush(wear_trace);
+        }
+    }
+    return status;
+}
+
+palStatus_t pal_plat_internalFlashRead(const size_t size, const uint32_t address, uint32_t *buffer)
+{
+    if (!flash_map) {
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    if (!in_range(address, size)) {
+        return PAL_ERR_INTERNAL_FLASH_WRONG_SIZE;
+    }
+    memcpy(buffer, flash_map + address, size);
+    return PAL_SUCCESS;
+}
+
+palStatus_t pal_plat_internalFlashWrite(const size_t size, const uint32_t address, const uint32_t *buffer)
+{
+    const uint8_t *data = (const uint8_t *)buffer;
+
+    if (!flash_map) {
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    if (!in_range(address, size) || (address % PAL_FLASH_MMAP_PAGE_SIZE) || (size % PAL_FLASH_MMAP_PAGE_SIZE)) {
+        return PAL_ERR_INTERNAL_FLASH_WRONG_SIZE;
+    }
+
+    // Check the whole range first, so a failed program leaves the flash untouched.
+    for (size_t i = 0; i < size; i++) {
+        if ((flash_map[address + i] & data[i]) != data[i]) {
+            printf("pal_plat_internalFlashWrite: setting programmed bits at 0x%" PRIx32 "\n", (uint32_t)(address + i));
+            return PAL_ERR_INTERNAL_FLASH_WRITE_ERROR;
+        }
+    }
+    for (size_t i = 0; i < size; i++) {
+        flash_map[address + i] &= data[i];
+    }
+    wear[active_subsystem].programs++;
+    wear[active_subsystem].program_bytes += size;
+    wear_trace_op("program", address, size, 0);
+
+#if PAL_FLASH_MMAP_SYNC_WRITES
+    return sync_range(address, size);
+#else
+    return PAL_SUCCESS;
+#endif
+}
+
+palStatus_t pal_plat_internalFlashErase(uint32_t address, size_t size)
+{
+    if (!flash_map) {
+        return PAL_ERR_GENERIC_FAILURE;
+    }
+    if (!in_range(address, size) || (address % PAL_FLASH_MMAP_SECTOR_SIZE) || (size % PAL_FLASH_MMAP_SECTOR_SIZE)) {
+        return PAL_ERR_INTERNAL_FLASH_WRONG_SIZE;
+    }
+    memset(flash_map + address, PAL_FLASH_MMAP_ERASE_VALUE, size);
+
+    // An erase switches areas, so everything programmed so far is committed with it.
+    palStatus_t status = sync_range(0, PAL_FLASH_MMAP_SIZE);
+
+    wear_counters_t *w = &wear[active_subsystem];
+    for (uint32_t sector = address / PAL_FLASH_MMAP_SECTOR_SIZE; sector < (address + size) / PAL_FLASH_MMAP_SECTOR_SIZE; sector++) {
+        sector_erases[sector]++;
+    }
+    w->erases++;
+    w->erased_sectors += size / PAL_FLASH_MMAP_SECTOR_SIZE;
+    wear_trace_op("erase", address, size, 0);
+
+    if (operation.depth > 0) {
+        if (operation.erased_bytes == 0) {
+            operation.erase_address = address;
+        }
+        operation.erased_bytes += size;
+    }
+
+    return status;
+}
+
+size_t pal_plat_internalFlashGetPageSize(void)
+{
+    return PAL_FLASH_MMAP_PAGE_SIZE;
+}
+
+size_t pal_plat_internalFlashGetSectorSize(uint32_t address)
+{
+    return PAL_FLASH_MMAP_SECTOR_SIZE;
+}
+
+#endif // PAL_FLASH_OVER_MMAP && !PAL_SIMULATOR_FLASH_OVER_FILE_SYSTEM
@@ -0,0 +1,326 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+// PAL timers over a timerfd, built with PAL_TIMER_OVER_TIMERFD.
+//
+// The PAL Linux port always builds its own timers, which are POSIX timers
+// delivering PAL_TIMER_SIGNAL, and has no switch to leave them out. The
+// option links the application with --wrap for the pal_plat_osTimer*
+// functions (see CMakeLists.txt), so the calls of the generic PAL timer API
+// land here and the signal timers are never created. Their code stays in
+// the binary, and mcc_platform_init() still masks the signal.
+//
+// The armed timers are kept in a binary heap ordered by deadline, and a
+// single timerfd is armed for the earliest one, so any number of timers
+// costs one file descriptor. A dispatcher thread blocks on the timerfd and
+// runs the expired callbacks without holding the lock, so the callbacks may
+// start, stop and delete timers. Expirations missed while the process was
+// not scheduled are skipped, as the overruns of a POSIX timer are.
+//
+// TESTS/host/pal_timer_benchmark.cpp compares the lateness and CPU time with
+// signal timers.
+
+#include "pal.h"
+#include "pal_plat_rtos.h"
+
+#if defined(PAL_TIMER_OVER_TIMERFD)
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+typedef struct pal_timerfd_timer {
+    palTimerFuncPtr function;
+    void *argument;
+    palTimerType_t type;
+    uint64_t period_ns;
+    uint64_t deadline_ns;
+    // Position in the heap, -1 when the timer is not armed.
+    int heap_index;
+    bool deleted;
+} pal_timerfd_timer_t;
+
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_idle = PTHREAD_COND_INITIALIZER;
+static pthread_t timer_thread;
+static int timer_fd = -1;
+static palStatus_t timer_init_status = PAL_ERR_GENERIC_FAILURE;
+
+static pal_timerfd_timer_t **heap;
+static int heap_size;
+static int heap_capacity;
+
+// Timer whose callback is running in the dispatcher thread.
+static pal_timerfd_timer_t *running;
+// Armed deadline of timer_fd, 0 when disarmed.
+static uint64_t armed_ns;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void heap_swap(int a, int b)
+{
+    pal_timerfd_timer_t *timer = heap[a];
+    heap[a] = heap[b];
+    heap[b] = timer;
+    heap[a]->heap_index = a;
+    heap[b]->heap_index = b;
+}
+
+static void heap_up(int index)
+{
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (heap[parent]->deadline_ns <= heap[index]->deadline_ns) {
+            break;
+        }
+        heap_swap(parent, index);
+        index = parent;
+    }
+}
+
+static void heap_down(int index)
+{
+    for (;;) {
+        int smallest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+        if (left < heap_size && heap[left]->deadline_ns < heap[smallest]->deadline_ns) {
+            smallest = left;
+        }
+        if (right < heap_size && heap[right]->deadline_ns < heap[smallest]->deadline_ns) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        heap_swap(smallest, index);
+        index = smallest;
+    }
+}
+
+static bool heap_push(pal_timerfd_timer_t *timer)
+{
+    if (heap_size == heap_capacity) {
+        int capacity = heap_capacity ? heap_capacity * 2 : 16;
+        pal_timerfd_timer_t **grown = (pal_timerfd_timer_t **)realloc(heap, capacity * sizeof(*heap));
+        if (!grown) {
+            return false;
+        }
+        heap = grown;
+        heap_capacity = capacity;
+    }
+    timer->heap_index = heap_size;
+    heap[heap_size++] = timer;
+    heap_up(timer->heap_index);
+    return true;
+}
+
+static void heap_remove(pal_timerfd_timer_t *timer)
+{
+    int index = timer->heap_index;
+    timer->heap_index = -1;
+    heap_size--;
+    if (index == heap_size) {
+        return;
+    }
+    heap[index] = heap[heap_size];
+    heap[index]->heap_index = index;
+    heap_up(index);
+    heap_down(heap[index]->heap_index);
+}
+
+// Arm timer_fd for the earliest deadline, called with timer_mutex held.
+static void rearm(void)
+{
+    uint64_t deadline = heap_size ? heap[0]->deadline_ns : 0;
+    if (deadline == armed_ns) {
+        return;
+    }
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = (time_t)(deadline / 1000000000ULL);
+    spec.it_value.tv_nsec = (long)(deadline % 1000000000ULL);
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == 0) {
+        armed_ns = deadline;
+    }
+}
+
+static void *timer_dispatcher(void *arg)
+{
+    (void)arg;
+    uint64_t expirations;
+
+    for (;;) {
+        // Blocks until the armed deadline. The count is not needed as the heap holds the deadlines.
+        if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            continue;
+        }
+
+        pthread_mutex_lock(&timer_mutex);
+        armed_ns = 0;
+        uint64_t now = now_ns();
+        while (heap_size && heap[0]->deadline_ns <= now) {
+            pal_timerfd_timer_t *timer = heap[0];
+            heap_remove(timer);
+            if (timer->type == palOsTimerPeriodic) {
+                // Keep the period without drift, but skip the expirations that were missed.
+                timer->deadline_ns += timer->period_ns;
+                if (timer->deadline_ns <= now) {
+                    timer->deadline_ns = now + timer->period_ns;
+                }
+                (void)heap_push(timer);
+            }
+            running = timer;
+            pthread_mutex_unlock(&timer_mutex);
+
+            timer->function(timer->argument);
+
+            pthread_mutex_lock(&timer_mutex);
+            running = NULL;
+            if (timer->deleted) {
+                free(timer);
+            }
+            pthread_cond_broadcast(&timer_idle);
+            now = now_ns();
+        }
+        rearm();
+        pthread_mutex_unlock(&timer_mutex);
+    }
+    return NULL;
+}
+
+static void timer_init(void)
+{
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        printf("pal timerfd: cannot create the timer, errno %d\n", errno);
+        return;
+    }
+    if (pthread_create(&timer_thread, NULL, timer_dispatcher, NULL) != 0) {
+        printf("pal timerfd: cannot start the dispatcher, errno %d\n", errno);
+        return;
+    }
+    pthread_detach(timer_thread);
+    timer_init_status = PAL_SUCCESS;
+}
+
+palStatus_t __wrap_pal_plat_osTimerCreate(palTimerFuncPtr function, void *funcArgument, palTimerType_t timerType, palTimerID_t *timerID)
+{
+    if (!function || !timerID || (timerType != palOsTimerOnce && timerType != palOsTimerPeriodic)) {
+        return PAL_ERR_INVALID_ARGUMENT;
+    }
+    pthread_once(&timer_once, timer_init);
+    if (timer_init_status != PAL_SUCCESS) {
+        return timer_init_status;
+    }
+
+    pal_timerfd_timer_t *timer = (pal_timerfd_timer_t *)calloc(1, sizeof(*timer));
+    if (!timer) {
+        return PAL_ERR_NO_MEMORY;
+    }
+    timer->function = function;
+    timer->argument = funcArgument;
+    timer->type = timerType;
+    timer->heap_index = -1;
+
+    *timerID = (palTimerID_t)timer;
+    return PAL_SUCCESS;
+}
+
+palStatus_t __wrap_pal_plat_osTimerStart(palTimerID_t timerID, uint32_t millisec)
+{
+    pal_timerfd_timer_t *timer = (pal_timerfd_timer_t *)timerID;
+    if (!timer || (millisec == 0 && timer->type == palOsTimerPeriodic)) {
+        return PAL_ERR_INVALID_ARGUMENT;
+    }
+
+    palStatus_t status = PAL_SUCCESS;
+    pthread_mutex_lock(&timer_mutex);
+    if (timer->heap_index >= 0) {
+        heap_remove(timer);
+    }
+    timer->period_ns = (uint64_t)millisec * 1000000ULL;
+    timer->deadline_ns = now_ns() + timer->period_ns;
+    if (heap_push(timer)) {
+        rearm();
+    } else {
+        status = PAL_ERR_NO_MEMORY;
+    }
+    pthread_mutex_unlock(&timer_mutex);
+    return status;
+}
+
+palStatus_t __wrap_pal_plat_osTimerStop(palTimerID_t timerID)
+{
+    pal_timerfd_timer_t *timer = (pal_timerfd_timer_t *)timerID;
+    if (!timer) {
+        return PAL_ERR_INVALID_ARGUMENT;
+    }
+
+    pthread_mutex_lock(&timer_mutex);
+    if (timer->heap_index >= 0) {
+        heap_remove(timer);
+        rearm();
+    }
+    pthread_mutex_unlock(&timer_mutex);
+    return PAL_SUCCESS;
+}
+
+palStatus_t __wrap_pal_plat_osTimerDelete(palTimerID_t *timerID)
+{
+    if (!timerID || !*timerID) {
+        return PAL_ERR_INVALID_ARGUMENT;
+    }
+    pal_timerfd_timer_t *timer = (pal_timerfd_timer_t *)*timerID;
+
+    pthread_mutex_lock(&timer_mutex);
+    if (timer->heap_index >= 0) {
+        heap_remove(timer);
+        rearm();
+    }
+    if (running == timer) {
+        if (pthread_equal(pthread_self(), timer_thread)) {
+            // Deleted from its own callback, the dispatcher frees it on return.
+            timer->deleted = true;
+            timer = NULL;
+        } else {
+            while (running == timer) {
+                pthread_cond_wait(&timer_idle, &timer_mutex);
+            }
+        }
+    }
+    pthread_mutex_unlock(&timer_mutex);
+
+    free(timer);
+    *timerID = 0;
+    return PAL_SUCCESS;
+}
+
+#endif // PAL_TIMER_OVER_TIMERFD
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "event_groups.h"
 #include "pal_plat_rtos.h"
 #include "mcc_common_setup.h"
 #include "MbedCloudClientConfig.h"
@@ -38,6 +39,41 @@ void mcc_platform_do_wait(int timeout_ms)
     vTaskDelay(pdMS_TO_TICKS(timeout_ms));
 }
 
+static EventGroupHandle_t event_group;
+
+// Created on first use, as the ports call mcc_platform_init() at different points.
+static EventGroupHandle_t get_event_group(void)
+{
+    if (event_group == NULL) {
+        vTaskSuspendAll();
+        if (event_group == NULL) {
+            event_group = xEventGroupCreate();
+        }
+        (void)xTaskResumeAll();
+    }
+    return event_group;
+}
+
+void mcc_platform_signal_event(uint32_t events)
+{
+    EventGroupHandle_t group = get_event_group();
+    if (group) {
+        (void)xEventGroupSetBits(group, (EventBits_t)events);
+    }
+}
+
+uint32_t mcc_platform_wait_event(uint32_t events, int timeout_ms)
+{
+    EventGroupHandle_t group = get_event_group();
+    if (group == NULL) {
+        mcc_platform_do_wait(timeout_ms == MCC_PLATFORM_WAIT_FOREVER ? 100 : timeout_ms);
+        return 0;
+    }
+    TickType_t ticks = (timeout_ms == MCC_PLATFORM_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t set = xEventGroupWaitBits(group, (EventBits_t)events, pdTRUE, pdFALSE, ticks);
+    return (uint32_t)set & events;
+}
+
 void mcc_platform_sw_build_info(void)
 {
     printf("Application ready. Build at: " __DATE__ " " __TIME__ "\r\n");
@@ -148,6 +148,42 @@ void mcc_platform_do_wait(int timeout_ms)
     k_msleep(timeout_ms);
 }
 
+K_MUTEX_DEFINE(event_mutex);
+K_CONDVAR_DEFINE(event_condvar);
+static uint32_t event_flags;
+
+void mcc_platform_signal_event(uint32_t events)
+{
+    k_mutex_lock(&event_mutex, K_FOREVER);
+    event_flags |= events;
+    k_condvar_broadcast(&event_condvar);
+    k_mutex_unlock(&event_mutex);
+}
+
+uint32_t mcc_platform_wait_event(uint32_t events, int timeout_ms)
+{
+    const int64_t deadline = k_uptime_get() + timeout_ms;
+    uint32_t set;
+
+    k_mutex_lock(&event_mutex, K_FOREVER);
+    while ((event_flags & events) == 0) {
+        if (timeout_ms == MCC_PLATFORM_WAIT_FOREVER) {
+            k_condvar_wait(&event_condvar, &event_mutex, K_FOREVER);
+        } else {
+            int64_t remaining = deadline - k_uptime_get();
+            if (remaining <= 0 ||
+                    k_condvar_wait(&event_condvar, &event_mutex, K_MSEC(remaining)) != 0) {
+                break;
+            }
+        }
+    }
+    set = event_flags & events;
+    event_flags &= ~set;
+    k_mutex_unlock(&event_mutex);
+
+    return set;
+}
+
 void mcc_platform_sw_build_info(void)
 {
     DEBUG_PRINT("mcc_platform_sw_build_info\r\n");
@@ -0,0 +1,108 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef FLASH_WEAR_H
+#define FLASH_WEAR_H
+
+// Wear accounting of the simulated internal flash.
+//
+// With PAL_FLASH_OVER_MMAP on Linux, every program and erase of the internal
+// flash is counted against the subsystem which is active at the time: bytes
+// and operations programmed, erase calls and erases per sector. On Linux
+// only SOTP lives in the internal flash. KCM items and FOTA candidates are
+// files, so the counters of a subsystem cover its SOTP traffic alone, such
+// as the saved time and the root of trust.
+//
+// A compaction is a logical operation of a flash user, delimited by
+// flash_wear_operation_begin() and flash_wear_operation_end() around one
+// SOTP call, which erased the flash. Its stall is the wall-clock duration
+// of the whole operation, the time the caller waited for it. PAL also
+// writes SOTP itself, such as the saved time, outside of any operation:
+// those erases are counted, but not as compactions.
+//
+// The report is printed at exit. Setting the environment variable
+// PAL_FLASH_WEAR_TRACE to a file name also records every operation and
+// compaction, which utils/flash_wear_replay.py replays to project the
+// flash lifetime and the compaction stalls.
+//
+// Elsewhere the functions do nothing.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    FLASH_WEAR_OTHER,
+    FLASH_WEAR_FCC,         // FCC and KCM, credentials and configuration
+    FLASH_WEAR_FOTA,
+    FLASH_WEAR_MIGRATION,   // KVStore migration
+    FLASH_WEAR_SUBSYSTEMS
+} flash_wear_subsystem_e;
+
+#if defined(__linux__) && defined(PAL_FLASH_OVER_MMAP)
+
+// Count the flash operations from now on against subsystem, as one logical operation.
+// @returns
+//   the subsystem to restore with flash_wear_leave()
+flash_wear_subsystem_e flash_wear_enter(flash_wear_subsystem_e subsystem);
+
+// Return to the subsystem active before flash_wear_enter().
+void flash_wear_leave(flash_wear_subsystem_e previous);
+
+// Start a logical operation, such as one SOTP call. Nested operations are
+// part of the outermost one.
+void flash_wear_operation_begin(void);
+
+// End the operation, counting it as a compaction if it erased the flash.
+void flash_wear_operation_end(void);
+
+// Print the counters of each subsystem and the projected flash lifetime.
+void flash_wear_report(void);
+
+#else
+
+static inline flash_wear_subsystem_e flash_wear_enter(flash_wear_subsystem_e subsystem)
+{
+    (void)subsystem;
+    return FLASH_WEAR_OTHER;
+}
+
+static inline void flash_wear_leave(flash_wear_subsystem_e previous)
+{
+    (void)previous;
+}
+
+static inline void flash_wear_operation_begin(void)
+{
+}
+
+static inline void flash_wear_operation_end(void)
+{
+}
+
+static inline void flash_wear_report(void)
+{
+}
+
+#endif // __linux__ && PAL_FLASH_OVER_MMAP
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLASH_WEAR_H
@@ -38,6 +38,14 @@ void mcc_platform_led_off(void);
 // Check if button has been pressed (if available)
 uint8_t mcc_platform_button_clicked(void);
 
+// Called on each button press, from interrupt or input thread context.
+typedef void (*mcc_platform_button_cb)(void);
+
+// Set a callback for button presses. Returns 1 if presses are delivered
+// through the callback, 0 if the platform only supports polling with
+// mcc_platform_button_clicked().
+uint8_t mcc_platform_set_button_callback(mcc_platform_button_cb cb);
+
 uint8_t mcc_platform_init_button_and_led(void);
 
 #ifdef __cplusplus
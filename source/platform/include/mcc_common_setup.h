@@ -69,6 +69,22 @@ void *mcc_platform_get_network_interface(void);
 // Wait
 void mcc_platform_do_wait(int timeout_ms);
 
+// Events for mcc_platform_wait_event().
+#define MCC_PLATFORM_EVENT_REGISTERED   0x01
+#define MCC_PLATFORM_EVENT_UNREGISTERED 0x02
+
+// Wait forever in mcc_platform_wait_event().
+#define MCC_PLATFORM_WAIT_FOREVER       -1
+
+// Set event flags, waking up a thread blocked in mcc_platform_wait_event().
+// The flags stay set until they are waited for, so an event signaled before
+// the wait is not lost.
+void mcc_platform_signal_event(uint32_t events);
+
+// Block until any of the event flags in events is set, or until timeout_ms passes.
+// Clears and returns the flags that were set, 0 on timeout.
+uint32_t mcc_platform_wait_event(uint32_t events, int timeout_ms);
+
 // for printing sW build info
 void mcc_platform_sw_build_info(void);
 
@@ -0,0 +1,51 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef MCC_HEAP_STATS_H
+#define MCC_HEAP_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Heap statistics for platforms without mbed_stats_heap_get().
+// Fields follow mbed_stats_heap_t.
+typedef struct mcc_heap_stats {
+    uint32_t current_size;      // Bytes currently allocated
+    uint32_t max_size;          // Peak of current_size
+    uint32_t total_size;        // Bytes allocated since start
+    uint32_t alloc_cnt;         // Allocations currently alive
+    uint32_t alloc_fail_cnt;
+} mcc_heap_stats_t;
+
+// Get the heap statistics. All fields are zero if the
+// platform does not support heap accounting.
+void mcc_heap_stats_get(mcc_heap_stats_t *stats);
+
+// Print the call sites holding most of the currently allocated memory,
+// at most max_sites of them. Addresses can be resolved with addr2line.
+void mcc_heap_stats_print_sites(unsigned max_sites);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MCC_HEAP_STATS_H
@@ -21,9 +21,13 @@
 #include "mbedtls/x509.h"
 #include "mbedtls/x509_crt.h"
 #include "mbedtls/oid.h"
+#include "mbedtls/sha256.h"
 #include "mbed-trace/mbed_trace.h"
-#include "tng_root_cert.h"
 #include "key_config_manager.h"
+#ifdef MCC_ATCA_HOST_MOCK
+#include "atca_host_mock.h"
+#else
+#include "tng_root_cert.h"
 #include "atcacert.h"
 #include "atca_status.h"
 #include "tng_atca.h"
@@ -31,15 +35,18 @@
 #include "atcacert_client.h"
 #include "atca_basic.h"
 #include "atca_helpers.h"
+#include "atecc608a_se.h"
+#endif
 #include "storage_kcm.h"
 #include "fcc_defs.h"
-#include "atecc608a_se.h"
 #include "cust_def_1_signer.h"
 #include "cust_def_2_device.h"
+#ifndef MCC_ATCA_HOST_MOCK
 #include "tngtls_cert_def_1_signer.h"
 #include "tngtls_cert_def_2_device.h"
 #include "tnglora_cert_def_1_signer.h"
 #include "tnglora_cert_def_2_device.h"
+#endif
 #define TRACE_GROUP "atml"
 
 /*Global certificate structure pointers, should be set during mcc_atca_init 
@@ -53,7 +60,13 @@ The decompression steps are:
 - Read the signer certificate data from SE using direct atca APIs
 - Read the device certificate data from SE using direct atca APIs
 - Retrieve the CN attribute of the device certificate and save it as Endpoint name in the device storage by using KCM functionality.
-- Create device certificate chain and save it to the device storage by using KCM functionally.*/
+- Create device certificate chain and save it to the device storage by using KCM functionally.
+
+The chain is stored once, with a record of the SE serial number and a digest of the certificate
+definitions of the firmware. Later boots do not access the SE while the chain and a record with
+the same definitions are stored, so as before a replaced SE is not noticed then. Without the record,
+or with other definitions, the stored chain is compared with the device certificate of the SE once.
+The chain and the endpoint name are not deletable, a chain that does not match requires a storage reset.*/
 
 /*******************************************************************************
 * Definitions
@@ -63,6 +76,15 @@ The decompression steps are:
 #define MCC_ATCA_SIGNER_CHAIN_DEPTH     2
 /*Signer public key size*/
 #define SIGNER_PUBLIC_KEY_MAX_LEN       64
+/*Name of the record stored with the chain*/
+#define MCC_ATCA_CHAIN_RECORD_NAME      "mcc_atca_chain_record"
+#define MCC_ATCA_DIGEST_SIZE            32
+
+/*Record stored with the chain: the SE it was read from and the certificate definitions used*/
+typedef struct mcc_atca_chain_record {
+    uint8_t serial_number[ATCA_SERIAL_NUM_SIZE];
+    uint8_t definitions_digest[MCC_ATCA_DIGEST_SIZE];
+} mcc_atca_chain_record_t;
 
 /*******************************************************************************
 * Static functions
@@ -284,6 +306,135 @@ void mcc_atca_release(void)
     }
 }
 
+/*Add a certificate definition to the definitions digest*/
+static int mcc_atca_hash_cert_def(mbedtls_sha256_context *ctx, const atcacert_def_t *cert_def)
+{
+    const uint32_t template_size = (uint32_t)cert_def->cert_template_size;
+    int res = mbedtls_sha256_update_ret(ctx, (const unsigned char *)&template_size, sizeof(template_size));
+    if (res == 0 && template_size > 0) {
+        res = mbedtls_sha256_update_ret(ctx, cert_def->cert_template, template_size);
+    }
+    if (res == 0) {
+        res = mbedtls_sha256_update_ret(ctx, &cert_def->cert_elements_count, sizeof(cert_def->cert_elements_count));
+    }
+    return res;
+}
+
+/*Compute the digest of the certificate definitions built into the firmware, without accessing the SE.
+ The definitions of every SE type are included, the type of the attached SE is only known after reading it.*/
+static int mcc_atca_get_definitions_digest(uint8_t *digest_out)
+{
+    mbedtls_sha256_context ctx;
+    int res;
+
+    mbedtls_sha256_init(&ctx);
+    res = mbedtls_sha256_starts_ret(&ctx, 0);
+    // The CA public key of the custom credentials is only a placeholder without them.
+    if (res == 0 && g_cert_def_1_signer.cert_template != NULL) {
+        res = mbedtls_sha256_update_ret(&ctx, g_cert_ca_public_key_1_signer, SIGNER_PUBLIC_KEY_MAX_LEN);
+    }
+    if (res == 0) {
+        res = mcc_atca_hash_cert_def(&ctx, &g_cert_def_1_signer);
+    }
+    if (res == 0) {
+        res = mcc_atca_hash_cert_def(&ctx, &g_cert_def_2_device);
+    }
+    if (res == 0) {
+        res = mbedtls_sha256_update_ret(&ctx, &g_cryptoauth_root_ca_002_cert[CRYPTOAUTH_ROOT_CA_002_PUBLIC_KEY_OFFSET], SIGNER_PUBLIC_KEY_MAX_LEN);
+    }
+    if (res == 0) {
+        res = mcc_atca_hash_cert_def(&ctx, &g_tngtls_cert_def_1_signer);
+    }
+    if (res == 0) {
+        res = mcc_atca_hash_cert_def(&ctx, &g_tngtls_cert_def_2_device);
+    }
+    if (res == 0) {
+        res = mcc_atca_hash_cert_def(&ctx, &g_tnglora_cert_def_1_signer);
+    }
+    if (res == 0) {
+        res = mcc_atca_hash_cert_def(&ctx, &g_tnglora_cert_def_2_device);
+    }
+    if (res == 0) {
+        res = mbedtls_sha256_finish_ret(&ctx, digest_out);
+    }
+    mbedtls_sha256_free(&ctx);
+
+    if (res != 0) {
+        tr_error("mbedtls_sha256 error (%" PRId32 ")", (int32_t)res);
+        return -1;
+    }
+    return 0;
+}
+
+/*Read the record stored with the chain*/
+static bool mcc_atca_get_chain_record(mcc_atca_chain_record_t *record_out)
+{
+    size_t record_size = 0;
+
+    kcm_status_e kcm_status = kcm_item_get_data((const uint8_t *)MCC_ATCA_CHAIN_RECORD_NAME, strlen(MCC_ATCA_CHAIN_RECORD_NAME), KCM_CONFIG_ITEM,
+                                                (uint8_t *)record_out, sizeof(*record_out), &record_size);
+    return kcm_status == KCM_STATUS_SUCCESS && record_size == sizeof(*record_out);
+}
+
+/*Store the record of the chain, a missing record only costs reading the SE on the next boot*/
+static void mcc_atca_store_chain_record(const mcc_atca_chain_record_t *record)
+{
+    kcm_status_e kcm_status;
+
+    // Storing over an existing item fails, so delete it first.
+    (void)kcm_item_delete((const uint8_t *)MCC_ATCA_CHAIN_RECORD_NAME, strlen(MCC_ATCA_CHAIN_RECORD_NAME), KCM_CONFIG_ITEM);
+    kcm_status = storage_item_store((const uint8_t *)MCC_ATCA_CHAIN_RECORD_NAME, strlen(MCC_ATCA_CHAIN_RECORD_NAME),
+                                    KCM_CONFIG_ITEM, true, STORAGE_ITEM_PREFIX_KCM, (const uint8_t *)record, sizeof(*record), true);
+    if (kcm_status != KCM_STATUS_SUCCESS) {
+        tr_error("Failed to store the certificate chain record (%" PRIu32 ")", (uint32_t)kcm_status);
+    }
+}
+
+/*Check if a certificate chain is stored*/
+static bool mcc_atca_chain_exists(void)
+{
+    kcm_cert_chain_handle cert_chain_h = NULL;
+    size_t chain_len = 0;
+
+    kcm_status_e kcm_status = kcm_cert_chain_open(&cert_chain_h, (const uint8_t *)g_fcc_bootstrap_device_certificate_name,
+                                                  strlen(g_fcc_bootstrap_device_certificate_name), &chain_len);
+    if (kcm_status != KCM_STATUS_SUCCESS) {
+        return false;
+    }
+    (void)kcm_cert_chain_close(cert_chain_h);
+    return true;
+}
+
+/*Compare the stored chain with the device certificate of the SE*/
+static bool mcc_atca_stored_chain_matches(const uint8_t *device_cert, size_t device_cert_size)
+{
+    kcm_cert_chain_handle cert_chain_h = NULL;
+    size_t chain_len = 0, cert_size = 0, act_cert_size = 0;
+    uint8_t *cert = NULL;
+    bool match = false;
+
+    kcm_status_e kcm_status = kcm_cert_chain_open(&cert_chain_h, (const uint8_t *)g_fcc_bootstrap_device_certificate_name,
+                                                  strlen(g_fcc_bootstrap_device_certificate_name), &chain_len);
+    if (kcm_status != KCM_STATUS_SUCCESS) {
+        return false;
+    }
+
+    // The leaf is stored first, a chain interrupted before the signer is not complete.
+    if (chain_len == MCC_ATCA_SIGNER_CHAIN_DEPTH &&
+            kcm_cert_chain_get_next_size(cert_chain_h, &cert_size) == KCM_STATUS_SUCCESS &&
+            cert_size == device_cert_size) {
+        cert = malloc(cert_size);
+        match = cert != NULL &&
+                kcm_cert_chain_get_next_data(cert_chain_h, cert, cert_size, &act_cert_size) == KCM_STATUS_SUCCESS &&
+                act_cert_size == device_cert_size &&
+                memcmp(cert, device_cert, device_cert_size) == 0;
+        free(cert);
+    }
+
+    (void)kcm_cert_chain_close(cert_chain_h);
+    return match;
+}
+
 static int mcc_decompress_device_cert_chain(void)
 {
     kcm_status_e kcm_status = KCM_STATUS_SUCCESS, close_chain_status = KCM_STATUS_SUCCESS;
@@ -291,19 +442,24 @@ static int mcc_decompress_device_cert_chain(void)
     size_t device_cert_size = 0, signer_cert_size = 0;
     uint8_t *signer_certificate_buffer = NULL;
     uint8_t *device_certificate_buffer = NULL;
+    mcc_atca_chain_record_t record, stored_record;
+    bool chain_exists = false, have_record = false;
+    ATCA_STATUS atca_status;
     int res = 0;
 
-    // Create chain for device and signer certificate.
-    kcm_status = storage_cert_chain_create(&cert_chain_h, (uint8_t *)g_fcc_bootstrap_device_certificate_name, strlen(g_fcc_bootstrap_device_certificate_name), MCC_ATCA_SIGNER_CHAIN_DEPTH, true, STORAGE_ITEM_PREFIX_KCM);
-    if (kcm_status == KCM_STATUS_FILE_EXIST) {
-        // Already exist. Skip read and store.
-        return 0;
-    }
-    if (kcm_status != KCM_STATUS_SUCCESS) {
-        tr_error("kcm_cert_chain_create failed (%" PRIu32 ")", (uint32_t)kcm_status);
+    res = mcc_atca_get_definitions_digest(record.definitions_digest);
+    if (res != 0) {
         return -1;
     }
 
+    // The stored chain was read from the SE with the certificate definitions of this firmware. Skip the SE.
+    chain_exists = mcc_atca_chain_exists();
+    have_record = mcc_atca_get_chain_record(&stored_record);
+    if (chain_exists && have_record &&
+            memcmp(stored_record.definitions_digest, record.definitions_digest, sizeof(record.definitions_digest)) == 0) {
+        return 0;
+    }
+
     /*Initialize atca resources*/
     res = mcc_atca_init();
     if (res != 0) {
@@ -311,6 +467,13 @@ static int mcc_decompress_device_cert_chain(void)
         goto Exit;
     }
 
+    atca_status = atcab_read_serial_number(record.serial_number);
+    if (atca_status != ATCA_SUCCESS) {
+        tr_error("atcab_read_serial_number error (%" PRIu32 ")", (uint32_t)atca_status);
+        res = -1;
+        goto Exit;
+    }
+
     // query device cert size
     res = mcc_atca_get_max_cert_size(g_mcc_cert_def_2_device, &device_cert_size);
     if (res != 0) {
@@ -333,7 +496,7 @@ static int mcc_decompress_device_cert_chain(void)
         goto Exit;
     }
 
-    device_certificate_buffer = malloc(signer_cert_size);
+    device_certificate_buffer = malloc(device_cert_size);
     if (device_certificate_buffer == NULL) {
         tr_error("Failed to allocate device certificate buffer");
         res = -1;
@@ -354,11 +517,34 @@ static int mcc_decompress_device_cert_chain(void)
         goto Exit;
     }
 
+    if (chain_exists) {
+        // Stored without a record, or with other certificate definitions. The chain is not deletable, so it can only be checked.
+        if (!mcc_atca_stored_chain_matches(device_certificate_buffer, device_cert_size)) {
+            if (have_record && memcmp(stored_record.serial_number, record.serial_number, sizeof(record.serial_number)) != 0) {
+                tr_error("Secure element has been replaced, reset the storage");
+            } else {
+                tr_error("Stored certificate chain does not belong to this secure element, reset the storage");
+            }
+            res = -1;
+        } else {
+            mcc_atca_store_chain_record(&record);
+        }
+        goto Exit;
+    }
+
+    // Create chain for device and signer certificate.
+    kcm_status = storage_cert_chain_create(&cert_chain_h, (uint8_t *)g_fcc_bootstrap_device_certificate_name, strlen(g_fcc_bootstrap_device_certificate_name), MCC_ATCA_SIGNER_CHAIN_DEPTH, true, STORAGE_ITEM_PREFIX_KCM);
+    if (kcm_status != KCM_STATUS_SUCCESS) {
+        tr_error("kcm_cert_chain_create failed (%" PRIu32 ")", (uint32_t)kcm_status);
+        res = -1;
+        goto Exit;
+    }
+
     // read and store the CN of the device X509 certificate
     res = mcc_store_device_cert_cn(device_certificate_buffer, device_cert_size);
     if (res != 0) {
         tr_error("mcc_store_device_cert_cn failed");
-        goto Exit;
+        goto Close_chain;
     }
 
     // Store the device and signer certificate as KCM chain that is not allowed for deleting
@@ -367,7 +553,7 @@ static int mcc_decompress_device_cert_chain(void)
     if (kcm_status != KCM_STATUS_SUCCESS) {
         tr_error("Failed to add Atmel's device certificate (%" PRIu32 ")", (uint32_t)kcm_status);
         res = -1;
-        goto Exit;
+        goto Close_chain;
     }
 
     //add signer certificate
@@ -377,17 +563,21 @@ static int mcc_decompress_device_cert_chain(void)
         res = -1;
     }
 
-Exit:
-    mcc_atca_release();
-    free(device_certificate_buffer);
-    free(signer_certificate_buffer);
-
+Close_chain:
     close_chain_status = storage_cert_chain_close(cert_chain_h, STORAGE_ITEM_PREFIX_KCM);
     if (close_chain_status != KCM_STATUS_SUCCESS) {
         tr_error("Failed closing certificate chain error (%u)", close_chain_status);
         // modify return status only if function succeed but we failed for storage_cert_chain_close
         res = -1;
     }
+    if (res == 0) {
+        mcc_atca_store_chain_record(&record);
+    }
+
+Exit:
+    mcc_atca_release();
+    free(device_certificate_buffer);
+    free(signer_certificate_buffer);
     return res;
 }
 /*******************************************************************************
@@ -52,12 +52,18 @@ static DigitalOut led(MBED_CONF_APP_LED_PINNAME, LED_OFF);
 
 #if PLATFORM_ENABLE_BUTTON
 static InterruptIn button(MBED_CONF_APP_BUTTON_PINNAME);
-static bool button_pressed = false;
+static volatile bool button_pressed = false;
+static volatile mcc_platform_button_cb button_cb = NULL;
 static void button_press(void);
 
 static void button_press(void)
 {
-    button_pressed = true;
+    mcc_platform_button_cb cb = button_cb;
+    if (cb) {
+        cb();
+    } else {
+        button_pressed = true;
+    }
 }
 #endif
 
@@ -72,6 +78,17 @@ uint8_t mcc_platform_button_clicked(void)
     return false;
 }
 
+uint8_t mcc_platform_set_button_callback(mcc_platform_button_cb cb)
+{
+#if PLATFORM_ENABLE_BUTTON
+    button_cb = cb;
+#else
+    (void)cb;
+#endif
+    // The InterruptIn calls button_press(), also nothing to poll without a button.
+    return 1;
+}
+
 uint8_t mcc_platform_init_button_and_led(void)
 {
 #if PLATFORM_ENABLE_BUTTON
@@ -390,6 +390,29 @@ void mcc_platform_do_wait(int timeout_ms)
 #endif
 }
 
+static EventFlags event_flags;
+
+void mcc_platform_signal_event(uint32_t events)
+{
+    event_flags.set(events);
+}
+
+uint32_t mcc_platform_wait_event(uint32_t events, int timeout_ms)
+{
+    uint32_t set;
+    if (timeout_ms == MCC_PLATFORM_WAIT_FOREVER) {
+        set = event_flags.wait_any(events);
+    } else {
+#if MBED_MAJOR_VERSION > 5
+        set = event_flags.wait_any_for(events, std::chrono::milliseconds(timeout_ms));
+#else
+        set = event_flags.wait_any(events, timeout_ms);
+#endif
+    }
+    // Errors, including the timeout, have the top bit set.
+    return (set & osFlagsError) ? 0 : (set & events);
+}
+
 int mcc_platform_run_program(main_t mainFunc)
 {
     mainFunc();
@@ -0,0 +1,249 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+#ifdef MCC_ATCA_HOST_MOCK
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "atca_host_mock.h"
+
+/* I2C blocks of each access: the compressed certificate and the public key of the
+signer and device certificates take 3 and 2 blocks, commands without data one */
+#define MOCK_COMMAND_BLOCKS     1
+#define MOCK_READ_CERT_BLOCKS   5
+
+/* Certificates of the mock secure element: the signer is a self signed CA and the
+device certificate is issued by it, with the serial number in its CN */
+static const uint8_t mock_signer_cert[] = {
+    0x30, 0x82, 0x01, 0xbe, 0x30, 0x82, 0x01, 0x65, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x50,
+    0x61, 0x9e, 0x13, 0x2c, 0x92, 0x3a, 0xdb, 0x79, 0xc3, 0x89, 0x43, 0xf7, 0x00, 0x57, 0x14, 0x99,
+    0x88, 0x7c, 0x4e, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
+    0x34, 0x31, 0x14, 0x30, 0x12, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x0b, 0x45, 0x78, 0x61, 0x6d,
+    0x70, 0x6c, 0x65, 0x20, 0x49, 0x6e, 0x63, 0x31, 0x1c, 0x30, 0x1a, 0x06, 0x03, 0x55, 0x04, 0x03,
+    0x0c, 0x13, 0x45, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x20, 0x53, 0x69, 0x67, 0x6e, 0x65, 0x72,
+    0x20, 0x46, 0x46, 0x46, 0x46, 0x30, 0x20, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x37, 0x30,
+    0x37, 0x31, 0x37, 0x34, 0x35, 0x5a, 0x18, 0x0f, 0x32, 0x31, 0x32, 0x36, 0x30, 0x39, 0x32, 0x33,
+    0x30, 0x37, 0x31, 0x37, 0x34, 0x35, 0x5a, 0x30, 0x34, 0x31, 0x14, 0x30, 0x12, 0x06, 0x03, 0x55,
+    0x04, 0x0a, 0x0c, 0x0b, 0x45, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x20, 0x49, 0x6e, 0x63, 0x31,
+    0x1c, 0x30, 0x1a, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x13, 0x45, 0x78, 0x61, 0x6d, 0x70, 0x6c,
+    0x65, 0x20, 0x53, 0x69, 0x67, 0x6e, 0x65, 0x72, 0x20, 0x46, 0x46, 0x46, 0x46, 0x30, 0x59, 0x30,
+    0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce,
+    0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0xd5, 0x91, 0xaf, 0x9b, 0xfd, 0x52, 0x92, 0x3a,
+    0x4c, 0xe9, 0xe9, 0x4a, 0xfb, 0xea, 0x5e, 0xaf, 0xe9, 0xc9, 0x6b, 0xac, 0x9f, 0x7f, 0x9e, 0xa5,
+    0x69, 0x1e, 0x55, 0x93, 0x1b, 0x44, 0xc1, 0x1a, 0x33, 0x2c, 0x2c, 0x28, 0xdd, 0x84, 0x47, 0xa2,
+    0xf6, 0xe2, 0xa7, 0x95, 0x4a, 0x25, 0x07, 0xe4, 0xb4, 0xbc, 0xec, 0xf4, 0xae, 0xd2, 0x4f, 0x6c,
+    0xec, 0x7c, 0x31, 0xd9, 0xe5, 0x54, 0xe3, 0x9a, 0xa3, 0x53, 0x30, 0x51, 0x30, 0x1d, 0x06, 0x03,
+    0x55, 0x1d, 0x0e, 0x04, 0x16, 0x04, 0x14, 0x1a, 0x89, 0xed, 0x16, 0x9c, 0x3e, 0xb1, 0x78, 0x2f,
+    0xc6, 0xbe, 0x83, 0xb5, 0x5e, 0xfe, 0x74, 0xda, 0xe1, 0x9e, 0xa0, 0x30, 0x1f, 0x06, 0x03, 0x55,
+    0x1d, 0x23, 0x04, 0x18, 0x30, 0x16, 0x80, 0x14, 0x1a, 0x89, 0xed, 0x16, 0x9c, 0x3e, 0xb1, 0x78,
+    0x2f, 0xc6, 0xbe, 0x83, 0xb5, 0x5e, 0xfe, 0x74, 0xda, 0xe1, 0x9e, 0xa0, 0x30, 0x0f, 0x06, 0x03,
+    0x55, 0x1d, 0x13, 0x01, 0x01, 0xff, 0x04, 0x05, 0x30, 0x03, 0x01, 0x01, 0xff, 0x30, 0x0a, 0x06,
+    0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03, 0x47, 0x00, 0x30, 0x44, 0x02, 0x20,
+    0x43, 0x27, 0xaf, 0x4b, 0xe7, 0x76, 0xf7, 0xcc, 0x8a, 0xa4, 0x19, 0x57, 0xa1, 0x4b, 0x17, 0x7e,
+    0x09, 0x57, 0xe3, 0x4e, 0x67, 0xf0, 0xa3, 0xfd, 0xfb, 0xa7, 0xea, 0xc5, 0xa3, 0xec, 0x42, 0xee,
+    0x02, 0x20, 0x51, 0xd5, 0xd4, 0xaf, 0x1c, 0x67, 0x89, 0xff, 0x2b, 0x0e, 0x0e, 0x81, 0xc3, 0xd1,
+    0xd0, 0x0c, 0xf2, 0x6f, 0xf4, 0x15, 0xfa, 0x59, 0x85, 0xdb, 0x3c, 0x55, 0xab, 0x0c, 0xba, 0x96,
+    0x66, 0xf2,
+};
+
+static const uint8_t mock_device_cert[] = {
+    0x30, 0x82, 0x01, 0x67, 0x30, 0x82, 0x01, 0x0c, 0x02, 0x14, 0x77, 0x43, 0x74, 0xc8, 0x01, 0xab,
+    0x0c, 0x43, 0x8d, 0x06, 0xe7, 0xa4, 0xb0, 0x25, 0x6b, 0xfa, 0x93, 0xe8, 0xd6, 0xba, 0x30, 0x0a,
+    0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30, 0x34, 0x31, 0x14, 0x30, 0x12,
+    0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x0b, 0x45, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x20, 0x49,
+    0x6e, 0x63, 0x31, 0x1c, 0x30, 0x1a, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x13, 0x45, 0x78, 0x61,
+    0x6d, 0x70, 0x6c, 0x65, 0x20, 0x53, 0x69, 0x67, 0x6e, 0x65, 0x72, 0x20, 0x46, 0x46, 0x46, 0x46,
+    0x30, 0x20, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x37, 0x30, 0x37, 0x31, 0x37, 0x34, 0x35,
+    0x5a, 0x18, 0x0f, 0x32, 0x31, 0x32, 0x36, 0x30, 0x39, 0x32, 0x33, 0x30, 0x37, 0x31, 0x37, 0x34,
+    0x35, 0x5a, 0x30, 0x35, 0x31, 0x14, 0x30, 0x12, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x0b, 0x45,
+    0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x20, 0x49, 0x6e, 0x63, 0x31, 0x1d, 0x30, 0x1b, 0x06, 0x03,
+    0x55, 0x04, 0x03, 0x0c, 0x14, 0x73, 0x6e, 0x30, 0x31, 0x32, 0x33, 0x30, 0x33, 0x30, 0x34, 0x30,
+    0x35, 0x30, 0x36, 0x30, 0x37, 0x30, 0x38, 0x45, 0x45, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a,
+    0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07,
+    0x03, 0x42, 0x00, 0x04, 0x2a, 0x1c, 0xec, 0x76, 0xdd, 0x7b, 0xb5, 0xc0, 0x77, 0x34, 0xed, 0x24,
+    0xf9, 0x2d, 0x3b, 0x21, 0x86, 0xed, 0x87, 0xd7, 0x1e, 0x3a, 0xfa, 0xb0, 0x2e, 0x41, 0x07, 0x21,
+    0xa0, 0x95, 0x16, 0x0c, 0x7b, 0x2a, 0xed, 0x97, 0x84, 0xcf, 0x4e, 0x11, 0xe1, 0xb3, 0x5e, 0x26,
+    0xf1, 0xc8, 0x64, 0x03, 0xf2, 0x47, 0x26, 0x0b, 0x0e, 0x10, 0x47, 0x91, 0x30, 0xe6, 0x8f, 0x78,
+    0xe5, 0xcc, 0x7a, 0x32, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02,
+    0x03, 0x49, 0x00, 0x30, 0x46, 0x02, 0x21, 0x00, 0x93, 0x81, 0xda, 0x2d, 0xed, 0xb6, 0xa5, 0xc4,
+    0xd9, 0x86, 0x4c, 0xde, 0x6b, 0x9c, 0x06, 0x38, 0x14, 0x2b, 0xb2, 0x27, 0x74, 0xa0, 0x41, 0xf9,
+    0x6e, 0x6f, 0x10, 0xa3, 0xcf, 0xad, 0xd1, 0x39, 0x02, 0x21, 0x00, 0xc7, 0xbd, 0xd5, 0x5e, 0x3f,
+    0x82, 0x37, 0x84, 0x50, 0x97, 0xc0, 0xe6, 0x14, 0x25, 0x60, 0x45, 0xb5, 0x89, 0xbd, 0x09, 0x39,
+    0xf5, 0xcb, 0x38, 0x9a, 0xfa, 0x41, 0x78, 0x1f, 0x76, 0x92, 0x89,
+};
+
+static const uint8_t mock_signer_public_key[] = {
+    0xd5, 0x91, 0xaf, 0x9b, 0xfd, 0x52, 0x92, 0x3a, 0x4c, 0xe9, 0xe9, 0x4a, 0xfb, 0xea, 0x5e, 0xaf,
+    0xe9, 0xc9, 0x6b, 0xac, 0x9f, 0x7f, 0x9e, 0xa5, 0x69, 0x1e, 0x55, 0x93, 0x1b, 0x44, 0xc1, 0x1a,
+    0x33, 0x2c, 0x2c, 0x28, 0xdd, 0x84, 0x47, 0xa2, 0xf6, 0xe2, 0xa7, 0x95, 0x4a, 0x25, 0x07, 0xe4,
+    0xb4, 0xbc, 0xec, 0xf4, 0xae, 0xd2, 0x4f, 0x6c, 0xec, 0x7c, 0x31, 0xd9, 0xe5, 0x54, 0xe3, 0x9a,
+};
+
+static const uint8_t mock_default_serial[ATCA_SERIAL_NUM_SIZE] = {
+    0x01, 0x23, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0xEE
+};
+
+static const uint8_t mock_tngtls_signer_template[] = "tngtls signer template";
+static const uint8_t mock_tngtls_device_template[] = "tngtls device template";
+static const uint8_t mock_tnglora_signer_template[] = "tnglora signer template";
+static const uint8_t mock_tnglora_device_template[] = "tnglora device template";
+
+const atcacert_def_t g_tngtls_cert_def_1_signer = {
+    NULL, 0, mock_tngtls_signer_template, sizeof(mock_tngtls_signer_template)
+};
+const atcacert_def_t g_tngtls_cert_def_2_device = {
+    NULL, 0, mock_tngtls_device_template, sizeof(mock_tngtls_device_template)
+};
+const atcacert_def_t g_tnglora_cert_def_1_signer = {
+    NULL, 0, mock_tnglora_signer_template, sizeof(mock_tnglora_signer_template)
+};
+const atcacert_def_t g_tnglora_cert_def_2_device = {
+    NULL, 0, mock_tnglora_device_template, sizeof(mock_tnglora_device_template)
+};
+
+const uint8_t g_cryptoauth_root_ca_002_cert[ATCA_PUB_KEY_SIZE] = { 0 };
+
+static uint8_t mock_serial[ATCA_SERIAL_NUM_SIZE];
+static unsigned long mock_blocks;
+static unsigned long mock_block_us = 3000;
+
+static void mock_transfer(unsigned long blocks)
+{
+    unsigned long us = blocks * mock_block_us;
+    struct timespec delay = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+
+    mock_blocks += blocks;
+    nanosleep(&delay, NULL);
+}
+
+static void mock_load_config(void)
+{
+    const char *env = getenv("ATCA_HOST_MOCK_BLOCK_US");
+    if (env) {
+        mock_block_us = strtoul(env, NULL, 0);
+    }
+
+    memcpy(mock_serial, mock_default_serial, sizeof(mock_serial));
+    env = getenv("ATCA_HOST_MOCK_SERIAL");
+    if (env && strlen(env) == 2 * ATCA_SERIAL_NUM_SIZE) {
+        for (int i = 0; i < ATCA_SERIAL_NUM_SIZE; i++) {
+            unsigned int byte;
+            if (sscanf(env + 2 * i, "%2x", &byte) == 1) {
+                mock_serial[i] = (uint8_t)byte;
+            }
+        }
+    }
+}
+
+static bool mock_is_signer(const atcacert_def_t *cert_def)
+{
+    return cert_def == &g_tngtls_cert_def_1_signer || cert_def == &g_tnglora_cert_def_1_signer;
+}
+
+ATCA_STATUS atecc608a_init(void)
+{
+    // Read on each init, a test can replace the secure element between boots.
+    mock_load_config();
+    mock_transfer(MOCK_COMMAND_BLOCKS);
+    return ATCA_SUCCESS;
+}
+
+ATCA_STATUS atecc608a_deinit(void)
+{
+    return ATCA_SUCCESS;
+}
+
+ATCA_STATUS tng_get_type(tng_type_t *type)
+{
+    if (type == NULL) {
+        return ATCA_BAD_PARAM;
+    }
+    mock_transfer(MOCK_COMMAND_BLOCKS);
+    *type = TNGTYPE_22;
+    return ATCA_SUCCESS;
+}
+
+ATCA_STATUS atcab_read_serial_number(uint8_t *serial_number)
+{
+    if (serial_number == NULL) {
+        return ATCA_BAD_PARAM;
+    }
+    mock_transfer(MOCK_COMMAND_BLOCKS);
+    memcpy(serial_number, mock_serial, ATCA_SERIAL_NUM_SIZE);
+    return ATCA_SUCCESS;
+}
+
+int atcacert_max_cert_size(const atcacert_def_t *cert_def, size_t *max_cert_size)
+{
+    if (cert_def == NULL || max_cert_size == NULL) {
+        return ATCACERT_E_BAD_PARAMS;
+    }
+    *max_cert_size = mock_is_signer(cert_def) ? sizeof(mock_signer_cert) : sizeof(mock_device_cert);
+    return ATCACERT_E_SUCCESS;
+}
+
+int atcacert_read_cert(const atcacert_def_t *cert_def, const uint8_t ca_public_key[64], uint8_t *cert, size_t *cert_size)
+{
+    const bool signer = mock_is_signer(cert_def);
+    const uint8_t *data = signer ? mock_signer_cert : mock_device_cert;
+    const size_t size = signer ? sizeof(mock_signer_cert) : sizeof(mock_device_cert);
+
+    if (cert_def == NULL || cert == NULL || cert_size == NULL) {
+        return ATCACERT_E_BAD_PARAMS;
+    }
+    if (*cert_size < size) {
+        return ATCACERT_E_BUFFER_TOO_SMALL;
+    }
+    // The device certificate is rebuilt with the public key of its signer.
+    if (!signer && (ca_public_key == NULL ||
+                    memcmp(ca_public_key, mock_signer_public_key, ATCA_PUB_KEY_SIZE) != 0)) {
+        return ATCACERT_E_VERIFY_FAILED;
+    }
+
+    mock_transfer(MOCK_READ_CERT_BLOCKS);
+    memcpy(cert, data, size);
+    *cert_size = size;
+
+    // Another secure element has another device certificate, change its signature.
+    if (!signer && memcmp(mock_serial, mock_default_serial, sizeof(mock_serial)) != 0) {
+        cert[size - 1] ^= 0x01;
+    }
+    return ATCACERT_E_SUCCESS;
+}
+
+int atcacert_get_subj_public_key(const atcacert_def_t *cert_def, const uint8_t *cert, size_t cert_size, uint8_t subj_public_key[64])
+{
+    if (cert_def == NULL || cert == NULL || subj_public_key == NULL || cert_size != sizeof(mock_signer_cert)) {
+        return ATCACERT_E_BAD_PARAMS;
+    }
+    memcpy(subj_public_key, mock_signer_public_key, ATCA_PUB_KEY_SIZE);
+    return ATCACERT_E_SUCCESS;
+}
+
+unsigned long atca_host_mock_get_blocks(void)
+{
+    return mock_blocks;
+}
+
+void atca_host_mock_print_stats(void)
+{
+    printf("Secure element: %lu I2C blocks, %lu ms\n", mock_blocks, mock_blocks * mock_block_us / 1000);
+    mock_blocks = 0;
+}
+#endif // MCC_ATCA_HOST_MOCK
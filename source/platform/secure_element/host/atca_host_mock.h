@@ -0,0 +1,97 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+#ifndef ATCA_HOST_MOCK_H
+#define ATCA_HOST_MOCK_H
+
+/* Host mock of the ATECC608A certificate API used by mcc_atca_credentials_init.c.
+
+Lets the certificate chain decompression run on Linux without the secure element,
+for example to benchmark it. Build mcc_atca_credentials_init.c, the se_atmel_credentials
+definitions and atca_host_mock.c with MBED_CONF_APP_SECURE_ELEMENT_ATCA_SUPPORT and
+MCC_ATCA_HOST_MOCK defined, with this directory first in the include path, as
+TESTS/host/atca_credentials_test does.
+
+Every access to the secure element sleeps for the time of its I2C transfers:
+ATCA_HOST_MOCK_BLOCK_US microseconds (default 3000, a 32 byte block at 100 kHz) per block.
+ATCA_HOST_MOCK_SERIAL sets the serial number as 18 hex digits, a serial other than the
+default one returns a different device certificate, as a replaced secure element would.
+Both are read by every atecc608a_init().*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int ATCA_STATUS;
+#define ATCA_SUCCESS                0x00
+#define ATCA_GEN_FAIL               0xE1
+#define ATCA_BAD_PARAM              0xE2
+
+#define ATCACERT_E_SUCCESS          0
+#define ATCACERT_E_BAD_PARAMS       2
+#define ATCACERT_E_BUFFER_TOO_SMALL 3
+#define ATCACERT_E_VERIFY_FAILED    11
+
+#define ATCA_SERIAL_NUM_SIZE        9
+#define ATCA_PUB_KEY_SIZE           64
+
+/* The part of the cryptoauthlib certificate definition used by the application */
+typedef struct atcacert_def_s {
+    const void     *cert_elements;
+    uint8_t         cert_elements_count;
+    const uint8_t  *cert_template;
+    size_t          cert_template_size;
+} atcacert_def_t;
+
+typedef enum {
+    TNGTYPE_UNKNOWN,
+    TNGTYPE_22,
+    TNGTYPE_LORA
+} tng_type_t;
+
+extern const atcacert_def_t g_tngtls_cert_def_1_signer;
+extern const atcacert_def_t g_tngtls_cert_def_2_device;
+extern const atcacert_def_t g_tnglora_cert_def_1_signer;
+extern const atcacert_def_t g_tnglora_cert_def_2_device;
+
+#define CRYPTOAUTH_ROOT_CA_002_PUBLIC_KEY_OFFSET 0
+extern const uint8_t g_cryptoauth_root_ca_002_cert[];
+
+ATCA_STATUS atecc608a_init(void);
+ATCA_STATUS atecc608a_deinit(void);
+ATCA_STATUS tng_get_type(tng_type_t *type);
+ATCA_STATUS atcab_read_serial_number(uint8_t *serial_number);
+
+int atcacert_max_cert_size(const atcacert_def_t *cert_def, size_t *max_cert_size);
+int atcacert_read_cert(const atcacert_def_t *cert_def, const uint8_t ca_public_key[64], uint8_t *cert, size_t *cert_size);
+int atcacert_get_subj_public_key(const atcacert_def_t *cert_def, const uint8_t *cert, size_t cert_size, uint8_t subj_public_key[64]);
+
+/* I2C blocks transferred since the last atca_host_mock_print_stats() */
+unsigned long atca_host_mock_get_blocks(void);
+
+/* Print and reset the I2C blocks and the simulated time spent since the last call */
+void atca_host_mock_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATCA_HOST_MOCK_H */
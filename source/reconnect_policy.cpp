@@ -0,0 +1,118 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "reconnect_policy.h"
+#include "key_config_manager.h"
+#include "pal.h"
+
+// Format of the item in storage.
+typedef struct reconnect_history {
+    uint32_t failures;
+    uint32_t reboots;
+} reconnect_history_t;
+
+// Loaded on first use, storage is not available before the client is initialized.
+static void load_history(reconnect_policy_t *policy)
+{
+    reconnect_history_t history;
+    size_t size = 0;
+
+    policy->loaded = true;
+    if (kcm_item_get_data((const uint8_t *)policy->name, strlen(policy->name), KCM_CONFIG_ITEM,
+                          (uint8_t *)&history, sizeof(history), &size) == KCM_STATUS_SUCCESS &&
+            size == sizeof(history)) {
+        policy->failures = history.failures;
+        policy->reboots = history.reboots;
+        printf("Reconnect history %s: %" PRIu32 " failures, %" PRIu32 " reboots\n",
+               policy->name, policy->failures, policy->reboots);
+    }
+}
+
+static void store_history(const reconnect_policy_t *policy)
+{
+    const reconnect_history_t history = { policy->failures, policy->reboots };
+    kcm_status_e status;
+
+    // Storing over an existing item fails, so delete it first.
+    (void)kcm_item_delete((const uint8_t *)policy->name, strlen(policy->name), KCM_CONFIG_ITEM);
+    status = kcm_item_store((const uint8_t *)policy->name, strlen(policy->name), KCM_CONFIG_ITEM, false,
+                            (const uint8_t *)&history, sizeof(history), NULL);
+    if (status != KCM_STATUS_SUCCESS) {
+        printf("Failed to store reconnect history, status %d\n", status);
+    }
+}
+
+static uint32_t backoff_ceiling(const reconnect_policy_t *policy)
+{
+    uint32_t ceiling = policy->base_ms;
+    for (uint32_t i = 1; i < policy->failures && ceiling < policy->cap_ms; i++) {
+        ceiling *= 2;
+    }
+    return (ceiling < policy->cap_ms) ? ceiling : policy->cap_ms;
+}
+
+uint32_t reconnect_policy_failure(reconnect_policy_t *policy)
+{
+    uint32_t random = 0;
+
+    if (!policy->loaded) {
+        load_history(policy);
+    }
+
+    policy->session_failures++;
+
+    // Once the cap is reached, the count is not needed for the backoff anymore
+    // and is not written again.
+    if (backoff_ceiling(policy) < policy->cap_ms) {
+        policy->failures++;
+        store_history(policy);
+    }
+
+    const uint32_t ceiling = backoff_ceiling(policy);
+    if (pal_osRandomBuffer((uint8_t *)&random, sizeof(random)) != PAL_SUCCESS) {
+        return ceiling;
+    }
+    return (uint32_t)(((uint64_t)random * ((uint64_t)ceiling + 1)) >> 32);
+}
+
+void reconnect_policy_success(reconnect_policy_t *policy)
+{
+    if (!policy->loaded) {
+        load_history(policy);
+    }
+
+    policy->session_failures = 0;
+    if (policy->failures != 0) {
+        policy->failures = 0;
+        store_history(policy);
+    }
+}
+
+bool reconnect_policy_reboot_due(reconnect_policy_t *policy, uint32_t threshold)
+{
+    if (threshold == 0 || policy->session_failures < threshold) {
+        return false;
+    }
+    policy->reboots++;
+    store_history(policy);
+    return true;
+}
@@ -0,0 +1,68 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef RECONNECT_POLICY_H
+#define RECONNECT_POLICY_H
+
+#include <stdint.h>
+
+// Upper limit of the wait between two attempts.
+#ifndef RECONNECT_POLICY_CAP_MS
+#define RECONNECT_POLICY_CAP_MS (1280 * 1000)
+#endif
+
+/*
+ * Exponential backoff with full jitter: after the n:th consecutive failure the
+ * wait is drawn uniformly from [0, min(cap, base * 2^(n-1))], which spreads the
+ * retries of a fleet recovering from the same outage.
+ *
+ * The failure count and the number of reboots caused by failures are kept in
+ * storage, so the backoff continues where it was after a reboot instead of
+ * starting over from the base wait.
+ */
+typedef struct reconnect_policy {
+    const char *name;           // Storage item name
+    uint32_t base_ms;
+    uint32_t cap_ms;
+    uint32_t failures;          // Consecutive failures, persisted
+    uint32_t reboots;           // Reboots after reaching the threshold, persisted
+    uint32_t session_failures;  // Consecutive failures since boot
+    bool loaded;
+} reconnect_policy_t;
+
+#define RECONNECT_POLICY_INIT(name, base_ms) { name, base_ms, RECONNECT_POLICY_CAP_MS, 0, 0, 0, false }
+
+/**
+ * @brief Record a failed attempt.
+ * @return Time to wait in milliseconds before the next attempt.
+ */
+uint32_t reconnect_policy_failure(reconnect_policy_t *policy);
+
+/**
+ * @brief Record a successful attempt, the next failure waits at most the base time again.
+ */
+void reconnect_policy_success(reconnect_policy_t *policy);
+
+/**
+ * @brief Check whether the failures since boot have reached the threshold.
+ *        If so, the reboot is counted in the history.
+ * @return true if the device should be rebooted.
+ */
+bool reconnect_policy_reboot_due(reconnect_policy_t *policy, uint32_t threshold);
+
+#endif // RECONNECT_POLICY_H
@@ -0,0 +1,134 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include <stdio.h>
+
+#include "startup_profiler.h"
+#include "pal.h"
+
+typedef struct startup_span {
+    const char *name;
+    uint64_t start_us;
+    uint64_t end_us;
+    bool started;
+    bool ended;
+} startup_span_t;
+
+// Names are the keys of the formatted output, keep in startup_phase_e order.
+static startup_span_t spans[STARTUP_PHASE_COUNT] = {
+    { "trace_init", 0, 0, false, false },
+    { "storage_init", 0, 0, false, false },
+    { "platform_init", 0, 0, false, false },
+    { "interface_init", 0, 0, false, false },
+    { "application_init", 0, 0, false, false },
+    { "pdmc_init", 0, 0, false, false },
+    { "interface_connect", 0, 0, false, false },
+    { "registration", 0, 0, false, false },
+};
+
+static uint64_t origin_us = 0;
+static bool origin_set = false;
+
+// Split to avoid overflowing with nanosecond tick rates.
+uint64_t startup_profiler_time_us(void)
+{
+    const uint64_t ticks = pal_osKernelSysTick();
+    const uint64_t freq = pal_osKernelSysTickFrequency();
+
+    return (ticks / freq) * 1000000 + ((ticks % freq) * 1000000) / freq;
+}
+
+void startup_profiler_begin(startup_phase_e phase)
+{
+    const uint64_t now = startup_profiler_time_us();
+
+    if (!origin_set) {
+        origin_us = now;
+        origin_set = true;
+    }
+
+    if (!spans[phase].started) {
+        spans[phase].start_us = now;
+        spans[phase].started = true;
+    }
+}
+
+void startup_profiler_end(startup_phase_e phase)
+{
+    if (spans[phase].started && !spans[phase].ended) {
+        spans[phase].end_us = startup_profiler_time_us();
+        spans[phase].ended = true;
+    }
+}
+
+bool startup_profiler_complete(void)
+{
+    return spans[STARTUP_PHASE_REGISTRATION].ended;
+}
+
+static bool append_value(char *buffer, size_t buffer_size, size_t *len, const char *name, uint64_t value)
+{
+    int ret = snprintf(buffer + *len, buffer_size - *len, "%s\"%s\":%lu",
+                       (*len > 1) ? "," : "", name, (unsigned long)value);
+    if (ret < 0 || (size_t)ret >= buffer_size - *len) {
+        return false;
+    }
+    *len += ret;
+    return true;
+}
+
+size_t startup_profiler_format(char *buffer, size_t buffer_size)
+{
+    size_t len = 1;
+    bool ok = true;
+
+    if (buffer_size < 3) {
+        return 0;
+    }
+    buffer[0] = '{';
+    buffer[1] = '\0';
+
+    for (int i = 0; i < STARTUP_PHASE_COUNT && ok; i++) {
+        if (spans[i].ended) {
+            ok = append_value(buffer, buffer_size, &len, spans[i].name, spans[i].end_us - spans[i].start_us);
+        }
+    }
+
+    if (ok && startup_profiler_complete()) {
+        ok = append_value(buffer, buffer_size, &len, "total", spans[STARTUP_PHASE_REGISTRATION].end_us - origin_us);
+    }
+
+    if (!ok || len + 2 > buffer_size) {
+        buffer[0] = '\0';
+        return 0;
+    }
+
+    buffer[len++] = '}';
+    buffer[len] = '\0';
+
+    return len;
+}
+
+void startup_profiler_print(void)
+{
+    char buffer[STARTUP_PROFILER_FORMAT_SIZE];
+
+    if (startup_profiler_format(buffer, sizeof(buffer)) > 0) {
+        printf("Startup profile: %s\r\n", buffer);
+    }
+}
@@ -0,0 +1,76 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef STARTUP_PROFILER_H
+#define STARTUP_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Startup phases of main_application(), in execution order.
+typedef enum {
+    STARTUP_PHASE_TRACE_INIT,
+    STARTUP_PHASE_STORAGE_INIT,
+    STARTUP_PHASE_PLATFORM_INIT,
+    STARTUP_PHASE_INTERFACE_INIT,
+    STARTUP_PHASE_APPLICATION_INIT,
+    STARTUP_PHASE_PDMC_INIT,
+    STARTUP_PHASE_INTERFACE_CONNECT,
+    STARTUP_PHASE_REGISTRATION,     // From pdmc_connect() until the Registered callback
+    STARTUP_PHASE_COUNT
+} startup_phase_e;
+
+// Size of the buffer needed by startup_profiler_format().
+#define STARTUP_PROFILER_FORMAT_SIZE 256
+
+/*
+ * Monotonic time in microseconds, the clock used for the spans.
+ */
+uint64_t startup_profiler_time_us(void);
+
+/*
+ * Record the start of a phase. The first call also sets the time origin.
+ */
+void startup_profiler_begin(startup_phase_e phase);
+
+/*
+ * Record the end of a phase. Only the first end of each phase is recorded,
+ * so re-registrations do not overwrite the cold boot figures.
+ */
+void startup_profiler_end(startup_phase_e phase);
+
+/*
+ * Returns true once the registration phase has ended.
+ */
+bool startup_profiler_complete(void);
+
+/*
+ * Format phase durations in microseconds as a JSON object, e.g.
+ * {"trace_init":120,"storage_init":4100,...,"total":1523000}.
+ * Phases which have not ended are left out.
+ *
+ * @returns length of the string, excluding the terminator.
+ */
+size_t startup_profiler_format(char *buffer, size_t buffer_size);
+
+/*
+ * Print the startup profile as one "Startup profile: {...}" line.
+ */
+void startup_profiler_print(void);
+
+#endif // STARTUP_PROFILER_H
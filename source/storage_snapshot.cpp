@@ -0,0 +1,275 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "storage_snapshot.h"
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <linux/fs.h>
+
+#include "pal.h"
+#include "startup_profiler.h"
+
+#define SNAPSHOT_PATH_SIZE (PAL_MAX_FILE_AND_FOLDER_LENGTH + 64)
+
+typedef struct snapshot_stats {
+    unsigned files;
+    unsigned cloned;
+    uint64_t bytes;
+} snapshot_stats_t;
+
+static const char *const partition_names[] = { "primary", "secondary" };
+
+// Mount points of the partitions, the secondary is left empty when
+// both partitions share the same directory.
+static bool get_mount_points(char mount_points[2][PAL_MAX_FILE_AND_FOLDER_LENGTH])
+{
+    if (pal_fsGetMountPoint(PAL_FS_PARTITION_PRIMARY, PAL_MAX_FILE_AND_FOLDER_LENGTH, mount_points[0]) != PAL_SUCCESS ||
+            pal_fsGetMountPoint(PAL_FS_PARTITION_SECONDARY, PAL_MAX_FILE_AND_FOLDER_LENGTH, mount_points[1]) != PAL_SUCCESS) {
+        printf("Storage snapshot: cannot get the mount points\n");
+        return false;
+    }
+    if (strcmp(mount_points[0], mount_points[1]) == 0) {
+        mount_points[1][0] = '\0';
+    }
+    return true;
+}
+
+static int copy_file(const char *from, const char *to, snapshot_stats_t *stats)
+{
+    int result = -1;
+    struct stat st;
+    int in = open(from, O_RDONLY);
+    if (in < 0) {
+        return -1;
+    }
+    int out = -1;
+    if (fstat(in, &st) != 0) {
+        goto done;
+    }
+    out = open(to, O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 0777);
+    if (out < 0) {
+        goto done;
+    }
+
+    // Share the data blocks when the file system supports reflinks.
+    if (ioctl(out, FICLONE, in) == 0) {
+        stats->cloned++;
+    } else {
+        off_t left = st.st_size;
+        while (left > 0) {
+            ssize_t copied = copy_file_range(in, NULL, out, NULL, (size_t)left, 0);
+            if (copied <= 0) {
+                goto done;
+            }
+            left -= copied;
+        }
+    }
+    stats->files++;
+    stats->bytes += (uint64_t)st.st_size;
+    result = 0;
+
+done:
+    if (out >= 0 && close(out) != 0) {
+        result = -1;
+    }
+    close(in);
+    return result;
+}
+
+static int copy_tree(const char *from, const char *to, snapshot_stats_t *stats)
+{
+    char from_path[SNAPSHOT_PATH_SIZE];
+    char to_path[SNAPSHOT_PATH_SIZE];
+    struct stat st;
+    int result = 0;
+
+    if (mkdir(to, 0744) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    DIR *dir = opendir(from);
+    if (!dir) {
+        // A partition that was never created is an empty one.
+        return (errno == ENOENT) ? 0 : -1;
+    }
+
+    struct dirent *entry;
+    while (result == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (snprintf(from_path, sizeof(from_path), "%s/%s", from, entry->d_name) >= (int)sizeof(from_path) ||
+                snprintf(to_path, sizeof(to_path), "%s/%s", to, entry->d_name) >= (int)sizeof(to_path) ||
+                lstat(from_path, &st) != 0) {
+            result = -1;
+        } else if (S_ISDIR(st.st_mode)) {
+            result = copy_tree(from_path, to_path, stats);
+        } else if (S_ISREG(st.st_mode)) {
+            result = copy_file(from_path, to_path, stats);
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+// Remove the contents of the directory, but keep the directory itself.
+static int clear_tree(const char *path)
+{
+    char entry_path[SNAPSHOT_PATH_SIZE];
+    struct stat st;
+    int result = 0;
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    struct dirent *entry;
+    while (result == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (snprintf(entry_path, sizeof(entry_path), "%s/%s", path, entry->d_name) >= (int)sizeof(entry_path) ||
+                lstat(entry_path, &st) != 0) {
+            result = -1;
+        } else if (S_ISDIR(st.st_mode)) {
+            result = clear_tree(entry_path);
+            if (result == 0 && rmdir(entry_path) != 0) {
+                result = -1;
+            }
+        } else if (unlink(entry_path) != 0) {
+            result = -1;
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+int storage_snapshot_capture(const char *snapshot_dir)
+{
+    char mount_points[2][PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    char tmp_dir[SNAPSHOT_PATH_SIZE];
+    char path[SNAPSHOT_PATH_SIZE];
+    snapshot_stats_t stats = { 0, 0, 0 };
+
+    if (!get_mount_points(mount_points)) {
+        return -1;
+    }
+    if (snprintf(tmp_dir, sizeof(tmp_dir), "%s.%d.tmp", snapshot_dir, (int)getpid()) >= (int)sizeof(tmp_dir)) {
+        return -1;
+    }
+
+    const uint64_t start_us = startup_profiler_time_us();
+    int result = (mkdir(tmp_dir, 0744) == 0) ? 0 : -1;
+    for (int i = 0; i < 2 && result == 0; i++) {
+        if (mount_points[i][0] == '\0') {
+            continue;
+        }
+        if (snprintf(path, sizeof(path), "%s/%s", tmp_dir, partition_names[i]) >= (int)sizeof(path)) {
+            result = -1;
+            break;
+        }
+        result = copy_tree(mount_points[i], path, &stats);
+    }
+
+    // Another endpoint may have captured the snapshot first, keep that one.
+    if (result == 0 && rename(tmp_dir, snapshot_dir) != 0) {
+        result = (errno == EEXIST || errno == ENOTEMPTY) ? 0 : -1;
+        clear_tree(tmp_dir);
+        rmdir(tmp_dir);
+        return result;
+    }
+    if (result != 0) {
+        printf("Storage snapshot: capture of %s failed, errno %d\n", snapshot_dir, errno);
+        clear_tree(tmp_dir);
+        rmdir(tmp_dir);
+        return result;
+    }
+
+    printf("Storage snapshot: captured %u files, %lu bytes into %s in %lu us\n",
+           stats.files, (unsigned long)stats.bytes, snapshot_dir,
+           (unsigned long)(startup_profiler_time_us() - start_us));
+    return 0;
+}
+
+int storage_snapshot_restore(const char *snapshot_dir)
+{
+    char mount_points[2][PAL_MAX_FILE_AND_FOLDER_LENGTH];
+    char path[SNAPSHOT_PATH_SIZE];
+    snapshot_stats_t stats = { 0, 0, 0 };
+
+    if (!get_mount_points(mount_points)) {
+        return -1;
+    }
+
+    const uint64_t start_us = startup_profiler_time_us();
+    int result = 0;
+    for (int i = 0; i < 2 && result == 0; i++) {
+        if (mount_points[i][0] == '\0') {
+            continue;
+        }
+        if (snprintf(path, sizeof(path), "%s/%s", snapshot_dir, partition_names[i]) >= (int)sizeof(path)) {
+            result = -1;
+            break;
+        }
+        result = clear_tree(mount_points[i]);
+        if (result == 0) {
+            result = copy_tree(path, mount_points[i], &stats);
+        }
+    }
+    if (result != 0) {
+        printf("Storage snapshot: restore of %s failed, errno %d\n", snapshot_dir, errno);
+        return result;
+    }
+
+    printf("Storage snapshot: restored %u files (%u cloned), %lu bytes from %s in %lu us\n",
+           stats.files, stats.cloned, (unsigned long)stats.bytes, snapshot_dir,
+           (unsigned long)(startup_profiler_time_us() - start_us));
+    return 0;
+}
+
+bool storage_snapshot_boot(void)
+{
+    struct stat st;
+    const char *snapshot_dir = getenv("PDMC_STORAGE_SNAPSHOT");
+    if (!snapshot_dir || !*snapshot_dir || stat(snapshot_dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    return storage_snapshot_restore(snapshot_dir) == 0;
+}
+
+void storage_snapshot_provisioned(void)
+{
+    struct stat st;
+    const char *snapshot_dir = getenv("PDMC_STORAGE_SNAPSHOT");
+    if (!snapshot_dir || !*snapshot_dir || stat(snapshot_dir, &st) == 0) {
+        return;
+    }
+    (void)storage_snapshot_capture(snapshot_dir);
+}
+
+#endif // __linux__
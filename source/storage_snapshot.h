@@ -0,0 +1,81 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef STORAGE_SNAPSHOT_H
+#define STORAGE_SNAPSHOT_H
+
+/*
+ * Snapshot and restore of the client storage on Linux.
+ *
+ * A snapshot is a directory holding a copy of the primary and secondary
+ * storage partitions (and the simulated internal flash kept in them), taken
+ * after the device has been provisioned. Restoring it before fcc_init()
+ * boots the device in the provisioned state without running the
+ * provisioning again.
+ *
+ * Files are cloned with FICLONE where the file system supports reflinks, so
+ * restoring into many endpoints (see pdmc_fleet.h) shares the data blocks
+ * copy-on-write. Other file systems fall back to copy_file_range(). Keep the
+ * mount points and the snapshot on tmpfs to get the RAM file system timing.
+ *
+ * Set the environment variable PDMC_STORAGE_SNAPSHOT to the snapshot
+ * directory. If it does not exist yet, it is captured after the storage has
+ * been initialized, otherwise it is restored. Use an absolute path in fleet
+ * mode, as every endpoint runs in its own working directory.
+ */
+
+#if defined(__linux__)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Copy the storage partitions into the directory snapshot_dir, which must
+ * not exist. The snapshot is written next to it and renamed into place, so
+ * concurrent captures leave one complete snapshot.
+ * Returns 0 on success.
+ */
+int storage_snapshot_capture(const char *snapshot_dir);
+
+/*
+ * Replace the contents of the storage partitions with the snapshot
+ * in snapshot_dir. Must be called before fcc_init().
+ * Returns 0 on success.
+ */
+int storage_snapshot_restore(const char *snapshot_dir);
+
+/*
+ * Restore the snapshot named by PDMC_STORAGE_SNAPSHOT, if it exists.
+ * Returns true if the storage was restored.
+ */
+bool storage_snapshot_boot(void);
+
+/*
+ * Capture the snapshot named by PDMC_STORAGE_SNAPSHOT, if it is set and
+ * does not exist yet.
+ */
+void storage_snapshot_provisioned(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __linux__
+
+#endif // STORAGE_SNAPSHOT_H
@@ -0,0 +1,355 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "mbed-cloud-client/MbedCloudClient.h"
+
+#if defined(TARGET_LIKE_LINUX) && (MBED_CLOUD_CLIENT_FOTA_ENABLE) && (MBED_CLOUD_CLIENT_FOTA_SUB_COMPONENT_SUPPORT == 1)
+
+#include "sub_component_pipeline.h"
+#include "startup_profiler.h"
+#include "fota/fota_status.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    PIPELINE_STAGE_NONE,
+    PIPELINE_STAGE_INSTALL,
+    PIPELINE_STAGE_VERIFY
+} pipeline_stage_e;
+
+typedef struct {
+    sub_component_pipeline_entry_t entry;
+    bool queued;
+    bool installed;
+    // Copies, the library may reuse its buffers after the callback returns.
+    char *file_name;
+    uint8_t *vendor_data;
+    size_t vendor_data_size;
+    // Result of the sub-component in this update, the first failure is kept.
+    int result;
+} pipeline_slot_t;
+
+typedef struct {
+    pipeline_slot_t *jobs[SUB_COMPONENT_PIPELINE_MAX_ENTRIES];
+    size_t count;
+    size_t next;
+    size_t done;
+    pipeline_stage_e stage;
+} pipeline_group_t;
+
+static pipeline_slot_t slots[SUB_COMPONENT_PIPELINE_MAX_ENTRIES];
+static size_t slot_count = 0;
+
+// The group waiting for its members, there is at most one.
+static pipeline_stage_e pending_stage = PIPELINE_STAGE_NONE;
+static unsigned pending_order = 0;
+
+// First sub-component which failed in this update.
+static pipeline_slot_t *failed_slot = NULL;
+
+// Worker pool, started with the first group and kept for the life of the process.
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+// Group being run, NULL while the pool is idle.
+static pipeline_group_t *pool_group = NULL;
+// Threads of the pool, the thread running a group is the last worker.
+static size_t pool_size = 0;
+
+static pipeline_slot_t *find_slot(const char *sub_comp_name)
+{
+    for (size_t i = 0; i < slot_count; i++) {
+        if (strcmp(slots[i].entry.name, sub_comp_name) == 0) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+static unsigned slot_order(const pipeline_slot_t *slot, pipeline_stage_e stage)
+{
+    return (stage == PIPELINE_STAGE_INSTALL) ? slot->entry.install_order : slot->entry.verify_order;
+}
+
+static void release_job(pipeline_slot_t *slot)
+{
+    free(slot->file_name);
+    free(slot->vendor_data);
+    slot->file_name = NULL;
+    slot->vendor_data = NULL;
+    slot->vendor_data_size = 0;
+    slot->queued = false;
+}
+
+static void discard_pending(void)
+{
+    for (size_t i = 0; i < slot_count; i++) {
+        release_job(&slots[i]);
+    }
+    pending_stage = PIPELINE_STAGE_NONE;
+}
+
+static int run_job(pipeline_stage_e stage, pipeline_slot_t *slot)
+{
+    sub_component_pipeline_cb cb = (stage == PIPELINE_STAGE_INSTALL) ? slot->entry.install : slot->entry.verify;
+    int result = cb ? cb(slot->entry.name, slot->file_name, slot->vendor_data, slot->vendor_data_size) : FOTA_STATUS_SUCCESS;
+    if (stage == PIPELINE_STAGE_INSTALL && result == FOTA_STATUS_SUCCESS) {
+        slot->installed = true;
+    }
+    return result;
+}
+
+// Run the jobs of pool_group until none is left, called with pool_lock held.
+static void take_jobs(void)
+{
+    while (pool_group && pool_group->next < pool_group->count) {
+        pipeline_group_t *group = pool_group;
+        pipeline_slot_t *slot = group->jobs[group->next++];
+        pthread_mutex_unlock(&pool_lock);
+
+        const int result = run_job(group->stage, slot);
+
+        pthread_mutex_lock(&pool_lock);
+        if (slot->result == FOTA_STATUS_SUCCESS) {
+            slot->result = result;
+        }
+        if (++group->done == group->count) {
+            pthread_cond_signal(&pool_done);
+        }
+    }
+}
+
+static void *pool_worker(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        take_jobs();
+        pthread_cond_wait(&pool_work, &pool_lock);
+    }
+    return NULL;
+}
+
+static void start_pool(void)
+{
+    pthread_t thread;
+
+    // A group still runs on the calling thread if no thread can be created.
+    while (pool_size + 1 < SUB_COMPONENT_PIPELINE_WORKERS) {
+        if (pthread_create(&thread, NULL, pool_worker, NULL) != 0) {
+            break;
+        }
+        pthread_detach(thread);
+        pool_size++;
+    }
+}
+
+static int run_pending(void)
+{
+    pipeline_group_t group;
+    int ret = FOTA_STATUS_SUCCESS;
+
+    if (pending_stage == PIPELINE_STAGE_NONE) {
+        return FOTA_STATUS_SUCCESS;
+    }
+
+    memset(&group, 0, sizeof(group));
+    group.stage = pending_stage;
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i].queued) {
+            group.jobs[group.count++] = &slots[i];
+        }
+    }
+
+    const uint64_t start_us = startup_profiler_time_us();
+
+    if (group.count > 1) {
+        start_pool();
+    }
+    pthread_mutex_lock(&pool_lock);
+    pool_group = &group;
+    pthread_cond_broadcast(&pool_work);
+    take_jobs();
+    while (group.done < group.count) {
+        pthread_cond_wait(&pool_done, &pool_lock);
+    }
+    pool_group = NULL;
+    pthread_mutex_unlock(&pool_lock);
+
+    for (size_t i = 0; i < group.count; i++) {
+        pipeline_slot_t *slot = group.jobs[i];
+        if (slot->result != FOTA_STATUS_SUCCESS) {
+            printf("Sub-component %s failed: %d\n", slot->entry.name, slot->result);
+            if (!failed_slot) {
+                failed_slot = slot;
+            }
+            if (ret == FOTA_STATUS_SUCCESS) {
+                ret = slot->result;
+            }
+        }
+    }
+
+    if (ret != FOTA_STATUS_SUCCESS && group.stage == PIPELINE_STAGE_INSTALL) {
+        for (size_t i = group.count; i > 0; i--) {
+            pipeline_slot_t *slot = group.jobs[i - 1];
+            if (slot->installed) {
+                if (slot->entry.rollback) {
+                    slot->entry.rollback(slot->entry.name, NULL, slot->vendor_data, slot->vendor_data_size);
+                }
+                slot->installed = false;
+            }
+        }
+    }
+
+    printf("Sub-component %s group %u: %u components in %lu ms\n",
+           (group.stage == PIPELINE_STAGE_INSTALL) ? "install" : "verify", pending_order,
+           (unsigned)group.count, (unsigned long)((startup_profiler_time_us() - start_us) / 1000));
+
+    discard_pending();
+    return ret;
+}
+
+static int queue_job(pipeline_stage_e stage, const char *sub_comp_name, const char *file_name,
+                     const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    pipeline_slot_t *slot = find_slot(sub_comp_name);
+    if (!slot) {
+        printf("Sub-component %s not in the pipeline\n", sub_comp_name);
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+
+    const unsigned order = slot_order(slot, stage);
+    if (pending_stage != PIPELINE_STAGE_NONE && (pending_stage != stage || pending_order != order)) {
+        int ret = run_pending();
+        if (ret != FOTA_STATUS_SUCCESS) {
+            // The failed group did not hold this sub-component, which never runs.
+            printf("Sub-component %s not run, %s failed\n", sub_comp_name, failed_slot->entry.name);
+            return ret;
+        }
+    }
+
+    release_job(slot);
+    if (file_name) {
+        slot->file_name = strdup(file_name);
+    }
+    if (vendor_data && vendor_data_size) {
+        slot->vendor_data = (uint8_t *)malloc(vendor_data_size);
+        if (slot->vendor_data) {
+            memcpy(slot->vendor_data, vendor_data, vendor_data_size);
+            slot->vendor_data_size = vendor_data_size;
+        }
+    }
+    if ((file_name && !slot->file_name) || (vendor_data && vendor_data_size && !slot->vendor_data)) {
+        release_job(slot);
+        discard_pending();
+        slot->result = FOTA_STATUS_OUT_OF_MEMORY;
+        if (!failed_slot) {
+            failed_slot = slot;
+        }
+        return FOTA_STATUS_OUT_OF_MEMORY;
+    }
+    slot->queued = true;
+    pending_stage = stage;
+    pending_order = order;
+
+    for (size_t i = 0; i < slot_count; i++) {
+        if (!slots[i].queued && slot_order(&slots[i], stage) == order) {
+            return FOTA_STATUS_SUCCESS;
+        }
+    }
+    return run_pending();
+}
+
+int sub_component_pipeline_add(const sub_component_pipeline_entry_t *entry)
+{
+    if (slot_count >= SUB_COMPONENT_PIPELINE_MAX_ENTRIES) {
+        return FOTA_STATUS_OUT_OF_MEMORY;
+    }
+    memset(&slots[slot_count], 0, sizeof(slots[slot_count]));
+    slots[slot_count].entry = *entry;
+    slot_count++;
+    return FOTA_STATUS_SUCCESS;
+}
+
+void sub_component_pipeline_reset(void)
+{
+    discard_pending();
+    for (size_t i = 0; i < slot_count; i++) {
+        slots[i].installed = false;
+        slots[i].result = FOTA_STATUS_SUCCESS;
+    }
+    failed_slot = NULL;
+}
+
+int sub_component_pipeline_install(const char *sub_comp_name, const char *file_name,
+                                   const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    return queue_job(PIPELINE_STAGE_INSTALL, sub_comp_name, file_name, vendor_data, vendor_data_size);
+}
+
+int sub_component_pipeline_verify(const char *sub_comp_name,
+                                  const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    return queue_job(PIPELINE_STAGE_VERIFY, sub_comp_name, NULL, vendor_data, vendor_data_size);
+}
+
+int sub_component_pipeline_flush(void)
+{
+    (void)run_pending();
+    if (failed_slot) {
+        printf("Sub-component update failed at %s: %d\n", failed_slot->entry.name, failed_slot->result);
+        return failed_slot->result;
+    }
+    return FOTA_STATUS_SUCCESS;
+}
+
+int sub_component_pipeline_result(const char *sub_comp_name)
+{
+    pipeline_slot_t *slot = find_slot(sub_comp_name);
+    if (!slot) {
+        return FOTA_STATUS_INTERNAL_ERROR;
+    }
+    // A deferred job has no result until its group ran.
+    if (slot->queued) {
+        (void)run_pending();
+    }
+    return slot->result;
+}
+
+int sub_component_pipeline_rollback(const char *sub_comp_name,
+                                    const uint8_t *vendor_data, size_t vendor_data_size)
+{
+    pipeline_slot_t *slot = find_slot(sub_comp_name);
+    int ret = FOTA_STATUS_SUCCESS;
+
+    // The update is abandoned, whatever did not run yet never will.
+    discard_pending();
+
+    if (slot && slot->installed) {
+        if (slot->entry.rollback) {
+            ret = slot->entry.rollback(sub_comp_name, NULL, vendor_data, vendor_data_size);
+        }
+        slot->installed = false;
+    }
+    return ret;
+}
+
+#endif // TARGET_LIKE_LINUX && MBED_CLOUD_CLIENT_FOTA_ENABLE && MBED_CLOUD_CLIENT_FOTA_SUB_COMPONENT_SUPPORT
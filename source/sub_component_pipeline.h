@@ -0,0 +1,116 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef SUB_COMPONENT_PIPELINE_H
+#define SUB_COMPONENT_PIPELINE_H
+
+/*
+ * Installer pipeline for the sub-components of a Linux gateway image.
+ *
+ * The FOTA library calls the install and verify callbacks of the sub-components
+ * one by one, sorted by their declared order. The pipeline defers the work of
+ * each call until every sub-component with the same order value has been
+ * called, then runs the whole group concurrently on a worker pool and waits
+ * for it before the next group starts. A group also runs when a call for
+ * another group or stage arrives, in case the package does not hold all of
+ * its members.
+ *
+ * When a member of an install group fails, the members of the group which
+ * did install are rolled back in reverse order before the failure is returned.
+ * Completed groups are rolled back by the library through
+ * sub_component_pipeline_rollback(), in the declared rollback order.
+ *
+ * A deferred call returns before its work has run, so a failure is returned
+ * by the call which ran the group, which may be the call of another
+ * sub-component. The result of every sub-component is kept until the next
+ * update, sub_component_pipeline_result() returns it, and
+ * sub_component_pipeline_flush() returns the first failure and names the
+ * sub-component which failed.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of sub-components which can be added to the pipeline.
+#ifndef SUB_COMPONENT_PIPELINE_MAX_ENTRIES
+#define SUB_COMPONENT_PIPELINE_MAX_ENTRIES 8
+#endif
+
+// Number of sub-components of a group which run at the same time.
+#ifndef SUB_COMPONENT_PIPELINE_WORKERS
+#define SUB_COMPONENT_PIPELINE_WORKERS 4
+#endif
+
+// Work of one stage of a sub-component, file_name is NULL except for install.
+// Runs on a worker thread, returns FOTA_STATUS_SUCCESS or a FOTA error.
+typedef int (*sub_component_pipeline_cb)(const char *sub_comp_name, const char *file_name,
+                                         const uint8_t *vendor_data, size_t vendor_data_size);
+
+typedef struct {
+    const char *name;
+    unsigned install_order;
+    unsigned verify_order;
+    sub_component_pipeline_cb install;
+    sub_component_pipeline_cb verify;
+    sub_component_pipeline_cb rollback;
+} sub_component_pipeline_entry_t;
+
+/**
+ * @brief Add a sub-component, the orders must match the ones given to the library.
+ * @return FOTA_STATUS_SUCCESS, or FOTA_STATUS_OUT_OF_MEMORY if all slots are in use.
+ */
+int sub_component_pipeline_add(const sub_component_pipeline_entry_t *entry);
+
+/**
+ * @brief Forget the work, state and results of the previous update.
+ */
+void sub_component_pipeline_reset(void);
+
+/**
+ * @brief Queue the install of a sub-component, runs its group once complete.
+ * @return Result of the group when it ran, FOTA_STATUS_SUCCESS when deferred.
+ */
+int sub_component_pipeline_install(const char *sub_comp_name, const char *file_name,
+                                   const uint8_t *vendor_data, size_t vendor_data_size);
+
+/**
+ * @brief Queue the verification of a sub-component, runs its group once complete.
+ * @return Result of the group when it ran, FOTA_STATUS_SUCCESS when deferred.
+ */
+int sub_component_pipeline_verify(const char *sub_comp_name,
+                                  const uint8_t *vendor_data, size_t vendor_data_size);
+
+/**
+ * @brief Run the groups still waiting for members.
+ * @return First failure of the update, FOTA_STATUS_SUCCESS if every sub-component succeeded.
+ */
+int sub_component_pipeline_flush(void);
+
+/**
+ * @brief Result of a sub-component in this update, runs its group if it is still waiting.
+ * @return First failure of its install and verify work, FOTA_STATUS_SUCCESS otherwise.
+ */
+int sub_component_pipeline_result(const char *sub_comp_name);
+
+/**
+ * @brief Roll back a sub-component, does nothing unless it was installed.
+ */
+int sub_component_pipeline_rollback(const char *sub_comp_name,
+                                    const uint8_t *vendor_data, size_t vendor_data_size);
+
+#endif // SUB_COMPONENT_PIPELINE_H
@@ -0,0 +1,327 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "verification_record.h"
+#include "key_config_manager.h"
+#include "fcc_defs.h"
+#include "pal.h"
+
+#define VERIFICATION_RECORD_VERSION 2
+
+// Format of the item in storage.
+typedef struct verification_record {
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t not_after;             // Earliest expiry of the certificates, 0 if unknown
+    uint8_t digest[PAL_SHA256_SIZE];
+} verification_record_t;
+
+typedef enum {
+    CREDENTIAL_CONFIG,
+    CREDENTIAL_CERTIFICATE,
+    CREDENTIAL_CERTIFICATE_CHAIN,   // Device certificate, with its intermediates
+    CREDENTIAL_PRIVATE_KEY,
+} credential_kind_e;
+
+typedef struct credential_item {
+    const char *name;
+    credential_kind_e kind;
+} credential_item_t;
+
+// The items checked by fcc_verify_device_configured_4mbed_cloud().
+static const credential_item_t credential_items[] = {
+    // General information
+    { g_fcc_use_bootstrap_parameter_name,           CREDENTIAL_CONFIG },
+    { g_fcc_endpoint_parameter_name,                CREDENTIAL_CONFIG },
+    { g_fcc_first_to_claim_parameter_name,          CREDENTIAL_CONFIG },
+    // Device meta data
+    { g_fcc_manufacturer_parameter_name,            CREDENTIAL_CONFIG },
+    { g_fcc_model_number_parameter_name,            CREDENTIAL_CONFIG },
+    { g_fcc_device_type_parameter_name,             CREDENTIAL_CONFIG },
+    { g_fcc_hardware_version_parameter_name,        CREDENTIAL_CONFIG },
+    { g_fcc_memory_size_parameter_name,             CREDENTIAL_CONFIG },
+    { g_fcc_device_serial_number_parameter_name,    CREDENTIAL_CONFIG },
+    { g_fcc_device_time_zone_parameter_name,        CREDENTIAL_CONFIG },
+    { g_fcc_offset_from_utc_parameter_name,         CREDENTIAL_CONFIG },
+    // Bootstrap and LwM2M security objects
+    { g_fcc_bootstrap_server_uri_name,              CREDENTIAL_CONFIG },
+    { g_fcc_bootstrap_server_ca_certificate_name,   CREDENTIAL_CERTIFICATE },
+    { g_fcc_bootstrap_device_certificate_name,      CREDENTIAL_CERTIFICATE_CHAIN },
+    { g_fcc_bootstrap_device_private_key_name,      CREDENTIAL_PRIVATE_KEY },
+    { g_fcc_lwm2m_server_uri_name,                  CREDENTIAL_CONFIG },
+    { g_fcc_lwm2m_server_ca_certificate_name,       CREDENTIAL_CERTIFICATE },
+    { g_fcc_lwm2m_device_certificate_name,          CREDENTIAL_CERTIFICATE_CHAIN },
+    { g_fcc_lwm2m_device_private_key_name,          CREDENTIAL_PRIVATE_KEY },
+    // Firmware update
+    { g_fcc_update_authentication_certificate_name, CREDENTIAL_CERTIFICATE },
+    { g_fcc_vendor_id_name,                         CREDENTIAL_CONFIG },
+    { g_fcc_class_id_name,                          CREDENTIAL_CONFIG },
+};
+
+#define CREDENTIAL_ITEM_COUNT (sizeof(credential_items) / sizeof(credential_items[0]))
+
+// Tags hashed before the data, so that items of different kinds never hash alike.
+#define TAG_MISSING     0
+#define TAG_DATA        1
+#define TAG_PUBLIC_KEY  2
+#define TAG_CHAIN       3
+
+typedef struct record_context {
+    palMDHandle_t md;
+    verification_record_t *record;
+    bool with_expiry;
+} record_context_t;
+
+static uint64_t certificate_not_after(const uint8_t *data, size_t size)
+{
+    palX509Handle_t cert = NULLPTR;
+    uint64_t not_after = 0;
+    size_t actual_size = 0;
+
+    if (pal_x509Initiate(&cert) != PAL_SUCCESS) {
+        return 0;
+    }
+    if (pal_x509CertParse(cert, data, size) != PAL_SUCCESS ||
+            pal_x509CertGetAttribute(cert, PAL_X509_VALID_TO, &not_after, sizeof(not_after),
+                                     &actual_size) != PAL_SUCCESS) {
+        not_after = 0;
+    }
+    pal_x509Free(&cert);
+    return not_after;
+}
+
+// Without data only the tag and the size are hashed, such as the length of a chain.
+static bool hash_value(record_context_t *context, uint32_t tag, const uint8_t *data, size_t size)
+{
+    const uint32_t header[2] = { tag, (uint32_t)size };
+
+    return pal_mdUpdate(context->md, (const unsigned char *)header, sizeof(header)) == PAL_SUCCESS &&
+           (!data || size == 0 || pal_mdUpdate(context->md, data, size) == PAL_SUCCESS);
+}
+
+static void note_expiry(record_context_t *context, const uint8_t *data, size_t size)
+{
+    if (context->with_expiry) {
+        uint64_t not_after = certificate_not_after(data, size);
+        if (not_after && (context->record->not_after == 0 || not_after < context->record->not_after)) {
+            context->record->not_after = not_after;
+        }
+    }
+}
+
+// Read a whole item, NULL when it is missing or unreadable.
+static uint8_t *read_item(const char *name, kcm_item_type_e type, size_t *size, kcm_status_e *status)
+{
+    size_t actual_size = 0;
+    uint8_t *data;
+
+    *status = kcm_item_get_data_size((const uint8_t *)name, strlen(name), type, size);
+    if (*status != KCM_STATUS_SUCCESS) {
+        return NULL;
+    }
+    data = (uint8_t *)malloc(*size ? *size : 1);
+    if (!data) {
+        *status = KCM_STATUS_OUT_OF_MEMORY;
+        return NULL;
+    }
+    *status = kcm_item_get_data((const uint8_t *)name, strlen(name), type, data, *size, &actual_size);
+    if (*status == KCM_STATUS_SUCCESS && actual_size != *size) {
+        *status = KCM_STATUS_ERROR;
+    }
+    if (*status != KCM_STATUS_SUCCESS) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static bool hash_item(record_context_t *context, const char *name, kcm_item_type_e type, uint32_t tag)
+{
+    kcm_status_e status;
+    size_t size = 0;
+    uint8_t *data = read_item(name, type, &size, &status);
+    bool result;
+
+    if (!data) {
+        // A missing item hashes differently from an empty one.
+        return status == KCM_STATUS_ITEM_NOT_FOUND && hash_value(context, TAG_MISSING, NULL, 0);
+    }
+    result = hash_value(context, tag, data, size);
+    if (result && type == KCM_CERTIFICATE_ITEM) {
+        note_expiry(context, data, size);
+    }
+    free(data);
+    return result;
+}
+
+// Every certificate of the chain, in order. A single certificate is a chain of one.
+static bool hash_chain(record_context_t *context, const char *name)
+{
+    kcm_cert_chain_handle chain = NULL;
+    size_t chain_length = 0;
+    bool result;
+
+    if (kcm_cert_chain_open(&chain, (const uint8_t *)name, strlen(name), &chain_length) != KCM_STATUS_SUCCESS) {
+        return hash_item(context, name, KCM_CERTIFICATE_ITEM, TAG_DATA);
+    }
+
+    result = hash_value(context, TAG_CHAIN, NULL, chain_length);
+    for (size_t i = 0; i < chain_length && result; i++) {
+        size_t size = 0;
+        size_t actual_size = 0;
+        uint8_t *cert = NULL;
+
+        result = kcm_cert_chain_get_next_size(chain, &size) == KCM_STATUS_SUCCESS &&
+                 (cert = (uint8_t *)malloc(size ? size : 1)) != NULL &&
+                 kcm_cert_chain_get_next_data(chain, cert, size, &actual_size) == KCM_STATUS_SUCCESS &&
+                 actual_size == size &&
+                 hash_value(context, TAG_DATA, cert, size);
+        if (result) {
+            note_expiry(context, cert, size);
+        }
+        free(cert);
+    }
+    (void)kcm_cert_chain_close(chain);
+    return result;
+}
+
+// The key data, or the public key of the pair when the private key cannot be read.
+static bool hash_private_key(record_context_t *context, const char *name)
+{
+    kcm_status_e status;
+    size_t size = 0;
+    uint8_t *data = read_item(name, KCM_PRIVATE_KEY_ITEM, &size, &status);
+    bool result;
+
+    if (data) {
+        result = hash_value(context, TAG_DATA, data, size);
+        free(data);
+        return result;
+    }
+    if (status == KCM_STATUS_ITEM_NOT_FOUND) {
+        return hash_value(context, TAG_MISSING, NULL, 0);
+    }
+
+    data = read_item(name, KCM_PUBLIC_KEY_ITEM, &size, &status);
+    if (!data) {
+        printf("Private key %s is not readable and has no public key, verifying credentials at every boot\r\n", name);
+        return false;
+    }
+    result = hash_value(context, TAG_PUBLIC_KEY, data, size);
+    free(data);
+    return result;
+}
+
+// Hash the name and the contents of every item, and optionally find the
+// earliest expiry of the certificates.
+static bool compute_record(verification_record_t *record, bool with_expiry)
+{
+    record_context_t context = { NULLPTR, record, with_expiry };
+    bool result = true;
+
+    memset(record, 0, sizeof(*record));
+    record->version = VERIFICATION_RECORD_VERSION;
+
+    if (pal_mdInit(&context.md, PAL_SHA256) != PAL_SUCCESS) {
+        return false;
+    }
+
+    for (size_t i = 0; i < CREDENTIAL_ITEM_COUNT && result; i++) {
+        const credential_item_t *item = &credential_items[i];
+
+        result = pal_mdUpdate(context.md, (const unsigned char *)item->name, strlen(item->name) + 1) == PAL_SUCCESS;
+        if (!result) {
+            break;
+        }
+        switch (item->kind) {
+            case CREDENTIAL_CONFIG:
+                result = hash_item(&context, item->name, KCM_CONFIG_ITEM, TAG_DATA);
+                break;
+            case CREDENTIAL_CERTIFICATE:
+                result = hash_item(&context, item->name, KCM_CERTIFICATE_ITEM, TAG_DATA);
+                break;
+            case CREDENTIAL_CERTIFICATE_CHAIN:
+                result = hash_chain(&context, item->name);
+                break;
+            case CREDENTIAL_PRIVATE_KEY:
+                result = hash_private_key(&context, item->name);
+                break;
+        }
+    }
+
+    if (result) {
+        result = pal_mdFinal(context.md, record->digest) == PAL_SUCCESS;
+    }
+    pal_mdFree(&context.md);
+    return result;
+}
+
+bool verification_record_matches(void)
+{
+    verification_record_t stored;
+    verification_record_t current;
+    size_t size = 0;
+
+    if (kcm_item_get_data((const uint8_t *)VERIFICATION_RECORD_NAME, strlen(VERIFICATION_RECORD_NAME),
+                          KCM_CONFIG_ITEM, (uint8_t *)&stored, sizeof(stored), &size) != KCM_STATUS_SUCCESS ||
+            size != sizeof(stored) || stored.version != VERIFICATION_RECORD_VERSION) {
+        return false;
+    }
+
+    // Without a known time the verification cannot check the expiry either.
+    const uint64_t now = pal_osGetTime();
+    if (now && stored.not_after && now + VERIFICATION_RECORD_EXPIRY_MARGIN >= stored.not_after) {
+        printf("Certificate expires at %" PRIu64 ", verifying credentials again\r\n", stored.not_after);
+        return false;
+    }
+
+    if (!compute_record(&current, false)) {
+        return false;
+    }
+    return memcmp(current.digest, stored.digest, sizeof(stored.digest)) == 0;
+}
+
+void verification_record_store(void)
+{
+    verification_record_t record;
+    kcm_status_e status;
+
+    if (!compute_record(&record, true)) {
+        printf("Failed to compute verification record\r\n");
+        return;
+    }
+
+    // Storing over an existing item fails, so delete it first.
+    verification_record_clear();
+    status = kcm_item_store((const uint8_t *)VERIFICATION_RECORD_NAME, strlen(VERIFICATION_RECORD_NAME),
+                            KCM_CONFIG_ITEM, false, (const uint8_t *)&record, sizeof(record), NULL);
+    if (status != KCM_STATUS_SUCCESS) {
+        printf("Failed to store verification record, status %d\r\n", status);
+    }
+}
+
+void verification_record_clear(void)
+{
+    (void)kcm_item_delete((const uint8_t *)VERIFICATION_RECORD_NAME, strlen(VERIFICATION_RECORD_NAME),
+                          KCM_CONFIG_ITEM);
+}
@@ -0,0 +1,71 @@
+// ----------------------------------------------------------------------------
+// Copyright 2022 Izuma Networks.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef VERIFICATION_RECORD_H
+#define VERIFICATION_RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Storage item name of the record.
+#ifndef VERIFICATION_RECORD_NAME
+#define VERIFICATION_RECORD_NAME "pdmc_verified"
+#endif
+
+// Verify again when a certificate expires within this many seconds.
+#ifndef VERIFICATION_RECORD_EXPIRY_MARGIN
+#define VERIFICATION_RECORD_EXPIRY_MARGIN (30 * 24 * 3600)
+#endif
+
+/*
+ * Record of a successful fcc_verify_device_configured_4mbed_cloud().
+ *
+ * The record holds a SHA-256 digest over the items which the verification
+ * checks, and the earliest expiry time of their certificates. The digest
+ * covers the general information, the device meta data, the bootstrap and
+ * LwM2M server URIs, CA certificates, device certificate chains with every
+ * certificate of the chain, and private keys, and the update authentication
+ * certificate with the vendor and class IDs. While the items hash to the
+ * same digest and no certificate is about to expire, the credentials are
+ * known to be valid and the full verification, which parses the certificate
+ * chains and checks the keys, can be skipped.
+ *
+ * A private key is covered by its data, or by the public key of its pair
+ * when the private key cannot be read. Without either, no record is kept
+ * and the credentials are verified at every boot. The record does not cover
+ * the current time, which the verification also checks, other than through
+ * the expiry time of the certificates.
+ */
+
+/**
+ * @brief Check the stored record against the credentials in storage.
+ * @return true when the credentials are unchanged since they were verified.
+ */
+bool verification_record_matches(void);
+
+/**
+ * @brief Store a record of the credentials in storage, call after a successful verification.
+ */
+void verification_record_store(void);
+
+/**
+ * @brief Remove the record, the next boot verifies the credentials again.
+ */
+void verification_record_clear(void);
+
+#endif // VERIFICATION_RECORD_H
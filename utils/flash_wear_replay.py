@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+# Copyright 2022 Izuma Networks.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Replay a flash wear trace and project the flash lifetime.
+
+The trace is written by the Linux internal flash simulator of
+source/platform/Linux/pal_plat_internal_flash_mmap.c when the client runs
+with PAL_FLASH_WEAR_TRACE=<file>. Each line is one program, erase or
+compaction, charged to the subsystem active at the time (see flash_wear.h).
+On Linux only SOTP uses the internal flash. KCM items and FOTA candidates
+are files and are not in the trace. A compaction is a logical operation,
+such as one SOTP call, which erased. Its stall_us is the wall-clock
+duration of the whole operation.
+
+The replay counts the programs, bytes and erases of every subsystem, and
+the compactions with the percentiles of their stalls. It then repeats the
+traced workload
+--per-day times a day until the most erased sector reaches --endurance
+cycles. The projection with ideal wear leveling spreads the same erases
+evenly over all sectors.
+"""
+
+import argparse
+import collections
+import csv
+import sys
+
+SECONDS_PER_DAY = 24 * 3600
+
+
+def percentile(values, fraction):
+    """Value at the fraction of the sorted values, 0 when empty."""
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(fraction * len(values)))]
+
+
+def replay(rows, sector_size):
+    """Count the operations of the trace per subsystem and per sector."""
+    stats = collections.defaultdict(lambda: {
+        'programs': 0, 'bytes': 0, 'erases': 0, 'erased': 0, 'stalls': []})
+    sector_erases = collections.Counter()
+    duration_us = 0
+
+    for row in rows:
+        subsystem = stats[row['subsystem']]
+        address = int(row['address'])
+        size = int(row['size'])
+        duration_us = max(duration_us, int(row['time_us']))
+        if row['op'] == 'program':
+            subsystem['programs'] += 1
+            subsystem['bytes'] += size
+        elif row['op'] == 'erase':
+            first = address // sector_size
+            count = max(1, size // sector_size)
+            for sector in range(first, first + count):
+                sector_erases[sector] += 1
+            subsystem['erases'] += 1
+            subsystem['erased'] += count
+        elif row['op'] == 'compaction':
+            subsystem['stalls'].append(int(row['stall_us']))
+    return stats, sector_erases, duration_us
+
+
+def lifetime_days(erases_per_run, runs_per_day, endurance):
+    """Days until a sector erased erases_per_run times a run wears out."""
+    if erases_per_run == 0 or runs_per_day <= 0:
+        return float('inf')
+    return endurance / (erases_per_run * runs_per_day)
+
+
+def print_report(stats, sector_erases, sectors, args, runs_per_day):
+    print('Internal flash (SOTP) traffic only, KCM items and FOTA candidates are files')
+    print('%-10s %8s %10s %8s %8s %8s %10s %10s %10s' % (
+        'subsystem', 'programs', 'bytes', 'erases', 'sectors', 'compct',
+        'p50 ms', 'p99 ms', 'max ms'))
+    for name in sorted(stats):
+        s = stats[name]
+        print('%-10s %8d %10d %8d %8d %8d %10.1f %10.1f %10.1f' % (
+            name, s['programs'], s['bytes'], s['erases'], s['erased'],
+            len(s['stalls']), percentile(s['stalls'], 0.5) / 1000.0,
+            percentile(s['stalls'], 0.99) / 1000.0,
+            max(s['stalls'], default=0) / 1000.0))
+
+    total = sum(sector_erases.values())
+    worst = max(sector_erases.values(), default=0)
+    print('\nSector erases per run: %d total, %d on the most erased '
+          'of %d sectors' % (total, worst, sectors))
+    print('Runs per day: %.1f, endurance %d cycles' % (runs_per_day, args.endurance))
+
+    days = lifetime_days(worst, runs_per_day, args.endurance)
+    leveled = lifetime_days(total / sectors if sectors else 0,
+                            runs_per_day, args.endurance)
+    print('Projected lifetime: %s' % format_days(days))
+    print('With ideal wear leveling: %s' % format_days(leveled))
+
+
+def format_days(days):
+    if days == float('inf'):
+        return 'unlimited, no erases'
+    return '%.1f days (%.1f years)' % (days, days / 365.0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('trace', help='trace file written with PAL_FLASH_WEAR_TRACE')
+    parser.add_argument('--sector-size', type=int, default=4096,
+                        help='PAL_FLASH_MMAP_SECTOR_SIZE of the traced build (default: %(default)s)')
+    parser.add_argument('--flash-size', type=int, default=0x10000,
+                        help='PAL_FLASH_MMAP_SIZE of the traced build (default: %(default)s)')
+    parser.add_argument('--endurance', type=int, default=100000,
+                        help='program/erase cycles of a sector (default: %(default)s)')
+    parser.add_argument('--per-day', type=float,
+                        help='times the traced workload runs a day, '
+                             'by default back to back for the traced duration')
+    args = parser.parse_args()
+
+    with open(args.trace, newline='') as trace:
+        stats, sector_erases, duration_us = replay(csv.DictReader(trace), args.sector_size)
+
+    if not stats:
+        print('Empty trace')
+        return 1
+
+    if args.per_day:
+        runs_per_day = args.per_day
+    else:
+        runs_per_day = SECONDS_PER_DAY * 1e6 / max(duration_us, 1)
+
+    print_report(stats, sector_erases, args.flash_size // args.sector_size, args, runs_per_day)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
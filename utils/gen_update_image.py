@@ -16,29 +16,89 @@
 
 """Generate the binary image to be used by FOTA."""
 
+import os
 import struct
-from time import time
+from concurrent.futures import ThreadPoolExecutor
+from time import time, monotonic
 import hashlib
 
+# Big endian. Fields: Magic, header size, version, FW size, FW hash
+HEADER_FORMAT = '>IIQI32s'
+HEADER_MAGIC = 0x464F5441  # "FOTA"
+
+CHUNK_SIZE = 1024 * 1024
+
+
+def _make_header(version: int, fw_size: int, digest: bytes):
+    return struct.pack(
+        HEADER_FORMAT,
+        HEADER_MAGIC,
+        struct.calcsize(HEADER_FORMAT),
+        version,
+        fw_size,
+        digest)
+
 
 def make_firmware_package(binary: bytes,
                           version: int):
     """Given version and binary, Generate the FOTA binary image."""
-    # Big endian. Fields: Magic, header size, version, FW size, FW hash
-    st_map = '>IIQI32s'
-    magic = 0x464F5441  # "FOTA"
-    header_size = struct.calcsize(st_map)
-    fw_size = len(binary)
     hash = hashlib.sha256()
     hash.update(binary)
-    meta = struct.pack(
-        st_map,
-        magic,
-        header_size,
-        version,
-        fw_size,
-        hash.digest())
-    return meta + binary
+    return _make_header(version, len(binary), hash.digest()) + binary
+
+
+def package_firmware_file(in_path: str,
+                          out_path: str,
+                          version: int,
+                          chunk_size: int = CHUNK_SIZE):
+    """
+    Generate the FOTA binary image from file to file in constant memory.
+
+    The binary is hashed while it is copied in chunks, the header is
+    written last into the space reserved for it.
+    Returns the size of the binary and the time taken in seconds.
+    """
+    start = monotonic()
+    header_size = struct.calcsize(HEADER_FORMAT)
+    hash = hashlib.sha256()
+    fw_size = 0
+    buffer = bytearray(chunk_size)
+    view = memoryview(buffer)
+
+    with open(in_path, 'rb') as in_file, open(out_path, 'wb') as out_file:
+        out_file.seek(header_size)
+        while True:
+            length = in_file.readinto(buffer)
+            if not length:
+                break
+            hash.update(view[:length])
+            out_file.write(view[:length])
+            fw_size += length
+        out_file.seek(0)
+        out_file.write(_make_header(version, fw_size, hash.digest()))
+
+    return fw_size, monotonic() - start
+
+
+def package_firmware_files(pairs, version: int, jobs: int = None):
+    """
+    Package (in_path, out_path) pairs concurrently.
+
+    Each image is hashed sequentially, as SHA-256 cannot be split, but
+    hashlib and file I/O release the GIL so the images run in parallel.
+    Prints the throughput of each image.
+    """
+    def package(pair):
+        in_path, out_path = pair
+        size, seconds = package_firmware_file(in_path, out_path, version)
+        mib = size / (1024 * 1024)
+        print('{} -> {}: {:.1f} MiB in {:.2f} s, {:.1f} MiB/s'.format(
+            in_path, out_path, mib, seconds,
+            mib / seconds if seconds > 0 else 0))
+
+    with ThreadPoolExecutor(max_workers=jobs or os.cpu_count()) as executor:
+        # list() re-raises the first failure
+        list(executor.map(package, pairs))
 
 
 if __name__ == '__main__':
@@ -47,20 +107,28 @@ if __name__ == '__main__':
     parser = argparse.ArgumentParser(
         description='Create firmware package from binary application image')
     parser.add_argument('-i', '--in-file',
-                        help='Raw binary application file name',
+                        nargs='+',
+                        help='Raw binary application file name(s)',
                         required=True)
     parser.add_argument('-o', '--out-file',
-                        help='Generated FOTA binary file name',
+                        nargs='+',
+                        help='Generated FOTA binary file name(s), '
+                             'one for each input file',
                         required=True)
     parser.add_argument(
         '-v', '--version',
         type=int,
         help='Firmware version (64 bit integer). Default: current epoch',
         default=int(time()))
+    parser.add_argument(
+        '-j', '--jobs',
+        type=int,
+        help='Images packaged in parallel. Default: number of CPUs')
 
     args = parser.parse_args()
 
-    with open(args.in_file, 'rb') as in_file, \
-            open(args.out_file, 'wb') as out_file:
-        out_file.write(make_firmware_package(in_file.read(),
-                                             version=args.version))
+    if len(args.in_file) != len(args.out_file):
+        parser.error('give one output file for each input file')
+
+    package_firmware_files(zip(args.in_file, args.out_file),
+                           version=args.version, jobs=args.jobs)
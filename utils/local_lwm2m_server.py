@@ -0,0 +1,590 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+# Copyright 2022 Izuma Networks.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Local LwM2M server stand-in for offline end-to-end tests.
+
+Accepts the registration of Linux example clients over plain CoAP/UDP,
+runs a scripted load of GET/PUT/POST/observe requests on the resources of
+create_pdmc_resources() of each of them and reports the request latency
+percentiles and the notification throughput over all of them.
+
+Build the client with LOCAL_LWM2M_SERVER, see define.txt:
+    cmake ... -DLOCAL_LWM2M_SERVER=127.0.0.1:5683
+
+A script is a JSON list of operations, e.g.
+    [{"method": "OBSERVE", "path": "/3200/0/5501"},
+     {"method": "PUT", "path": "/3201/0/5853", "payload": "100:100"}]
+The OBSERVE operations are started once, the rest are repeated.
+
+With fleet mode, wait for all the endpoints before reporting:
+    PDMC_FLEET_SIZE=10 ./mbedCloudClientExample.elf
+    local_lwm2m_server.py -e 10
+
+--get PATH runs only blockwise GETs of PATH, e.g. to benchmark 5000/0/2
+with many parallel transfers:
+    local_lwm2m_server.py --get /5000/0/2 -p 16 -n 1000
+"""
+
+import asyncio
+import json
+import random
+import struct
+import time
+
+COAP_VERSION = 1
+
+CON, NON, ACK, RST = range(4)
+
+EMPTY = 0x00
+GET, POST, PUT, DELETE = 0x01, 0x02, 0x03, 0x04
+
+CREATED = 0x41
+DELETED = 0x42
+CHANGED = 0x44
+CONTENT = 0x45
+NOT_FOUND = 0x84
+
+OPT_OBSERVE = 6
+OPT_LOCATION_PATH = 8
+OPT_URI_PATH = 11
+OPT_CONTENT_FORMAT = 12
+OPT_URI_QUERY = 15
+OPT_BLOCK2 = 23
+
+CONTENT_FORMAT_TEXT = 0
+
+ACK_TIMEOUT = 2.0
+ACK_RANDOM_FACTOR = 1.5
+MAX_RETRANSMIT = 4
+
+METHODS = {'GET': GET, 'POST': POST, 'PUT': PUT, 'DELETE': DELETE}
+
+DEFAULT_SCRIPT = [
+    {'method': 'OBSERVE', 'path': '/3200/0/5501'},
+    {'method': 'GET', 'path': '/3200/0/5501'},
+    {'method': 'PUT', 'path': '/3200/0/5501', 'payload': '0'},
+    {'method': 'PUT', 'path': '/3201/0/5853', 'payload': '100:100:100:100'},
+    {'method': 'POST', 'path': '/3201/0/5850'},
+    {'method': 'GET', 'path': '/5000/0/2'},
+    {'method': 'GET', 'path': '/5000/0/3'},
+]
+
+
+class Message:
+    """A CoAP message, RFC 7252."""
+
+    def __init__(self, mtype=CON, code=EMPTY, mid=0, token=b'',
+                 options=None, payload=b''):
+        """Initialise the message."""
+        self.mtype = mtype
+        self.code = code
+        self.mid = mid
+        self.token = token
+        self.options = options or []
+        self.payload = payload
+
+    def option(self, number):
+        """Return the values of an option, in order."""
+        return [value for opt, value in self.options if opt == number]
+
+    @property
+    def path(self):
+        """Return the Uri-Path as a string."""
+        return '/' + '/'.join(
+            v.decode(errors='replace') for v in self.option(OPT_URI_PATH))
+
+    @property
+    def query(self):
+        """Return the Uri-Query parameters as a dict."""
+        params = {}
+        for value in self.option(OPT_URI_QUERY):
+            key, _, val = value.decode(errors='replace').partition('=')
+            params[key] = val
+        return params
+
+    @property
+    def is_request(self):
+        """Return True for requests."""
+        return 0 < self.code < 0x20
+
+    @property
+    def is_response(self):
+        """Return True for responses."""
+        return self.code >= 0x40
+
+    def encode(self):
+        """Encode the message to a datagram."""
+        data = bytearray(struct.pack(
+            '>BBH',
+            (COAP_VERSION << 6) | (self.mtype << 4) | len(self.token),
+            self.code,
+            self.mid))
+        data += self.token
+        last = 0
+        for number, value in sorted(self.options, key=lambda o: o[0]):
+            delta = number - last
+            last = number
+            d_nibble, d_ext = _option_nibble(delta)
+            l_nibble, l_ext = _option_nibble(len(value))
+            data.append((d_nibble << 4) | l_nibble)
+            data += d_ext + l_ext + value
+        if self.payload:
+            data.append(0xFF)
+            data += self.payload
+        return bytes(data)
+
+    @classmethod
+    def decode(cls, data):
+        """Decode a datagram, raises ValueError if it is malformed."""
+        if len(data) < 4:
+            raise ValueError('short message')
+        first, code, mid = struct.unpack_from('>BBH', data)
+        if first >> 6 != COAP_VERSION:
+            raise ValueError('unknown version')
+        tkl = first & 0x0F
+        pos = 4 + tkl
+        msg = cls((first >> 4) & 0x03, code, mid, bytes(data[4:pos]))
+        number = 0
+        while pos < len(data):
+            if data[pos] == 0xFF:
+                msg.payload = bytes(data[pos + 1:])
+                break
+            header = data[pos]
+            delta, pos = _option_value(header >> 4, data, pos + 1)
+            length, pos = _option_value(header & 0x0F, data, pos)
+            if pos + length > len(data):
+                raise ValueError('truncated option')
+            number += delta
+            msg.options.append((number, bytes(data[pos:pos + length])))
+            pos += length
+        return msg
+
+
+def _option_nibble(value):
+    if value < 13:
+        return value, b''
+    if value < 269:
+        return 13, struct.pack('>B', value - 13)
+    return 14, struct.pack('>H', value - 269)
+
+
+def _option_value(nibble, data, pos):
+    if nibble < 13:
+        return nibble, pos
+    if nibble == 13:
+        return data[pos] + 13, pos + 1
+    if nibble == 14:
+        return struct.unpack_from('>H', data, pos)[0] + 269, pos + 2
+    raise ValueError('reserved option nibble')
+
+
+def encode_uint(value):
+    """Encode an uint option value with the minimal number of bytes."""
+    return value.to_bytes((value.bit_length() + 7) // 8, 'big')
+
+
+def decode_uint(value):
+    """Decode an uint option value."""
+    return int.from_bytes(value, 'big')
+
+
+def percentile(samples, pct):
+    """Nearest-rank percentile of sorted samples."""
+    if not samples:
+        return 0.0
+    rank = max(1, -(-len(samples) * pct // 100))
+    return samples[int(rank) - 1]
+
+
+class Stats:
+    """Latency samples per operation and notification counters."""
+
+    def __init__(self):
+        """Initialise the class."""
+        self.latency = {}
+        self.errors = {}
+        self.notifications = 0
+        self.blocks = 0
+        self.start = None
+        self.end = None
+
+    def add(self, name, seconds, ok):
+        """Record the latency of one completed request."""
+        self.latency.setdefault(name, []).append(seconds * 1000.0)
+        if not ok:
+            self.errors[name] = self.errors.get(name, 0) + 1
+
+    def report(self):
+        """Print the latency percentiles and notification throughput."""
+        print('{:<28} {:>6} {:>6} {:>8} {:>8} {:>8} {:>8}'.format(
+            'operation', 'count', 'errors', 'p50 ms', 'p90 ms', 'p99 ms',
+            'max ms'))
+        for name, samples in self.latency.items():
+            samples.sort()
+            print('{:<28} {:>6} {:>6} {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f}'
+                  .format(name, len(samples), self.errors.get(name, 0),
+                          percentile(samples, 50), percentile(samples, 90),
+                          percentile(samples, 99), samples[-1]))
+        duration = (self.end or time.monotonic()) - (self.start or 0)
+        if self.start is not None and duration > 0:
+            print('notifications: {} in {:.2f} s, {:.1f}/s'.format(
+                self.notifications, duration,
+                self.notifications / duration))
+            print('GET blocks: {} in {:.2f} s, {:.1f}/s'.format(
+                self.blocks, duration, self.blocks / duration))
+
+
+class Endpoint:
+    """State of one registered client and the load sent to it."""
+
+    def __init__(self, server, addr, location):
+        """Initialise the class."""
+        self.server = server
+        self.addr = addr
+        self.location = location
+        self.name = '?'
+        self.registered = asyncio.Event()
+        self.done = asyncio.Event()
+        self.load = None
+
+    def send(self, msg):
+        """Send a message to the endpoint."""
+        self.server.send(msg, self.addr)
+
+    async def transmit(self, msg):
+        """Send a confirmable message with retransmissions."""
+        timeout = ACK_TIMEOUT * random.uniform(1.0, ACK_RANDOM_FACTOR)
+        for _ in range(MAX_RETRANSMIT + 1):
+            self.send(msg)
+            await asyncio.sleep(timeout)
+            timeout *= 2
+        future = self.server.pending.pop(msg.token, None)
+        if future and not future.done():
+            future.set_exception(TimeoutError('no acknowledgement'))
+
+    async def request(self, code, path, payload=b'', options=None):
+        """Send a request and wait for its response."""
+        server = self.server
+        token = server.next_token()
+        opts = [(OPT_URI_PATH, s.encode()) for s in path.strip('/').split('/')]
+        opts += options or []
+        if payload:
+            opts.append((OPT_CONTENT_FORMAT, encode_uint(CONTENT_FORMAT_TEXT)))
+        msg = Message(CON, code, server.next_mid(), token, opts, payload)
+        future = asyncio.get_running_loop().create_future()
+        server.pending[token] = future
+        key = (self.addr, msg.mid)
+        server.unacked[key] = asyncio.ensure_future(self.transmit(msg))
+        try:
+            return await asyncio.wait_for(future, 60)
+        finally:
+            retransmission = server.unacked.pop(key, None)
+            if retransmission:
+                retransmission.cancel()
+
+    async def get(self, path):
+        """GET a resource, following Block2 until the last block."""
+        stats = self.server.stats
+        num = 0
+        payload = b''
+        while True:
+            block2 = encode_uint((num << 4) | self.server.block_szx)
+            response = await self.request(GET, path,
+                                          options=[(OPT_BLOCK2, block2)])
+            payload += response.payload
+            block = response.option(OPT_BLOCK2)
+            if response.code == CONTENT:
+                stats.blocks += 1
+            if response.code != CONTENT or not block:
+                return response.code, payload
+            value = decode_uint(block[0])
+            if not value & 0x08:
+                return response.code, payload
+            num = (value >> 4) + 1
+
+    async def observe(self, path):
+        """Start observing a resource."""
+        response = await self.request(
+            GET, path, options=[(OPT_OBSERVE, encode_uint(0))])
+        if response.code != CONTENT or not response.option(OPT_OBSERVE):
+            print('Observation of {} on {} refused, code {}'.format(
+                path, self.name, code_str(response.code)))
+
+    async def run_operation(self, operation):
+        """Run and time one operation of the script."""
+        method = operation['method'].upper()
+        path = operation['path']
+        name = '{} {}'.format(method, path)
+        start = time.monotonic()
+        try:
+            if method == 'GET':
+                code, _ = await self.get(path)
+            else:
+                payload = operation.get('payload', '').encode()
+                code = (await self.request(METHODS[method], path,
+                                           payload)).code
+            ok = code < 0x80
+        except (TimeoutError, asyncio.TimeoutError, ConnectionResetError):
+            ok = False
+        self.server.stats.add(name, time.monotonic() - start, ok)
+
+    async def run_load(self):
+        """Run the script once the endpoint has registered."""
+        server = self.server
+        await self.registered.wait()
+        # Give the client time to settle after the registration.
+        await asyncio.sleep(1)
+
+        if server.stats.start is None:
+            server.stats.start = time.monotonic()
+        for operation in server.script:
+            if operation['method'].upper() == 'OBSERVE':
+                await self.observe(operation['path'])
+
+        operations = [o for o in server.script
+                      if o['method'].upper() != 'OBSERVE']
+        queue = asyncio.Queue()
+        for _ in range(server.repeat):
+            for operation in operations:
+                queue.put_nowait(operation)
+
+        async def worker():
+            while not queue.empty():
+                await self.run_operation(queue.get_nowait())
+
+        await asyncio.gather(*(worker() for _ in range(server.parallel)))
+        # Let the last notifications in.
+        await asyncio.sleep(1)
+
+    def finish(self, task=None):
+        """Mark the endpoint done when its load ends or it deregisters."""
+        if task is not None and not task.cancelled() and task.exception():
+            print('Load of {} failed: {}'.format(self.name, task.exception()))
+        self.done.set()
+        self.server.check_finished()
+
+
+class Lwm2mServer(asyncio.DatagramProtocol):
+    """Registration interface and request sender for the clients.
+
+    The clients are told apart by their address, fleet mode runs each
+    endpoint on a port of its own. Each registration gets a location of its
+    own, rd/<n>, and the load script runs against every registered endpoint.
+    """
+
+    def __init__(self, script, repeat, parallel, block_size, endpoints):
+        """Initialise the class."""
+        self.script = script
+        self.repeat = repeat
+        self.parallel = parallel
+        self.block_szx = block_size.bit_length() - 5
+        self.expected = endpoints
+        self.stats = Stats()
+        self.transport = None
+        self.mid = random.randint(0, 0xFFFF)
+        self.token = random.randint(0, 0xFFFFFFFF)
+        self.pending = {}       # token -> future of the response
+        self.unacked = {}       # (addr, mid) -> retransmission task
+        self.responses = {}     # (addr, mid) of a client request -> response
+        self.endpoints = {}     # addr -> Endpoint
+        self.locations = {}     # registration location -> Endpoint
+        self.finished = asyncio.Event()
+
+    def next_mid(self):
+        """Return the next message id."""
+        self.mid = (self.mid + 1) & 0xFFFF
+        return self.mid
+
+    def next_token(self):
+        """Return a new token."""
+        self.token = (self.token + 1) & 0xFFFFFFFF
+        return struct.pack('>I', self.token)
+
+    def connection_made(self, transport):
+        """Keep the transport."""
+        self.transport = transport
+
+    def send(self, msg, addr):
+        """Send a message to a client."""
+        self.transport.sendto(msg.encode(), addr)
+
+    def check_finished(self):
+        """Finish once the expected endpoints have registered and are done."""
+        if (len(self.locations) >= self.expected and
+                all(e.done.is_set() for e in self.locations.values())):
+            self.finished.set()
+
+    def datagram_received(self, data, addr):
+        """Dispatch a datagram from a client."""
+        try:
+            msg = Message.decode(data)
+        except (ValueError, struct.error) as error:
+            print('Dropping malformed message: {}'.format(error))
+            return
+
+        if msg.mtype in (ACK, RST):
+            retransmission = self.unacked.pop((addr, msg.mid), None)
+            if retransmission:
+                retransmission.cancel()
+            if msg.mtype == RST:
+                future = self.pending.pop(msg.token, None)
+                if future and not future.done():
+                    future.set_exception(ConnectionResetError('reset'))
+                return
+        elif msg.mtype == CON and msg.code == EMPTY:
+            # CoAP ping
+            self.send(Message(RST, EMPTY, msg.mid), addr)
+            return
+
+        if msg.is_request:
+            self.handle_request(msg, addr)
+        elif msg.is_response:
+            if msg.mtype == CON:
+                self.send(Message(ACK, EMPTY, msg.mid), addr)
+            self.handle_response(msg)
+
+    def respond(self, request, addr, code, options=None, payload=b''):
+        """Send a response, piggybacked if the request was confirmable."""
+        mtype = ACK if request.mtype == CON else NON
+        mid = request.mid if request.mtype == CON else self.next_mid()
+        response = Message(mtype, code, mid, request.token, options, payload)
+        if len(self.responses) >= 64 * max(1, len(self.endpoints)):
+            self.responses.pop(next(iter(self.responses)))
+        self.responses[(addr, request.mid)] = response
+        self.send(response, addr)
+
+    def register(self, msg, addr):
+        """Create or renew the endpoint registered from an address."""
+        endpoint = self.endpoints.get(addr)
+        if endpoint is None:
+            location = 'rd/{}'.format(len(self.locations))
+            endpoint = Endpoint(self, addr, location)
+            self.endpoints[addr] = endpoint
+            self.locations[location] = endpoint
+        endpoint.name = msg.query.get('ep', '?')
+        print('Registered {} from {}:{} at {}, lifetime {} s'.format(
+            endpoint.name, addr[0], addr[1], endpoint.location,
+            msg.query.get('lt', '-')))
+        if len(self.locations) == 1:
+            print('Resources: {}'.format(msg.payload.decode(errors='replace')))
+        self.respond(msg, addr, CREATED,
+                     [(OPT_LOCATION_PATH, s.encode())
+                      for s in endpoint.location.split('/')])
+        if endpoint.load is None and not endpoint.done.is_set():
+            endpoint.load = asyncio.ensure_future(endpoint.run_load())
+            endpoint.load.add_done_callback(endpoint.finish)
+        endpoint.registered.set()
+
+    def handle_request(self, msg, addr):
+        """Serve the registration interface."""
+        if (addr, msg.mid) in self.responses:
+            # Duplicate of a confirmable request, resend the same response.
+            self.send(self.responses[(addr, msg.mid)], addr)
+            return
+        segments = msg.option(OPT_URI_PATH)
+        location = '/'.join(s.decode(errors='replace') for s in segments)
+        endpoint = self.locations.get(location)
+        if msg.code == POST and segments == [b'rd']:
+            self.register(msg, addr)
+        elif msg.code == POST and endpoint is not None:
+            self.respond(msg, addr, CHANGED)
+        elif msg.code == DELETE and endpoint is not None:
+            print('Client {} deregistered'.format(endpoint.name))
+            self.respond(msg, addr, DELETED)
+            if endpoint.load is not None:
+                endpoint.load.cancel()
+            else:
+                endpoint.finish()
+        else:
+            if segments[:1] == [b'bs']:
+                print('Bootstrap is not emulated, build with LOCAL_LWM2M_SERVER')
+            self.respond(msg, addr, NOT_FOUND)
+
+    def handle_response(self, msg):
+        """Complete a pending request, or count a notification."""
+        future = self.pending.get(msg.token)
+        if future is not None and not future.done():
+            future.set_result(msg)
+            if not msg.option(OPT_OBSERVE):
+                del self.pending[msg.token]
+        elif msg.option(OPT_OBSERVE):
+            self.stats.notifications += 1
+
+
+def code_str(code):
+    """Format a CoAP code as c.dd."""
+    return '{}.{:02d}'.format(code >> 5, code & 0x1F)
+
+
+async def serve(args, script):
+    """Serve until the load has run on, or deregistered, every endpoint."""
+    loop = asyncio.get_running_loop()
+    transport, server = await loop.create_datagram_endpoint(
+        lambda: Lwm2mServer(script, args.repeat, args.parallel,
+                            args.block_size, args.endpoints),
+        local_addr=(args.host, args.port))
+    print('Listening on coap://{}:{}'.format(args.host, args.port))
+    try:
+        await server.finished.wait()
+    finally:
+        server.stats.end = time.monotonic()
+        for endpoint in server.locations.values():
+            if endpoint.load is not None:
+                endpoint.load.cancel()
+        print('endpoints: {}'.format(len(server.locations)))
+        server.stats.report()
+        transport.close()
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description='Local LwM2M server for offline load tests')
+    parser.add_argument('--host', default='127.0.0.1',
+                        help='Address to listen on. Default: 127.0.0.1')
+    parser.add_argument('--port', type=int, default=5683,
+                        help='UDP port to listen on. Default: 5683')
+    parser.add_argument('-s', '--script',
+                        help='JSON file with the operations to run. '
+                             'Default: the resources of pdmc_example.cpp')
+    parser.add_argument('-g', '--get', metavar='PATH',
+                        help='Only GET the resource, instead of a script')
+    parser.add_argument('-n', '--repeat', type=int, default=100,
+                        help='Number of runs of the script. Default: 100')
+    parser.add_argument('-p', '--parallel', type=int, default=1,
+                        help='Outstanding requests. Default: 1 (NSTART)')
+    parser.add_argument('-e', '--endpoints', type=int, default=1,
+                        help='Endpoints to wait for, e.g. the PDMC_FLEET '
+                             'size. Default: 1')
+    parser.add_argument('-b', '--block-size', type=int, default=512,
+                        choices=[16, 32, 64, 128, 256, 512, 1024],
+                        help='Block2 size for GET. Default: 512')
+
+    args = parser.parse_args()
+
+    script = DEFAULT_SCRIPT
+    if args.get:
+        script = [{'method': 'GET', 'path': args.get}]
+    elif args.script:
+        with open(args.script) as script_file:
+            script = json.load(script_file)
+
+    try:
+        asyncio.run(serve(args, script))
+    except KeyboardInterrupt:
+        pass
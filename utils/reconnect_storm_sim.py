@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+# Copyright 2022 Izuma Networks.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Simulate a fleet reconnecting after a service outage.
+
+Compares the old doubling wait with the backoff of
+source/reconnect_policy.cpp (cap, full jitter, failure count kept over
+reboots). All devices lose the service at the same moment. While the
+outage lasts every attempt fails, afterwards the service accepts at most
+--capacity connections per second and rejects the rest.
+"""
+
+import heapq
+import random
+
+BASE_S = 5.0
+REBOOT_THRESHOLD = 9        # MAX_PDMC_CLIENT_CONNECTION_ERROR_COUNT
+REBOOT_S = 30.0
+
+
+def doubling_wait(failures, _cap, _rng):
+    """Wait of the old connect loop, restarts from the base after reboot."""
+    return BASE_S * 2 ** (failures - 1)
+
+
+def jittered_wait(failures, cap, rng):
+    """Wait of reconnect_policy_failure()."""
+    return rng.uniform(0, min(cap, BASE_S * 2 ** (failures - 1)))
+
+
+def simulate(devices, outage, capacity, policy, cap, persist, seed):
+    """Return the attempt times, and the time when all devices are back."""
+    rng = random.Random(seed)
+    # (time of the next attempt, device), failures since boot and in total
+    queue = [(0.0, device) for device in range(devices)]
+    session = [0] * devices
+    total = [0] * devices
+    attempts = []
+    accepted = {}
+    done = 0.0
+
+    while queue:
+        now, device = heapq.heappop(queue)
+        attempts.append(now)
+        second = int(now)
+        if now >= outage and accepted.get(second, 0) < capacity:
+            accepted[second] = accepted.get(second, 0) + 1
+            done = max(done, now)
+            continue
+
+        session[device] += 1
+        total[device] += 1
+        failures = total[device] if persist else session[device]
+        wait = policy(failures, cap, rng)
+        if session[device] >= REBOOT_THRESHOLD:
+            session[device] = 0
+            if not persist:
+                total[device] = 0
+            wait += REBOOT_S
+        heapq.heappush(queue, (now + wait, device))
+
+    return attempts, done
+
+
+def report(name, attempts, done, outage, bucket, rows):
+    """Print attempts per bucket after the outage and the recovery time."""
+    per_second = {}
+    buckets = {}
+    for t in attempts:
+        if t >= outage:
+            per_second[int(t)] = per_second.get(int(t), 0) + 1
+            index = int((t - outage) // bucket)
+            buckets[index] = buckets.get(index, 0) + 1
+    print('{}: {} attempts, peak {}/s, all connected {:.0f} s after the '
+          'outage'.format(name, len(attempts),
+                          max(per_second.values(), default=0),
+                          done - outage))
+    # Only the busy buckets, the doubling waits leave long gaps.
+    peak = max(buckets.values(), default=0)
+    for index in sorted(buckets)[:rows]:
+        count = buckets[index]
+        print('  {:>6.0f} s {:>7} {}'.format(index * bucket, count,
+                                             '#' * (50 * count // peak)))
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description='Simulate the reconnect storm of a fleet')
+    parser.add_argument('-n', '--devices', type=int, default=10000,
+                        help='Number of devices. Default: 10000')
+    parser.add_argument('-o', '--outage', type=float, default=600,
+                        help='Outage length in seconds. Default: 600')
+    parser.add_argument('-c', '--capacity', type=int, default=200,
+                        help='Accepted connections per second. Default: 200')
+    parser.add_argument('--cap', type=float, default=1280,
+                        help='Backoff cap in seconds. Default: 1280')
+    parser.add_argument('-b', '--bucket', type=float, default=30,
+                        help='Histogram bucket in seconds. Default: 30')
+    parser.add_argument('-r', '--rows', type=int, default=20,
+                        help='Histogram rows to print. Default: 20')
+    parser.add_argument('-s', '--seed', type=int, default=1,
+                        help='Random seed. Default: 1')
+
+    args = parser.parse_args()
+
+    for name, policy, persist in (('doubling', doubling_wait, False),
+                                  ('jittered', jittered_wait, True)):
+        attempts, done = simulate(args.devices, args.outage, args.capacity,
+                                  policy, args.cap, persist, args.seed)
+        report(name, attempts, done, args.outage, args.bucket,
+               args.rows)
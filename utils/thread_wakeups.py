@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+# Copyright 2022 Izuma Networks.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Count the wakeups of each thread of a running Linux client.
+
+Every time a sleeping thread is woken up, the kernel counts a voluntary
+context switch for it in /proc/<pid>/task/<tid>/status. The counters are
+sampled at the start and end of the measurement, and the difference is
+reported per thread as wakeups per second.
+
+Run it against an idle, registered client. The main thread blocks in
+mcc_platform_wait_event() until the client unregisters, so it should show
+no wakeups.
+"""
+
+import argparse
+import os
+import sys
+import time
+
+
+def read_threads(pid):
+    """Name and voluntary context switches of every thread of the process."""
+    threads = {}
+    task_dir = '/proc/%d/task' % pid
+    for tid in os.listdir(task_dir):
+        name = '?'
+        switches = None
+        try:
+            with open(os.path.join(task_dir, tid, 'status')) as status:
+                for line in status:
+                    if line.startswith('Name:'):
+                        name = line.split(None, 1)[1].strip()
+                    elif line.startswith('voluntary_ctxt_switches:'):
+                        switches = int(line.split()[1])
+        except OSError:
+            # The thread exited while reading.
+            continue
+        if switches is not None:
+            threads[int(tid)] = (name, switches)
+    return threads
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('pid', type=int, help='process id of the client')
+    parser.add_argument('--seconds', type=float, default=10.0,
+                        help='length of the measurement (default: %(default)s)')
+    args = parser.parse_args()
+
+    try:
+        before = read_threads(args.pid)
+        time.sleep(args.seconds)
+        after = read_threads(args.pid)
+    except OSError as error:
+        print('Cannot read the threads of %d: %s' % (args.pid, error))
+        return 1
+
+    print('%-8s %-16s %10s %12s' % ('tid', 'name', 'wakeups', 'wakeups/s'))
+    for tid in sorted(after):
+        name, switches = after[tid]
+        wakeups = switches - before.get(tid, (name, 0))[1]
+        main_thread = ' (main)' if tid == args.pid else ''
+        print('%-8d %-16s %10d %12.1f%s' % (tid, name, wakeups,
+                                            wakeups / args.seconds, main_thread))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())